@@ -0,0 +1,60 @@
+#ifndef ALERTS_H
+#define ALERTS_H ALERTS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#define ALERT_RULES_MAX 8
+
+enum alert_metric {
+    ALERT_METRIC_CO2 = 1,         /* ppm */
+    ALERT_METRIC_TEMPERATURE = 2, /* decidegree celsius */
+    ALERT_METRIC_HUMIDITY = 3,    /* permille */
+    ALERT_METRIC_BATTERY = 4      /* percent */
+};
+
+enum alert_direction {
+    ALERT_ABOVE = 0,
+    ALERT_BELOW = 1
+};
+
+struct alert_rule {
+    uint8_t metric;
+    uint8_t direction;
+    int32_t threshold;
+    /* distance back from the threshold before the alert is cleared */
+    int32_t hysteresis;
+    /* how long the condition has to hold before the state changes */
+    uint32_t min_duration_ms;
+
+    bool active;
+    bool pending;
+    uint32_t pending_since_ms;
+};
+
+/* called once per state change, active is true when the alert was raised */
+typedef void (*alert_callback)(const struct alert_rule *rule, int32_t value, bool active);
+
+void alerts_clear(void);
+
+bool alerts_add_rule(uint8_t metric, uint8_t direction, int32_t threshold, int32_t hysteresis, uint32_t min_duration_ms);
+
+uint8_t alerts_rule_count(void);
+
+const struct alert_rule *alerts_get_rule(uint8_t index);
+
+void alerts_evaluate(uint8_t metric, int32_t value, uint32_t now_ms, alert_callback callback);
+
+const char *alerts_metric_name(uint8_t metric);
+
+int alerts_metric_from_name(const char *name);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* ALERTS_H */
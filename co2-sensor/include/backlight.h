@@ -0,0 +1,59 @@
+#ifndef BACKLIGHT_H
+#define BACKLIGHT_H BACKLIGHT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+enum backlight_state {
+    BACKLIGHT_ON = 0,
+    BACKLIGHT_DIMMED = 1,
+    BACKLIGHT_ASLEEP = 2
+};
+
+#define BACKLIGHT_STATES 3
+
+struct backlight_config {
+    /* without a touch or an alert, 0 turns the step off */
+    uint32_t dim_after_ms;
+    uint32_t sleep_after_ms;
+    /* with power from USB the panel only dims */
+    bool sleep_on_ac;
+    /* brightness in %, from day_hour and from night_hour on */
+    uint8_t day_level;
+    uint8_t night_level;
+    uint8_t dimmed_level;
+    uint8_t day_hour;
+    uint8_t night_hour;
+};
+
+void backlight_reset(uint32_t now_ms);
+
+/* false if a level is above 100 or an hour above 23 */
+bool backlight_configure(const struct backlight_config *config);
+
+const struct backlight_config *backlight_get_config(void);
+
+/* a touch or an alert, wakes the panel and restarts the timeouts */
+void backlight_activity(uint32_t now_ms);
+
+/* sleeps right away, until the next activity */
+void backlight_sleep(uint32_t now_ms);
+
+/* runs the timeouts, returns the state the panel should be in */
+enum backlight_state backlight_update(uint32_t now_ms, uint8_t hour, bool ac);
+
+/* brightness in % of the current state, 0 while asleep */
+uint8_t backlight_level(void);
+
+/* total seconds spent in a state, including the current one */
+uint32_t backlight_time(enum backlight_state state, uint32_t now_ms);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* BACKLIGHT_H */
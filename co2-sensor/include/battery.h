@@ -0,0 +1,71 @@
+#ifndef BATTERY_H
+#define BATTERY_H BATTERY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* register blocks of the AXP192 read together once per second */
+#define BATTERY_AXP192_POWER_REG 0x00
+#define BATTERY_AXP192_POWER_LEN 2
+#define BATTERY_AXP192_ADC_REG 0x78
+#define BATTERY_AXP192_ADC_LEN 6
+#define BATTERY_AXP192_COULOMB_REG 0xb0
+#define BATTERY_AXP192_COULOMB_LEN 8
+
+/* a sample older than this is stale, the model and the consumers skip it */
+#define BATTERY_SAMPLE_MAX_AGE_MS 3000
+
+#define BATTERY_CAPACITY_MIN_MAH 100
+#define BATTERY_CAPACITY_MAX_MAH 5000
+
+struct battery_sample {
+    uint32_t time_ms;
+    /* V at the terminals */
+    float voltage;
+    /* mA, positive while charging */
+    float current;
+    /* charged minus discharged, the counter only moves by differences */
+    float coulomb_mah;
+    bool ac;
+    bool charging;
+};
+
+/* decodes the three register blocks, see BATTERY_AXP192_*_REG */
+void battery_axp192_sample(struct battery_sample *sample, const uint8_t *power, const uint8_t *adc,
+                           const uint8_t *coulomb, uint32_t now_ms);
+
+/* forgets the charge state, the next sample starts again from the voltage */
+void battery_reset(float capacity_mah);
+
+/*
+ * Coulomb counting between samples, pulled towards the state of charge of the
+ * open circuit voltage: hard at the end of charge and at the cutoff, gently
+ * otherwise. The counted charge between two such reference points learns the
+ * capacity.
+ */
+void battery_update(const struct battery_sample *sample);
+
+/* last sample, NULL before the first one or if it is older than BATTERY_SAMPLE_MAX_AGE_MS */
+const struct battery_sample *battery_last_sample(uint32_t now_ms);
+
+/* 0..1 */
+float battery_soc(void);
+
+int battery_percent(void);
+
+float battery_capacity(void);
+
+float battery_remaining(void);
+
+/* state of charge of a battery at rest, 0..1 */
+float battery_ocv_soc(float voltage);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* BATTERY_H */
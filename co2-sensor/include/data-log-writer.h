@@ -0,0 +1,104 @@
+#ifndef DATA_LOG_WRITER_H
+#define DATA_LOG_WRITER_H DATA_LOG_WRITER_H
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include <FS.h>
+#include <data-log.h>
+#include <data-retention.h>
+#include <sd-volume.h>
+
+// a rollup reads one log while it appends to another
+#define DATA_LOG_WRITER_STACK 6144
+// on the core without the loop task, below the WiFi tasks
+#define DATA_LOG_WRITER_PRIORITY 1
+#define DATA_LOG_WRITER_CORE 0
+// records kept while the card is out: a day with one record every 2 s in PSRAM, else a few minutes
+#define DATA_LOG_BACKLOG 43200
+#define DATA_LOG_BACKLOG_INTERNAL 256
+#define DATA_LOG_WRITE_BATCH 64
+// a missing card is looked for at this interval
+#define DATA_LOG_MOUNT_RETRY_MS 5000
+#define DATA_LOG_IDLE_MS 1000
+// trace bytes queued for the card, two flushes of the trace buffer
+#define DATA_LOG_TRACE_BUFFER 4096
+
+/*
+ * Writes the data log in a task of its own, so the frame loop never waits for
+ * the card. Records are queued in a ring the task drains in batches. A failed
+ * write unmounts the card, the task mounts it again once it is back and
+ * writes what was queued meanwhile. A full ring drops the newest records.
+ * While nothing is queued the task compacts the log to its retention windows
+ * every hour.
+ *
+ * The task is the only one which mounts the card and writes to it, the trace
+ * is queued for it as well. Other tasks reading the card hold lock() while
+ * they do, the task holds it for each of its steps.
+ */
+class DataLogWriter
+{
+public:
+    DataLogWriter(DataLog &log, RemovableVolume &volume, DataRetention *retention = NULL, fs::FS *traceFs = NULL,
+                  const char *tracePath = NULL);
+    // only on a computer, the task never ends on the device
+    ~DataLogWriter();
+
+    // mounts the volume if it is there and starts the task, false without memory for the ring
+    bool begin();
+
+    // from the loop task, never blocks
+    bool submit(const struct dataRecord *record);
+
+    bool mounted() const;
+    uint32_t pending() const;
+    uint32_t dropped() const;
+
+    // from the loop task, waits for the step of the task: drops what is queued of the last trace and removes its file
+    bool restartTrace();
+
+    // from the loop task, never blocks; false if it does not fit or a write of the trace failed since its restart
+    bool submitTrace(const uint8_t *data, size_t len);
+
+    // the card for a reader, false if the task did not finish its step within wait
+    bool lock(TickType_t wait = portMAX_DELAY);
+    void unlock();
+
+    // a step of the task, returns the ms until the next one; runs without the task on a computer
+    uint32_t run(uint32_t nowMs);
+
+private:
+    static void task(void *arg);
+
+    uint32_t step(uint32_t nowMs);
+    bool mount(uint32_t nowMs);
+    void unmount(uint32_t nowMs);
+    void writeTrace();
+
+    DataLog &log;
+    RemovableVolume &volume;
+    DataRetention *retention;
+    struct dataRecord *ring;
+    uint32_t capacity;
+    // head is written by submit(), tail by the task
+    uint32_t head;
+    uint32_t tail;
+    uint32_t droppedCount;
+    volatile bool isMounted;
+    uint32_t nextMountMs;
+    // the windows are counted back from the last record written
+    uint32_t newestTime;
+    uint32_t nextCompactMs;
+    TaskHandle_t handle;
+    SemaphoreHandle_t mutex;
+    fs::FS *traceFs;
+    const char *tracePath;
+    uint8_t *traceRing;
+    // like head and tail, in bytes
+    uint32_t traceHead;
+    uint32_t traceTail;
+    volatile bool traceFailed;
+};
+
+#endif /* DATA_LOG_WRITER_H */
@@ -0,0 +1,157 @@
+#ifndef DATA_LOG_H
+#define DATA_LOG_H DATA_LOG_H
+
+#include <FS.h>
+
+#include <gorilla.h>
+
+// unless the log is given another period, a block holds the records of one hour, longer ones are split
+#define DATA_LOG_INDEX_PERIOD 3600
+// unless the log is given another length, a segment holds the records of one day
+#define DATA_LOG_SEGMENT 86400
+#define DATA_LOG_BLOCK_MAX 16384
+#define DATA_LOG_MAGIC "CO2L"
+#define DATA_LOG_MAGIC_LEN 4
+// co2, temperature, humidity and battery charge
+#define DATA_LOG_FIELDS 4
+#define DATA_LOG_LINE_MAX 96
+// records are encoded into this many bytes before they are written
+#define DATA_LOG_WRITE_BUFFER 512
+#define DATA_LOG_PATH_MAX 32
+// logs a DataLogQuery reads one after the other
+#define DATA_LOG_QUERY_LOGS 3
+
+struct dataRecord
+{
+    uint32_t time;
+    int32_t co2Ppm;
+    // in tenths
+    int32_t temperature;
+    int32_t humidity;
+    float batteryMah;
+};
+
+// index file entry, the period of the log a block starts in and its offset
+struct dataIndexEntry
+{
+    uint32_t slot;
+    uint32_t offset;
+};
+
+/*
+ * The measurements in blocks of gorilla.h records with a sparse index next to
+ * them: the index file holds the offset of every block, so a query seeks to
+ * its start with a binary search and only decodes the blocks of its range.
+ * Each record is appended as soon as it is encoded, a restart begins a new
+ * block.
+ *
+ * The log is split into segments of a whole number of days, each with a data
+ * and an index file named after its first day: log-20240115.bin and
+ * log-20240115.idx for log.bin and log.idx. log.seg lists the segments in
+ * order. Old records are dropped by removing whole segments, nothing is
+ * rewritten but the list, which is replaced by renaming a new one. A log of
+ * older firmware in log.bin becomes the last segment.
+ */
+class DataLog
+{
+public:
+    DataLog(fs::FS &fs, const char *dataPath, const char *indexPath, uint32_t period = DATA_LOG_INDEX_PERIOD,
+            uint32_t segment = DATA_LOG_SEGMENT);
+
+    // false if the file system is not usable
+    bool begin();
+
+    // time of the last record, false for an empty log
+    bool newest(uint32_t *time);
+
+    // start of the segment time falls into
+    uint32_t segmentStart(uint32_t time) const;
+
+    // removes the segments which end before time, false while it is queried
+    bool dropBefore(uint32_t time);
+
+    // appends the records with one open of the file per segment, returns how many were written
+    size_t append(const struct dataRecord *records, size_t count);
+
+    // a CSV line with the local time, as data.txt had them
+    static int format(char *line, size_t len, const struct dataRecord *record);
+
+    static const char *header();
+
+private:
+    friend class DataLogQuery;
+
+    bool readSegments();
+    bool addSegment(uint32_t segment);
+    bool replaceSegments(File &segments);
+    bool openSegment(uint32_t segment, File *file);
+    bool startBlock(uint32_t slot, uint32_t offset);
+    void path(char *out, const char *path, const char *suffix) const;
+    void segmentPath(char *out, const char *path, uint32_t segment) const;
+
+    fs::FS &fs;
+    const char *dataPath;
+    const char *indexPath;
+    uint32_t period;
+    uint32_t segmentLen;
+    bool hasSegments;
+    uint32_t lastSegment;
+    uint32_t lastSlot;
+    bool blockStarted;
+    uint32_t blockLen;
+    struct gorilla_state encoder;
+    // queries reading the files, which must not be removed meanwhile
+    uint8_t readers;
+};
+
+// the records of [from, to) in the order they were logged
+class DataLogQuery
+{
+public:
+    DataLogQuery(DataLog &log, uint32_t from, uint32_t to);
+
+    // the logs one after the other, the one with the oldest records first
+    DataLogQuery(DataLog *const *logs, uint8_t count, uint32_t from, uint32_t to);
+    ~DataLogQuery();
+
+    bool next(struct dataRecord *record);
+
+    // the records as CSV lines, the header line first, 0 at the end
+    size_t read(uint8_t *buffer, size_t len);
+
+    // blocks decoded and records in them, including the ones outside of the range
+    uint32_t blocks() const;
+    uint32_t scanned() const;
+
+private:
+    bool seek();
+    bool openSegment();
+    bool loadBlock();
+    void close();
+
+    DataLog *logs[DATA_LOG_QUERY_LOGS];
+    uint8_t logCount;
+    uint8_t current;
+    bool reading;
+    uint32_t from;
+    uint32_t to;
+    // the list of segments, the next one in it and the files of the current one
+    File segments;
+    uint32_t segment;
+    File index;
+    File file;
+    uint32_t block;
+    uint32_t blockCount;
+    uint32_t records;
+    bool started;
+    bool done;
+    uint8_t *blockData;
+    struct gorilla_decoder decoder;
+    char line[DATA_LOG_LINE_MAX];
+    // a line read() could not fit into the caller's buffer yet
+    uint8_t pendingLen;
+    uint8_t pendingPos;
+    bool headerSent;
+};
+
+#endif /* DATA_LOG_H */
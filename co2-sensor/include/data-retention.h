@@ -0,0 +1,65 @@
+#ifndef DATA_RETENTION_H
+#define DATA_RETENTION_H DATA_RETENTION_H
+
+#include <data-log.h>
+
+#define DATA_RETENTION_RAW_DAYS 30
+#define DATA_RETENTION_MINUTE_DAYS 365
+#define DATA_RETENTION_HOUR_DAYS 3650
+// the seconds of a day fit into the uint32_t times for a century
+#define DATA_RETENTION_DAYS_MAX 36500
+#define DATA_RETENTION_MINUTE 60
+#define DATA_RETENTION_HOUR 3600
+// the hour log is indexed by day, a block of hours would hold a single record
+#define DATA_RETENTION_HOUR_BLOCK 86400
+// segments of the minute and hour logs, the raw log has one a day
+#define DATA_RETENTION_MINUTE_SEGMENT (30 * 86400)
+#define DATA_RETENTION_HOUR_SEGMENT (365 * 86400)
+#define DATA_RETENTION_LOGS 3
+// aggregates appended with one open of the file
+#define DATA_RETENTION_BATCH 32
+#define DATA_RETENTION_INTERVAL_MS 3600000
+
+/*
+ * Keeps the data log within the configured windows: records older than the
+ * raw window are rolled up into the means of each minute, minutes older than
+ * the minute window into the means of each hour, hours older than the hour
+ * window are dropped, a whole segment at a time. The aggregates are appended
+ * before the segments they come from are removed, an interrupted rollup skips what the target already has.
+ * The logs do not overlap, so a query reads them one after the other.
+ */
+class DataRetention
+{
+public:
+    DataRetention(DataLog &raw, DataLog &minutes, DataLog &hours);
+
+    // the minute and hour logs, the raw one is begun by its writer
+    bool begin();
+
+    // false unless 1 <= raw days <= minute days <= hour days <= DATA_RETENTION_DAYS_MAX
+    bool configure(uint16_t rawDays, uint16_t minuteDays, uint16_t hourDays);
+
+    uint16_t rawDays() const;
+    uint16_t minuteDays() const;
+    uint16_t hourDays() const;
+
+    // rolls up and drops what is older than the windows before now, false if a step failed
+    bool compact(uint32_t now);
+
+    // hours, minutes and raw records, for a DataLogQuery over the whole history
+    DataLog *const *logs() const;
+
+private:
+    bool rollup(DataLog &source, DataLog &target, uint32_t period, uint32_t before);
+
+    DataLog &raw;
+    DataLog &minutes;
+    DataLog &hours;
+    DataLog *tiers[DATA_RETENTION_LOGS];
+    // set by the loop task, read by the writer
+    volatile uint16_t rawWindow;
+    volatile uint16_t minuteWindow;
+    volatile uint16_t hourWindow;
+};
+
+#endif /* DATA_RETENTION_H */
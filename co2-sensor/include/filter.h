@@ -0,0 +1,59 @@
+#ifndef FILTER_H
+#define FILTER_H FILTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* co2, temperature and humidity, numbered as the alert metrics and measurement types */
+#define FILTER_METRICS 3
+#define FILTER_MEDIAN_MAX 9
+
+enum filter_smoothing {
+    FILTER_SMOOTHING_NONE = 0,
+    FILTER_SMOOTHING_EMA = 1,
+    FILTER_SMOOTHING_KALMAN = 2
+};
+
+/*
+ * Stages run in order median, smoothing, rate limit. Each one keeps a fixed
+ * state and costs O(1) per sample (the median O(window) with window <= 9).
+ */
+struct filter_config {
+    /* samples of the median despiking, 1 turns it off */
+    uint8_t median;
+    uint8_t smoothing;
+    /* weight of a new sample, 0..1 */
+    float alpha;
+    /* Kalman variances in the unit of the metric squared, per sample */
+    float process_noise;
+    float measurement_noise;
+    /* largest change per second, 0 turns it off */
+    int32_t max_rate;
+};
+
+void filter_reset(void);
+
+/* false if the metric or a parameter is invalid, resets the state of the metric */
+bool filter_configure(uint8_t metric, const struct filter_config *config);
+
+const struct filter_config *filter_get_config(uint8_t metric);
+
+/* runs a raw sample through the pipeline of the metric and returns the filtered value */
+int32_t filter_process(uint8_t metric, int32_t raw, uint32_t now_ms);
+
+/* last raw sample, false before the first one */
+bool filter_raw(uint8_t metric, int32_t *value);
+
+const char *filter_smoothing_name(uint8_t smoothing);
+
+int filter_smoothing_from_name(const char *name);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* FILTER_H */
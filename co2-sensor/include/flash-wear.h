@@ -0,0 +1,27 @@
+#ifndef FLASH_WEAR_H
+#define FLASH_WEAR_H FLASH_WEAR_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * Bytes erased and written on the data partition since the start, by SPIFFS
+ * or LittleFS. Both go through esp_partition_erase_range() and
+ * esp_partition_write(), which are wrapped by the linker (-Wl,--wrap in
+ * platformio.ini). A sector of the flash lasts about 100000 erases.
+ */
+struct flash_wear {
+    uint32_t erased_bytes;
+    uint32_t written_bytes;
+};
+
+void flash_wear_read(struct flash_wear *wear);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* FLASH_WEAR_H */
@@ -0,0 +1,71 @@
+#ifndef GLYPH_ATLAS_H
+#define GLYPH_ATLAS_H GLYPH_ATLAS_H
+
+#include <M5Core2.h>
+
+#define GLYPH_ATLAS_COLORS_MAX 5
+#define GLYPH_FIELD_LEN 32
+
+/*
+ * The characters of a monospaced font rendered once into 16 bit tiles, one set
+ * per color. Drawing a character copies its tile to the display instead of
+ * rasterizing the glyph again. The tiles live in PSRAM if there is some.
+ */
+class GlyphAtlas
+{
+public:
+    GlyphAtlas(const GFXfont *font, uint8_t size, const char *charset, uint16_t background = BLACK);
+    ~GlyphAtlas();
+
+    // renders the charset in each color, false without memory for the tiles
+    bool begin(const uint16_t *colors, uint8_t colorsLen);
+    bool ready() const;
+
+    uint16_t width() const;
+    uint16_t height() const;
+    uint16_t background() const;
+
+    // NULL for characters or colors which were not rendered
+    const uint16_t *tile(char c, uint16_t color) const;
+
+private:
+    const GFXfont *font;
+    uint8_t size;
+    const char *charset;
+    uint16_t backgroundColor;
+    uint16_t colors[GLYPH_ATLAS_COLORS_MAX];
+    uint8_t colorsLen;
+    uint16_t tileWidth;
+    uint16_t tileHeight;
+    // colorsLen sets of strlen(charset) tiles
+    uint16_t *tiles;
+};
+
+// a line of text at a fixed place, a draw only copies the characters that changed
+class GlyphField
+{
+public:
+    // datum is TL_DATUM, TC_DATUM or TR_DATUM
+    GlyphField(GlyphAtlas &atlas, int16_t x, int16_t y, uint8_t datum);
+
+    // returns the number of tiles copied
+    uint8_t draw(TFT_eSPI &display, const char *text, uint16_t color);
+
+    // the next draw starts from an empty background, after the screen was cleared
+    void invalidate();
+
+private:
+    void clear(TFT_eSPI &display, int16_t from, int16_t to);
+
+    GlyphAtlas &atlas;
+    int16_t x;
+    int16_t y;
+    uint8_t datum;
+    char shown[GLYPH_FIELD_LEN + 1];
+    uint8_t shownLen;
+    int16_t shownX;
+    uint16_t shownColor;
+    bool valid;
+};
+
+#endif /* GLYPH_ATLAS_H */
@@ -0,0 +1,63 @@
+#ifndef GORILLA_H
+#define GORILLA_H GORILLA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * Time series codec after Facebook's Gorilla, byte aligned so a record can be
+ * appended to a file as soon as it is encoded. Each record is the
+ * delta-of-delta of its time and the delta of each value to the one before,
+ * zigzag varints. A regular interval and slowly changing values take one
+ * byte per field. The first record of a block holds the absolute values.
+ */
+
+#define GORILLA_FIELDS_MAX 4
+/* time and GORILLA_FIELDS_MAX values of 5 bytes at most */
+#define GORILLA_RECORD_MAX (5 * (1 + GORILLA_FIELDS_MAX))
+
+struct gorilla_state {
+    uint8_t fields;
+    bool started;
+    uint32_t time;
+    int32_t delta;
+    int32_t values[GORILLA_FIELDS_MAX];
+};
+
+struct gorilla_decoder {
+    struct gorilla_state state;
+    const uint8_t *data;
+    size_t len;
+    size_t pos;
+};
+
+/* starts a block with fields values per record */
+void gorilla_encoder_init(struct gorilla_state *encoder, uint8_t fields);
+
+/* encodes the next record of the block into out, returns its length */
+uint8_t gorilla_encode(struct gorilla_state *encoder, uint32_t time, const int32_t *values, uint8_t *out);
+
+void gorilla_decoder_init(struct gorilla_decoder *decoder, uint8_t fields, const uint8_t *data, size_t len);
+
+/* the next record of the block, false at its end or at a record cut off by a reset while writing */
+bool gorilla_decode(struct gorilla_decoder *decoder, uint32_t *time, int32_t *values);
+
+/*
+ * Decodes a whole block into columns, values[field * capacity + record]. The
+ * varints are unpacked first, the deltas are summed up in separate loops
+ * without branches, which a compiler can vectorize on a computer. Returns the
+ * number of records.
+ */
+size_t gorilla_decode_block(const uint8_t *data, size_t len, uint8_t fields, uint32_t *times, int32_t *values,
+                            size_t capacity);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* GORILLA_H */
@@ -0,0 +1,89 @@
+#ifndef HEALTH_H
+#define HEALTH_H HEALTH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#define HEALTH_HISTOGRAM_BUCKETS 8
+
+struct health_latency {
+    uint32_t count;
+    uint32_t last_us;
+    uint32_t max_us;
+};
+
+void health_record_loop(uint32_t duration_ms, uint32_t frame_duration_ms);
+
+void health_record_mqtt_publish(uint32_t duration_us);
+
+void health_record_sd_write(uint32_t duration_us);
+
+void health_record_sd_mount(void);
+
+/* records waiting for the SD card */
+void health_set_sd_backlog(uint32_t records);
+
+void health_record_sd_dropped(void);
+
+void health_record_wifi_connected(void);
+
+/* time from the data ready signal of a sensor until its sample reached all consumers */
+void health_record_sample(uint32_t latency_us);
+
+/* bus time of an I2C transaction, called from the bus tasks */
+void health_record_i2c(uint32_t duration_us, bool ok);
+
+/* time from the touch completing a gesture until the screen showed its effect */
+void health_record_tap(uint32_t latency_us);
+
+/* upper bound in ms of a histogram bucket, UINT32_MAX for the last one */
+uint32_t health_bucket_limit(uint8_t bucket);
+
+uint32_t health_loop_bucket_count(uint8_t bucket);
+
+uint32_t health_sample_bucket_count(uint8_t bucket);
+
+uint32_t health_missed_frames(void);
+
+uint32_t health_wifi_reconnects(void);
+
+/* 0 if not connected */
+int32_t health_wifi_rssi(void);
+
+const struct health_latency *health_mqtt_publish(void);
+
+const struct health_latency *health_sd_write(void);
+
+uint32_t health_sd_mounts(void);
+
+uint32_t health_sd_backlog(void);
+
+uint32_t health_sd_dropped(void);
+
+const struct health_latency *health_sample(void);
+
+const struct health_latency *health_i2c(void);
+
+uint32_t health_i2c_errors(void);
+
+const struct health_latency *health_tap(void);
+
+uint32_t health_free_heap(void);
+
+uint32_t health_min_free_heap(void);
+
+uint32_t health_largest_free_block(void);
+
+uint32_t health_free_psram(void);
+
+uint32_t health_uptime(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* HEALTH_H */
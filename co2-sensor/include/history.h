@@ -0,0 +1,69 @@
+#ifndef HISTORY_H
+#define HISTORY_H HISTORY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* one series per measurement type (see *_MEASUREMENT in sensorhub-mib.h) */
+#define HISTORY_MEASUREMENTS 5
+
+#define HISTORY_MINUTE_BUCKETS 1440 /* one day */
+#define HISTORY_HOUR_BUCKETS 168    /* one week */
+#define HISTORY_DAY_BUCKETS 366     /* one year */
+
+enum history_resolution {
+    HISTORY_RESOLUTION_MINUTE = 1,
+    HISTORY_RESOLUTION_HOUR = 2,
+    HISTORY_RESOLUTION_DAY = 3
+};
+
+#define HISTORY_RESOLUTIONS 3
+
+struct history_bucket {
+    uint32_t start; /* unix time of the first second of the bucket */
+    int16_t min;
+    int16_t max;
+    int16_t mean;
+    uint16_t samples;
+};
+
+/*
+ * Ring of buckets ordered by start time, oldest first. The newest bucket is
+ * the one currently being filled, so it is visible before it is complete.
+ */
+struct history_series {
+    struct history_bucket *buckets;
+    uint32_t period;
+    uint16_t capacity;
+    uint16_t head;
+    uint16_t len;
+    int32_t sum; /* sum of the samples in the newest bucket */
+};
+
+bool history_init(void);
+
+void history_add_sample(uint8_t measurement_type, uint32_t timestamp, int32_t value);
+
+/* only for the loop task, which writes the rings */
+const struct history_series *history_get_series(uint8_t measurement_type, uint8_t resolution);
+
+/* consistent copies of a bucket for other tasks */
+bool history_find(uint8_t measurement_type, uint8_t resolution, uint32_t start, struct history_bucket *copy);
+
+bool history_next(uint8_t measurement_type, uint8_t resolution, uint32_t start, struct history_bucket *copy);
+
+const struct history_bucket *history_series_at(const struct history_series *series, uint16_t index);
+
+int32_t history_series_find(const struct history_series *series, uint32_t start);
+
+uint16_t history_series_upper_bound(const struct history_series *series, uint32_t start);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* HISTORY_H */
@@ -0,0 +1,61 @@
+#ifndef I2C_BUS_H
+#define I2C_BUS_H I2C_BUS_H
+
+#include <stdint.h>
+
+#define I2C_TX_MAX 8
+#define I2C_RX_MAX 32
+// transactions waiting per bus
+#define I2C_QUEUE_LEN 8
+
+enum i2cStatus
+{
+    I2C_IDLE,
+    I2C_QUEUED,
+    I2C_DONE,
+    I2C_ERROR
+};
+
+/*
+ * One bus transaction: write tx, wait delayMs and read rxLen bytes. The delay
+ * is the command execution time of the device, it elapses on the bus and not
+ * in the caller. The descriptor belongs to the caller and must not be touched
+ * while its status is I2C_QUEUED.
+ */
+struct i2cTransaction
+{
+    uint8_t address;
+    uint8_t txLen;
+    uint8_t rxLen;
+    uint16_t delayMs;
+    uint8_t tx[I2C_TX_MAX];
+    uint8_t rx[I2C_RX_MAX];
+    volatile uint8_t status;
+
+    // timing of the last run, µs on the esp_timer clock
+    int64_t queuedUs;
+    int64_t doneUs;
+    // queued until the bus started it
+    uint32_t waitUs;
+    // time on the bus without delayMs
+    uint32_t busUs;
+};
+
+// sets up a transaction, lengths beyond the buffers are cut
+void i2cPrepare(struct i2cTransaction *transaction, uint8_t address, const uint8_t *tx, uint8_t txLen,
+                uint16_t delayMs, uint8_t rxLen);
+
+// queue of transactions executed in order
+class I2cBus
+{
+public:
+    virtual ~I2cBus() {}
+
+    // queues the transaction, false if the queue is full or the bus not started
+    virtual bool submit(struct i2cTransaction *transaction) = 0;
+
+    // submits the transaction and waits for it, for setup and rare configuration
+    virtual bool transfer(struct i2cTransaction *transaction) = 0;
+};
+
+#endif /* I2C_BUS_H */
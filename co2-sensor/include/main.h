@@ -7,6 +7,11 @@
 #define _ESPASYNC_WIFIMGR_LOGLEVEL_ 0
 
 #define GRAPH_UNITS 240
+// zoom levels in seconds: 4 and 12 hours, 1, 3 and 7 days, 1 and 3 months, 1 year
+#define GRAPH_SPANS {14400, 43200, 86400, 259200, 604800, 2592000, 7776000, 31536000}
+#define GRAPH_ZOOMS 8
+// the history reaches back one year
+#define GRAPH_HISTORY 31536000
 
 #define NUM_WIFI_CREDENTIALS 2
 #define MAX_SSID_LEN 32
@@ -24,6 +29,27 @@
 #define STATE_FILENAME "/state"
 #define MQTT_FILENAME "/mqtt.json"
 #define CONFIG_FILENAME "/wifi_config"
+#define ALERTS_FILENAME "/alerts.json"
+#define FILTERS_FILENAME "/filters.json"
+#define DISPLAY_FILENAME "/display.json"
+#define SNMPV3_FILENAME "/snmpv3.json"
+#define RETENTION_FILENAME "/retention.json"
+// on the SD card
+#define TRACE_FILENAME "/trace.bin"
+// compressed, data.txt of older firmware stays as it is
+#define DATA_FILENAME "/log.bin"
+#define DATA_INDEX_FILENAME "/log.idx"
+// means of the records older than the retention windows
+#define DATA_MINUTES_FILENAME "/log-min.bin"
+#define DATA_MINUTES_INDEX_FILENAME "/log-min.idx"
+#define DATA_HOURS_FILENAME "/log-hour.bin"
+#define DATA_HOURS_INDEX_FILENAME "/log-hour.idx"
+// the history is restored from the data log at startup, at most this far back
+#define HISTORY_RESTORE_SECONDS 86400
+// range of /export without from and to
+#define EXPORT_DEFAULT_SECONDS 86400
+// a step of the data log writer the export waits for, then it answers busy
+#define EXPORT_LOCK_MS 2000
 
 #define TOPIC_DISCOVERY "homeassistant/sensor/"
 #define TOPIC_CO2 "/co2"
@@ -32,6 +58,12 @@
 #define TOPIC_BATTERY "/battery"
 #define TOPIC_CONFIG "/config"
 #define TOPIC_STATE "/state"
+#define TOPIC_ALERT "/alert"
+#define TOPIC_ALERT_CONFIG "/alert/config"
+#define TOPIC_FILTER_CONFIG "/filter/config"
+#define TOPIC_DISPLAY_CONFIG "/display/config"
+#define TOPIC_RETENTION_CONFIG "/retention/config"
+#define TOPIC_TRACE "/trace"
 
 #define HOMEASSISTANT_UNIQUE_ID_Label "unique_id"
 #define HOMEASSISTANT_NAME_Label "name"
@@ -49,6 +81,9 @@
 #define HOMEASSISTANT_STATE_HUMIDITY_Label "humidity"
 #define HOMEASSISTANT_STATE_TEMPERATURE_Label "temperature"
 #define HOMEASSISTANT_STATE_BATTERY_Label "battery"
+#define HOMEASSISTANT_STATE_CO2_RAW_Label "carbon_dioxide_raw"
+#define HOMEASSISTANT_STATE_HUMIDITY_RAW_Label "humidity_raw"
+#define HOMEASSISTANT_STATE_TEMPERATURE_RAW_Label "temperature_raw"
 
 #define HOMEASSISTANT_DEVICE_MODEL_Value "Smoca CO2 Sensor"
 #define HOMEASSISTANT_DEVICE_MANUFACTURER_Value "Smoca AG"
@@ -66,6 +101,60 @@
 #define MQTT_TOPIC_LEN 64
 #define MQTT_USERNAME_LEN 24
 #define MQTT_KEY_LEN 32
+#define SNMP_TRAP_HOST_LEN 64
+
+#define SNMPV3_USER_Label "SNMPV3_USER_Label"
+#define SNMPV3_AUTH_PASSWORD_Label "SNMPV3_AUTH_PASSWORD_Label"
+#define SNMPV3_PRIV_PASSWORD_Label "SNMPV3_PRIV_PASSWORD_Label"
+#define SNMPV3_ONLY_Label "SNMPV3_ONLY_Label"
+#define SNMP_RATE_LIMIT_Label "SNMP_RATE_LIMIT_Label"
+#define SNMP_RATE_LIMIT_LEN 6
+#define SNMPV3_USER_LEN 33
+#define SNMPV3_PASSWORD_LEN 64
+
+#define SNMPV3_BOOTS_Label "boots"
+#define SNMPV3_ENGINE_ID_Label "engine_id"
+#define SNMPV3_USERS_Label "users"
+#define SNMPV3_V3_ONLY_Label "v3_only"
+#define SNMPV3_RATE_LIMIT_Label "rate_limit"
+#define SNMPV3_NAME_Label "name"
+#define SNMPV3_AUTH_Label "auth"
+#define SNMPV3_AUTH_KEY_Label "auth_key"
+#define SNMPV3_PRIV_Label "priv"
+#define SNMPV3_PRIV_KEY_Label "priv_key"
+
+#define ALERTS_TRAP_HOST_Label "trap_host"
+#define ALERTS_RULES_Label "rules"
+#define ALERTS_METRIC_Label "metric"
+#define ALERTS_DIRECTION_Label "direction"
+#define ALERTS_THRESHOLD_Label "threshold"
+#define ALERTS_HYSTERESIS_Label "hysteresis"
+#define ALERTS_DURATION_Label "duration"
+
+#define FILTERS_Label "filters"
+#define FILTER_MEDIAN_Label "median"
+#define FILTER_SMOOTHING_Label "smoothing"
+#define FILTER_ALPHA_Label "alpha"
+#define FILTER_PROCESS_NOISE_Label "process_noise"
+#define FILTER_MEASUREMENT_NOISE_Label "measurement_noise"
+#define FILTER_MAX_RATE_Label "max_rate"
+
+#define DISPLAY_DIM_AFTER_Label "dim_after"
+#define DISPLAY_SLEEP_AFTER_Label "sleep_after"
+#define DISPLAY_SLEEP_ON_AC_Label "sleep_on_ac"
+#define DISPLAY_DAY_LEVEL_Label "day_level"
+#define DISPLAY_NIGHT_LEVEL_Label "night_level"
+#define DISPLAY_DIMMED_LEVEL_Label "dimmed_level"
+#define DISPLAY_DAY_HOUR_Label "day_hour"
+#define DISPLAY_NIGHT_HOUR_Label "night_hour"
+
+#define RETENTION_RAW_DAYS_Label "raw_days"
+#define RETENTION_MINUTE_DAYS_Label "minute_days"
+#define RETENTION_HOUR_DAYS_Label "hour_days"
+
+// specific trap codes, see shAlertRaised / shAlertCleared in sensorhub.mib
+#define SNMP_TRAP_ALERT_RAISED 1
+#define SNMP_TRAP_ALERT_CLEARED 2
 
 #define DISCOVERY_IDENTIFIERS_LEN 72
 #define DISCOVERY_DEVICE_MODEL_NAME_LEN 24
@@ -80,21 +169,37 @@
 #define WIFI_CONNECT_TIMEOUT 5000L
 #define MQTT_INTERVAL 2000L
 #define MQTT_PUBLISH_INTERVAL 60000L
+#define SENSOR_ID_AIR 1
+#define SENSOR_ID_BATTERY 2
+#define SENSOR_ALTITUDE 440
+// GPIO wired to the RDY output of the SCD30, -1 to poll the data ready status instead
+#define SCD30_READY_PIN -1
+
+#define AXP192_ADDRESS 0x34
+
+// characters of the CO2 readout and of the header, "%c" only uses English day and month names
+#define CO2_GLYPHS "0123456789pm"
+#define HEADER_GLYPHS " 0123456789:%+-ADFJMNOSTWabcdeghilnoprtuvy"
+
 #define STRCPY(dst, src) if (strlcpy(dst, src, sizeof(dst)) >= sizeof(dst)) { Serial.println("not enugh space in dst for src"); } 
 
 // hardware
 #include <m5stack_core2/pins_arduino.h>
 #include <Arduino.h>
 #include <M5Core2.h>
-#include <SparkFun_SCD30_Arduino_Library.h>
-#include <SparkFun_SCD4x_Arduino_Library.h>
+#include <sensor-drivers.h>
+#include <glyph-atlas.h>
+#include <data-log-writer.h>
+#include <wire-i2c-bus.h>
+#include <touch-panel.h>
+#include <profile-scope.h>
 
 // memory
 #include <FS.h>
 #include <SD.h>
 #include <SPI.h>
 #include <sys/time.h>
-#include <SPIFFS.h>
+#include <storage.h>
 
 // WiFi AccessPoint and ConfigPortal
 #include <WiFi.h>
@@ -109,6 +214,14 @@
 // mqtt
 #include <PubSubClient.h>
 
+#include <alerts.h>
+#include <battery.h>
+#include <filter.h>
+#include <backlight.h>
+#include <trace.h>
+#include <plot.h>
+#include <touch.h>
+
 #include <smoca_logo.h>
 
 #include <set>
@@ -188,7 +301,14 @@ struct state
     struct tm current_time;
     int graph_index;
     enum graphMode graph_mode;
+    // index into GRAPH_SPANS and seconds the graph ends before now
+    uint8_t graph_zoom = 0;
+    uint32_t graph_offset = 0;
+    // frame times instead of the graph, toggled by a long press on the header
+    bool profile_overlay = false;
     bool display_sleep = false;
+    // in %, 0 while the display sleeps
+    uint8_t backlight_level = 0;
     float battery_capacity;
     enum menuMode menu_mode = menuModeGraphs;
     bool auto_calibration_on = false;
@@ -218,6 +338,7 @@ struct state
     char mqttPassword[MQTT_KEY_LEN];
     enum connectionState connectionState = WiFi_down_MQTT_down;
     bool is_screen_rotated = false;
+    char snmpTrapHost[SNMP_TRAP_HOST_LEN];
 };
 
 struct discoveryDeviceConfig
@@ -240,11 +361,9 @@ struct discoveryConfig
     discoveryDeviceConfig device;
 };
 
+// the battery charge is not in the history, the graph keeps its last GRAPH_UNITS minutes
 struct graph
 {
-    float co2[GRAPH_UNITS];
-    float temperature[GRAPH_UNITS];
-    float humidity[GRAPH_UNITS];
     float batteryMah[GRAPH_UNITS];
 };
 
@@ -298,6 +417,49 @@ void loadMQTTConfig();
 
 void saveMQTTConfig(struct state *state);
 
+void loadAlertConfig();
+
+bool applyAlertConfig(JsonDocument &json);
+
+void saveAlertConfig();
+
+void loadFilterConfig();
+
+bool applyFilterConfig(JsonDocument &json);
+
+void saveFilterConfig();
+
+void loadDisplayConfig();
+
+bool applyDisplayConfig(JsonDocument &json);
+
+void saveDisplayConfig();
+
+void loadRetentionConfig();
+
+bool applyRetentionConfig(JsonDocument &json);
+
+void saveRetentionConfig();
+
+void setTrapDestination(struct state *state);
+
+void loadSnmpv3Config();
+
+void saveSnmpv3Config();
+
+void saveSnmpv3Boots();
+
+void setSnmpRateLimit(long perSecond);
+void addSnmpv3User(const char *name, const char *authPassword, const char *privPassword);
+
+String toHex(const uint8_t *data, size_t len);
+
+bool fromHex(const char *hex, uint8_t *data, size_t len);
+
+void mqttCallback(char *topic, byte *payload, unsigned int length);
+
+void onAlert(const struct alert_rule *rule, int32_t value, bool active);
+
 bool loadConfigData();
 
 void saveConfigData();
@@ -335,12 +497,18 @@ void updateScreenRotation(struct state *oldstate, struct state *state);
 
 void updateTouch(struct state *state);
 
+bool handleGraphGesture(struct state *state, const struct touch_event *event);
+
+bool handleTap(struct state *state, const Point &at);
+
 void updateTime(struct state *state);
 
 void updateBattery(struct state *state);
 
 void updateCo2(struct state *state);
 
+void onSensorReadings(uint8_t sensorId, const struct sensorReadings *readings, uint32_t nowMs);
+
 void updateGraph(struct state *oldstate, struct state *state);
 
 void updateLed(struct state *oldstate, struct state *state);
@@ -367,6 +535,12 @@ void drawValues(struct state *oldstate, struct state *state);
 
 void drawGraph(struct state *oldstate, struct state *state);
 
+void drawHistoryGraph(struct state *state);
+
+void drawProfileOverlay(struct state *oldstate, struct state *state);
+
+String graphSpanLabel(uint32_t seconds);
+
 void drawCalibrationPpmSettings(struct state *oldstate, struct state *state);
 
 void drawCalibrationTempSettings(struct state *oldstate, struct state *state);
@@ -393,6 +567,19 @@ bool needFirmwareUpdate(const char *deviceVersion, const char *remoteVersion);
 
 void writeSsd(struct state *state);
 
+void restoreHistory();
+
+// with the data log writer locked
+void restoreHistory(uint32_t now);
+
+void handleExport(AsyncWebServerRequest *request);
+
+void startTrace();
+
+void stopTrace();
+
+void updateTrace(struct state *oldstate, struct state *state);
+
 String padTwo(String input);
 
 void writeFile(fs::FS &fs, const char *path, const char *message);
@@ -401,6 +588,10 @@ void printTime();
 
 void syncData(struct state *state);
 
+void handleSerial();
+
+void printProfile(Print &out);
+
 bool setRtc();
 
 void setTimeFromRtc();
@@ -409,8 +600,10 @@ void appendFile(fs::FS &fs, const char *path, const char *message);
 
 void setDisplayPower(bool state);
 
-uint32_t Read32bit(uint8_t Addr);
+void setBacklight(uint8_t level);
+
+void updateDisplayPower(struct state *oldstate, struct state *state);
 
-uint32_t ReadByte(uint8_t Addr);
+bool ReadByte(uint8_t Addr, uint8_t *Data);
 
 void WriteByte(uint8_t Addr, uint8_t Data);
@@ -0,0 +1,20 @@
+#ifndef MEMORY_FS_H
+#define MEMORY_FS_H MEMORY_FS_H
+
+#include <FS.h>
+
+/*
+ * A flat file system in RAM with the interface of SPIFFS and LittleFS: "/"
+ * lists the files, there are no other directories. Files opened while one is
+ * rewritten keep reading what it held before.
+ */
+class MemoryFS : public fs::FS
+{
+public:
+    MemoryFS();
+
+    // removes all files
+    void clear();
+};
+
+#endif /* MEMORY_FS_H */
@@ -0,0 +1,168 @@
+#ifndef MIB_BUILDER_H
+#define MIB_BUILDER_H MIB_BUILDER_H
+
+/*
+ * Compile time builders for lwIP MIB trees, replaces the LwipMibCompiler.
+ *
+ * Every builder is a type whose static constexpr members are the lwIP node
+ * structures, so the whole tree ends up in flash exactly like the generated C
+ * code did. The get_value dispatch of scalar arrays and tables is generated
+ * from the getters given per scalar / column:
+ *
+ *   using tree = mib::tree<1,
+ *       mib::table<1, get_instance, get_next_instance,
+ *           mib::column<2, SNMP_ASN1_TYPE_OCTET_STRING, sensor_name>>,
+ *       mib::scalar_array<6,
+ *           mib::scalar<1, SNMP_ASN1_TYPE_COUNTER, auth_count>>>;
+ *   const struct snmp_mib my_mib = mib::definition<tree, 1, 3, 6, 1, 4, 1, 58049, 1>::value;
+ *
+ * Scalar getters are u32_t / s32_t (void), column getters take the cell
+ * instance and return u32_t, s32_t or a zero terminated const char *, NULL
+ * for an empty value; strings are cut at SNMP_MAX_VALUE_SIZE.
+ */
+
+#include "lwip/apps/snmp_opts.h"
+#if LWIP_SNMP
+
+#include "lwip/apps/snmp_core.h"
+#include "lwip/apps/snmp_scalar.h"
+#include "lwip/apps/snmp_table.h"
+
+#include <string.h>
+#include <type_traits>
+
+namespace mib {
+
+namespace detail {
+
+template <typename... Ids>
+constexpr bool ascending(Ids... ids)
+{
+    u32_t list[] = { 0, static_cast<u32_t>(ids)... };
+
+    for (size_t i = 2; i < sizeof(list) / sizeof(list[0]); i++) {
+        if (list[i - 1] >= list[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* writes a getter result in the representation snmp_msg.c expects for its type */
+template <typename T>
+s16_t encode(T result, void *value)
+{
+    if constexpr (std::is_same<T, const char *>::value) {
+        if (result == NULL) {
+            return 0;
+        }
+
+        /* value is a buffer of SNMP_MAX_VALUE_SIZE */
+        size_t len = strnlen(result, SNMP_MAX_VALUE_SIZE);
+
+        MEMCPY(value, result, len);
+        return (s16_t)len;
+    } else {
+        static_assert(std::is_same<T, u32_t>::value || std::is_same<T, s32_t>::value,
+            "getters return u32_t, s32_t or const char *");
+        *(T *)value = result;
+        return sizeof(T);
+    }
+}
+
+} /* namespace detail */
+
+/* --- scalars ------------------------------------------------------------ */
+
+template <u32_t Oid, u8_t Type, auto Get>
+struct scalar {
+    static constexpr u32_t oid = Oid;
+    static constexpr struct snmp_scalar_array_node_def def = { Oid, Type, SNMP_NODE_INSTANCE_READ_ONLY };
+
+    static s16_t get(void *value)
+    {
+        return detail::encode(Get(), value);
+    }
+};
+
+template <u32_t Oid, typename... Scalars>
+struct scalar_array {
+    static_assert(sizeof...(Scalars) > 0, "a scalar array needs scalars");
+    static_assert(detail::ascending(Scalars::oid...), "scalar oids have to be ascending");
+
+    static constexpr u32_t oid = Oid;
+    static constexpr struct snmp_scalar_array_node_def defs[] = { Scalars::def... };
+
+    static s16_t get_value(const struct snmp_scalar_array_node_def *def, void *value)
+    {
+        s16_t len = 0;
+
+        /* snmp_scalar_array_get_instance() only passes defs of this array */
+        (void)((def->oid == Scalars::oid && (len = Scalars::get(value), true)) || ...);
+        return len;
+    }
+
+    static constexpr struct snmp_scalar_array_node value = SNMP_SCALAR_CREATE_ARRAY_NODE(Oid, defs, get_value, NULL, NULL);
+    static constexpr const struct snmp_node *node = &value.node.node;
+};
+
+/* --- tables ------------------------------------------------------------- */
+
+template <u32_t Id, u8_t Type, auto Get>
+struct column {
+    static constexpr u32_t id = Id;
+    static constexpr struct snmp_table_col_def def = { Id, Type, SNMP_NODE_INSTANCE_READ_ONLY };
+
+    static s16_t get(struct snmp_node_instance *cell_instance, void *value)
+    {
+        return detail::encode(Get(cell_instance), value);
+    }
+};
+
+/* index columns are not-accessible and left out, the row lookup is up to get_instance / get_next_instance */
+template <u32_t Oid, auto GetInstance, auto GetNextInstance, typename... Columns>
+struct table {
+    static_assert(sizeof...(Columns) > 0, "a table needs columns");
+    static_assert(detail::ascending(Columns::id...), "column ids have to be ascending");
+
+    static constexpr u32_t oid = Oid;
+    static constexpr struct snmp_table_col_def columns[] = { Columns::def... };
+
+    static s16_t get_value(struct snmp_node_instance *cell_instance, void *value)
+    {
+        u32_t id = SNMP_TABLE_GET_COLUMN_FROM_OID(cell_instance->instance_oid.id);
+        s16_t len = 0;
+
+        (void)((id == Columns::id && (len = Columns::get(cell_instance, value), true)) || ...);
+        return len;
+    }
+
+    static constexpr struct snmp_table_node value = SNMP_TABLE_CREATE(Oid, columns, GetInstance, GetNextInstance, get_value, NULL, NULL);
+    static constexpr const struct snmp_node *node = &value.node.node;
+};
+
+/* --- tree --------------------------------------------------------------- */
+
+template <u32_t Oid, typename... Nodes>
+struct tree {
+    static_assert(sizeof...(Nodes) > 0, "a tree needs nodes");
+    static_assert(detail::ascending(Nodes::oid...), "node oids have to be ascending");
+
+    static constexpr u32_t oid = Oid;
+    static constexpr const struct snmp_node *subnodes[] = { Nodes::node... };
+    static constexpr struct snmp_tree_node value = SNMP_CREATE_TREE_NODE(Oid, subnodes);
+    static constexpr const struct snmp_node *node = &value.node;
+};
+
+template <typename Root, u32_t... BaseOid>
+struct definition {
+    static_assert(sizeof...(BaseOid) > 0 && sizeof...(BaseOid) <= SNMP_MAX_OBJ_ID_LEN, "invalid base oid");
+
+    static constexpr u32_t base_oid[] = { BaseOid... };
+    static constexpr struct snmp_mib value = { base_oid, sizeof...(BaseOid), Root::node };
+};
+
+} /* namespace mib */
+
+#endif /* LWIP_SNMP */
+#endif /* MIB_BUILDER_H */
@@ -0,0 +1,44 @@
+#ifndef PLOT_H
+#define PLOT_H PLOT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "history.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#define PLOT_COLUMNS_MAX 320
+/* a resolution is only used while the range holds at most this many of its buckets */
+#define PLOT_BUCKETS_MAX 1440
+
+struct plot_column {
+    int16_t min;
+    int16_t max;
+    int16_t mean;
+    bool valid;
+};
+
+/* finest history resolution with at most PLOT_BUCKETS_MAX buckets in span, the coarsest one if none */
+uint8_t plot_resolution(uint32_t span);
+
+/*
+ * Splits [start, start + span) into len columns and folds the buckets of the
+ * series into them: the lowest min, the highest max and the mean weighted by
+ * samples, so a peak survives any zoom. A bucket wider than a column fills all
+ * the columns it overlaps. Reads each bucket in the range once, returns the
+ * number of columns with data.
+ */
+uint16_t plot_decimate(const struct history_series *series, uint32_t start, uint32_t span,
+                       struct plot_column *columns, uint16_t len);
+
+/* lowest min and highest max of the valid columns, false if there are none */
+bool plot_bounds(const struct plot_column *columns, uint16_t len, int16_t *min, int16_t *max);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* PLOT_H */
@@ -0,0 +1,28 @@
+#ifndef PROFILE_SCOPE_H
+#define PROFILE_SCOPE_H PROFILE_SCOPE_H
+
+#include <Esp.h>
+
+#include <profiler.h>
+
+// counts the CPU cycles of its lifetime into a section of the frame
+class ProfileScope
+{
+public:
+    explicit ProfileScope(enum profile_section section) : section(section), start(ESP.getCycleCount()) {}
+    ~ProfileScope() { profiler_record(section, ESP.getCycleCount() - start); }
+
+private:
+    enum profile_section section;
+    uint32_t start;
+};
+
+// runs a call of the main loop as a section
+#define PROFILE(section, call)                                                                                         \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        ProfileScope profileScope(section);                                                                            \
+        call;                                                                                                          \
+    } while (0)
+
+#endif /* PROFILE_SCOPE_H */
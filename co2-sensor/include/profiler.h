@@ -0,0 +1,91 @@
+#ifndef PROFILER_H
+#define PROFILER_H PROFILER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* the subsystems run by the main loop, the rest of a frame is PROFILE_SECTIONS */
+enum profile_section {
+    PROFILE_TOUCH = 0,
+    PROFILE_TIME,
+    PROFILE_BATTERY,
+    PROFILE_CO2,
+    PROFILE_GRAPH,
+    PROFILE_LED,
+    PROFILE_TIME_STATE,
+    PROFILE_MQTT,
+    PROFILE_WIFI_MQTT,
+    PROFILE_SCREEN_ROTATION,
+    PROFILE_DISPLAY_POWER,
+    PROFILE_DRAW,
+    PROFILE_SYNC,
+    PROFILE_SSD,
+    PROFILE_TRACE,
+    PROFILE_SECTIONS
+};
+
+/* last frames kept for the frame rate and percentiles, about 13 s at 20 fps */
+#define PROFILE_FRAMES 256
+#define PROFILE_BUCKETS 10
+
+struct profile_stats {
+    uint32_t count;
+    uint32_t last_us;
+    uint32_t max_us;
+    uint64_t total_us;
+};
+
+struct profile_frame {
+    uint32_t start_ms;
+    uint32_t duration_us;
+    /* the section which took the longest, PROFILE_SECTIONS for the untimed rest */
+    uint8_t worst;
+    uint32_t worst_us;
+};
+
+struct profile_summary {
+    uint16_t frames;
+    float fps;
+    uint32_t p50_us;
+    uint32_t p99_us;
+    /* the slowest frame and what took the longest in it */
+    struct profile_frame slowest;
+};
+
+void profiler_reset(uint32_t cycles_per_us);
+
+/* time of a section in the current frame, from the main loop */
+void profiler_record(enum profile_section section, uint32_t cycles);
+
+/* closes the current frame, called by the main loop before it waits for the next one */
+void profiler_frame(uint32_t start_ms, uint32_t cycles);
+
+/* "other" for PROFILE_SECTIONS */
+const char *profiler_section_name(uint8_t section);
+
+/* upper bound in µs of a histogram bucket, UINT32_MAX for the last one */
+uint32_t profiler_bucket_limit(uint8_t bucket);
+
+uint32_t profiler_bucket_count(uint8_t section, uint8_t bucket);
+
+const struct profile_stats *profiler_stats(uint8_t section);
+
+/* false before the first frame */
+bool profiler_last_frame(struct profile_frame *frame);
+
+/*
+ * Frame rate and frame time percentiles over the frames in the ring. Can be
+ * called from any task, frames overwritten while reading are left out. False
+ * with less than two frames.
+ */
+bool profiler_summary(struct profile_summary *summary);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* PROFILER_H */
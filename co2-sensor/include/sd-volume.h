@@ -0,0 +1,25 @@
+#ifndef SD_VOLUME_H
+#define SD_VOLUME_H SD_VOLUME_H
+
+// a file system on a medium which can be taken out while it is mounted
+class RemovableVolume
+{
+public:
+    virtual ~RemovableVolume() {}
+
+    // false without a medium
+    virtual bool mount() = 0;
+
+    // after the medium was removed, before it is mounted again
+    virtual void unmount() = 0;
+};
+
+// the microSD slot, the card shares the SPI bus with the display
+class SdVolume : public RemovableVolume
+{
+public:
+    bool mount();
+    void unmount();
+};
+
+#endif /* SD_VOLUME_H */
@@ -0,0 +1,216 @@
+#ifndef SENSOR_DRIVERS_H
+#define SENSOR_DRIVERS_H SENSOR_DRIVERS_H
+
+#include <i2c-bus.h>
+#include <sensor-hub.h>
+
+#define SCD30_INTERVAL_MS 2000
+#define SCD4X_INTERVAL_MS 5000
+#define BME280_INTERVAL_MS 2000
+// polling of the data ready status starts this early before the next sample is expected
+#define SENSOR_READY_EARLY_MS 100
+// poll interval of the data ready status, one frame
+#define SENSOR_READY_POLL_MS 50
+// retry after a failed bus transaction
+#define SENSOR_RETRY_MS 250
+// next step if a submitted transaction did not complete by then
+#define SENSOR_TRANSACTION_TIMEOUT_MS 1000
+
+#define SENSIRION_COMMANDS_MAX 3
+// settings kept while the commands of one before are queued, one for each kind
+#define SENSIRION_SETTINGS_MAX 3
+
+struct sensirionProtocol
+{
+    uint8_t address;
+    uint16_t dataReady;
+    uint16_t readMeasurement;
+    // between a read command and its response
+    uint16_t readDelayMs;
+    uint8_t measurementWords;
+};
+
+// the latest value of a setting which came while commands were queued
+struct sensirionSetting
+{
+    uint16_t command;
+    uint16_t argument;
+};
+
+/*
+ * Command framing of the Sensirion sensors: 16 bit commands and words, each
+ * word followed by its CRC-8. A step submits one transaction and the next step,
+ * run as soon as it completed, handles the response: poll the data ready
+ * status, then read the measurement. A setting which comes while the commands
+ * of another are queued is kept and submitted by the first step after them.
+ */
+class SensirionDriver : public SensorDriver
+{
+public:
+    uint32_t step(struct sensorReadings *readings);
+    bool pending();
+
+protected:
+    SensirionDriver(I2cBus &bus, const struct sensirionProtocol *protocol);
+
+    // command and rxWords words read after delayMs
+    void prepare(struct i2cTransaction *transaction, uint16_t command, uint16_t delayMs, uint8_t rxWords);
+    // command with an argument word
+    void prepareArgument(struct i2cTransaction *transaction, uint16_t command, uint16_t argument, uint16_t delayMs);
+
+    // words of a completed transaction, false on bus or CRC errors
+    static bool words(const struct i2cTransaction *transaction, uint16_t *words, uint8_t len);
+
+    // true if none of the commands is queued any more
+    bool commandsDone() const;
+
+    // submits the prepared commands[0..len-1], they run in order
+    bool submitCommands(uint8_t len);
+
+    // submits the commands of the setting, or keeps its latest value until the ones before are done
+    void submitSetting(uint16_t command, uint16_t argument);
+
+    // prepares the commands of a setting, returns how many
+    virtual uint8_t prepareSetting(uint16_t command, uint16_t argument) = 0;
+
+    // a data ready interrupt, the status poll is skipped
+    virtual bool interrupted(int64_t * /* readyUs */) { return false; }
+
+    virtual void convert(const uint16_t *words, struct sensorReadings *readings) = 0;
+
+    // until the next step after a sample or after a poll without one
+    virtual uint32_t nextStepMs(bool sampled) = 0;
+
+    I2cBus &bus;
+    const struct sensirionProtocol *protocol;
+    struct i2cTransaction commands[SENSIRION_COMMANDS_MAX];
+
+private:
+    enum state
+    {
+        SENSIRION_IDLE,
+        SENSIRION_POLLING,
+        SENSIRION_READING
+    };
+
+    // submits the oldest kept setting once the commands before it are done
+    void submitKept();
+
+    enum state state;
+    struct i2cTransaction transaction;
+    int64_t readyAtUs;
+    // in the order they came
+    struct sensirionSetting kept[SENSIRION_SETTINGS_MAX];
+    uint8_t keptLen;
+};
+
+/*
+ * With readyPin wired to the RDY output of the SCD30 a sample is read as soon
+ * as the interrupt fires, otherwise the data ready status is polled around the
+ * time the next sample is expected.
+ */
+class Scd30Driver : public SensirionDriver
+{
+public:
+    Scd30Driver(I2cBus &bus);
+
+    void configure(bool autoCalibration, float temperatureOffset, uint16_t altitude, int8_t readyPin = -1);
+
+    const char *name() const;
+    uint8_t measurementTypes(const uint8_t **types) const;
+    bool begin();
+    bool pending();
+
+    void setAutoCalibration(bool enabled);
+    void setTemperatureOffset(float offset);
+    void forceCalibration(uint16_t ppm);
+
+protected:
+    bool interrupted(int64_t *readyUs);
+    void convert(const uint16_t *words, struct sensorReadings *readings);
+    uint32_t nextStepMs(bool sampled);
+    // a single command with an argument
+    uint8_t prepareSetting(uint16_t command, uint16_t argument);
+
+private:
+    static void onReady(void *arg);
+
+    bool autoCalibration;
+    float temperatureOffset;
+    uint16_t altitude;
+    int8_t readyPin;
+    volatile bool ready;
+    volatile int64_t readyUs;
+};
+
+class Scd4xDriver : public SensirionDriver
+{
+public:
+    Scd4xDriver(I2cBus &bus);
+
+    void configure(bool autoCalibration, float temperatureOffset, uint16_t altitude);
+
+    const char *name() const;
+    uint8_t measurementTypes(const uint8_t **types) const;
+    bool begin();
+
+    void setAutoCalibration(bool enabled);
+    void setTemperatureOffset(float offset);
+    void forceCalibration(uint16_t ppm);
+
+protected:
+    void convert(const uint16_t *words, struct sensorReadings *readings);
+    uint32_t nextStepMs(bool sampled);
+    // the SCD4x only accepts settings while the periodic measurement is stopped
+    uint8_t prepareSetting(uint16_t command, uint16_t argument);
+
+private:
+
+    bool autoCalibration;
+    float temperatureOffset;
+    uint16_t altitude;
+};
+
+// Bosch BME280 in forced mode, 1x oversampling, no filter
+class Bme280Driver : public SensorDriver
+{
+public:
+    Bme280Driver(I2cBus &bus, uint8_t address = 0x76);
+
+    const char *name() const;
+    uint8_t measurementTypes(const uint8_t **types) const;
+    bool begin();
+    uint32_t step(struct sensorReadings *readings);
+    bool pending();
+
+private:
+    enum state
+    {
+        BME280_IDLE,
+        BME280_TRIGGERING,
+        BME280_CONVERTING,
+        BME280_READING
+    };
+
+    struct calibration
+    {
+        uint16_t t1;
+        int16_t t2, t3;
+        uint16_t p1;
+        int16_t p2, p3, p4, p5, p6, p7, p8, p9;
+        uint8_t h1, h3;
+        int16_t h2, h4, h5;
+        int8_t h6;
+    };
+
+    bool readRegisters(uint8_t reg, uint8_t *data, uint8_t len);
+    void compensate(const uint8_t *data, struct sensorReadings *readings);
+
+    I2cBus &bus;
+    uint8_t address;
+    enum state state;
+    struct i2cTransaction transaction;
+    struct calibration calibration;
+};
+
+#endif /* SENSOR_DRIVERS_H */
@@ -0,0 +1,108 @@
+#ifndef SENSOR_HUB_DRIVER_H
+#define SENSOR_HUB_DRIVER_H SENSOR_HUB_DRIVER_H
+
+#include <stdint.h>
+
+#define SENSOR_HUB_SENSORS_MAX 8
+#define SENSOR_HUB_READINGS_MAX 4
+// bus transactions per call of SensorHub::run(), keeps a frame short
+#define SENSOR_HUB_STEPS_PER_RUN 2
+
+// measurement types and units as in sensorhub-mib.h / SENSORHUB-MIB
+struct sensorReading
+{
+    uint8_t type;
+    int32_t value;
+};
+
+// timestamps are µs on the monotonic esp_timer clock
+struct sensorReadings
+{
+    // the sensor signalled data ready
+    int64_t readyUs;
+    // the data was read from the sensor
+    int64_t timestampUs;
+    uint8_t len;
+    struct sensorReading reading[SENSOR_HUB_READINGS_MAX];
+};
+
+/*
+ * A sensor is driven as a state machine. Every step() does at most one short
+ * bus transaction, e.g. start a conversion or read a result, and returns how
+ * long the sensor needs until the next step. The bus is free for the other
+ * sensors while a conversion is running.
+ */
+class SensorDriver
+{
+public:
+    virtual ~SensorDriver() {}
+
+    virtual const char *name() const = 0;
+
+    // measurement types this sensor reports
+    virtual uint8_t measurementTypes(const uint8_t **types) const = 0;
+
+    // probes the sensor, false if it is not on the bus
+    virtual bool begin() = 0;
+
+    // fills readings when a measurement completed, returns ms until the next step
+    virtual uint32_t step(struct sensorReadings *readings) = 0;
+
+    // true if a data ready interrupt is waiting for its step, which is then run at once
+    virtual bool pending() { return false; }
+
+    // calibration, ignored by sensors without it
+    virtual void setAutoCalibration(bool /* enabled */) {}
+    virtual void setTemperatureOffset(float /* offset */) {}
+    virtual void forceCalibration(uint16_t /* ppm */) {}
+};
+
+typedef void (*sensorReadingsCallback)(uint8_t sensorId, const struct sensorReadings *readings, uint32_t nowMs);
+
+/*
+ * Registry of the sensors on the bus and scheduler of their steps. run() is
+ * called every frame and executes the due steps, pending interrupts first and
+ * then the one waiting longest.
+ * It has no dependency on the bus itself, so it can be run with mock drivers.
+ * run() and add() belong to the loop, value() can be called from other tasks.
+ */
+class SensorHub
+{
+public:
+    SensorHub(sensorReadingsCallback callback);
+
+    // probes the driver and registers it under the given MIB sensor id
+    bool add(uint8_t id, SensorDriver *driver);
+
+    void run(uint32_t nowMs);
+
+    uint8_t count() const;
+
+    SensorDriver *get(uint8_t id) const;
+
+    // first sensor reporting the measurement type
+    SensorDriver *find(uint8_t type) const;
+
+    // latest value, false if the sensor did not report it yet
+    bool value(uint8_t id, uint8_t type, int32_t *value) const;
+
+private:
+    struct entry
+    {
+        uint8_t id;
+        SensorDriver *driver;
+        uint32_t dueMs;
+        // odd while latest is written, value() retries if it changed meanwhile
+        uint32_t sequence;
+        struct sensorReadings latest;
+    };
+
+    struct entry *entryById(uint8_t id);
+    const struct entry *entryById(uint8_t id) const;
+
+    sensorReadingsCallback callback;
+    struct entry entries[SENSOR_HUB_SENSORS_MAX];
+    uint8_t entriesLen;
+};
+
+#endif /* SENSOR_HUB_DRIVER_H */
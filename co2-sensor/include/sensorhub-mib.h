@@ -1,7 +1,3 @@
-/*
-Generated by LwipMibCompiler
-*/
-
 #ifndef SENSOR_HUB_H
 #define SENSOR_HUB_H SENSOR_HUB_H
 
@@ -16,14 +12,26 @@ extern "C" {
 
 extern const struct snmp_mib sensorhub_mib;
 
+void sensorhub_mib_init(void);
+
 #define CO2_PPM_MEASUREMENT 1
 #define TEMPERATURE_MEASUREMENT 2
 #define HUMIDITY_MEASUREMENT 3
 #define BATTERY_VOLTAGE_MEASUREMENT 4
 #define BATTERY_CURRENT_MEASUREMENT 5
+#define IAQ_MEASUREMENT 6
+#define PRESSURE_MEASUREMENT 7
 
 extern int get_measurement(u32_t, u32_t);
 
+/* before filtering, the same as get_measurement() for unfiltered measurements */
+extern int get_measurement_raw(u32_t sensor_id, u32_t measurement_type);
+
+/* NULL if there is no sensor with the id */
+extern const char *get_sensor_name(u32_t sensor_id);
+
+extern u8_t get_sensor_measurement_types(u32_t sensor_id, const u8_t **types);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
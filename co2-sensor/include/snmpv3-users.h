@@ -0,0 +1,76 @@
+#ifndef SNMPV3_USERS_H
+#define SNMPV3_USERS_H SNMPV3_USERS_H
+
+#include "lwip/apps/snmp_opts.h"
+#if LWIP_SNMP && LWIP_SNMP_V3
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "lwip/apps/snmpv3.h"
+
+#define SNMPV3_USERS_MAX 4
+#define SNMPV3_USER_NAME_LEN 32
+#define SNMPV3_KEY_LEN 20
+#define SNMPV3_ENGINE_ID_LEN 11
+/* RFC 3414 2.2.2: the limit of snmpEngineTime and snmpEngineBoots */
+#define SNMPV3_ENGINE_MAX 2147483647
+
+/* keys are stored localized to the engine id, the passwords are never kept */
+struct snmpv3_user {
+    char name[SNMPV3_USER_NAME_LEN + 1];
+    u8_t auth_algo;
+    u8_t auth_key[SNMPV3_KEY_LEN];
+    u8_t priv_algo;
+    u8_t priv_key[SNMPV3_KEY_LEN];
+};
+
+struct snmpv3_timing {
+    u32_t count;
+    u32_t total_us;
+    u32_t max_us;
+};
+
+enum snmpv3_timing_kind {
+    SNMPV3_TIMING_AUTH = 0,
+    SNMPV3_TIMING_PRIV = 1
+};
+
+/* used by snmp_msg.c, see LWIP_SNMPV3_INCLUDE_ENGINE in platformio.ini */
+#define SNMPV3_TIMING_BEGIN(start) u32_t start = snmpv3_timing_now()
+#define SNMPV3_TIMING_END(kind, start) snmpv3_timing_record(kind, start)
+#define SNMPV3_COMMUNITY_ALLOWED() snmpv3_users_community_allowed()
+
+void snmpv3_users_init(const u8_t *mac, u32_t boots);
+
+void snmpv3_users_get_engine_id(const u8_t **id, u8_t *len);
+
+void snmpv3_users_clear(void);
+
+u8_t snmpv3_users_count(void);
+
+const struct snmpv3_user *snmpv3_users_get(u8_t index);
+
+err_t snmpv3_users_add(const struct snmpv3_user *user);
+
+err_t snmpv3_users_add_password(const char *name, u8_t auth_algo, const char *auth_password, u8_t priv_algo, const char *priv_password);
+
+void snmpv3_users_set_v3_only(u8_t v3_only);
+
+u8_t snmpv3_users_get_v3_only(void);
+
+u8_t snmpv3_users_community_allowed(void);
+
+u32_t snmpv3_timing_now(void);
+
+void snmpv3_timing_record(u8_t kind, u32_t start_us);
+
+const struct snmpv3_timing *snmpv3_timing_get(u8_t kind);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* LWIP_SNMP && LWIP_SNMP_V3 */
+#endif /* SNMPV3_USERS_H */
@@ -0,0 +1,105 @@
+#ifndef STORAGE_H
+#define STORAGE_H STORAGE_H
+
+#include <FS.h>
+
+#include <memory-fs.h>
+#include <sd-volume.h>
+
+#define STORAGE_COPY_BUFFER 256
+#define STORAGE_PATH_MAX 64
+// where a move to another file system is staged, the files are copied next to the marker, which is written last
+#define STORAGE_STAGE_PREFIX "/settings-moving-"
+#define STORAGE_STAGE_DONE "/settings-moving.done"
+#define STORAGE_BENCH_FILENAME "/bench.tmp"
+#define STORAGE_BENCH_ROUNDS 20
+#define STORAGE_BENCH_APPEND 64
+// about the size of the largest settings file
+#define STORAGE_BENCH_REWRITE 512
+
+// a file system the settings are kept on
+class StorageBackend
+{
+public:
+    virtual ~StorageBackend() {}
+
+    virtual const char *name() const = 0;
+
+    // false without a usable file system, format makes an empty one if there is none
+    virtual bool mount(bool format) = 0;
+
+    virtual void unmount() = 0;
+
+    virtual fs::FS &fs() = 0;
+};
+
+// the data partition as written by older firmware
+class SpiffsStorage : public StorageBackend
+{
+public:
+    const char *name() const;
+    bool mount(bool format);
+    void unmount();
+    fs::FS &fs();
+};
+
+// the same partition, wear levelled and safe against a reset while a file is written
+class LittleFsStorage : public StorageBackend
+{
+public:
+    const char *name() const;
+    bool mount(bool format);
+    void unmount();
+    fs::FS &fs();
+};
+
+// until the next start, when there is no usable partition
+class MemoryStorage : public StorageBackend
+{
+public:
+    const char *name() const;
+    bool mount(bool format);
+    void unmount();
+    fs::FS &fs();
+
+private:
+    MemoryFS memory;
+};
+
+// the microSD card, a move of the settings is staged on it, it is never formatted
+class SdStorage : public StorageBackend
+{
+public:
+    explicit SdStorage(RemovableVolume &volume);
+
+    const char *name() const;
+    bool mount(bool format);
+    void unmount();
+    fs::FS &fs();
+
+private:
+    RemovableVolume &volume;
+};
+
+/*
+ * Mounts primary. A partition still formatted by legacy is moved over once:
+ * its files are copied to stage, then the partition is formatted for primary
+ * and they are copied back. The marker on stage is written after the copy and
+ * removed after the copy back, a start which finds it finishes the move, so a
+ * reset at any point keeps the settings. Without a stage, legacy stays in use.
+ * Without a usable partition the settings are kept in scratch.
+ */
+StorageBackend &mountStorage(StorageBackend &primary, StorageBackend &legacy, MemoryStorage &scratch,
+                             StorageBackend *stage);
+
+/*
+ * Copies the files of the root directory whose path starts with fromPrefix,
+ * with it replaced by toPrefix. False if one could not be read or written
+ * completely.
+ */
+bool copyStorage(fs::FS &from, const char *fromPrefix, fs::FS &to, const char *toPrefix);
+
+// times opening, appending to and rewriting a scratch file on the backend, in µs, and counts the flash erased and written
+void benchmarkStorage(Print &out, StorageBackend &backend);
+
+#endif /* STORAGE_H */
@@ -0,0 +1,50 @@
+#ifndef TOUCH_PANEL_H
+#define TOUCH_PANEL_H TOUCH_PANEL_H
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <i2c-bus.h>
+
+#define FT6336_ADDRESS 0x38
+// TD_STATUS followed by the coordinates of the first point
+#define FT6336_REG_STATUS 0x02
+#define FT6336_INT_PIN 39
+
+#define TOUCH_PANEL_STACK 2048
+// above the loop task, like the bus tasks
+#define TOUCH_PANEL_PRIORITY 2
+// while touched the panel is read at this interval
+#define TOUCH_PANEL_SAMPLE_MS 10
+
+/*
+ * The FT6336 pulls its INT line low on a touch. The interrupt wakes a task,
+ * which follows the touch until it ended and feeds the samples with their time
+ * into touch.h, so gestures are recognized and queued even while the loop is
+ * stuck in a long frame.
+ */
+class TouchPanel
+{
+public:
+    TouchPanel(I2cBus &bus, int8_t interruptPin = FT6336_INT_PIN);
+
+    bool begin();
+
+    // with the screen turned by 180 degrees the coordinates are turned as well
+    void setRotated(bool rotated);
+
+private:
+    static void onInterrupt(void *arg);
+    static void task(void *arg);
+
+    bool read(bool *pressed, int16_t *x, int16_t *y);
+
+    I2cBus &bus;
+    int8_t interruptPin;
+    volatile bool rotated;
+    volatile int64_t interruptUs;
+    TaskHandle_t handle;
+    struct i2cTransaction transaction;
+};
+
+#endif /* TOUCH_PANEL_H */
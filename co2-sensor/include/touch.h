@@ -0,0 +1,61 @@
+#ifndef TOUCH_H
+#define TOUCH_H TOUCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#define TOUCH_QUEUE_LEN 16
+/* a release shorter than this is a bounce of the touch going on */
+#define TOUCH_DEBOUNCE_US 30000
+#define TOUCH_LONG_PRESS_US 600000
+/* a touch moving further is a swipe */
+#define TOUCH_SWIPE_PX 40
+
+enum touch_gesture {
+    TOUCH_TAP = 1,
+    TOUCH_LONG_PRESS = 2,
+    TOUCH_SWIPE_LEFT = 3,
+    TOUCH_SWIPE_RIGHT = 4,
+    TOUCH_SWIPE_UP = 5,
+    TOUCH_SWIPE_DOWN = 6
+};
+
+struct touch_event {
+    uint8_t gesture;
+    /* where the touch started and where it was last */
+    int16_t x;
+    int16_t y;
+    int16_t end_x;
+    int16_t end_y;
+    /* esp_timer µs of the first sample and of the one which completed the gesture */
+    int64_t start_us;
+    int64_t end_us;
+};
+
+void touch_reset(void);
+
+/*
+ * Feeds a sample of the touch controller into the recognizer. Samples come from
+ * a single producer, the events are queued for a single consumer, so the two
+ * can run in different tasks.
+ */
+void touch_sample(int64_t time_us, bool pressed, int16_t x, int16_t y);
+
+/* completes a released touch once no bounce can follow any more */
+void touch_poll(int64_t now_us);
+
+/* the oldest queued event, false if there is none */
+bool touch_next(struct touch_event *event);
+
+/* events lost because the queue was full */
+uint32_t touch_dropped(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* TOUCH_H */
@@ -0,0 +1,114 @@
+#ifndef TRACE_H
+#define TRACE_H TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "battery.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#define TRACE_MAGIC "CO2T"
+#define TRACE_VERSION 1
+/* magic, version and the start as unix time */
+#define TRACE_HEADER_LEN 9
+/* events wait here until they are appended to the trace file */
+#define TRACE_BUFFER_SIZE 2048
+
+enum trace_type {
+    TRACE_SENSOR = 1,
+    TRACE_BATTERY = 2,
+    TRACE_TOUCH = 3,
+    TRACE_CONNECTIVITY = 4
+};
+
+/*
+ * A record is its type, the ms since the previous record as a varint and the
+ * payload, signed values zigzag encoded:
+ *   sensor        sensor id, measurement type, raw value
+ *   battery       mV, current in 0.5 mA, coulomb counter in 0.01 mAh, ac | charging << 1
+ *   touch         x, y, pressed
+ *   connectivity  WiFi status, MQTT connected
+ * A sample of the air sensor takes 5 to 8 bytes.
+ */
+struct trace_event {
+    uint8_t type;
+    uint32_t time_ms;
+    union {
+        struct {
+            uint8_t sensor_id;
+            uint8_t measurement_type;
+            int32_t value;
+        } sensor;
+        struct battery_sample battery;
+        struct {
+            int16_t x;
+            int16_t y;
+            bool pressed;
+        } touch;
+        struct {
+            uint8_t wifi_status;
+            bool mqtt_connected;
+        } connectivity;
+    };
+};
+
+/* recorder, events are dropped while it is stopped or its buffer is full */
+void trace_start(uint32_t now_ms, uint32_t unix_time);
+
+void trace_stop(void);
+
+bool trace_running(void);
+
+void trace_sensor(uint32_t now_ms, uint8_t sensor_id, uint8_t measurement_type, int32_t value);
+
+void trace_battery(const struct battery_sample *sample);
+
+void trace_touch(uint32_t now_ms, int16_t x, int16_t y, bool pressed);
+
+void trace_connectivity(uint32_t now_ms, uint8_t wifi_status, bool mqtt_connected);
+
+/* encoded bytes not yet written, trace_consumed() releases them */
+size_t trace_pending(const uint8_t **data);
+
+void trace_consumed(void);
+
+uint32_t trace_dropped(void);
+
+struct trace_reader {
+    const uint8_t *data;
+    size_t len;
+    size_t pos;
+    uint32_t time_ms;
+    uint32_t unix_time;
+};
+
+/* false if data does not start with a trace header */
+bool trace_reader_init(struct trace_reader *reader, const uint8_t *data, size_t len);
+
+/* 1 with the next event, 0 at the end, -1 on a truncated or unknown record */
+int trace_next(struct trace_reader *reader, struct trace_event *event);
+
+struct trace_handlers {
+    /* a frame of the firmware loop, between the events */
+    void (*tick)(void *context, uint32_t now_ms);
+    void (*event)(void *context, const struct trace_event *event);
+};
+
+/*
+ * Replays a trace in virtual time: before each event every tick_ms frame up to
+ * its time runs, then the event is delivered. Nothing waits, a day of samples
+ * replays as fast as the handlers run, and the same trace always gives the same
+ * calls. Returns the number of events or -1 if the trace is corrupt.
+ */
+long trace_replay(const uint8_t *data, size_t len, uint32_t tick_ms, const struct trace_handlers *handlers,
+                  void *context);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* TRACE_H */
@@ -0,0 +1,38 @@
+#ifndef WIRE_I2C_BUS_H
+#define WIRE_I2C_BUS_H WIRE_I2C_BUS_H
+
+#include <Wire.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+
+#include <i2c-bus.h>
+
+#define WIRE_I2C_BUS_STACK 2048
+// above the loop task, the bus task sleeps while a transaction is running
+#define WIRE_I2C_BUS_PRIORITY 2
+
+/*
+ * Executes the transactions on a TwoWire in a task of its own. TwoWire locks
+ * every transaction, so the bus can be shared with libraries using it directly.
+ */
+class WireI2cBus : public I2cBus
+{
+public:
+    WireI2cBus(TwoWire &wire, const char *name);
+
+    // starts the task, the TwoWire has to be started before
+    bool begin();
+
+    bool submit(struct i2cTransaction *transaction);
+    bool transfer(struct i2cTransaction *transaction);
+
+private:
+    static void task(void *arg);
+    void execute(struct i2cTransaction *transaction);
+
+    TwoWire &wire;
+    const char *name;
+    QueueHandle_t queue;
+};
+
+#endif /* WIRE_I2C_BUS_H */
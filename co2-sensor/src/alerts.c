@@ -0,0 +1,120 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "alerts.h"
+
+#include <string.h>
+
+static struct alert_rule rules[ALERT_RULES_MAX];
+static uint8_t rules_len;
+
+static const char *metric_names[] = { "co2", "temperature", "humidity", "battery" };
+
+void alerts_clear(void)
+{
+    memset(rules, 0, sizeof(rules));
+    rules_len = 0;
+}
+
+bool alerts_add_rule(uint8_t metric, uint8_t direction, int32_t threshold, int32_t hysteresis, uint32_t min_duration_ms)
+{
+    struct alert_rule *rule;
+
+    if (rules_len >= ALERT_RULES_MAX || alerts_metric_name(metric) == NULL || direction > ALERT_BELOW) {
+        return false;
+    }
+
+    rule = &rules[rules_len++];
+    memset(rule, 0, sizeof(*rule));
+    rule->metric = metric;
+    rule->direction = direction;
+    rule->threshold = threshold;
+    rule->hysteresis = hysteresis < 0 ? -hysteresis : hysteresis;
+    rule->min_duration_ms = min_duration_ms;
+    return true;
+}
+
+uint8_t alerts_rule_count(void)
+{
+    return rules_len;
+}
+
+const struct alert_rule *alerts_get_rule(uint8_t index)
+{
+    return index < rules_len ? &rules[index] : NULL;
+}
+
+/* true if value asks for the opposite of the current rule state */
+static bool rule_wants_change(const struct alert_rule *rule, int32_t value)
+{
+    if (rule->direction == ALERT_ABOVE) {
+        return rule->active ? value < rule->threshold - rule->hysteresis : value > rule->threshold;
+    }
+
+    return rule->active ? value > rule->threshold + rule->hysteresis : value < rule->threshold;
+}
+
+void alerts_evaluate(uint8_t metric, int32_t value, uint32_t now_ms, alert_callback callback)
+{
+    for (uint8_t i = 0; i < rules_len; i++) {
+        struct alert_rule *rule = &rules[i];
+
+        if (rule->metric != metric) {
+            continue;
+        }
+
+        if (!rule_wants_change(rule, value)) {
+            rule->pending = false;
+            continue;
+        }
+
+        if (!rule->pending) {
+            rule->pending = true;
+            rule->pending_since_ms = now_ms;
+        }
+
+        if (now_ms - rule->pending_since_ms < rule->min_duration_ms) {
+            continue;
+        }
+
+        rule->pending = false;
+        rule->active = !rule->active;
+        if (callback != NULL) {
+            callback(rule, value, rule->active);
+        }
+    }
+}
+
+const char *alerts_metric_name(uint8_t metric)
+{
+    if (metric < ALERT_METRIC_CO2 || metric > ALERT_METRIC_BATTERY) {
+        return NULL;
+    }
+
+    return metric_names[metric - 1];
+}
+
+int alerts_metric_from_name(const char *name)
+{
+    for (uint8_t i = 0; i < sizeof(metric_names) / sizeof(metric_names[0]); i++) {
+        if (strcmp(name, metric_names[i]) == 0) {
+            return i + 1;
+        }
+    }
+
+    return -1;
+}
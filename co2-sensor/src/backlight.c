@@ -0,0 +1,127 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "backlight.h"
+
+#define BACKLIGHT_DEFAULT_CONFIG { 60000, 300000, false, 100, 40, 20, 7, 21 }
+
+static const struct backlight_config default_config = BACKLIGHT_DEFAULT_CONFIG;
+static struct backlight_config config = BACKLIGHT_DEFAULT_CONFIG;
+static enum backlight_state current;
+static uint8_t level;
+static uint32_t activity_ms;
+static uint32_t entered_ms;
+/* closed periods per state, the open one is added on reading */
+static uint64_t state_ms[BACKLIGHT_STATES];
+
+static void enter(enum backlight_state state, uint32_t now_ms)
+{
+    if (state == current) {
+        return;
+    }
+    state_ms[current] += now_ms - entered_ms;
+    entered_ms = now_ms;
+    current = state;
+}
+
+void backlight_reset(uint32_t now_ms)
+{
+    config = default_config;
+    current = BACKLIGHT_ON;
+    level = config.day_level;
+    activity_ms = now_ms;
+    entered_ms = now_ms;
+    for (uint8_t i = 0; i < BACKLIGHT_STATES; i++) {
+        state_ms[i] = 0;
+    }
+}
+
+bool backlight_configure(const struct backlight_config *new_config)
+{
+    if (new_config->day_level > 100 || new_config->night_level > 100 || new_config->dimmed_level > 100 ||
+        new_config->day_hour > 23 || new_config->night_hour > 23) {
+        return false;
+    }
+
+    config = *new_config;
+    return true;
+}
+
+const struct backlight_config *backlight_get_config(void)
+{
+    return &config;
+}
+
+void backlight_activity(uint32_t now_ms)
+{
+    activity_ms = now_ms;
+    enter(BACKLIGHT_ON, now_ms);
+}
+
+void backlight_sleep(uint32_t now_ms)
+{
+    enter(BACKLIGHT_ASLEEP, now_ms);
+}
+
+static bool is_day(uint8_t hour)
+{
+    if (config.day_hour <= config.night_hour) {
+        return hour >= config.day_hour && hour < config.night_hour;
+    }
+    return hour >= config.day_hour || hour < config.night_hour;
+}
+
+enum backlight_state backlight_update(uint32_t now_ms, uint8_t hour, bool ac)
+{
+    uint32_t idle_ms = now_ms - activity_ms;
+
+    if (current != BACKLIGHT_ASLEEP) {
+        if (config.sleep_after_ms > 0 && idle_ms >= config.sleep_after_ms && (!ac || config.sleep_on_ac)) {
+            enter(BACKLIGHT_ASLEEP, now_ms);
+        } else if (config.dim_after_ms > 0 && idle_ms >= config.dim_after_ms) {
+            enter(BACKLIGHT_DIMMED, now_ms);
+        }
+    }
+
+    switch (current) {
+    case BACKLIGHT_ON:
+        level = is_day(hour) ? config.day_level : config.night_level;
+        break;
+    case BACKLIGHT_DIMMED:
+        /* dimming never brightens a dark night setting */
+        level = is_day(hour) || config.night_level > config.dimmed_level ? config.dimmed_level : config.night_level;
+        break;
+    default:
+        level = 0;
+        break;
+    }
+    return current;
+}
+
+uint8_t backlight_level(void)
+{
+    return level;
+}
+
+uint32_t backlight_time(enum backlight_state state, uint32_t now_ms)
+{
+    if (state >= BACKLIGHT_STATES) {
+        return 0;
+    }
+    return (uint32_t)((state_ms[state] + (state == current ? now_ms - entered_ms : 0)) / 1000);
+}
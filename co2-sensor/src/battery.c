@@ -0,0 +1,217 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "battery.h"
+
+#include <math.h>
+#include <stddef.h>
+
+/* internal resistance of the cell and its wiring, separates the open circuit voltage from the load */
+#define BATTERY_RESISTANCE_OHM 0.2f
+/* the charger has terminated below this current at BATTERY_FULL_VOLTAGE */
+#define BATTERY_FULL_CURRENT_MA 20.0f
+#define BATTERY_FULL_VOLTAGE 4.15f
+/* open circuit voltage of the cutoff */
+#define BATTERY_EMPTY_VOLTAGE 3.3f
+/* the voltage of a cell settles within minutes once the current stops */
+#define BATTERY_REST_CURRENT_MA 30.0f
+#define BATTERY_REST_MS 300000
+/* share of the distance to the voltage based state of charge corrected per sample */
+#define BATTERY_GAIN_REST 0.05f
+#define BATTERY_GAIN_LOAD 0.002f
+/* a capacity is only learned between reference points this far apart */
+#define BATTERY_LEARN_SPAN 0.5f
+#define BATTERY_LEARN_WEIGHT 0.3f
+/* more than this between two samples means the counter was cleared */
+#define BATTERY_COUNTER_JUMP_MAH 50.0f
+
+struct ocv_point {
+    float voltage;
+    float soc;
+};
+
+/* open circuit voltage of a single LiPo cell at room temperature */
+static const struct ocv_point ocv_curve[] = {
+    { 3.27f, 0.00f }, { 3.61f, 0.05f }, { 3.69f, 0.10f }, { 3.71f, 0.15f },
+    { 3.73f, 0.20f }, { 3.75f, 0.25f }, { 3.77f, 0.30f }, { 3.79f, 0.35f },
+    { 3.80f, 0.40f }, { 3.82f, 0.45f }, { 3.84f, 0.50f }, { 3.85f, 0.55f },
+    { 3.87f, 0.60f }, { 3.91f, 0.65f }, { 3.95f, 0.70f }, { 3.98f, 0.75f },
+    { 4.02f, 0.80f }, { 4.08f, 0.85f }, { 4.11f, 0.90f }, { 4.15f, 0.95f },
+    { 4.20f, 1.00f }
+};
+
+#define OCV_POINTS (sizeof(ocv_curve) / sizeof(ocv_curve[0]))
+
+struct battery_state {
+    bool started;
+    struct battery_sample sample;
+    bool sampled;
+    float capacity_mah;
+    float soc;
+    /* coulomb counter of the last sample and the charge counted since the start */
+    float last_coulomb_mah;
+    float counted_mah;
+    uint32_t rest_since_ms;
+    bool resting;
+
+    /* last point with a known state of charge */
+    bool referenced;
+    float reference_soc;
+    float reference_mah;
+};
+
+static struct battery_state state = { .capacity_mah = 700 };
+
+static uint32_t be32(const uint8_t *data)
+{
+    return (uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 | (uint32_t)data[2] << 8 | data[3];
+}
+
+void battery_axp192_sample(struct battery_sample *sample, const uint8_t *power, const uint8_t *adc,
+                           const uint8_t *coulomb, uint32_t now_ms)
+{
+    /* 12 bit voltage in 1.1 mV, 13 bit currents in 0.5 mA */
+    uint16_t voltage = adc[0] << 4 | (adc[1] & 0x0f);
+    uint16_t charge = adc[2] << 5 | (adc[3] & 0x1f);
+    uint16_t discharge = adc[4] << 5 | (adc[5] & 0x1f);
+    /* 0.5 mA per count at 25 samples per second, of 65536 counts each */
+    int64_t counts = (int64_t)be32(coulomb) - be32(coulomb + 4);
+
+    sample->time_ms = now_ms;
+    sample->voltage = voltage * 0.0011f;
+    sample->current = ((int32_t)charge - discharge) * 0.5f;
+    sample->coulomb_mah = 65536 * 0.5f * counts / 3600.0f / 25.0f;
+    sample->ac = (power[0] & 0x80) != 0;
+    sample->charging = (power[1] & 0x40) != 0;
+}
+
+void battery_reset(float capacity_mah)
+{
+    bool valid = capacity_mah >= BATTERY_CAPACITY_MIN_MAH && capacity_mah <= BATTERY_CAPACITY_MAX_MAH;
+
+    state = (struct battery_state){ 0 };
+    state.capacity_mah = valid ? capacity_mah : 700;
+}
+
+float battery_ocv_soc(float voltage)
+{
+    if (voltage <= ocv_curve[0].voltage) {
+        return 0;
+    }
+    for (size_t i = 1; i < OCV_POINTS; i++) {
+        if (voltage < ocv_curve[i].voltage) {
+            const struct ocv_point *low = &ocv_curve[i - 1];
+            const struct ocv_point *high = &ocv_curve[i];
+            return low->soc + (high->soc - low->soc) * (voltage - low->voltage) / (high->voltage - low->voltage);
+        }
+    }
+    return 1;
+}
+
+/* learns the capacity from the charge counted since the last reference point */
+static void reference(float soc, bool anchor)
+{
+    float span = fabsf(soc - state.reference_soc);
+
+    if (state.referenced && span >= BATTERY_LEARN_SPAN) {
+        float capacity = fabsf(state.counted_mah - state.reference_mah) / span;
+
+        if (capacity >= BATTERY_CAPACITY_MIN_MAH && capacity <= BATTERY_CAPACITY_MAX_MAH) {
+            state.capacity_mah += BATTERY_LEARN_WEIGHT * (capacity - state.capacity_mah);
+        }
+    }
+
+    /* a rest point close to the last one keeps the older, more distant reference */
+    if (!state.referenced || anchor || span >= BATTERY_LEARN_SPAN) {
+        state.referenced = true;
+        state.reference_soc = soc;
+        state.reference_mah = state.counted_mah;
+    }
+}
+
+void battery_update(const struct battery_sample *sample)
+{
+    float ocv = sample->voltage - sample->current / 1000.0f * BATTERY_RESISTANCE_OHM;
+    float ocv_soc = battery_ocv_soc(ocv);
+    bool rest = fabsf(sample->current) < BATTERY_REST_CURRENT_MA;
+
+    state.sample = *sample;
+    state.sampled = true;
+
+    if (!state.started) {
+        state.started = true;
+        state.soc = ocv_soc;
+        state.last_coulomb_mah = sample->coulomb_mah;
+    }
+
+    float delta = sample->coulomb_mah - state.last_coulomb_mah;
+    state.last_coulomb_mah = sample->coulomb_mah;
+    if (fabsf(delta) > BATTERY_COUNTER_JUMP_MAH) {
+        delta = 0;
+    }
+    state.counted_mah += delta;
+    state.soc += delta / state.capacity_mah;
+
+    if (!rest || !state.resting) {
+        state.rest_since_ms = sample->time_ms;
+    }
+    state.resting = rest;
+
+    if (sample->ac && sample->voltage >= BATTERY_FULL_VOLTAGE && fabsf(sample->current) < BATTERY_FULL_CURRENT_MA) {
+        state.soc = 1;
+        reference(1, true);
+    } else if (!sample->ac && ocv <= BATTERY_EMPTY_VOLTAGE) {
+        state.soc = 0;
+        reference(0, true);
+    } else if (rest && sample->time_ms - state.rest_since_ms >= BATTERY_REST_MS) {
+        state.soc += BATTERY_GAIN_REST * (ocv_soc - state.soc);
+        reference(ocv_soc, false);
+    } else {
+        state.soc += BATTERY_GAIN_LOAD * (ocv_soc - state.soc);
+    }
+
+    state.soc = fminf(fmaxf(state.soc, 0), 1);
+}
+
+const struct battery_sample *battery_last_sample(uint32_t now_ms)
+{
+    if (!state.sampled || now_ms - state.sample.time_ms > BATTERY_SAMPLE_MAX_AGE_MS) {
+        return NULL;
+    }
+    return &state.sample;
+}
+
+float battery_soc(void)
+{
+    return state.soc;
+}
+
+int battery_percent(void)
+{
+    return (int)lroundf(state.soc * 100);
+}
+
+float battery_capacity(void)
+{
+    return state.capacity_mah;
+}
+
+float battery_remaining(void)
+{
+    return state.soc * state.capacity_mah;
+}
@@ -0,0 +1,284 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "data-log-writer.h"
+#include "health.h"
+
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include <string.h>
+
+DataLogWriter::DataLogWriter(DataLog &log, RemovableVolume &volume, DataRetention *retention, fs::FS *traceFs,
+                             const char *tracePath)
+    : log(log), volume(volume), retention(retention), ring(NULL), capacity(0), head(0), tail(0), droppedCount(0),
+      isMounted(false), nextMountMs(0), newestTime(0), nextCompactMs(0), handle(NULL), mutex(NULL),
+      traceFs(traceFs), tracePath(tracePath), traceRing(NULL), traceHead(0), traceTail(0), traceFailed(false)
+{
+}
+
+DataLogWriter::~DataLogWriter()
+{
+    free(ring);
+    free(traceRing);
+    if (mutex != NULL)
+    {
+        vSemaphoreDelete(mutex);
+    }
+}
+
+bool DataLogWriter::begin()
+{
+    if (ring == NULL)
+    {
+        capacity = DATA_LOG_BACKLOG;
+        ring = (struct dataRecord *)heap_caps_malloc(capacity * sizeof(struct dataRecord), MALLOC_CAP_SPIRAM);
+        if (ring == NULL)
+        {
+            capacity = DATA_LOG_BACKLOG_INTERNAL;
+            ring = (struct dataRecord *)malloc(capacity * sizeof(struct dataRecord));
+        }
+        if (ring == NULL)
+        {
+            capacity = 0;
+            return false;
+        }
+    }
+    if (traceFs != NULL && traceRing == NULL)
+    {
+        traceRing = (uint8_t *)heap_caps_malloc(DATA_LOG_TRACE_BUFFER, MALLOC_CAP_SPIRAM);
+        if (traceRing == NULL)
+        {
+            traceRing = (uint8_t *)malloc(DATA_LOG_TRACE_BUFFER);
+        }
+    }
+    if (mutex == NULL && (mutex = xSemaphoreCreateMutex()) == NULL)
+    {
+        return false;
+    }
+
+    // at startup the card is mounted right away, so the history can be restored from it
+    mount(millis());
+
+    if (handle == NULL && xTaskCreatePinnedToCore(task, "data-log", DATA_LOG_WRITER_STACK, this,
+                                                  DATA_LOG_WRITER_PRIORITY, &handle, DATA_LOG_WRITER_CORE) != pdPASS)
+    {
+        handle = NULL;
+        return false;
+    }
+    return true;
+}
+
+bool DataLogWriter::submit(const struct dataRecord *record)
+{
+    uint32_t tailNow = __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+
+    if (capacity == 0 || head - tailNow >= capacity)
+    {
+        droppedCount++;
+        health_record_sd_dropped();
+        return false;
+    }
+
+    ring[head % capacity] = *record;
+    __atomic_store_n(&head, head + 1, __ATOMIC_RELEASE);
+    if (handle != NULL)
+    {
+        xTaskNotifyGive(handle);
+    }
+    return true;
+}
+
+bool DataLogWriter::mounted() const
+{
+    return isMounted;
+}
+
+uint32_t DataLogWriter::pending() const
+{
+    return __atomic_load_n(&head, __ATOMIC_ACQUIRE) - __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+}
+
+uint32_t DataLogWriter::dropped() const
+{
+    return droppedCount;
+}
+
+bool DataLogWriter::restartTrace()
+{
+    if (traceRing == NULL || !lock())
+    {
+        return false;
+    }
+
+    // between two steps, the task does not touch the trace
+    bool restarted = isMounted;
+    if (restarted)
+    {
+        __atomic_store_n(&traceTail, traceHead, __ATOMIC_RELEASE);
+        traceFailed = false;
+        traceFs->remove(tracePath);
+    }
+    unlock();
+    return restarted;
+}
+
+bool DataLogWriter::submitTrace(const uint8_t *data, size_t len)
+{
+    uint32_t used = traceHead - __atomic_load_n(&traceTail, __ATOMIC_ACQUIRE);
+
+    if (traceRing == NULL || traceFailed || len > DATA_LOG_TRACE_BUFFER - used)
+    {
+        return false;
+    }
+
+    // up to the end of the ring, the rest from its start
+    uint32_t at = traceHead % DATA_LOG_TRACE_BUFFER;
+    size_t first = min(len, (size_t)(DATA_LOG_TRACE_BUFFER - at));
+    memcpy(&traceRing[at], data, first);
+    memcpy(traceRing, data + first, len - first);
+    __atomic_store_n(&traceHead, traceHead + len, __ATOMIC_RELEASE);
+    if (handle != NULL)
+    {
+        xTaskNotifyGive(handle);
+    }
+    return true;
+}
+
+bool DataLogWriter::lock(TickType_t wait)
+{
+    return mutex != NULL && xSemaphoreTake(mutex, wait) == pdTRUE;
+}
+
+void DataLogWriter::unlock()
+{
+    xSemaphoreGive(mutex);
+}
+
+bool DataLogWriter::mount(uint32_t nowMs)
+{
+    if (!volume.mount() || !log.begin() || (retention != NULL && !retention->begin()))
+    {
+        volume.unmount();
+        nextMountMs = nowMs + DATA_LOG_MOUNT_RETRY_MS;
+        return false;
+    }
+
+    isMounted = true;
+    health_record_sd_mount();
+    return true;
+}
+
+void DataLogWriter::unmount(uint32_t nowMs)
+{
+    isMounted = false;
+    volume.unmount();
+    nextMountMs = nowMs + DATA_LOG_MOUNT_RETRY_MS;
+}
+
+uint32_t DataLogWriter::run(uint32_t nowMs)
+{
+    // a reader holds the card for a chunk of a query at most
+    if (!lock(pdMS_TO_TICKS(DATA_LOG_IDLE_MS)))
+    {
+        return 0;
+    }
+    uint32_t wait = step(nowMs);
+    unlock();
+    return wait;
+}
+
+uint32_t DataLogWriter::step(uint32_t nowMs)
+{
+    if (!isMounted && ((int32_t)(nowMs - nextMountMs) < 0 || !mount(nowMs)))
+    {
+        return nextMountMs - nowMs;
+    }
+
+    writeTrace();
+
+    uint32_t first = tail;
+    uint32_t count = __atomic_load_n(&head, __ATOMIC_ACQUIRE) - first;
+    health_set_sd_backlog(count);
+    if (count == 0)
+    {
+        // records submitted meanwhile wait in the ring
+        if (retention != NULL && newestTime != 0 && (int32_t)(nowMs - nextCompactMs) >= 0)
+        {
+            nextCompactMs = nowMs + DATA_RETENTION_INTERVAL_MS;
+            retention->compact(newestTime);
+        }
+        return DATA_LOG_IDLE_MS;
+    }
+
+    // up to the end of the ring, the rest in the next step
+    count = min(min(count, capacity - first % capacity), (uint32_t)DATA_LOG_WRITE_BATCH);
+    int64_t start = esp_timer_get_time();
+    size_t written = log.append(&ring[first % capacity], count);
+    if (written > 0)
+    {
+        health_record_sd_write(esp_timer_get_time() - start);
+        newestTime = ring[(first + written - 1) % capacity].time;
+    }
+    __atomic_store_n(&tail, first + written, __ATOMIC_RELEASE);
+
+    // the card was taken out or is full
+    if (written < count)
+    {
+        unmount(nowMs);
+        return DATA_LOG_MOUNT_RETRY_MS;
+    }
+    return 0;
+}
+
+// a failed write stops the trace, what is queued of it is dropped
+void DataLogWriter::writeTrace()
+{
+    uint32_t first = traceTail;
+    uint32_t count = __atomic_load_n(&traceHead, __ATOMIC_ACQUIRE) - first;
+
+    if (count == 0)
+    {
+        return;
+    }
+    if (!traceFailed)
+    {
+        uint32_t at = first % DATA_LOG_TRACE_BUFFER;
+        uint32_t len = min(count, (uint32_t)DATA_LOG_TRACE_BUFFER - at);
+        File file = traceFs->open(tracePath, FILE_APPEND);
+
+        traceFailed = !file || file.write(&traceRing[at], len) != len ||
+                      file.write(traceRing, count - len) != count - len;
+        if (file)
+        {
+            file.close();
+        }
+    }
+    __atomic_store_n(&traceTail, first + count, __ATOMIC_RELEASE);
+}
+
+void DataLogWriter::task(void *arg)
+{
+    DataLogWriter *writer = (DataLogWriter *)arg;
+
+    for (;;)
+    {
+        // a tick at least, so the idle task of the core gets its turn while a backlog is written
+        TickType_t wait = pdMS_TO_TICKS(writer->run(millis()));
+        ulTaskNotifyTake(pdTRUE, wait > 0 ? wait : 1);
+    }
+}
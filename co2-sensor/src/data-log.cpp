@@ -0,0 +1,671 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "data-log.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// the battery charge is logged in tenths of mAh, NAN before the first reading
+#define BATTERY_UNKNOWN INT32_MIN
+
+static void toValues(const struct dataRecord *record, int32_t *values)
+{
+    values[0] = record->co2Ppm;
+    values[1] = record->temperature;
+    values[2] = record->humidity;
+    values[3] = isnan(record->batteryMah) ? BATTERY_UNKNOWN : (int32_t)lroundf(record->batteryMah * 10);
+}
+
+static void fromValues(const int32_t *values, struct dataRecord *record)
+{
+    record->co2Ppm = values[0];
+    record->temperature = values[1];
+    record->humidity = values[2];
+    record->batteryMah = values[3] == BATTERY_UNKNOWN ? NAN : values[3] / 10.0f;
+}
+
+// binary search for the first block of slot or later
+static bool findBlock(File &index, uint32_t slot, uint32_t *block)
+{
+    struct dataIndexEntry entry;
+    uint32_t low = 0;
+    uint32_t high = index.size() / sizeof(entry);
+
+    while (low < high)
+    {
+        uint32_t middle = low + (high - low) / 2;
+        index.seek(middle * sizeof(entry));
+        if (index.read((uint8_t *)&entry, sizeof(entry)) != sizeof(entry))
+        {
+            return false;
+        }
+        if (entry.slot < slot)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    *block = low;
+    return true;
+}
+
+// binary search in the list of segments for the first one from segment on
+static bool findSegment(File &segments, uint32_t segment, uint32_t *position)
+{
+    uint32_t entry;
+    uint32_t low = 0;
+    uint32_t high = segments.size() / sizeof(entry);
+
+    while (low < high)
+    {
+        uint32_t middle = low + (high - low) / 2;
+        segments.seek(middle * sizeof(entry));
+        if (segments.read((uint8_t *)&entry, sizeof(entry)) != sizeof(entry))
+        {
+            return false;
+        }
+        if (entry < segment)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    *position = low;
+    return true;
+}
+
+// the last complete entry of a file of fixed size entries, a reset can leave a partial one behind
+static bool readLast(fs::FS &fs, const char *path, uint8_t *entry, size_t len)
+{
+    File file = fs.open(path, FILE_READ);
+    bool found = file && file.size() >= len && file.seek(file.size() / len * len - len) &&
+                 file.read(entry, len) == len;
+
+    file.close();
+    return found;
+}
+
+DataLog::DataLog(fs::FS &fs, const char *dataPath, const char *indexPath, uint32_t period, uint32_t segment)
+    : fs(fs), dataPath(dataPath), indexPath(indexPath), period(period), segmentLen(segment), hasSegments(false),
+      lastSegment(0), lastSlot(0), blockStarted(false), blockLen(0), readers(0)
+{
+}
+
+bool DataLog::begin()
+{
+    char data[DATA_LOG_PATH_MAX];
+    char index[DATA_LOG_PATH_MAX];
+    struct dataIndexEntry entry;
+
+    if (!readSegments())
+    {
+        return false;
+    }
+
+    // a log of older firmware in one file becomes the last segment, a query of any range reads it
+    if (fs.exists(dataPath))
+    {
+        if (!hasSegments && !readLast(fs, indexPath, (uint8_t *)&entry, sizeof(entry)))
+        {
+            // nothing of it was indexed
+            fs.remove(dataPath);
+            fs.remove(indexPath);
+        }
+        else if (!hasSegments && !addSegment(entry.slot * (uint64_t)period / segmentLen))
+        {
+            return false;
+        }
+        segmentPath(data, dataPath, lastSegment);
+        segmentPath(index, indexPath, lastSegment);
+        // the index first, a reset in between finds the data file still to be moved
+        if (hasSegments && fs.exists(indexPath) && !fs.exists(index) && !fs.rename(indexPath, index))
+        {
+            return false;
+        }
+        if (hasSegments && !fs.exists(data) && !fs.rename(dataPath, data))
+        {
+            return false;
+        }
+    }
+
+    // the index continues after its last entry, the records in a new block
+    segmentPath(index, indexPath, lastSegment);
+    if (hasSegments && readLast(fs, index, (uint8_t *)&entry, sizeof(entry)))
+    {
+        lastSlot = entry.slot;
+    }
+    blockStarted = false;
+    return true;
+}
+
+// the list of segments, completes a replacement of it which was interrupted
+bool DataLog::readSegments()
+{
+    char segments[DATA_LOG_PATH_MAX];
+    char segmentsNew[DATA_LOG_PATH_MAX];
+
+    path(segments, dataPath, ".seg");
+    path(segmentsNew, dataPath, ".seg.new");
+    if (fs.exists(segmentsNew))
+    {
+        // the new list is only renamed once it is complete and the old one removed
+        if (fs.exists(segments) ? !fs.remove(segmentsNew) : !fs.rename(segmentsNew, segments))
+        {
+            return false;
+        }
+    }
+
+    hasSegments = readLast(fs, segments, (uint8_t *)&lastSegment, sizeof(lastSegment));
+    return true;
+}
+
+// lists segment as the last one before its files are created
+bool DataLog::addSegment(uint32_t segment)
+{
+    char segments[DATA_LOG_PATH_MAX];
+
+    path(segments, dataPath, ".seg");
+    // a partial entry of a reset before would be taken for the start of this one
+    File list = fs.open(segments, FILE_READ);
+    if (list && list.size() % sizeof(segment) != 0 && !replaceSegments(list))
+    {
+        return false;
+    }
+    list.close();
+
+    File file = fs.open(segments, FILE_APPEND);
+    if (!file)
+    {
+        return false;
+    }
+    bool written = file.write((const uint8_t *)&segment, sizeof(segment)) == sizeof(segment);
+    file.close();
+    if (!written)
+    {
+        return false;
+    }
+
+    hasSegments = true;
+    lastSegment = segment;
+    // the new index starts with the next record
+    blockStarted = false;
+    return true;
+}
+
+bool DataLog::openSegment(uint32_t segment, File *file)
+{
+    char data[DATA_LOG_PATH_MAX];
+
+    if ((!hasSegments || segment > lastSegment) && !addSegment(segment))
+    {
+        return false;
+    }
+    segmentPath(data, dataPath, lastSegment);
+    *file = fs.open(data, FILE_APPEND);
+    return *file;
+}
+
+bool DataLog::newest(uint32_t *time)
+{
+    struct dataRecord record;
+    bool found = false;
+
+    // records of the last block from before it started are only there after the clock went back
+    DataLogQuery query(*this, lastSlot * period, UINT32_MAX);
+    while (query.next(&record))
+    {
+        if (!found || record.time > *time)
+        {
+            *time = record.time;
+        }
+        found = true;
+    }
+    return found;
+}
+
+uint32_t DataLog::segmentStart(uint32_t time) const
+{
+    return time / segmentLen * segmentLen;
+}
+
+// path with its extension replaced by suffix
+void DataLog::path(char *out, const char *path, const char *suffix) const
+{
+    const char *dot = strrchr(path, '.');
+
+    snprintf(out, DATA_LOG_PATH_MAX, "%.*s%s", dot != NULL ? (int)(dot - path) : (int)strlen(path), path, suffix);
+}
+
+// log.bin of the segment starting on 2024-01-15 is log-20240115.bin
+void DataLog::segmentPath(char *out, const char *path, uint32_t segment) const
+{
+    const char *dot = strrchr(path, '.');
+    time_t start = (time_t)segment * segmentLen;
+    struct tm day;
+
+    gmtime_r(&start, &day);
+    snprintf(out, DATA_LOG_PATH_MAX, "%.*s-%04d%02d%02d%s", dot != NULL ? (int)(dot - path) : (int)strlen(path),
+             path, day.tm_year + 1900, day.tm_mon + 1, day.tm_mday, dot != NULL ? dot : "");
+}
+
+bool DataLog::dropBefore(uint32_t time)
+{
+    char segmentsPath[DATA_LOG_PATH_MAX];
+    char file[DATA_LOG_PATH_MAX];
+    uint32_t count;
+    uint32_t segment = 0;
+
+    path(segmentsPath, dataPath, ".seg");
+    File segments = fs.open(segmentsPath, FILE_READ);
+    if (!segments)
+    {
+        return !hasSegments;
+    }
+    if (!findSegment(segments, time / segmentLen, &count))
+    {
+        segments.close();
+        return false;
+    }
+    // a query which started meanwhile reads the files, the drop is tried again later
+    if (count == 0 || __atomic_load_n(&readers, __ATOMIC_ACQUIRE) > 0)
+    {
+        segments.close();
+        return count == 0;
+    }
+
+    // the files go first, a reset meanwhile leaves segments in the list which are skipped and removed again
+    bool removed = segments.seek(0);
+    for (uint32_t i = 0; removed && i < count; i++)
+    {
+        removed = segments.read((uint8_t *)&segment, sizeof(segment)) == sizeof(segment);
+        segmentPath(file, dataPath, segment);
+        removed = removed && (!fs.exists(file) || fs.remove(file));
+        segmentPath(file, indexPath, segment);
+        removed = removed && (!fs.exists(file) || fs.remove(file));
+    }
+
+    if (!removed)
+    {
+        segments.close();
+        return false;
+    }
+    return replaceSegments(segments);
+}
+
+// replaces the list by the entries of segments from its position on, closes it
+bool DataLog::replaceSegments(File &segments)
+{
+    char segmentsPath[DATA_LOG_PATH_MAX];
+    char segmentsNew[DATA_LOG_PATH_MAX];
+    uint32_t segment;
+
+    path(segmentsPath, dataPath, ".seg");
+    path(segmentsNew, dataPath, ".seg.new");
+
+    // a partial entry at the end is left out
+    File rest = fs.open(segmentsNew, FILE_WRITE);
+    bool empty = true;
+    bool written = rest;
+    while (written && segments.read((uint8_t *)&segment, sizeof(segment)) == sizeof(segment))
+    {
+        written = rest.write((const uint8_t *)&segment, sizeof(segment)) == sizeof(segment);
+        empty = false;
+    }
+    rest.close();
+    segments.close();
+
+    if (!written || !fs.remove(segmentsPath))
+    {
+        fs.remove(segmentsNew);
+        return false;
+    }
+    if (empty)
+    {
+        // the last segment has no entries after it
+        fs.remove(segmentsNew);
+        hasSegments = false;
+        blockStarted = false;
+        return true;
+    }
+    return fs.rename(segmentsNew, segmentsPath);
+}
+
+bool DataLog::startBlock(uint32_t slot, uint32_t offset)
+{
+    char path[DATA_LOG_PATH_MAX];
+    struct dataIndexEntry entry = {slot, offset};
+
+    segmentPath(path, indexPath, lastSegment);
+    File index = fs.open(path, FILE_APPEND);
+    if (!index || index.write((const uint8_t *)&entry, sizeof(entry)) != sizeof(entry))
+    {
+        return false;
+    }
+    index.close();
+
+    lastSlot = slot;
+    blockStarted = true;
+    gorilla_encoder_init(&encoder, DATA_LOG_FIELDS);
+    return true;
+}
+
+size_t DataLog::append(const struct dataRecord *records, size_t count)
+{
+    uint8_t data[DATA_LOG_WRITE_BUFFER];
+    int32_t values[DATA_LOG_FIELDS];
+    size_t len = 0;
+    size_t written = 0;
+    uint32_t size = 0;
+    File file;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        uint32_t slot = records[i].time / period;
+        uint32_t segment = records[i].time / segmentLen;
+
+        // the clock going back keeps the segment and the block, so the index stays sorted
+        bool newSegment = !hasSegments || segment > lastSegment;
+        bool newBlock = newSegment || !blockStarted || slot > lastSlot ||
+                        blockLen + GORILLA_RECORD_MAX > DATA_LOG_BLOCK_MAX;
+        if (len + DATA_LOG_MAGIC_LEN + GORILLA_RECORD_MAX > sizeof(data) || (newBlock && len > 0))
+        {
+            // the block cannot continue after a partly written record
+            blockStarted = file.write(data, len) == len;
+            if (!blockStarted)
+            {
+                len = 0;
+                break;
+            }
+            size += len;
+            written = i;
+            len = 0;
+        }
+        if (newSegment || !file)
+        {
+            file.close();
+            if (!openSegment(segment, &file))
+            {
+                break;
+            }
+            size = file.size();
+        }
+        // the index points at the block only once all records before it are written
+        if (newBlock)
+        {
+            if (!startBlock(slot > lastSlot ? slot : lastSlot, size))
+            {
+                break;
+            }
+            memcpy(data, DATA_LOG_MAGIC, DATA_LOG_MAGIC_LEN);
+            len = DATA_LOG_MAGIC_LEN;
+            blockLen = DATA_LOG_MAGIC_LEN;
+        }
+
+        toValues(&records[i], values);
+        uint8_t recordLen = gorilla_encode(&encoder, records[i].time, values, data + len);
+        len += recordLen;
+        blockLen += recordLen;
+    }
+
+    if (len > 0)
+    {
+        blockStarted = file.write(data, len) == len;
+        if (blockStarted)
+        {
+            written = count;
+        }
+    }
+    file.close();
+    return written;
+}
+
+int DataLog::format(char *line, size_t len, const struct dataRecord *record)
+{
+    time_t time = record->time;
+    struct tm local;
+
+    localtime_r(&time, &local);
+    int written = snprintf(line, len, "%04d-%02d-%02d-%02d-%02d-%02d,%d,%.2f,%.2f,%.2f\r\n", local.tm_year + 1900,
+                           local.tm_mon + 1, local.tm_mday, local.tm_hour, local.tm_min, local.tm_sec,
+                           record->co2Ppm, record->temperature / 10.0, record->humidity / 10.0,
+                           record->batteryMah);
+    return written < (int)len ? written : len - 1;
+}
+
+const char *DataLog::header()
+{
+    return "Date, Co2 (ppm), Temperature, Humidity, Battery Charge \r\n";
+}
+
+DataLogQuery::DataLogQuery(DataLog &log, uint32_t from, uint32_t to)
+    : logCount(1), current(0), reading(false), from(from), to(to), segment(0), block(0), blockCount(0),
+      records(0), started(false), done(false), blockData(NULL), pendingLen(0), pendingPos(0), headerSent(false)
+{
+    logs[0] = &log;
+    decoder.len = 0;
+    decoder.pos = 0;
+}
+
+DataLogQuery::DataLogQuery(DataLog *const *logs, uint8_t count, uint32_t from, uint32_t to)
+    : logCount(count < DATA_LOG_QUERY_LOGS ? count : DATA_LOG_QUERY_LOGS), current(0), reading(false), from(from),
+      to(to), segment(0), block(0), blockCount(0), records(0), started(false), done(false), blockData(NULL),
+      pendingLen(0), pendingPos(0), headerSent(false)
+{
+    memcpy(this->logs, logs, logCount * sizeof(logs[0]));
+    decoder.len = 0;
+    decoder.pos = 0;
+}
+
+DataLogQuery::~DataLogQuery()
+{
+    close();
+    free(blockData);
+}
+
+bool DataLogQuery::seek()
+{
+    DataLog *log = logs[current];
+    char path[DATA_LOG_PATH_MAX];
+    uint32_t position;
+
+    // counted before the files are opened, so a drop does not remove them meanwhile
+    __atomic_add_fetch(&log->readers, 1, __ATOMIC_ACQ_REL);
+    reading = true;
+
+    log->path(path, log->dataPath, ".seg");
+    segments = log->fs.open(path, FILE_READ);
+    if (blockData == NULL)
+    {
+        blockData = (uint8_t *)malloc(DATA_LOG_BLOCK_MAX);
+    }
+    decoder.len = 0;
+    decoder.pos = 0;
+    return segments && blockData != NULL && findSegment(segments, from / log->segmentLen, &position) &&
+           segments.seek(position * sizeof(segment)) && openSegment();
+}
+
+// opens the next segment which has a block in the range, false after the last one
+bool DataLogQuery::openSegment()
+{
+    DataLog *log = logs[current];
+    char path[DATA_LOG_PATH_MAX];
+
+    index.close();
+    file.close();
+    while (segments.read((uint8_t *)&segment, sizeof(segment)) == sizeof(segment) &&
+           segment * (uint64_t)log->segmentLen < to)
+    {
+        // the files of a segment whose drop was interrupted are gone already
+        log->segmentPath(path, log->indexPath, segment);
+        index = log->fs.open(path, FILE_READ);
+        log->segmentPath(path, log->dataPath, segment);
+        file = log->fs.open(path, FILE_READ);
+        if (index && file && findBlock(index, from / log->period, &block))
+        {
+            return true;
+        }
+        index.close();
+        file.close();
+    }
+    return false;
+}
+
+void DataLogQuery::close()
+{
+    segments.close();
+    index.close();
+    file.close();
+    if (reading)
+    {
+        __atomic_sub_fetch(&logs[current]->readers, 1, __ATOMIC_ACQ_REL);
+        reading = false;
+    }
+}
+
+// reads the next block, it ends where the next one starts
+bool DataLogQuery::loadBlock()
+{
+    struct dataIndexEntry entry;
+    struct dataIndexEntry nextEntry;
+
+    // the blocks of a segment are in the order of their slots, later segments can still have some in range
+    while (!index.seek(block * sizeof(entry)) || index.read((uint8_t *)&entry, sizeof(entry)) != sizeof(entry) ||
+           entry.slot * (uint64_t)logs[current]->period >= to)
+    {
+        if (!openSegment())
+        {
+            return false;
+        }
+    }
+    uint32_t end = index.read((uint8_t *)&nextEntry, sizeof(nextEntry)) == sizeof(nextEntry) ? nextEntry.offset
+                                                                                            : file.size();
+    uint32_t len = end > entry.offset ? end - entry.offset : 0;
+    if (len > DATA_LOG_BLOCK_MAX)
+    {
+        len = DATA_LOG_BLOCK_MAX;
+    }
+    block++;
+
+    if (len < DATA_LOG_MAGIC_LEN || !file.seek(entry.offset) || file.read(blockData, len) != len ||
+        memcmp(blockData, DATA_LOG_MAGIC, DATA_LOG_MAGIC_LEN) != 0)
+    {
+        // an empty or damaged block is skipped
+        len = DATA_LOG_MAGIC_LEN;
+    }
+    gorilla_decoder_init(&decoder, DATA_LOG_FIELDS, blockData + DATA_LOG_MAGIC_LEN, len - DATA_LOG_MAGIC_LEN);
+    blockCount++;
+    return true;
+}
+
+bool DataLogQuery::next(struct dataRecord *record)
+{
+    int32_t values[DATA_LOG_FIELDS];
+
+    while (current < logCount)
+    {
+        if (!started)
+        {
+            started = true;
+            done = !seek();
+        }
+
+        while (!done)
+        {
+            if (!gorilla_decode(&decoder, &record->time, values))
+            {
+                done = !loadBlock();
+                continue;
+            }
+
+            records++;
+            if (record->time < from)
+            {
+                continue;
+            }
+            if (record->time >= to)
+            {
+                // later blocks can still hold records from before the clock went back
+                continue;
+            }
+            fromValues(values, record);
+            return true;
+        }
+
+        close();
+        current++;
+        started = false;
+    }
+    return false;
+}
+
+size_t DataLogQuery::read(uint8_t *out, size_t len)
+{
+    struct dataRecord record;
+    size_t written = 0;
+
+    if (!headerSent)
+    {
+        strncpy(line, DataLog::header(), sizeof(line) - 1);
+        line[sizeof(line) - 1] = '\0';
+        pendingLen = strlen(line);
+        pendingPos = 0;
+        headerSent = true;
+    }
+
+    while (written < len)
+    {
+        if (pendingPos == pendingLen)
+        {
+            if (!next(&record))
+            {
+                break;
+            }
+            pendingLen = DataLog::format(line, sizeof(line), &record);
+            pendingPos = 0;
+        }
+
+        size_t copy = pendingLen - pendingPos;
+        if (copy > len - written)
+        {
+            copy = len - written;
+        }
+        memcpy(out + written, line + pendingPos, copy);
+        pendingPos += copy;
+        written += copy;
+    }
+    return written;
+}
+
+uint32_t DataLogQuery::blocks() const
+{
+    return blockCount;
+}
+
+uint32_t DataLogQuery::scanned() const
+{
+    return records;
+}
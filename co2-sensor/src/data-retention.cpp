@@ -0,0 +1,183 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "data-retention.h"
+
+#include <math.h>
+#include <string.h>
+
+#define DAY_SECONDS 86400
+
+// the sums of the records of a period, the mean is its aggregate
+struct rollupSum
+{
+    uint32_t start;
+    uint32_t count;
+    int64_t co2Ppm;
+    int64_t temperature;
+    int64_t humidity;
+    double batteryMah;
+    // the battery charge is unknown before its first reading
+    uint32_t batteryCount;
+};
+
+static void addRecord(struct rollupSum *sum, uint32_t start, const struct dataRecord *record)
+{
+    if (sum->count == 0)
+    {
+        memset(sum, 0, sizeof(*sum));
+        sum->start = start;
+    }
+    sum->count++;
+    sum->co2Ppm += record->co2Ppm;
+    sum->temperature += record->temperature;
+    sum->humidity += record->humidity;
+    if (!isnan(record->batteryMah))
+    {
+        sum->batteryMah += record->batteryMah;
+        sum->batteryCount++;
+    }
+}
+
+static void takeMean(struct rollupSum *sum, struct dataRecord *record)
+{
+    record->time = sum->start;
+    record->co2Ppm = llround((double)sum->co2Ppm / sum->count);
+    record->temperature = llround((double)sum->temperature / sum->count);
+    record->humidity = llround((double)sum->humidity / sum->count);
+    record->batteryMah = sum->batteryCount > 0 ? sum->batteryMah / sum->batteryCount : NAN;
+    sum->count = 0;
+}
+
+DataRetention::DataRetention(DataLog &raw, DataLog &minutes, DataLog &hours)
+    : raw(raw), minutes(minutes), hours(hours), rawWindow(DATA_RETENTION_RAW_DAYS),
+      minuteWindow(DATA_RETENTION_MINUTE_DAYS), hourWindow(DATA_RETENTION_HOUR_DAYS)
+{
+    tiers[0] = &hours;
+    tiers[1] = &minutes;
+    tiers[2] = &raw;
+}
+
+bool DataRetention::begin()
+{
+    return minutes.begin() && hours.begin();
+}
+
+bool DataRetention::configure(uint16_t rawDays, uint16_t minuteDays, uint16_t hourDays)
+{
+    if (rawDays < 1 || minuteDays < rawDays || hourDays < minuteDays || hourDays > DATA_RETENTION_DAYS_MAX)
+    {
+        return false;
+    }
+
+    rawWindow = rawDays;
+    minuteWindow = minuteDays;
+    hourWindow = hourDays;
+    return true;
+}
+
+uint16_t DataRetention::rawDays() const
+{
+    return rawWindow;
+}
+
+uint16_t DataRetention::minuteDays() const
+{
+    return minuteWindow;
+}
+
+uint16_t DataRetention::hourDays() const
+{
+    return hourWindow;
+}
+
+DataLog *const *DataRetention::logs() const
+{
+    return tiers;
+}
+
+bool DataRetention::compact(uint32_t now)
+{
+    uint32_t rawSeconds = (uint32_t)rawWindow * DAY_SECONDS;
+    uint32_t minuteSeconds = (uint32_t)minuteWindow * DAY_SECONDS;
+    uint32_t hourSeconds = (uint32_t)hourWindow * DAY_SECONDS;
+    bool compacted = true;
+
+    // a clock which was never set has nothing that old
+    if (now > rawSeconds)
+    {
+        compacted = rollup(raw, minutes, DATA_RETENTION_MINUTE, raw.segmentStart(now - rawSeconds));
+    }
+    if (compacted && now > minuteSeconds)
+    {
+        compacted = rollup(minutes, hours, DATA_RETENTION_HOUR, minutes.segmentStart(now - minuteSeconds));
+    }
+    if (compacted && now > hourSeconds)
+    {
+        compacted = hours.dropBefore(hours.segmentStart(now - hourSeconds));
+    }
+    return compacted;
+}
+
+// before is the start of a segment of the source, so the query reads exactly the segments which are dropped
+bool DataRetention::rollup(DataLog &source, DataLog &target, uint32_t period, uint32_t before)
+{
+    struct dataRecord batch[DATA_RETENTION_BATCH];
+    struct dataRecord record;
+    struct rollupSum sum;
+    size_t len = 0;
+    uint32_t rolledUntil = 0;
+    bool rolled = target.newest(&rolledUntil);
+    bool appended = true;
+
+    sum.count = 0;
+    {
+        DataLogQuery query(source, 0, before);
+        while (appended && query.next(&record))
+        {
+            uint32_t start = record.time / period * period;
+            if (rolled && start <= rolledUntil)
+            {
+                continue;
+            }
+
+            if (sum.count > 0 && start != sum.start)
+            {
+                takeMean(&sum, &batch[len++]);
+                if (len == DATA_RETENTION_BATCH)
+                {
+                    appended = target.append(batch, len) == len;
+                    len = 0;
+                }
+            }
+            addRecord(&sum, start, &record);
+        }
+    }
+
+    if (appended && sum.count > 0)
+    {
+        takeMean(&sum, &batch[len++]);
+    }
+    if (appended && len > 0)
+    {
+        appended = target.append(batch, len) == len;
+    }
+
+    // the blocks are only dropped once their aggregates are written
+    return appended && source.dropBefore(before);
+}
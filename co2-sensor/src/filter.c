@@ -0,0 +1,193 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "filter.h"
+
+#include <math.h>
+#include <string.h>
+
+struct filter_state {
+    /* median window in arrival order and sorted */
+    int32_t window[FILTER_MEDIAN_MAX];
+    int32_t sorted[FILTER_MEDIAN_MAX];
+    uint8_t window_len;
+    uint8_t window_pos;
+
+    bool started;
+    float estimate;
+    float variance;
+    int32_t output;
+    uint32_t last_ms;
+    int32_t raw;
+};
+
+/* a median of three removes single sample spikes and delays by one sample */
+#define FILTER_DEFAULT_CONFIG { 3, FILTER_SMOOTHING_NONE, 0.5f, 1.0f, 1.0f, 0 }
+
+static const struct filter_config default_config = FILTER_DEFAULT_CONFIG;
+static struct filter_config configs[FILTER_METRICS] = { FILTER_DEFAULT_CONFIG, FILTER_DEFAULT_CONFIG, FILTER_DEFAULT_CONFIG };
+static struct filter_state states[FILTER_METRICS];
+
+static const char *smoothing_names[] = { "none", "ema", "kalman" };
+
+void filter_reset(void)
+{
+    for (uint8_t i = 0; i < FILTER_METRICS; i++) {
+        configs[i] = default_config;
+    }
+    memset(states, 0, sizeof(states));
+}
+
+bool filter_configure(uint8_t metric, const struct filter_config *config)
+{
+    if (metric < 1 || metric > FILTER_METRICS ||
+        config->median < 1 || config->median > FILTER_MEDIAN_MAX ||
+        config->smoothing > FILTER_SMOOTHING_KALMAN ||
+        !(config->alpha > 0 && config->alpha <= 1) ||
+        !(config->process_noise > 0) || !(config->measurement_noise > 0) ||
+        config->max_rate < 0) {
+        return false;
+    }
+
+    configs[metric - 1] = *config;
+    memset(&states[metric - 1], 0, sizeof(states[0]));
+    return true;
+}
+
+const struct filter_config *filter_get_config(uint8_t metric)
+{
+    return metric >= 1 && metric <= FILTER_METRICS ? &configs[metric - 1] : NULL;
+}
+
+/* replaces the oldest sample of the window, the sorted copy is shifted instead of sorted again */
+static int32_t median(struct filter_state *state, uint8_t size, int32_t value)
+{
+    uint8_t i;
+
+    if (state->window_len == size) {
+        int32_t oldest = state->window[state->window_pos];
+
+        for (i = 0; state->sorted[i] != oldest; i++) {
+        }
+        memmove(&state->sorted[i], &state->sorted[i + 1], (size - i - 1) * sizeof(int32_t));
+        state->window_len--;
+    }
+
+    for (i = state->window_len; i > 0 && state->sorted[i - 1] > value; i--) {
+        state->sorted[i] = state->sorted[i - 1];
+    }
+    state->sorted[i] = value;
+    state->window_len++;
+
+    state->window[state->window_pos] = value;
+    state->window_pos = (state->window_pos + 1) % size;
+
+    return state->sorted[(state->window_len - 1) / 2];
+}
+
+static float smooth(const struct filter_config *config, struct filter_state *state, float value)
+{
+    switch (config->smoothing) {
+    case FILTER_SMOOTHING_EMA:
+        state->estimate += config->alpha * (value - state->estimate);
+        break;
+    case FILTER_SMOOTHING_KALMAN: {
+        /* random walk model: predict, then correct with the sample */
+        float gain;
+
+        state->variance += config->process_noise;
+        gain = state->variance / (state->variance + config->measurement_noise);
+        state->estimate += gain * (value - state->estimate);
+        state->variance *= 1 - gain;
+        break;
+    }
+    default:
+        state->estimate = value;
+        break;
+    }
+
+    return state->estimate;
+}
+
+int32_t filter_process(uint8_t metric, int32_t raw, uint32_t now_ms)
+{
+    const struct filter_config *config;
+    struct filter_state *state;
+    int32_t value;
+
+    if (metric < 1 || metric > FILTER_METRICS) {
+        return raw;
+    }
+
+    config = &configs[metric - 1];
+    state = &states[metric - 1];
+    state->raw = raw;
+
+    value = median(state, config->median, raw);
+
+    if (!state->started) {
+        state->started = true;
+        state->estimate = value;
+        state->variance = config->measurement_noise;
+        state->output = value;
+        state->last_ms = now_ms;
+        return value;
+    }
+
+    value = (int32_t)lroundf(smooth(config, state, value));
+
+    if (config->max_rate > 0) {
+        int32_t max_change = (int32_t)(((int64_t)config->max_rate * (now_ms - state->last_ms) + 999) / 1000);
+
+        if (value > state->output + max_change) {
+            value = state->output + max_change;
+        } else if (value < state->output - max_change) {
+            value = state->output - max_change;
+        }
+    }
+
+    state->output = value;
+    state->last_ms = now_ms;
+    return value;
+}
+
+bool filter_raw(uint8_t metric, int32_t *value)
+{
+    if (metric < 1 || metric > FILTER_METRICS || !states[metric - 1].started) {
+        return false;
+    }
+
+    *value = states[metric - 1].raw;
+    return true;
+}
+
+const char *filter_smoothing_name(uint8_t smoothing)
+{
+    return smoothing <= FILTER_SMOOTHING_KALMAN ? smoothing_names[smoothing] : NULL;
+}
+
+int filter_smoothing_from_name(const char *name)
+{
+    for (uint8_t i = 0; i < sizeof(smoothing_names) / sizeof(smoothing_names[0]); i++) {
+        if (strcmp(name, smoothing_names[i]) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
@@ -0,0 +1,51 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "flash-wear.h"
+
+#include <esp_partition.h>
+
+static uint32_t erased_bytes;
+static uint32_t written_bytes;
+
+esp_err_t __real_esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size);
+esp_err_t __real_esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src,
+                                     size_t size);
+
+/* the settings partition keeps the SPIFFS subtype after it was formatted for LittleFS */
+esp_err_t __wrap_esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    if (partition->subtype == ESP_PARTITION_SUBTYPE_DATA_SPIFFS) {
+        __atomic_add_fetch(&erased_bytes, size, __ATOMIC_RELAXED);
+    }
+    return __real_esp_partition_erase_range(partition, offset, size);
+}
+
+esp_err_t __wrap_esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src,
+                                     size_t size)
+{
+    if (partition->subtype == ESP_PARTITION_SUBTYPE_DATA_SPIFFS) {
+        __atomic_add_fetch(&written_bytes, size, __ATOMIC_RELAXED);
+    }
+    return __real_esp_partition_write(partition, dst_offset, src, size);
+}
+
+void flash_wear_read(struct flash_wear *wear)
+{
+    wear->erased_bytes = __atomic_load_n(&erased_bytes, __ATOMIC_RELAXED);
+    wear->written_bytes = __atomic_load_n(&written_bytes, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,201 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "glyph-atlas.h"
+
+#include <esp_heap_caps.h>
+#include <string.h>
+
+GlyphAtlas::GlyphAtlas(const GFXfont *font, uint8_t size, const char *charset, uint16_t background)
+    : font(font), size(size), charset(charset), backgroundColor(background), colorsLen(0), tileWidth(0),
+      tileHeight(0), tiles(NULL)
+{
+}
+
+GlyphAtlas::~GlyphAtlas()
+{
+    free(tiles);
+}
+
+bool GlyphAtlas::begin(const uint16_t *newColors, uint8_t newColorsLen)
+{
+    TFT_eSprite sprite(&M5.Lcd);
+    size_t charsetLen = strlen(charset);
+
+    if (tiles != NULL || newColorsLen > GLYPH_ATLAS_COLORS_MAX)
+    {
+        return false;
+    }
+
+    sprite.setColorDepth(16);
+    sprite.setFreeFont(font);
+    sprite.setTextSize(size);
+    sprite.setTextDatum(TL_DATUM);
+    // monospaced, every character advances as far as a digit
+    tileWidth = sprite.textWidth("0");
+    tileHeight = sprite.fontHeight();
+
+    size_t pixels = (size_t)tileWidth * tileHeight;
+    size_t bytes = charsetLen * newColorsLen * pixels * sizeof(uint16_t);
+    tiles = (uint16_t *)heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM);
+    if (tiles == NULL)
+    {
+        tiles = (uint16_t *)malloc(bytes);
+    }
+    if (tiles == NULL || sprite.createSprite(tileWidth, tileHeight) == NULL)
+    {
+        free(tiles);
+        tiles = NULL;
+        return false;
+    }
+
+    memcpy(colors, newColors, newColorsLen * sizeof(uint16_t));
+    colorsLen = newColorsLen;
+
+    uint16_t *tile = tiles;
+    char text[2] = {0, 0};
+    for (uint8_t color = 0; color < colorsLen; color++)
+    {
+        sprite.setTextColor(colors[color]);
+        for (size_t c = 0; c < charsetLen; c++)
+        {
+            text[0] = charset[c];
+            sprite.fillSprite(backgroundColor);
+            sprite.drawString(text, 0, 0);
+            for (uint16_t y = 0; y < tileHeight; y++)
+            {
+                for (uint16_t x = 0; x < tileWidth; x++)
+                {
+                    *tile++ = sprite.readPixel(x, y);
+                }
+            }
+        }
+    }
+
+    sprite.deleteSprite();
+    return true;
+}
+
+bool GlyphAtlas::ready() const
+{
+    return tiles != NULL;
+}
+
+uint16_t GlyphAtlas::width() const
+{
+    return tileWidth;
+}
+
+uint16_t GlyphAtlas::height() const
+{
+    return tileHeight;
+}
+
+uint16_t GlyphAtlas::background() const
+{
+    return backgroundColor;
+}
+
+const uint16_t *GlyphAtlas::tile(char c, uint16_t color) const
+{
+    const char *found = c != '\0' ? strchr(charset, c) : NULL;
+
+    if (tiles == NULL || found == NULL)
+    {
+        return NULL;
+    }
+
+    for (uint8_t i = 0; i < colorsLen; i++)
+    {
+        if (colors[i] == color)
+        {
+            size_t index = i * strlen(charset) + (found - charset);
+            return tiles + index * tileWidth * tileHeight;
+        }
+    }
+    return NULL;
+}
+
+GlyphField::GlyphField(GlyphAtlas &atlas, int16_t x, int16_t y, uint8_t datum)
+    : atlas(atlas), x(x), y(y), datum(datum), shownLen(0), shownX(0), shownColor(0), valid(false)
+{
+    shown[0] = '\0';
+}
+
+void GlyphField::invalidate()
+{
+    valid = false;
+}
+
+void GlyphField::clear(TFT_eSPI &display, int16_t from, int16_t to)
+{
+    if (to > from)
+    {
+        display.fillRect(from, y, to - from, atlas.height(), atlas.background());
+    }
+}
+
+uint8_t GlyphField::draw(TFT_eSPI &display, const char *text, uint16_t color)
+{
+    uint8_t len = strnlen(text, GLYPH_FIELD_LEN);
+    int16_t width = atlas.width();
+    int16_t left = datum == TC_DATUM ? x - len * width / 2 : datum == TR_DATUM ? x - len * width : x;
+    int16_t right = left + len * width;
+    int16_t shownRight = shownX + shownLen * width;
+    bool all = !valid || left != shownX || color != shownColor;
+    uint8_t copied = 0;
+
+    // tiles are in the byte order of the font colors, like images
+    bool swapBytes = display.getSwapBytes();
+    display.setSwapBytes(true);
+
+    if (valid)
+    {
+        // the part of the old text the new one does not cover
+        clear(display, shownX, min(left, shownRight));
+        clear(display, max(right, shownX), shownRight);
+    }
+
+    for (uint8_t i = 0; i < len; i++)
+    {
+        if (!all && i < shownLen && shown[i] == text[i])
+        {
+            continue;
+        }
+
+        const uint16_t *tile = atlas.tile(text[i], color);
+        if (tile != NULL)
+        {
+            display.pushImage(left + i * width, y, width, atlas.height(), tile);
+        }
+        else
+        {
+            clear(display, left + i * width, left + (i + 1) * width);
+        }
+        copied++;
+    }
+
+    display.setSwapBytes(swapBytes);
+
+    memcpy(shown, text, len);
+    shown[len] = '\0';
+    shownLen = len;
+    shownX = left;
+    shownColor = color;
+    valid = true;
+    return copied;
+}
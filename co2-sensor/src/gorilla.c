@@ -0,0 +1,183 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gorilla.h"
+
+#include <string.h>
+
+static uint8_t put_varint(uint8_t *data, uint32_t value)
+{
+    uint8_t len = 0;
+
+    while (value >= 0x80) {
+        data[len++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    data[len++] = (uint8_t)value;
+    return len;
+}
+
+static bool get_varint(const uint8_t *data, size_t len, size_t *pos, uint32_t *value)
+{
+    uint32_t result = 0;
+
+    for (uint8_t shift = 0; shift < 35; shift += 7) {
+        if (*pos >= len) {
+            return false;
+        }
+        uint8_t byte = data[(*pos)++];
+        result |= (uint32_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint32_t zigzag(int32_t value)
+{
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value)
+{
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+void gorilla_encoder_init(struct gorilla_state *encoder, uint8_t fields)
+{
+    memset(encoder, 0, sizeof(*encoder));
+    encoder->fields = fields < GORILLA_FIELDS_MAX ? fields : GORILLA_FIELDS_MAX;
+}
+
+uint8_t gorilla_encode(struct gorilla_state *encoder, uint32_t time, const int32_t *values, uint8_t *out)
+{
+    uint8_t len;
+
+    if (!encoder->started) {
+        /* the delta of the first record is 0, so the second one is small as well */
+        len = put_varint(out, time);
+        encoder->started = true;
+    } else {
+        int32_t delta = (int32_t)(time - encoder->time);
+        len = put_varint(out, zigzag((int32_t)((uint32_t)delta - (uint32_t)encoder->delta)));
+        encoder->delta = delta;
+    }
+    encoder->time = time;
+
+    for (uint8_t i = 0; i < encoder->fields; i++) {
+        len += put_varint(out + len, zigzag((int32_t)((uint32_t)values[i] - (uint32_t)encoder->values[i])));
+        encoder->values[i] = values[i];
+    }
+    return len;
+}
+
+void gorilla_decoder_init(struct gorilla_decoder *decoder, uint8_t fields, const uint8_t *data, size_t len)
+{
+    gorilla_encoder_init(&decoder->state, fields);
+    decoder->data = data;
+    decoder->len = len;
+    decoder->pos = 0;
+}
+
+bool gorilla_decode(struct gorilla_decoder *decoder, uint32_t *time, int32_t *values)
+{
+    struct gorilla_state *state = &decoder->state;
+    uint32_t raw[1 + GORILLA_FIELDS_MAX];
+    size_t pos = decoder->pos;
+
+    /* a record is only taken when it is complete */
+    for (uint8_t i = 0; i <= state->fields; i++) {
+        if (!get_varint(decoder->data, decoder->len, &pos, &raw[i])) {
+            decoder->pos = decoder->len;
+            return false;
+        }
+    }
+    decoder->pos = pos;
+
+    if (!state->started) {
+        state->time = raw[0];
+        state->started = true;
+    } else {
+        state->delta = (int32_t)((uint32_t)state->delta + (uint32_t)unzigzag(raw[0]));
+        state->time += (uint32_t)state->delta;
+    }
+    *time = state->time;
+
+    for (uint8_t i = 0; i < state->fields; i++) {
+        state->values[i] = (int32_t)((uint32_t)state->values[i] + (uint32_t)unzigzag(raw[1 + i]));
+        values[i] = state->values[i];
+    }
+    return true;
+}
+
+size_t gorilla_decode_block(const uint8_t *data, size_t len, uint8_t fields, uint32_t *times, int32_t *values,
+                            size_t capacity)
+{
+    size_t count = 0;
+    size_t pos = 0;
+    uint32_t raw[1 + GORILLA_FIELDS_MAX];
+
+    if (fields > GORILLA_FIELDS_MAX) {
+        fields = GORILLA_FIELDS_MAX;
+    }
+
+    /* the varints, each record only when it is complete */
+    while (count < capacity) {
+        uint8_t i;
+
+        for (i = 0; i <= fields; i++) {
+            if (!get_varint(data, len, &pos, &raw[i])) {
+                break;
+            }
+        }
+        if (i <= fields) {
+            break;
+        }
+        times[count] = raw[0];
+        for (i = 0; i < fields; i++) {
+            values[i * capacity + count] = (int32_t)raw[1 + i];
+        }
+        count++;
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    /* deltas of the time from its delta-of-delta, then the times from the deltas */
+    uint32_t delta = 0;
+    for (size_t i = 1; i < count; i++) {
+        delta += (uint32_t)unzigzag(times[i]);
+        times[i] = delta;
+    }
+    for (size_t i = 1; i < count; i++) {
+        times[i] += times[i - 1];
+    }
+
+    for (uint8_t field = 0; field < fields; field++) {
+        int32_t *column = values + field * capacity;
+
+        for (size_t i = 0; i < count; i++) {
+            column[i] = unzigzag((uint32_t)column[i]);
+        }
+        for (size_t i = 1; i < count; i++) {
+            column[i] = (int32_t)((uint32_t)column[i] + (uint32_t)column[i - 1]);
+        }
+    }
+    return count;
+}
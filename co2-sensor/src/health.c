@@ -0,0 +1,224 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "health.h"
+
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include <esp_wifi.h>
+
+static const uint32_t bucket_limits[HEALTH_HISTOGRAM_BUCKETS] = { 10, 20, 50, 100, 200, 500, 1000, UINT32_MAX };
+static uint32_t loop_buckets[HEALTH_HISTOGRAM_BUCKETS];
+static uint32_t sample_buckets[HEALTH_HISTOGRAM_BUCKETS];
+static uint32_t missed_frames;
+static uint32_t wifi_connects;
+
+static struct health_latency mqtt_publish;
+static struct health_latency sd_write;
+static uint32_t sd_mounts;
+static uint32_t sd_backlog;
+static uint32_t sd_dropped;
+static struct health_latency sample;
+static struct health_latency i2c;
+static uint32_t i2c_errors;
+static struct health_latency tap;
+
+static void record_bucket(uint32_t *buckets, uint32_t duration_ms)
+{
+    uint8_t bucket = 0;
+
+    while (duration_ms > bucket_limits[bucket]) {
+        bucket++;
+    }
+    buckets[bucket]++;
+}
+
+static void record_latency(struct health_latency *latency, uint32_t duration_us)
+{
+    latency->count++;
+    latency->last_us = duration_us;
+    if (duration_us > latency->max_us) {
+        latency->max_us = duration_us;
+    }
+}
+
+void health_record_loop(uint32_t duration_ms, uint32_t frame_duration_ms)
+{
+    record_bucket(loop_buckets, duration_ms);
+
+    /* every started frame duration beyond the first one was skipped */
+    if (duration_ms > frame_duration_ms && frame_duration_ms > 0) {
+        missed_frames += (duration_ms - 1) / frame_duration_ms;
+    }
+}
+
+void health_record_mqtt_publish(uint32_t duration_us)
+{
+    record_latency(&mqtt_publish, duration_us);
+}
+
+void health_record_sd_write(uint32_t duration_us)
+{
+    record_latency(&sd_write, duration_us);
+}
+
+void health_record_sd_mount(void)
+{
+    sd_mounts++;
+}
+
+void health_set_sd_backlog(uint32_t records)
+{
+    sd_backlog = records;
+}
+
+void health_record_sd_dropped(void)
+{
+    sd_dropped++;
+}
+
+void health_record_wifi_connected(void)
+{
+    wifi_connects++;
+}
+
+void health_record_sample(uint32_t latency_us)
+{
+    record_latency(&sample, latency_us);
+    record_bucket(sample_buckets, (latency_us + 999) / 1000);
+}
+
+void health_record_i2c(uint32_t duration_us, bool ok)
+{
+    record_latency(&i2c, duration_us);
+    if (!ok) {
+        i2c_errors++;
+    }
+}
+
+void health_record_tap(uint32_t latency_us)
+{
+    record_latency(&tap, latency_us);
+}
+
+uint32_t health_bucket_limit(uint8_t bucket)
+{
+    return bucket < HEALTH_HISTOGRAM_BUCKETS ? bucket_limits[bucket] : 0;
+}
+
+uint32_t health_loop_bucket_count(uint8_t bucket)
+{
+    return bucket < HEALTH_HISTOGRAM_BUCKETS ? loop_buckets[bucket] : 0;
+}
+
+uint32_t health_sample_bucket_count(uint8_t bucket)
+{
+    return bucket < HEALTH_HISTOGRAM_BUCKETS ? sample_buckets[bucket] : 0;
+}
+
+uint32_t health_missed_frames(void)
+{
+    return missed_frames;
+}
+
+uint32_t health_wifi_reconnects(void)
+{
+    return wifi_connects > 0 ? wifi_connects - 1 : 0;
+}
+
+int32_t health_wifi_rssi(void)
+{
+    wifi_ap_record_t ap;
+
+    if (esp_wifi_sta_get_ap_info(&ap) != ESP_OK) {
+        return 0;
+    }
+
+    return ap.rssi;
+}
+
+const struct health_latency *health_mqtt_publish(void)
+{
+    return &mqtt_publish;
+}
+
+const struct health_latency *health_sd_write(void)
+{
+    return &sd_write;
+}
+
+uint32_t health_sd_mounts(void)
+{
+    return sd_mounts;
+}
+
+uint32_t health_sd_backlog(void)
+{
+    return sd_backlog;
+}
+
+uint32_t health_sd_dropped(void)
+{
+    return sd_dropped;
+}
+
+const struct health_latency *health_sample(void)
+{
+    return &sample;
+}
+
+const struct health_latency *health_i2c(void)
+{
+    return &i2c;
+}
+
+uint32_t health_i2c_errors(void)
+{
+    return i2c_errors;
+}
+
+const struct health_latency *health_tap(void)
+{
+    return &tap;
+}
+
+uint32_t health_free_heap(void)
+{
+    return heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+}
+
+uint32_t health_min_free_heap(void)
+{
+    return heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+}
+
+uint32_t health_largest_free_block(void)
+{
+    return heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+}
+
+uint32_t health_free_psram(void)
+{
+    return heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+}
+
+/* seconds since boot */
+uint32_t health_uptime(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000000);
+}
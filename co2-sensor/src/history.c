@@ -0,0 +1,228 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "history.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <esp_heap_caps.h>
+
+static struct history_series series_table[HISTORY_MEASUREMENTS][HISTORY_RESOLUTIONS];
+
+/*
+ * The loop task is the only writer of the rings, the tcpip thread reads them
+ * for shHistoryTable. Every update is wrapped in a sequence count, odd while
+ * it is written. A reader copies the bucket out and retries if the count
+ * changed meanwhile. The rings only grow and never move, so a torn read stays
+ * within the buckets and is just thrown away.
+ */
+static uint32_t history_sequence;
+
+static int16_t clamp16(int32_t value)
+{
+    if (value > INT16_MAX) {
+        return INT16_MAX;
+    }
+    if (value < INT16_MIN) {
+        return INT16_MIN;
+    }
+    return (int16_t)value;
+}
+
+static bool series_init(struct history_series *series, uint16_t capacity, uint32_t period)
+{
+    size_t size = capacity * sizeof(struct history_bucket);
+
+    /* about 120 kB in total, keep it out of the internal ram */
+    series->buckets = (struct history_bucket *)heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+    if (series->buckets == NULL) {
+        series->buckets = (struct history_bucket *)malloc(size);
+    }
+    if (series->buckets == NULL) {
+        return false;
+    }
+
+    series->capacity = capacity;
+    series->period = period;
+    series->head = 0;
+    series->len = 0;
+    series->sum = 0;
+    return true;
+}
+
+static struct history_bucket *series_newest(struct history_series *series)
+{
+    return &series->buckets[(series->head + series->len - 1) % series->capacity];
+}
+
+static void series_add(struct history_series *series, uint32_t timestamp, int32_t value)
+{
+    uint32_t start = timestamp - timestamp % series->period;
+    struct history_bucket *bucket;
+
+    if (series->buckets == NULL) {
+        return;
+    }
+
+    /*
+     * The ring has to stay sorted for the binary search. If the clock was set
+     * back, keep adding to the newest bucket until time catches up again.
+     */
+    if (series->len == 0 || start > series_newest(series)->start) {
+        if (series->len < series->capacity) {
+            series->len++;
+        } else {
+            series->head = (series->head + 1) % series->capacity;
+        }
+
+        bucket = series_newest(series);
+        bucket->start = start;
+        bucket->min = clamp16(value);
+        bucket->max = clamp16(value);
+        bucket->samples = 0;
+        series->sum = 0;
+    } else {
+        bucket = series_newest(series);
+    }
+
+    if (bucket->samples == UINT16_MAX) {
+        return;
+    }
+
+    series->sum += value;
+    bucket->samples++;
+    bucket->min = clamp16(value) < bucket->min ? clamp16(value) : bucket->min;
+    bucket->max = clamp16(value) > bucket->max ? clamp16(value) : bucket->max;
+    bucket->mean = clamp16(series->sum / bucket->samples);
+}
+
+bool history_init(void)
+{
+    bool ok = true;
+
+    for (uint8_t i = 0; i < HISTORY_MEASUREMENTS; i++) {
+        ok &= series_init(&series_table[i][HISTORY_RESOLUTION_MINUTE - 1], HISTORY_MINUTE_BUCKETS, 60);
+        ok &= series_init(&series_table[i][HISTORY_RESOLUTION_HOUR - 1], HISTORY_HOUR_BUCKETS, 3600);
+        ok &= series_init(&series_table[i][HISTORY_RESOLUTION_DAY - 1], HISTORY_DAY_BUCKETS, 86400);
+    }
+
+    return ok;
+}
+
+void history_add_sample(uint8_t measurement_type, uint32_t timestamp, int32_t value)
+{
+    if (measurement_type < 1 || measurement_type > HISTORY_MEASUREMENTS) {
+        return;
+    }
+
+    __atomic_add_fetch(&history_sequence, 1, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    for (uint8_t i = 0; i < HISTORY_RESOLUTIONS; i++) {
+        series_add(&series_table[measurement_type - 1][i], timestamp, value);
+    }
+    __atomic_add_fetch(&history_sequence, 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Copy of the first bucket starting at or after start, for readers outside the
+ * loop task. exact only accepts a bucket starting at start.
+ */
+static bool history_read(uint8_t measurement_type, uint8_t resolution, uint32_t start, bool exact,
+                         struct history_bucket *copy)
+{
+    const struct history_series *series = history_get_series(measurement_type, resolution);
+    uint32_t sequence;
+    uint16_t index;
+    bool found;
+
+    if (series == NULL || series->buckets == NULL) {
+        return false;
+    }
+
+    do {
+        sequence = __atomic_load_n(&history_sequence, __ATOMIC_ACQUIRE);
+        index = start > 0 ? history_series_upper_bound(series, start - 1) : 0;
+
+        found = index < series->len;
+        if (found) {
+            *copy = *history_series_at(series, index);
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((sequence & 1) != 0 || __atomic_load_n(&history_sequence, __ATOMIC_RELAXED) != sequence);
+
+    return found && (!exact || copy->start == start);
+}
+
+bool history_find(uint8_t measurement_type, uint8_t resolution, uint32_t start, struct history_bucket *copy)
+{
+    return history_read(measurement_type, resolution, start, true, copy);
+}
+
+bool history_next(uint8_t measurement_type, uint8_t resolution, uint32_t start, struct history_bucket *copy)
+{
+    return history_read(measurement_type, resolution, start, false, copy);
+}
+
+const struct history_series *history_get_series(uint8_t measurement_type, uint8_t resolution)
+{
+    if (measurement_type < 1 || measurement_type > HISTORY_MEASUREMENTS ||
+        resolution < 1 || resolution > HISTORY_RESOLUTIONS) {
+        return NULL;
+    }
+
+    return &series_table[measurement_type - 1][resolution - 1];
+}
+
+const struct history_bucket *history_series_at(const struct history_series *series, uint16_t index)
+{
+    if (index >= series->len) {
+        return NULL;
+    }
+
+    return &series->buckets[(series->head + index) % series->capacity];
+}
+
+/* index of the bucket starting at start, -1 if there is none */
+int32_t history_series_find(const struct history_series *series, uint32_t start)
+{
+    uint16_t index = history_series_upper_bound(series, start - 1);
+
+    if (start == 0 || index >= series->len || history_series_at(series, index)->start != start) {
+        return -1;
+    }
+
+    return index;
+}
+
+/* index of the first bucket starting after start, len if there is none */
+uint16_t history_series_upper_bound(const struct history_series *series, uint32_t start)
+{
+    uint16_t low = 0;
+    uint16_t high = series->len;
+
+    while (low < high) {
+        uint16_t mid = low + (high - low) / 2;
+
+        if (history_series_at(series, mid)->start <= start) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    return low;
+}
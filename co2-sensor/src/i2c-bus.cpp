@@ -0,0 +1,34 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "i2c-bus.h"
+
+#include <string.h>
+
+void i2cPrepare(struct i2cTransaction *transaction, uint8_t address, const uint8_t *tx, uint8_t txLen,
+                uint16_t delayMs, uint8_t rxLen)
+{
+    transaction->address = address;
+    transaction->txLen = txLen < I2C_TX_MAX ? txLen : I2C_TX_MAX;
+    transaction->rxLen = rxLen < I2C_RX_MAX ? rxLen : I2C_RX_MAX;
+    transaction->delayMs = delayMs;
+    transaction->status = I2C_IDLE;
+    if (tx != NULL)
+    {
+        memcpy(transaction->tx, tx, transaction->txLen);
+    }
+}
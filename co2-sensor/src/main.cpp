@@ -17,11 +17,23 @@
 
 #include <main.h>
 #include <lwip/apps/snmp.h>
+#include <lwip/apps/snmp_core.h>
+#include <lwip/apps/snmp_mib2.h>
+#include <lwip/tcpip.h>
 #include <sensorhub-mib.h>
+#include <history.h>
+#include <snmpv3-users.h>
+#include <health.h>
+#include <esp_timer.h>
+#include "snmp/snmp_cache.h"
 
 static const struct snmp_mib *mibs[] = {
+    &mib2,
     &sensorhub_mib};
 
+static const u8_t sysDescr[] = "smoca CO2 sensor";
+static const u16_t sysDescrLen = sizeof(sysDescr) - 1;
+
 struct state state;
 struct graph graph;
 
@@ -55,6 +67,15 @@ TFT_eSprite DisbuffHeader = TFT_eSprite(&M5.Lcd);
 TFT_eSprite DisbuffValue = TFT_eSprite(&M5.Lcd);
 TFT_eSprite DisbuffGraph = TFT_eSprite(&M5.Lcd);
 TFT_eSprite DisbuffBody = TFT_eSprite(&M5.Lcd);
+// pre-rendered readouts, only the characters which changed are copied to the display
+// the colors of co2color()
+const uint16_t co2Colors[] = {CYAN, GREEN, YELLOW, ORANGE, RED};
+const uint16_t headerColors[] = {WHITE};
+GlyphAtlas co2Glyphs(&FreeMonoBold18pt7b, 2, CO2_GLYPHS);
+GlyphAtlas headerGlyphs(&FreeMono9pt7b, 1, HEADER_GLYPHS);
+GlyphField co2Field(co2Glyphs, 160, 36, TC_DATUM);
+GlyphField clockField(headerGlyphs, 0, 1, TL_DATUM);
+GlyphField batteryField(headerGlyphs, 320, 1, TR_DATUM);
 
 uint64_t chipid = ESP.getEfuseMac(); // The chip ID is essentially its MAC address(length: 6 bytes).
 uint16_t chip = (uint16_t)(chipid >> 32);
@@ -73,10 +94,40 @@ IPAddress APStaticGW = IPAddress(192, 168, 100, 1);
 IPAddress APStaticSN = IPAddress(255, 255, 255, 0);
 
 AsyncWebServer webServer(80);
-
-SCD30 airSensorSCD30;
-SCD4x airSensorSCD40;
-void* currentAirSensor;
+LittleFsStorage littleFsStorage;
+SpiffsStorage spiffsStorage;
+MemoryStorage memoryStorage;
+// the settings, on LittleFS unless the flash partition cannot be used
+StorageBackend *storage = &memoryStorage;
+DataLog dataLog(SD, DATA_FILENAME, DATA_INDEX_FILENAME);
+DataLog dataMinutes(SD, DATA_MINUTES_FILENAME, DATA_MINUTES_INDEX_FILENAME, DATA_LOG_INDEX_PERIOD,
+                    DATA_RETENTION_MINUTE_SEGMENT);
+DataLog dataHours(SD, DATA_HOURS_FILENAME, DATA_HOURS_INDEX_FILENAME, DATA_RETENTION_HOUR_BLOCK,
+                  DATA_RETENTION_HOUR_SEGMENT);
+DataRetention dataRetention(dataLog, dataMinutes, dataHours);
+SdVolume sdVolume;
+// a move of the settings from SPIFFS is staged on the card
+SdStorage sdStorage(sdVolume);
+// the only writer of the data logs, mounts the card again after it was taken out
+DataLogWriter dataLogWriter(dataLog, sdVolume, &dataRetention, &SD, TRACE_FILENAME);
+
+// Wire: external sensors, Wire1: internal bus with the AXP192
+WireI2cBus sensorBus(Wire, "i2c-sensors");
+WireI2cBus axpBus(Wire1, "i2c-axp");
+// power status, battery ADC and coulomb counter blocks of the AXP192, read asynchronously once per second
+struct i2cTransaction batteryReads[3];
+// the FT6336 shares Wire1, its interrupt queues the gestures
+TouchPanel touchPanel(axpBus);
+// esp_timer µs at the end of the gesture the next frame shows, 0 if none
+int64_t inputUs;
+// snmpEngineBoots in the snmpv3 file, it goes up at runtime when snmpEngineTime starts over
+uint32_t savedSnmpv3Boots;
+Scd30Driver scd30(sensorBus);
+Scd4xDriver scd4x(sensorBus);
+Bme280Driver bme280(sensorBus);
+SensorHub sensorHub(onSensorReadings);
+// the CO2 sensor shown on the display, SENSOR_ID_AIR in the MIB
+SensorDriver *airSensor;
 
 WM_Config WM_config;
 WiFi_STA_IPConfig WM_STA_IPconfig;
@@ -93,10 +144,25 @@ ESPAsync_WMParameter *mqttTopic;
 ESPAsync_WMParameter *mqttDevice;
 ESPAsync_WMParameter *mqttUser;
 ESPAsync_WMParameter *mqttPassword;
+ESPAsync_WMParameter *snmpv3User;
+ESPAsync_WMParameter *snmpv3AuthPassword;
+ESPAsync_WMParameter *snmpv3PrivPassword;
+ESPAsync_WMParameter *snmpv3Only;
+ESPAsync_WMParameter *snmpRateLimit;
 
 WiFiClient client;
 PubSubClient mqtt(client);
 
+// mqtt.publish() with its duration recorded for the health MIB
+template <typename... Args>
+bool mqttPublish(Args... args)
+{
+    unsigned long start = micros();
+    bool published = mqtt.publish(args...);
+    health_record_mqtt_publish(micros() - start);
+    return published;
+}
+
 // MQTT discovery data configurations
 struct discoveryDeviceConfig deviceConfig;
 struct discoveryConfig co2Config;
@@ -128,13 +194,12 @@ void setup()
     my_nan = sqrt(-1);
 
     M5.begin();
+    profiler_reset(getCpuFrequencyMhz());
+    axpBus.begin();
+    touchPanel.begin();
 
-    // Initialize SPIFFS
-    if (!SPIFFS.begin(true))
-    {
-        Serial.println("An Error has occurred while mounting SPIFFS");
-        return;
-    }
+    storage = &mountStorage(littleFsStorage, spiffsStorage, memoryStorage, &sdStorage);
+    Serial.printf("Settings on %s\n", storage->name());
 
     loadStateFile();
     if (state.is_screen_rotated)
@@ -143,6 +208,7 @@ void setup()
         M5.BtnB.set(130, -40, 70, 40, false);
         M5.BtnC.set(230, -40, 80, 40, false);
         M5.Lcd.setRotation(3);
+        touchPanel.setRotated(true);
     }
 
     M5.Lcd.setSwapBytes(true);
@@ -151,16 +217,29 @@ void setup()
     M5.Axp.SetCHGCurrent(AXP192::kCHG_280mA);
     M5.Axp.EnableCoulombcounter();
     M5.Axp.SetLed(M5.Axp.isACIN() ? 1 : 0);
+    battery_reset(state.battery_capacity);
 
     ssid.toUpperCase();
     mqtt.setBufferSize(512);
+    mqtt.setCallback(mqttCallback);
 
     loadMQTTConfig();
+    loadAlertConfig();
+    loadFilterConfig();
+    backlight_reset(millis());
+    loadDisplayConfig();
+    loadRetentionConfig();
+    loadSnmpv3Config();
     setPassword(&state);
     setDisplayPower(true);
     setTimeFromRtc();
     printTime();
     createSprites();
+    if (!co2Glyphs.begin(co2Colors, sizeof(co2Colors) / sizeof(co2Colors[0])) ||
+        !headerGlyphs.begin(headerColors, sizeof(headerColors) / sizeof(headerColors[0])))
+    {
+        Serial.println("no memory for the glyph tiles, rendering text");
+    }
     hideButtons();
 
     if (!state.next_time_sync.tm_year)
@@ -172,15 +251,24 @@ void setup()
 
     for (int i = 0; i < GRAPH_UNITS; i++)
     {
-        graph.temperature[i] = my_nan;
-        graph.co2[i] = my_nan;
-        graph.humidity[i] = my_nan;
         graph.batteryMah[i] = my_nan;
     }
 
+    if (!history_init())
+    {
+        Serial.println("Not enough memory for the measurement history");
+    }
+
     initSD();
+    restoreHistory();
     initAirSensor();
     initAsyncWifiManager(&state);
+    webServer.on("/profile", HTTP_GET, [](AsyncWebServerRequest *request) {
+        AsyncResponseStream *response = request->beginResponseStream("text/plain");
+        printProfile(*response);
+        request->send(response);
+    });
+    webServer.on("/export", HTTP_GET, handleExport);
     initSTAIPConfigStruct(WM_STA_IPconfig);
     initDeviceDiscoveryConfig(&deviceConfig);
     initCo2DiscoveryConfig(&co2Config);
@@ -198,11 +286,15 @@ void setup()
     }
 
 #if LWIP_SNMP
-    const struct snmp_obj_id device_enterprise_oid = {8, {1, 3, 6, 1, 4, 1, 58049, 1}};
+    // lwIP keeps the pointer, it has to outlive setup()
+    static const struct snmp_obj_id device_enterprise_oid = {8, {1, 3, 6, 1, 4, 1, 58049, 1}};
     snmp_set_device_enterprise_oid(&device_enterprise_oid);
 
+    snmp_mib2_set_sysdescr(sysDescr, &sysDescrLen);
     snmp_set_mibs(mibs, LWIP_ARRAYSIZE(mibs));
+    sensorhub_mib_init();
     snmp_init();
+    setTrapDestination(&state);
 #endif /* LWIP_SNMP */
 
     cycle = 0;
@@ -239,48 +331,169 @@ extern "C" int get_measurement(u32_t sensor_id, u32_t measurement_type)
         }
         break;
     default:
-        return 0;
+    {
+        int32_t value;
+        return sensorHub.value(sensor_id, measurement_type, &value) ? value : 0;
+    }
+    }
+}
+
+extern "C" int get_measurement_raw(u32_t sensor_id, u32_t measurement_type)
+{
+    int32_t raw;
+
+    if (sensor_id == SENSOR_ID_AIR && filter_raw(measurement_type, &raw))
+    {
+        return raw;
+    }
+    return get_measurement(sensor_id, measurement_type);
+}
+
+extern "C" const char *get_sensor_name(u32_t sensor_id)
+{
+    if (sensor_id == SENSOR_ID_BATTERY)
+    {
+        return "BATTERY";
+    }
+
+    SensorDriver *driver = sensor_id <= 0xff ? sensorHub.get(sensor_id) : NULL;
+    return driver != NULL ? driver->name() : NULL;
+}
+
+extern "C" u8_t get_sensor_measurement_types(u32_t sensor_id, const u8_t **types)
+{
+    static const u8_t batteryTypes[] = {BATTERY_VOLTAGE_MEASUREMENT, BATTERY_CURRENT_MEASUREMENT};
+
+    if (sensor_id == SENSOR_ID_BATTERY)
+    {
+        *types = batteryTypes;
+        return sizeof(batteryTypes);
     }
+
+    SensorDriver *driver = sensor_id <= 0xff ? sensorHub.get(sensor_id) : NULL;
+    return driver != NULL ? driver->measurementTypes(types) : 0;
 }
 
 void loop()
 {
     unsigned long start = millis();
+    uint32_t startCycles = ESP.getCycleCount();
     struct state oldstate;
     memcpy(&oldstate, &state, sizeof(struct state));
 
-    M5.update();
-
-    updateTouch(&state);
-    updateTime(&state);
-    updateBattery(&state);
-    updateCo2(&state);
-    updateGraph(&oldstate, &state);
-    updateLed(&oldstate, &state);
-    updateTimeState(&oldstate, &state);
-    updateMQTT(&state);
+    // no M5.update(), its M5.Touch would read the FT6336 on Wire1 behind the back of axpBus
+    PROFILE(PROFILE_TOUCH, updateTouch(&state));
+    PROFILE(PROFILE_TIME, updateTime(&state));
+    PROFILE(PROFILE_BATTERY, updateBattery(&state));
+    PROFILE(PROFILE_CO2, updateCo2(&state));
+    PROFILE(PROFILE_GRAPH, updateGraph(&oldstate, &state));
+    PROFILE(PROFILE_LED, updateLed(&oldstate, &state));
+    PROFILE(PROFILE_TIME_STATE, updateTimeState(&oldstate, &state));
+    PROFILE(PROFILE_MQTT, updateMQTT(&state));
 
     saveStateFile(&oldstate, &state);
 
-    handleWifiMqtt(&oldstate, &state);
+    PROFILE(PROFILE_WIFI_MQTT, handleWifiMqtt(&oldstate, &state));
 
-    updateScreenRotation(&oldstate, &state);
-    drawScreen(&oldstate, &state);
+    PROFILE(PROFILE_SCREEN_ROTATION, updateScreenRotation(&oldstate, &state));
+    PROFILE(PROFILE_DISPLAY_POWER, updateDisplayPower(&oldstate, &state));
+    PROFILE(PROFILE_DRAW, drawScreen(&oldstate, &state));
+    if (inputUs != 0)
+    {
+        health_record_tap(esp_timer_get_time() - inputUs);
+        inputUs = 0;
+    }
 
     handleConfigPortal(&oldstate, &state);
-    syncData(&state);
+    PROFILE(PROFILE_SYNC, syncData(&state));
     handleFirmware(&oldstate, &state);
-    writeSsd(&state);
+    PROFILE(PROFILE_SSD, writeSsd(&state));
+    PROFILE(PROFILE_TRACE, updateTrace(&oldstate, &state));
+    handleSerial();
+    saveSnmpv3Boots();
 
     cycle++;
+    profiler_frame(start, ESP.getCycleCount() - startCycles);
     unsigned long duration = millis() - start;
+    health_record_loop(duration, frame_duration_ms);
     if (duration < frame_duration_ms)
     {
         delay(frame_duration_ms - duration);
     }
     else
     {
-        Serial.println("we are to slow:" + String(duration));
+        struct profile_frame frame;
+        profiler_last_frame(&frame);
+        Serial.println("we are to slow:" + String(duration) + ", " + profiler_section_name(frame.worst) + ": " +
+                       String(frame.worst_us / 1000));
+    }
+}
+
+// "profile" on the serial console prints the frame times
+void handleSerial()
+{
+    static char line[16];
+    static uint8_t len = 0;
+
+    while (Serial.available() > 0)
+    {
+        char c = Serial.read();
+        if (c != '\n' && c != '\r')
+        {
+            if (len < sizeof(line) - 1)
+                line[len++] = c;
+            continue;
+        }
+
+        line[len] = '\0';
+        if (strcmp(line, "profile") == 0)
+        {
+            printProfile(Serial);
+        }
+        else if (strcmp(line, "storage") == 0)
+        {
+            benchmarkStorage(Serial, *storage);
+            if (storage != &memoryStorage)
+            {
+                benchmarkStorage(Serial, memoryStorage);
+            }
+        }
+        len = 0;
+    }
+}
+
+/*
+ * Frame rate and frame time percentiles of the last frames, then per section
+ * of the loop the count, mean, last and longest time and a histogram, in µs.
+ */
+void printProfile(Print &out)
+{
+    struct profile_summary summary;
+
+    if (profiler_summary(&summary))
+    {
+        out.printf("frames %u fps %.1f p50 %u p99 %u max %u worst %s %u\n", summary.frames, summary.fps,
+                   summary.p50_us, summary.p99_us, summary.slowest.duration_us,
+                   profiler_section_name(summary.slowest.worst), summary.slowest.worst_us);
+    }
+
+    out.print("section count mean last max");
+    for (uint8_t bucket = 0; bucket < PROFILE_BUCKETS - 1; bucket++)
+    {
+        out.printf(" <=%u", profiler_bucket_limit(bucket));
+    }
+    out.println(" more");
+
+    for (uint8_t section = 0; section <= PROFILE_SECTIONS; section++)
+    {
+        const struct profile_stats *stats = profiler_stats(section);
+        out.printf("%s %u %u %u %u", profiler_section_name(section), stats->count,
+                   stats->count > 0 ? (uint32_t)(stats->total_us / stats->count) : 0, stats->last_us, stats->max_us);
+        for (uint8_t bucket = 0; bucket < PROFILE_BUCKETS; bucket++)
+        {
+            out.printf(" %u", profiler_bucket_count(section, bucket));
+        }
+        out.println();
     }
 }
 
@@ -301,7 +514,7 @@ String randomPassword(int length)
 
 void loadStateFile()
 {
-    File file = SPIFFS.open(STATE_FILENAME, "r");
+    File file = storage->fs().open(STATE_FILENAME, "r");
 
     if (file)
     {
@@ -358,7 +571,7 @@ void saveStateFile(struct state *oldstate, struct state *state)
         return;
     }
 
-    File f = SPIFFS.open(STATE_FILENAME, "w");
+    File f = storage->fs().open(STATE_FILENAME, "w");
     f.print(
         (String)state->battery_capacity + "\n" +
         (String)state->auto_calibration_on + "\n" +
@@ -416,6 +629,25 @@ void initAsyncWifiManager(struct state *state)
     asyncWifiManager->addParameter(mqttUser);
     asyncWifiManager->addParameter(mqttPassword);
 
+#if LWIP_SNMP && LWIP_SNMP_V3
+    // the passwords are only used to derive the keys and are not stored
+    const struct snmpv3_user *user = snmpv3_users_get(0);
+    snmpv3User = new ESPAsync_WMParameter(SNMPV3_USER_Label, "SNMPv3 User", user ? user->name : "", SNMPV3_USER_LEN - 1);
+    snmpv3AuthPassword = new ESPAsync_WMParameter(SNMPV3_AUTH_PASSWORD_Label, "SNMPv3 SHA Password (min. 8)", "", SNMPV3_PASSWORD_LEN - 1);
+    snmpv3PrivPassword = new ESPAsync_WMParameter(SNMPV3_PRIV_PASSWORD_Label, "SNMPv3 AES Password (min. 8)", "", SNMPV3_PASSWORD_LEN - 1);
+    snmpv3Only = new ESPAsync_WMParameter(SNMPV3_ONLY_Label, "SNMPv3 only, no v1/v2c with a user (1/0)", snmpv3_users_get_v3_only() ? "1" : "0", 1);
+
+    asyncWifiManager->addParameter(snmpv3User);
+    asyncWifiManager->addParameter(snmpv3AuthPassword);
+    asyncWifiManager->addParameter(snmpv3PrivPassword);
+    asyncWifiManager->addParameter(snmpv3Only);
+#endif /* LWIP_SNMP && LWIP_SNMP_V3 */
+#if LWIP_SNMP && SNMP_LWIP_RESPONSE_CACHE
+    snmpRateLimit = new ESPAsync_WMParameter(SNMP_RATE_LIMIT_Label, "SNMP requests/s per address (0 = unlimited)",
+                                             String(snmp_rate_limit_get()).c_str(), SNMP_RATE_LIMIT_LEN - 1);
+    asyncWifiManager->addParameter(snmpRateLimit);
+#endif /* LWIP_SNMP && SNMP_LWIP_RESPONSE_CACHE */
+
 #if !USE_DHCP_IP
 #if USE_CONFIGURABLE_DNS
     // Set static IP, Gateway, Subnetmask, DNS1 and DNS2. New in v1.0.5
@@ -427,63 +659,41 @@ void initAsyncWifiManager(struct state *state)
 #endif
 }
 
+// mounts the card and creates the log if it doesn't exist, a card inserted later is mounted in the background
 void initSD()
 {
-    SD.begin();
-    if (!SD.begin())
+    if (!dataLogWriter.begin())
     {
-        Serial.println("Card Mount Failed");
+        Serial.println("No memory for the data log");
     }
-
-    uint8_t cardType = SD.cardType();
-    if (cardType == CARD_NONE)
+    if (!dataLogWriter.mounted())
     {
         Serial.println("No SD card attached");
     }
-
-    Serial.println("Initializing SD card...");
-    if (!SD.begin())
-    {
-        Serial.println("ERROR - SD card initialization failed!");
-    }
-
-    // If the data.txt file doesn't exist
-    // Create a file on the SD card and write the data labels
-    File file = SD.open("/data.txt");
-    if (!file)
-    {
-        Serial.println("File doens't exist");
-        Serial.println("Creating file...");
-        writeFile(SD, "/data.txt", "Date, Co2 (ppm), Temperature, Humidity, Battery Charge \r\n");
-    }
-    else
-    {
-        Serial.println("File already exists");
-    }
-
-    file.close();
 }
 
 void initAirSensor()
 {
     Wire.begin(G32, G33);
+    sensorBus.begin();
 
-    if (airSensorSCD30.begin(Wire, state.auto_calibration_on) == true)
-    {
-        currentAirSensor = &airSensorSCD30;
-        Serial.println("Air sensor SCD30 detected.");
-        airSensorSCD30.setTemperatureOffset(state.temp_offset);
-        airSensorSCD30.setAltitudeCompensation(440);
-    } 
-    else if (airSensorSCD40.begin(Wire, state.auto_calibration_on) == true)
+    scd30.configure(state.auto_calibration_on, state.temp_offset, SENSOR_ALTITUDE, SCD30_READY_PIN);
+    scd4x.configure(state.auto_calibration_on, state.temp_offset, SENSOR_ALTITUDE);
+
+    // the first sensor found gets SENSOR_ID_AIR, the others the ids after the battery
+    SensorDriver *drivers[] = {&scd30, &scd4x, &bme280};
+    uint8_t id = SENSOR_ID_AIR;
+    for (SensorDriver *driver : drivers)
     {
-        currentAirSensor = &airSensorSCD40;
-        Serial.println("Air sensor SCD4x detected.");
-        airSensorSCD40.setTemperatureOffset(state.temp_offset);
-        airSensorSCD40.setSensorAltitude(440);
-        airSensorSCD40.startPeriodicMeasurement();
-    } 
-    else 
+        if (sensorHub.add(id, driver))
+        {
+            Serial.println("Sensor " + (String)driver->name() + " detected, id " + (String)id + ".");
+            id = id == SENSOR_ID_AIR ? SENSOR_ID_BATTERY + 1 : id + 1;
+        }
+    }
+
+    airSensor = sensorHub.get(SENSOR_ID_AIR);
+    if (airSensor == NULL || airSensor != sensorHub.find(CO2_PPM_MEASUREMENT))
     {
         DisbuffValue.setTextColor(RED);
         Serial.println("Air sensor not detected. Please check wiring. Freezing...");
@@ -645,6 +855,15 @@ void handleWifiMqtt(struct state *oldstate, struct state *state)
     if (WiFi.status() != oldstate->wifi_status)
     {
         state->wifi_status = WiFi.status();
+        if (state->wifi_status == WL_CONNECTED)
+        {
+            health_record_wifi_connected();
+            if (!state->is_config_running)
+            {
+                // serves /profile, a running server ignores the call
+                webServer.begin();
+            }
+        }
         Serial.println(
             "WiFi Status changed from " + (String)oldstate->wifi_status + " to " + (String)state->wifi_status);
     }
@@ -910,6 +1129,19 @@ void handleWifiMqtt(struct state *oldstate, struct state *state)
             if (mqtt.connected())
             {
                 state->connectionState = WiFi_up_MQTT_up;
+                if ((String)state->mqttTopic != "")
+                {
+                    String alertConfigTopic = (String)state->mqttTopic + (String)TOPIC_ALERT_CONFIG;
+                    mqtt.subscribe((const char *)alertConfigTopic.c_str());
+                    String filterConfigTopic = (String)state->mqttTopic + (String)TOPIC_FILTER_CONFIG;
+                    mqtt.subscribe((const char *)filterConfigTopic.c_str());
+                    String displayConfigTopic = (String)state->mqttTopic + (String)TOPIC_DISPLAY_CONFIG;
+                    mqtt.subscribe((const char *)displayConfigTopic.c_str());
+                    String retentionConfigTopic = (String)state->mqttTopic + (String)TOPIC_RETENTION_CONFIG;
+                    mqtt.subscribe((const char *)retentionConfigTopic.c_str());
+                    String traceTopic = (String)state->mqttTopic + (String)TOPIC_TRACE;
+                    mqtt.subscribe((const char *)traceTopic.c_str());
+                }
                 sendMQTTDiscoveryMessages(
                     &co2Config,
                     &humidityConfig,
@@ -974,22 +1206,30 @@ void handleWifiMqtt(struct state *oldstate, struct state *state)
                     stateJson[HOMEASSISTANT_STATE_TEMPERATURE_Label] = temperature;
                     stateJson[HOMEASSISTANT_STATE_BATTERY_Label] = battery;
 
+                    int32_t raw;
+                    if (filter_raw(CO2_PPM_MEASUREMENT, &raw))
+                        stateJson[HOMEASSISTANT_STATE_CO2_RAW_Label] = (String)raw;
+                    if (filter_raw(HUMIDITY_MEASUREMENT, &raw))
+                        stateJson[HOMEASSISTANT_STATE_HUMIDITY_RAW_Label] = (String)((double)raw / 10);
+                    if (filter_raw(TEMPERATURE_MEASUREMENT, &raw))
+                        stateJson[HOMEASSISTANT_STATE_TEMPERATURE_RAW_Label] = (String)((double)raw / 10);
+
                     size_t n = serializeJson(stateJson, stateBuffer);
 
-                    if (mqtt.publish((const char *)co2Topic.c_str(), (const char *)co2.c_str()))
+                    if (mqttPublish((const char *)co2Topic.c_str(), (const char *)co2.c_str()))
                         Serial.println("Published co2 to MQTT");
 
-                    if (mqtt.publish((const char *)humidityTopic.c_str(), (const char *)humidity.c_str()))
+                    if (mqttPublish((const char *)humidityTopic.c_str(), (const char *)humidity.c_str()))
                         Serial.println("Published humidity to MQTT");
 
-                    if (mqtt.publish((const char *)temperatureTopic.c_str(),
+                    if (mqttPublish((const char *)temperatureTopic.c_str(),
                                      (const char *)temperature.c_str()))
                         Serial.println("Published temperature to MQTT");
 
-                    if (mqtt.publish((const char*)batteryTopic.c_str(),
+                    if (mqttPublish((const char*)batteryTopic.c_str(),
                                      (const char*)battery.c_str()))
                         Serial.println("Published battery to MQTT");
-                    if (mqtt.publish((const char*)stateTopic.c_str(),
+                    if (mqttPublish((const char*)stateTopic.c_str(),
                                      stateBuffer, n))
                         Serial.println("Published device state to MQTT");
                 }
@@ -1053,7 +1293,7 @@ void sendMQTTDiscoveryMessage(struct discoveryConfig* config)
     json["state_class"] = "measurement";
     
     size_t n = serializeJson(json, buffer);
-    mqtt.publish((const char*)topic.c_str(), buffer, n, true);
+    mqttPublish((const char*)topic.c_str(), buffer, n, true);
 }
 
 void sendMQTTDiscoveryMessages(
@@ -1072,7 +1312,7 @@ void sendMQTTDiscoveryMessages(
 
 void loadMQTTConfig()
 {
-    File file = SPIFFS.open(MQTT_FILENAME, "r");
+    File file = storage->fs().open(MQTT_FILENAME, "r");
 
     if (!file)
     {
@@ -1127,7 +1367,7 @@ void saveMQTTConfig(struct state *state)
     json[MQTT_USERNAME_Label] = state->mqttUser;
     json[MQTT_KEY_Label] = state->mqttPassword;
 
-    File file = SPIFFS.open(MQTT_FILENAME, "w");
+    File file = storage->fs().open(MQTT_FILENAME, "w");
 
     if (!file)
     {
@@ -1141,9 +1381,667 @@ void saveMQTTConfig(struct state *state)
     file.close();
 }
 
+void loadAlertConfig()
+{
+    File file = storage->fs().open(ALERTS_FILENAME, "r");
+
+    if (file)
+    {
+        DynamicJsonDocument json(1024);
+        DeserializationError error = deserializeJson(json, file);
+        file.close();
+
+        if (!error && applyAlertConfig(json))
+        {
+            Serial.println("Loaded alert rules.");
+            return;
+        }
+
+        Serial.println("alert file could not be read, using default rules.");
+    }
+
+    // red co2 level and an almost empty battery
+    alerts_clear();
+    alerts_add_rule(ALERT_METRIC_CO2, ALERT_ABOVE, 1400, 100, 60000);
+    alerts_add_rule(ALERT_METRIC_BATTERY, ALERT_BELOW, 10, 5, 0);
+}
+
+/*
+ * {"trap_host": "192.168.1.10",
+ *  "rules": [{"metric": "co2", "direction": "above", "threshold": 1400, "hysteresis": 100, "duration": 60}]}
+ *
+ * metric is one of co2 (ppm), temperature (decidegree), humidity (permille) or battery (percent),
+ * duration is in seconds.
+ */
+bool applyAlertConfig(JsonDocument &json)
+{
+    JsonArray rules = json[ALERTS_RULES_Label];
+
+    if (rules.isNull())
+        return false;
+
+    alerts_clear();
+
+    for (JsonObject rule : rules)
+    {
+        int metric = alerts_metric_from_name(rule[ALERTS_METRIC_Label] | "");
+        uint8_t direction = strcmp(rule[ALERTS_DIRECTION_Label] | "above", "below") == 0 ? ALERT_BELOW : ALERT_ABOVE;
+
+        if (metric < 0 ||
+            !alerts_add_rule(metric, direction,
+                             rule[ALERTS_THRESHOLD_Label] | 0,
+                             rule[ALERTS_HYSTERESIS_Label] | 0,
+                             (rule[ALERTS_DURATION_Label] | 0) * 1000UL))
+        {
+            Serial.println("Skipping invalid alert rule");
+        }
+    }
+
+    if (json.containsKey(ALERTS_TRAP_HOST_Label))
+        STRCPY(state.snmpTrapHost, json[ALERTS_TRAP_HOST_Label] | "");
+
+    return true;
+}
+
+void saveAlertConfig()
+{
+    DynamicJsonDocument json(1024);
+    JsonArray rules = json.createNestedArray(ALERTS_RULES_Label);
+
+    json[ALERTS_TRAP_HOST_Label] = state.snmpTrapHost;
+
+    for (uint8_t i = 0; i < alerts_rule_count(); i++)
+    {
+        const struct alert_rule *rule = alerts_get_rule(i);
+        JsonObject entry = rules.createNestedObject();
+
+        entry[ALERTS_METRIC_Label] = alerts_metric_name(rule->metric);
+        entry[ALERTS_DIRECTION_Label] = rule->direction == ALERT_BELOW ? "below" : "above";
+        entry[ALERTS_THRESHOLD_Label] = rule->threshold;
+        entry[ALERTS_HYSTERESIS_Label] = rule->hysteresis;
+        entry[ALERTS_DURATION_Label] = rule->min_duration_ms / 1000;
+    }
+
+    File file = storage->fs().open(ALERTS_FILENAME, "w");
+
+    if (!file)
+    {
+        Serial.println("failed to open alert file for writing");
+        return;
+    }
+
+    serializeJson(json, file);
+    file.close();
+    Serial.println("Saved alert rules");
+}
+
+void loadFilterConfig()
+{
+    File file = storage->fs().open(FILTERS_FILENAME, "r");
+
+    if (!file)
+    {
+        return;
+    }
+
+    DynamicJsonDocument json(1024);
+    DeserializationError error = deserializeJson(json, file);
+    file.close();
+
+    if (!error && applyFilterConfig(json))
+    {
+        Serial.println("Loaded filters.");
+        return;
+    }
+
+    Serial.println("filter file could not be read, using default filters.");
+    filter_reset();
+}
+
+/*
+ * {"filters": [{"metric": "co2", "median": 5, "smoothing": "kalman", "process_noise": 4,
+ *               "measurement_noise": 400, "max_rate": 20}]}
+ *
+ * metric is one of co2, temperature or humidity, smoothing one of none, ema (with alpha)
+ * or kalman, max_rate is the largest change per second. Metrics not listed use the default,
+ * a median of three.
+ */
+bool applyFilterConfig(JsonDocument &json)
+{
+    JsonArray filters = json[FILTERS_Label];
+
+    if (filters.isNull())
+        return false;
+
+    filter_reset();
+
+    for (JsonObject filter : filters)
+    {
+        int metric = alerts_metric_from_name(filter[ALERTS_METRIC_Label] | "");
+        int smoothing = filter_smoothing_from_name(filter[FILTER_SMOOTHING_Label] | "none");
+        const struct filter_config *defaults = filter_get_config(metric > 0 ? metric : CO2_PPM_MEASUREMENT);
+        struct filter_config config = {
+            filter[FILTER_MEDIAN_Label] | defaults->median,
+            (uint8_t)smoothing,
+            filter[FILTER_ALPHA_Label] | defaults->alpha,
+            filter[FILTER_PROCESS_NOISE_Label] | defaults->process_noise,
+            filter[FILTER_MEASUREMENT_NOISE_Label] | defaults->measurement_noise,
+            filter[FILTER_MAX_RATE_Label] | defaults->max_rate};
+
+        if (metric < 0 || smoothing < 0 || !filter_configure(metric, &config))
+        {
+            Serial.println("Skipping invalid filter");
+        }
+    }
+
+    return true;
+}
+
+void saveFilterConfig()
+{
+    DynamicJsonDocument json(1024);
+    JsonArray filters = json.createNestedArray(FILTERS_Label);
+
+    for (uint8_t metric = 1; metric <= FILTER_METRICS; metric++)
+    {
+        const struct filter_config *config = filter_get_config(metric);
+        JsonObject entry = filters.createNestedObject();
+
+        entry[ALERTS_METRIC_Label] = alerts_metric_name(metric);
+        entry[FILTER_MEDIAN_Label] = config->median;
+        entry[FILTER_SMOOTHING_Label] = filter_smoothing_name(config->smoothing);
+        entry[FILTER_ALPHA_Label] = config->alpha;
+        entry[FILTER_PROCESS_NOISE_Label] = config->process_noise;
+        entry[FILTER_MEASUREMENT_NOISE_Label] = config->measurement_noise;
+        entry[FILTER_MAX_RATE_Label] = config->max_rate;
+    }
+
+    File file = storage->fs().open(FILTERS_FILENAME, "w");
+
+    if (!file)
+    {
+        Serial.println("failed to open filter file for writing");
+        return;
+    }
+
+    serializeJson(json, file);
+    file.close();
+    Serial.println("Saved filters");
+}
+
+void loadDisplayConfig()
+{
+    File file = storage->fs().open(DISPLAY_FILENAME, "r");
+
+    if (!file)
+    {
+        return;
+    }
+
+    DynamicJsonDocument json(512);
+    DeserializationError error = deserializeJson(json, file);
+    file.close();
+
+    if (!error && applyDisplayConfig(json))
+    {
+        Serial.println("Loaded display settings.");
+        return;
+    }
+
+    Serial.println("display file could not be read, using default display settings.");
+}
+
+/*
+ * {"dim_after": 60, "sleep_after": 300, "sleep_on_ac": false, "day_level": 100,
+ *  "night_level": 40, "dimmed_level": 20, "day_hour": 7, "night_hour": 21}
+ *
+ * Timeouts are in seconds since the last touch or alert, 0 turns them off. Levels are
+ * the brightness in %, the night level applies from night_hour until day_hour.
+ * Missing keys keep their current value.
+ */
+bool applyDisplayConfig(JsonDocument &json)
+{
+    const struct backlight_config *current = backlight_get_config();
+    struct backlight_config config = {
+        (json[DISPLAY_DIM_AFTER_Label] | current->dim_after_ms / 1000) * 1000,
+        (json[DISPLAY_SLEEP_AFTER_Label] | current->sleep_after_ms / 1000) * 1000,
+        json[DISPLAY_SLEEP_ON_AC_Label] | current->sleep_on_ac,
+        json[DISPLAY_DAY_LEVEL_Label] | current->day_level,
+        json[DISPLAY_NIGHT_LEVEL_Label] | current->night_level,
+        json[DISPLAY_DIMMED_LEVEL_Label] | current->dimmed_level,
+        json[DISPLAY_DAY_HOUR_Label] | current->day_hour,
+        json[DISPLAY_NIGHT_HOUR_Label] | current->night_hour};
+
+    return backlight_configure(&config);
+}
+
+void saveDisplayConfig()
+{
+    const struct backlight_config *config = backlight_get_config();
+    DynamicJsonDocument json(512);
+
+    json[DISPLAY_DIM_AFTER_Label] = config->dim_after_ms / 1000;
+    json[DISPLAY_SLEEP_AFTER_Label] = config->sleep_after_ms / 1000;
+    json[DISPLAY_SLEEP_ON_AC_Label] = config->sleep_on_ac;
+    json[DISPLAY_DAY_LEVEL_Label] = config->day_level;
+    json[DISPLAY_NIGHT_LEVEL_Label] = config->night_level;
+    json[DISPLAY_DIMMED_LEVEL_Label] = config->dimmed_level;
+    json[DISPLAY_DAY_HOUR_Label] = config->day_hour;
+    json[DISPLAY_NIGHT_HOUR_Label] = config->night_hour;
+
+    File file = storage->fs().open(DISPLAY_FILENAME, "w");
+
+    if (!file)
+    {
+        Serial.println("failed to open display file for writing");
+        return;
+    }
+
+    serializeJson(json, file);
+    file.close();
+    Serial.println("Saved display settings");
+}
+
+void loadRetentionConfig()
+{
+    File file = storage->fs().open(RETENTION_FILENAME, "r");
+
+    if (!file)
+    {
+        return;
+    }
+
+    DynamicJsonDocument json(256);
+    DeserializationError error = deserializeJson(json, file);
+    file.close();
+
+    if (!error && applyRetentionConfig(json))
+    {
+        Serial.println("Loaded retention settings.");
+        return;
+    }
+
+    Serial.println("retention file could not be read, using default retention settings.");
+}
+
+/*
+ * {"raw_days": 30, "minute_days": 365, "hour_days": 3650}
+ *
+ * The SD card keeps every record for raw_days, the means of each minute until
+ * they are minute_days old and the means of each hour until hour_days. The
+ * windows must not be shorter than the ones before them. Missing keys keep
+ * their current value.
+ */
+bool applyRetentionConfig(JsonDocument &json)
+{
+    return dataRetention.configure(json[RETENTION_RAW_DAYS_Label] | dataRetention.rawDays(),
+                                   json[RETENTION_MINUTE_DAYS_Label] | dataRetention.minuteDays(),
+                                   json[RETENTION_HOUR_DAYS_Label] | dataRetention.hourDays());
+}
+
+void saveRetentionConfig()
+{
+    DynamicJsonDocument json(256);
+
+    json[RETENTION_RAW_DAYS_Label] = dataRetention.rawDays();
+    json[RETENTION_MINUTE_DAYS_Label] = dataRetention.minuteDays();
+    json[RETENTION_HOUR_DAYS_Label] = dataRetention.hourDays();
+
+    File file = storage->fs().open(RETENTION_FILENAME, "w");
+
+    if (!file)
+    {
+        Serial.println("failed to open retention file for writing");
+        return;
+    }
+
+    serializeJson(json, file);
+    file.close();
+    Serial.println("Saved retention settings");
+}
+
+void setTrapDestination(struct state *state)
+{
+#if LWIP_SNMP
+    IPAddress trapIP;
+
+    if (!trapIP.fromString((String)state->snmpTrapHost))
+    {
+        snmp_trap_dst_enable(0, 0);
+        return;
+    }
+
+    ip_addr_t dst;
+    IP_ADDR4(&dst, trapIP[0], trapIP[1], trapIP[2], trapIP[3]);
+    snmp_trap_dst_ip_set(0, &dst);
+    snmp_trap_dst_enable(0, 1);
+    Serial.println("Sending SNMP traps to " + trapIP.toString());
+#endif /* LWIP_SNMP */
+}
+
+void mqttCallback(char *topic, byte *payload, unsigned int length)
+{
+    DynamicJsonDocument json(1024);
+
+    if ((String)topic == (String)state.mqttTopic + (String)TOPIC_FILTER_CONFIG)
+    {
+        if (deserializeJson(json, payload, length) || !applyFilterConfig(json))
+        {
+            Serial.println("Received invalid filters");
+            return;
+        }
+
+        saveFilterConfig();
+        return;
+    }
+
+    if ((String)topic == (String)state.mqttTopic + (String)TOPIC_DISPLAY_CONFIG)
+    {
+        if (deserializeJson(json, payload, length) || !applyDisplayConfig(json))
+        {
+            Serial.println("Received invalid display settings");
+            return;
+        }
+
+        saveDisplayConfig();
+        return;
+    }
+
+    if ((String)topic == (String)state.mqttTopic + (String)TOPIC_RETENTION_CONFIG)
+    {
+        if (deserializeJson(json, payload, length) || !applyRetentionConfig(json))
+        {
+            Serial.println("Received invalid retention settings");
+            return;
+        }
+
+        saveRetentionConfig();
+        return;
+    }
+
+    if ((String)topic == (String)state.mqttTopic + (String)TOPIC_TRACE)
+    {
+        if (length == 5 && strncmp((const char *)payload, "start", length) == 0)
+            startTrace();
+        else if (length == 4 && strncmp((const char *)payload, "stop", length) == 0)
+            stopTrace();
+        return;
+    }
+
+    if ((String)topic != (String)state.mqttTopic + (String)TOPIC_ALERT_CONFIG)
+        return;
+
+    DeserializationError error = deserializeJson(json, payload, length);
+
+    if (error || !applyAlertConfig(json))
+    {
+        Serial.println("Received invalid alert rules");
+        return;
+    }
+
+    saveAlertConfig();
+    setTrapDestination(&state);
+}
+
+#if LWIP_SNMP
+struct alertTrap
+{
+    s32_t metric;
+    s32_t value;
+    s32_t threshold;
+    bool active;
+};
+
+// runs in the tcpip thread, the raw snmp api must not be used from loop()
+static void sendAlertTrap(void *ctx)
+{
+    static const u32_t metricOid[] = {1, 3, 6, 1, 4, 1, 58049, 1, 5, 1, 0};
+    static const u32_t valueOid[] = {1, 3, 6, 1, 4, 1, 58049, 1, 5, 2, 0};
+    static const u32_t thresholdOid[] = {1, 3, 6, 1, 4, 1, 58049, 1, 5, 3, 0};
+
+    struct alertTrap *trap = (struct alertTrap *)ctx;
+    struct snmp_varbind varbinds[3];
+    memset(varbinds, 0, sizeof(varbinds));
+
+    snmp_oid_assign(&varbinds[0].oid, metricOid, LWIP_ARRAYSIZE(metricOid));
+    varbinds[0].value = &trap->metric;
+    snmp_oid_assign(&varbinds[1].oid, valueOid, LWIP_ARRAYSIZE(valueOid));
+    varbinds[1].value = &trap->value;
+    snmp_oid_assign(&varbinds[2].oid, thresholdOid, LWIP_ARRAYSIZE(thresholdOid));
+    varbinds[2].value = &trap->threshold;
+
+    for (int i = 0; i < 3; i++)
+    {
+        varbinds[i].type = SNMP_ASN1_TYPE_INTEGER;
+        varbinds[i].value_len = sizeof(s32_t);
+        varbinds[i].next = i < 2 ? &varbinds[i + 1] : NULL;
+        varbinds[i].prev = i > 0 ? &varbinds[i - 1] : NULL;
+    }
+
+    snmp_send_trap_specific(trap->active ? SNMP_TRAP_ALERT_RAISED : SNMP_TRAP_ALERT_CLEARED, varbinds);
+    delete trap;
+}
+#endif /* LWIP_SNMP */
+
+void onAlert(const struct alert_rule *rule, int32_t value, bool active)
+{
+    String metric = alerts_metric_name(rule->metric);
+
+    Serial.println("Alert " + metric + (active ? " raised: " : " cleared: ") + String(value));
+
+    if (active)
+    {
+        backlight_activity(millis());
+    }
+
+#if LWIP_SNMP
+    struct alertTrap *trap = new alertTrap{rule->metric, value, rule->threshold, active};
+    if (tcpip_callback(sendAlertTrap, trap) != ERR_OK)
+    {
+        delete trap;
+    }
+#endif /* LWIP_SNMP */
+
+    if (!mqtt.connected() || (String)state.mqttTopic == "")
+        return;
+
+    String alertTopic = (String)state.mqttTopic + (String)TOPIC_ALERT;
+    DynamicJsonDocument json(256);
+    char buffer[128];
+
+    json[ALERTS_METRIC_Label] = metric;
+    json[ALERTS_DIRECTION_Label] = rule->direction == ALERT_BELOW ? "below" : "above";
+    json[ALERTS_THRESHOLD_Label] = rule->threshold;
+    json["value"] = value;
+    json["active"] = active;
+
+    size_t n = serializeJson(json, buffer);
+
+    if (mqttPublish((const char *)alertTopic.c_str(), (const uint8_t *)buffer, n))
+        Serial.println("Published alert to MQTT");
+}
+
+void loadSnmpv3Config()
+{
+#if LWIP_SNMP && LWIP_SNMP_V3
+    DynamicJsonDocument json(2048);
+    File file = storage->fs().open(SNMPV3_FILENAME, "r");
+
+    if (file)
+    {
+        DeserializationError error = deserializeJson(json, file);
+        file.close();
+
+        if (error)
+        {
+            Serial.println("snmpv3 file could not be read.");
+            json.clear();
+        }
+    }
+
+    uint8_t mac[6];
+    esp_efuse_mac_get_default(mac);
+    // snmpEngineBoots has to increase on every boot (RFC 3414 2.2.2)
+    snmpv3_users_init(mac, (json[SNMPV3_BOOTS_Label] | 0) + 1);
+
+    const u8_t *engineId;
+    u8_t engineIdLen;
+    snmpv3_users_get_engine_id(&engineId, &engineIdLen);
+
+    // once a user exists, v1/v2c communities are refused unless explicitly allowed
+    snmpv3_users_set_v3_only(json[SNMPV3_V3_ONLY_Label] | true);
+
+    // off unless configured, a GETBULK walk may go on beyond the limit
+    setSnmpRateLimit(json[SNMPV3_RATE_LIMIT_Label] | 0);
+
+    // stored keys are localized to the engine id and useless on another device
+    if (toHex(engineId, engineIdLen) == (String)(json[SNMPV3_ENGINE_ID_Label] | ""))
+    {
+        snmpv3_users_clear();
+
+        for (JsonObject entry : json[SNMPV3_USERS_Label].as<JsonArray>())
+        {
+            struct snmpv3_user user;
+            memset(&user, 0, sizeof(user));
+
+            STRCPY(user.name, entry[SNMPV3_NAME_Label] | "");
+            user.auth_algo = (String)(entry[SNMPV3_AUTH_Label] | "") == "md5" ? SNMP_V3_AUTH_ALGO_MD5 : SNMP_V3_AUTH_ALGO_SHA;
+            user.priv_algo = (String)(entry[SNMPV3_PRIV_Label] | "") == "des"   ? SNMP_V3_PRIV_ALGO_DES
+                             : (String)(entry[SNMPV3_PRIV_Label] | "") == "aes" ? SNMP_V3_PRIV_ALGO_AES
+                                                                                : SNMP_V3_PRIV_ALGO_INVAL;
+
+            if (!fromHex(entry[SNMPV3_AUTH_KEY_Label] | "", user.auth_key, SNMPV3_KEY_LEN) ||
+                (user.priv_algo != SNMP_V3_PRIV_ALGO_INVAL && !fromHex(entry[SNMPV3_PRIV_KEY_Label] | "", user.priv_key, SNMPV3_KEY_LEN)) ||
+                snmpv3_users_add(&user) != ERR_OK)
+            {
+                Serial.println("Skipping invalid snmpv3 user");
+            }
+        }
+    }
+
+    Serial.println("Loaded " + String(snmpv3_users_count()) + " snmpv3 users.");
+    saveSnmpv3Config();
+#endif /* LWIP_SNMP && LWIP_SNMP_V3 */
+}
+
+void saveSnmpv3Config()
+{
+#if LWIP_SNMP && LWIP_SNMP_V3
+    DynamicJsonDocument json(2048);
+    const u8_t *engineId;
+    u8_t engineIdLen;
+
+    snmpv3_users_get_engine_id(&engineId, &engineIdLen);
+    savedSnmpv3Boots = snmpv3_get_engine_boots();
+    json[SNMPV3_BOOTS_Label] = savedSnmpv3Boots;
+    json[SNMPV3_ENGINE_ID_Label] = toHex(engineId, engineIdLen);
+    json[SNMPV3_V3_ONLY_Label] = snmpv3_users_get_v3_only() != 0;
+#if SNMP_LWIP_RESPONSE_CACHE
+    json[SNMPV3_RATE_LIMIT_Label] = snmp_rate_limit_get();
+#endif /* SNMP_LWIP_RESPONSE_CACHE */
+
+    JsonArray users = json.createNestedArray(SNMPV3_USERS_Label);
+    for (uint8_t i = 0; i < snmpv3_users_count(); i++)
+    {
+        const struct snmpv3_user *user = snmpv3_users_get(i);
+        JsonObject entry = users.createNestedObject();
+
+        entry[SNMPV3_NAME_Label] = user->name;
+        entry[SNMPV3_AUTH_Label] = user->auth_algo == SNMP_V3_AUTH_ALGO_MD5 ? "md5" : "sha";
+        entry[SNMPV3_AUTH_KEY_Label] = toHex(user->auth_key, SNMPV3_KEY_LEN);
+        if (user->priv_algo != SNMP_V3_PRIV_ALGO_INVAL)
+        {
+            entry[SNMPV3_PRIV_Label] = user->priv_algo == SNMP_V3_PRIV_ALGO_DES ? "des" : "aes";
+            entry[SNMPV3_PRIV_KEY_Label] = toHex(user->priv_key, SNMPV3_KEY_LEN);
+        }
+    }
+
+    File file = storage->fs().open(SNMPV3_FILENAME, "w");
+
+    if (!file)
+    {
+        Serial.println("failed to open snmpv3 file for writing");
+        return;
+    }
+
+    serializeJson(json, file);
+    file.close();
+#endif /* LWIP_SNMP && LWIP_SNMP_V3 */
+}
+
+// a reboot must not go back to the boots before snmpEngineTime started over (RFC 3414 2.2.2)
+void saveSnmpv3Boots()
+{
+#if LWIP_SNMP && LWIP_SNMP_V3
+    if (snmpv3_get_engine_boots() != savedSnmpv3Boots)
+    {
+        saveSnmpv3Config();
+    }
+#endif /* LWIP_SNMP && LWIP_SNMP_V3 */
+}
+
+void setSnmpRateLimit(long perSecond)
+{
+#if LWIP_SNMP && SNMP_LWIP_RESPONSE_CACHE
+    // bursts of two seconds worth of requests
+    perSecond = constrain(perSecond, 0, 1000);
+    snmp_rate_limit_set(perSecond, 2 * perSecond);
+#endif /* LWIP_SNMP && SNMP_LWIP_RESPONSE_CACHE */
+}
+
+void addSnmpv3User(const char *name, const char *authPassword, const char *privPassword)
+{
+#if LWIP_SNMP && LWIP_SNMP_V3
+    unsigned long start = millis();
+    err_t err = snmpv3_users_add_password(
+        name,
+        SNMP_V3_AUTH_ALGO_SHA, authPassword,
+        privPassword[0] != '\0' ? SNMP_V3_PRIV_ALGO_AES : SNMP_V3_PRIV_ALGO_INVAL, privPassword);
+
+    if (err != ERR_OK)
+    {
+        Serial.println("Invalid snmpv3 user, passwords need at least 8 characters");
+        return;
+    }
+
+    Serial.println("Localized snmpv3 keys in " + String(millis() - start) + "ms");
+    saveSnmpv3Config();
+#endif /* LWIP_SNMP && LWIP_SNMP_V3 */
+}
+
+String toHex(const uint8_t *data, size_t len)
+{
+    String hex;
+    char digits[3];
+
+    for (size_t i = 0; i < len; i++)
+    {
+        sprintf(digits, "%02x", data[i]);
+        hex += digits;
+    }
+
+    return hex;
+}
+
+bool fromHex(const char *hex, uint8_t *data, size_t len)
+{
+    if (strlen(hex) != len * 2)
+        return false;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        unsigned int byte;
+        if (sscanf(hex + 2 * i, "%2x", &byte) != 1)
+            return false;
+        data[i] = byte;
+    }
+
+    return true;
+}
+
 bool loadConfigData()
 {
-    File file = SPIFFS.open(CONFIG_FILENAME, "r");
+    File file = storage->fs().open(CONFIG_FILENAME, "r");
     memset(&WM_config, 0, sizeof(WM_config));
     memset(&WM_STA_IPconfig, 0, sizeof(WM_STA_IPconfig));
 
@@ -1163,7 +2061,7 @@ bool loadConfigData()
 
 void saveConfigData()
 {
-    File file = SPIFFS.open(CONFIG_FILENAME, "w");
+    File file = storage->fs().open(CONFIG_FILENAME, "w");
     LOGERROR(F("SaveWiFiCfgFile "));
 
     if (file)
@@ -1260,7 +2158,7 @@ void handleConfigPortal(struct state *oldstate, struct state *state)
         Router_SSID = "";
         Router_Pass = "";
 
-        SPIFFS.remove(CONFIG_FILENAME);
+        storage->fs().remove(CONFIG_FILENAME);
 
         asyncWifiManager->resetSettings();
         WiFi.disconnect(false, true);
@@ -1296,6 +2194,21 @@ void configPortalCallback()
     saveMQTTConfig(&state);
     setMQTTServer(&state);
 
+#if LWIP_SNMP && LWIP_SNMP_V3
+    snmpv3_users_set_v3_only((String)snmpv3Only->getValue() != "0");
+#if SNMP_LWIP_RESPONSE_CACHE
+    setSnmpRateLimit(((String)snmpRateLimit->getValue()).toInt());
+#endif /* SNMP_LWIP_RESPONSE_CACHE */
+    if ((String)snmpv3User->getValue() != "" && (String)snmpv3AuthPassword->getValue() != "")
+    {
+        addSnmpv3User(snmpv3User->getValue(), snmpv3AuthPassword->getValue(), snmpv3PrivPassword->getValue());
+    }
+    else
+    {
+        saveSnmpv3Config();
+    }
+#endif /* LWIP_SNMP && LWIP_SNMP_V3 */
+
     WiFi.mode(WIFI_STA); // close AP
 }
 
@@ -1479,106 +2392,101 @@ void updateScreenRotation(struct state *oldstate, struct state *state)
         M5.Lcd.clearDisplay();
         M5.Lcd.setRotation(1);
     }
+    touchPanel.setRotated(state->is_screen_rotated);
 }
 
 void updateTouch(struct state *state)
 {
-    switch (state->menu_mode)
+    struct touch_event event;
+
+    // the gestures queued by the touch panel task, the only one reading the FT6336
+    while (touch_next(&event))
     {
-    case menuModeGraphs:
-        if (batteryButton.wasPressed())
-            state->graph_mode = graphModeBatteryMah;
-        if (co2Button.wasPressed())
-            state->graph_mode = graphModeCo2;
-        if (midLeftButton.wasPressed())
-            state->graph_mode = graphModeTemperature;
-        if (midRightButton.wasPressed())
-            state->graph_mode = graphModeHumidity;
-        break;
+        trace_touch(event.start_us / 1000, event.x, event.y, true);
+        trace_touch(event.end_us / 1000, event.end_x, event.end_y, false);
+
+        // the touch waking the display presses no button
+        bool asleep = state->display_sleep;
+        backlight_activity(millis());
+        if (asleep)
+            continue;
 
+        if ((state->menu_mode == menuModeGraphs && handleGraphGesture(state, &event)) ||
+            (event.gesture == TOUCH_TAP && handleTap(state, Point(event.x, event.y))))
+        {
+            inputUs = event.end_us;
+        }
+    }
+}
+
+/*
+ * The buttons of the menus and the touch buttons below the screen, at is where
+ * a tap started. Returns whether it pressed one.
+ */
+bool handleTap(struct state *state, const Point &at)
+{
+    bool pressed = false;
+    auto hit = [&](Button &button) {
+        bool contains = button.contains(at);
+        pressed = pressed || contains;
+        return contains;
+    };
+
+    switch (state->menu_mode)
+    {
     case menuModeCalibrationPpmSettings:
-        if (midLeftButton.wasPressed())
+        if (hit(midLeftButton))
             state->calibration_ppm_value -= state->calibration_ppm_value >= 410 ? 10 : 0;
-        if (midRightButton.wasPressed())
+        if (hit(midRightButton))
             state->calibration_ppm_value += state->calibration_ppm_value <= 1990 ? 10 : 0;
-        if (toggleAutoCalButton.wasPressed())
+        if (hit(toggleAutoCalButton))
         {
             state->auto_calibration_on = !state->auto_calibration_on;
-            if (currentAirSensor == &airSensorSCD30)
-            {
-                airSensorSCD30.setAutoSelfCalibration(state->auto_calibration_on);
-            } 
-            else if (currentAirSensor == &airSensorSCD40) 
-            {
-                airSensorSCD40.setAutomaticSelfCalibrationEnabled(state->auto_calibration_on);
-            }
+            airSensor->setAutoCalibration(state->auto_calibration_on);
         }
-        if (submitCalibrationButton.wasPressed())
+        if (hit(submitCalibrationButton))
             state->menu_mode = menuModeCalibrationPpmAlert;
         break;
 
     case menuModeCalibrationTempSettings:
-        if (midLeftButton.wasPressed())
+        if (hit(midLeftButton))
             state->calibration_temp_value -= state->calibration_temp_value >= 10.0 ? 0.1 : 0;
-        if (midRightButton.wasPressed())
+        if (hit(midRightButton))
             state->calibration_temp_value += state->calibration_temp_value <= 42.0 ? 0.1 : 0;
 
-        if (submitCalibrationButton.wasPressed())
+        if (hit(submitCalibrationButton))
             state->menu_mode = menuModeCalibrationTempAlert;
         break;
 
     case menuModeCalibrationTempAlert:
-        if (submitCalibrationButton.wasPressed())
+        if (hit(submitCalibrationButton))
         {
-            if (currentAirSensor == &airSensorSCD30)
-            {
-                // temp_now + old_offset - temp_target = new offset
-                float temp_now = airSensorSCD30.getTemperature();
-                float temp_target = state->calibration_temp_value;
-                float old_offset = state->temp_offset;
-                float new_offset = temp_now + old_offset - temp_target;
-                state->temp_offset = new_offset;
-                airSensorSCD30.setTemperatureOffset(new_offset);
-            } 
-            else if (currentAirSensor == &airSensorSCD40)
-            {
-                float temp_now = airSensorSCD40.getTemperature();
-                float temp_target = state->calibration_temp_value;
-                float old_offset = state->temp_offset;
-                float new_offset = temp_now + old_offset - temp_target;
-                state->temp_offset = new_offset;
-                airSensorSCD40.stopPeriodicMeasurement();
-                airSensorSCD40.setTemperatureOffset(new_offset);
-                airSensorSCD40.startPeriodicMeasurement();
-            }
+            // temp_now + old_offset - temp_target = new offset
+            float temp_now = state->temperature_celsius / 10.0;
+            float temp_target = state->calibration_temp_value;
+            float old_offset = state->temp_offset;
+            float new_offset = temp_now + old_offset - temp_target;
+            state->temp_offset = new_offset;
+            airSensor->setTemperatureOffset(new_offset);
             state->menu_mode = menuModeCalibrationTempSettings;
         }
-        if (toggleAutoCalButton.wasPressed())
+        if (hit(toggleAutoCalButton))
             state->menu_mode = menuModeCalibrationTempSettings;
         break;
 
     case menuModeCalibrationPpmAlert:
-        if (submitCalibrationButton.wasPressed())
+        if (hit(submitCalibrationButton))
         {
-            if (currentAirSensor == &airSensorSCD30)
-            {
-                airSensorSCD30.setForcedRecalibrationFactor(state->calibration_ppm_value);
-            } 
-            else if (currentAirSensor == &airSensorSCD40)
-            {
-                airSensorSCD40.stopPeriodicMeasurement();
-                airSensorSCD40.performForcedRecalibration(state->calibration_ppm_value);
-                airSensorSCD40.startPeriodicMeasurement();
-            }
+            airSensor->forceCalibration(state->calibration_ppm_value);
             state->menu_mode = menuModeCalibrationPpmSettings;
             state->cal_info = infoCalSuccess;
         }
-        if (toggleAutoCalButton.wasPressed())
+        if (hit(toggleAutoCalButton))
             state->menu_mode = menuModeCalibrationPpmSettings;
         break;
 
     case menuModeWiFiSettings:
-        if (toggleWiFiButton.wasPressed())
+        if (hit(toggleWiFiButton))
             state->is_wifi_activated = !state->is_wifi_activated;
 
         // abort config
@@ -1586,45 +2494,111 @@ void updateTouch(struct state *state)
         {
             state->is_config_running = false;
         }
-        if (resetWiFiButton.wasPressed())
+        if (hit(resetWiFiButton))
         {
             state->is_requesting_reset = true;
         }
         break;
 
     case menuModeTimeSettings:
-        if (syncTimeButton.wasPressed())
+        if (hit(syncTimeButton))
             state->force_sync = true;
         break;
 
     case menuModeUpdateSettings:
-        if (syncTimeButton.wasPressed())
+        if (hit(syncTimeButton))
             state->is_requesting_update = true;
         break;
 
     case menuModeRotationSettings:
-        if (rotateScreenButton.wasPressed())
+        if (hit(rotateScreenButton))
             state->is_screen_rotated = !state->is_screen_rotated;
 
     default:
         break;
     }
 
-    if (M5.BtnA.wasPressed())
+    if (hit(M5.BtnA))
     {
         if (state->menu_mode == menuModeGraphs)
         {
-            setDisplayPower(state->display_sleep);
-            state->display_sleep = !state->display_sleep;
+            backlight_sleep(millis());
         }
         else
             state->menu_mode = menuModeGraphs;
     }
 
-    if (M5.BtnC.wasPressed())
+    if (hit(M5.BtnC))
     {
         handleNavigation(state);
     }
+
+    return pressed;
+}
+
+/*
+ * A tap on a value shows its graph. A swipe starting on the values or on the
+ * graph: left and right pan by half the shown range, up zooms out and down
+ * zooms in. A long press there returns to the last four hours.
+ */
+bool handleGraphGesture(struct state *state, const struct touch_event *event)
+{
+    static const uint32_t spans[GRAPH_ZOOMS] = GRAPH_SPANS;
+    Point from(event->x, event->y);
+    uint8_t zoom = state->graph_zoom;
+    uint32_t offset = state->graph_offset;
+    enum graphMode mode = state->graph_mode;
+
+    if (event->gesture == TOUCH_LONG_PRESS && from.y >= 0 && from.y < 26)
+    {
+        state->profile_overlay = !state->profile_overlay;
+        return true;
+    }
+
+    if (event->gesture == TOUCH_TAP)
+    {
+        if (batteryButton.contains(from))
+            state->graph_mode = graphModeBatteryMah;
+        if (co2Button.contains(from))
+            state->graph_mode = graphModeCo2;
+        if (midLeftButton.contains(from))
+            state->graph_mode = graphModeTemperature;
+        if (midRightButton.contains(from))
+            state->graph_mode = graphModeHumidity;
+        return state->graph_mode != mode;
+    }
+
+    if (!(co2Button.contains(from) || midLeftButton.contains(from) || midRightButton.contains(from) ||
+          (from.y >= 144 && from.y < 240)))
+    {
+        return false;
+    }
+
+    uint32_t step = spans[zoom] / 2;
+    switch (event->gesture)
+    {
+    case TOUCH_LONG_PRESS:
+        state->graph_zoom = 0;
+        state->graph_offset = 0;
+        break;
+    case TOUCH_SWIPE_RIGHT:
+        state->graph_offset += step;
+        break;
+    case TOUCH_SWIPE_LEFT:
+        state->graph_offset = state->graph_offset > step ? state->graph_offset - step : 0;
+        break;
+    case TOUCH_SWIPE_UP:
+        if (state->graph_zoom < GRAPH_ZOOMS - 1)
+            state->graph_zoom++;
+        break;
+    case TOUCH_SWIPE_DOWN:
+        if (state->graph_zoom > 0)
+            state->graph_zoom--;
+        break;
+    }
+
+    state->graph_offset = min(state->graph_offset, GRAPH_HISTORY - spans[state->graph_zoom]);
+    return state->graph_zoom != zoom || state->graph_offset != offset;
 }
 
 void updateTime(struct state *state)
@@ -1646,40 +2620,61 @@ void updateBattery(struct state *state)
         return;
     }
 
-    int columbCharged = Read32bit(0xB0);
-    int columbDischarged = Read32bit(0xB4);
-    float batVoltage = M5.Axp.GetBatVoltage();
-    state->battery_current = M5.Axp.GetBatCurrent();
+    // the registers of the last second, the next reads run on the bus meanwhile
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        if (batteryReads[i].status == I2C_QUEUED)
+        {
+            return;
+        }
+    }
+
+    if (batteryReads[0].status == I2C_DONE && batteryReads[1].status == I2C_DONE &&
+        batteryReads[2].status == I2C_DONE)
+    {
+        struct battery_sample sample;
+
+        // millis() runs on the esp_timer clock as well
+        battery_axp192_sample(&sample, batteryReads[0].rx, batteryReads[1].rx, batteryReads[2].rx,
+                              batteryReads[2].doneUs / 1000);
+        battery_update(&sample);
+        trace_battery(&sample);
+    }
 
-    if (batVoltage < 3.2 && columbDischarged > columbCharged)
+    const uint8_t regs[] = {BATTERY_AXP192_POWER_REG, BATTERY_AXP192_ADC_REG, BATTERY_AXP192_COULOMB_REG};
+    const uint8_t lens[] = {BATTERY_AXP192_POWER_LEN, BATTERY_AXP192_ADC_LEN, BATTERY_AXP192_COULOMB_LEN};
+    for (uint8_t i = 0; i < 3; i++)
     {
-        M5.Axp.ClearCoulombcounter();
-        M5.Axp.EnableCoulombcounter();
+        i2cPrepare(&batteryReads[i], AXP192_ADDRESS, &regs[i], 1, 0, lens[i]);
+        axpBus.submit(&batteryReads[i]);
     }
 
-    state->battery_voltage = batVoltage;
-    state->battery_mah = 65536 * 0.5 * (columbCharged - columbDischarged) / 3600.0 / 25.0;
+    const struct battery_sample *sample = battery_last_sample(millis());
+    if (sample == NULL)
+    {
+        return;
+    }
 
-    if (state->in_ac && abs(state->battery_current) < 0.1 && state->battery_voltage >= 4.15 &&
-        abs(state->battery_mah - state->battery_capacity) > 1)
+    if (abs(battery_capacity() - state->battery_capacity) > 1)
     {
-        Serial.println("maximum found " + String(state->battery_mah));
-        state->battery_capacity = state->battery_mah;
+        Serial.println("battery capacity learned " + String(battery_capacity()));
+        state->battery_capacity = battery_capacity();
     }
 
-    int batteryPercent = state->battery_mah * 100 / state->battery_capacity;
-    batteryPercent = max(min(100, batteryPercent), 0);
+    state->battery_voltage = sample->voltage;
+    state->battery_current = sample->current;
+    state->battery_mah = battery_remaining();
+    state->battery_percent = battery_percent();
+    state->in_ac = sample->ac;
 
-    /*Serial.println(
-      "mAh: " + String(state->battery_mah) +
-      " charged: " + String(columbCharged) +
-      " discharched: " + String(columbDischarged) +
-      " batteryPercent " + String(batteryPercent) +
-      " current " + state->battery_current  +
-      " voltage " + String(state->battery_voltage)
-    ); */
-    state->battery_percent = batteryPercent;
-    state->in_ac = M5.Axp.isACIN();
+    alerts_evaluate(ALERT_METRIC_BATTERY, state->battery_percent, millis(), onAlert);
+
+    uint32_t now = time(NULL);
+    history_add_sample(BATTERY_VOLTAGE_MEASUREMENT, now, get_measurement(2, BATTERY_VOLTAGE_MEASUREMENT));
+    history_add_sample(BATTERY_CURRENT_MEASUREMENT, now, get_measurement(2, BATTERY_CURRENT_MEASUREMENT));
+#if SNMP_LWIP_RESPONSE_CACHE
+    snmp_cache_advance_epoch();
+#endif /* SNMP_LWIP_RESPONSE_CACHE */
 }
 
 void updateLed(struct state *oldstate, struct state *state)
@@ -1698,35 +2693,67 @@ void updateGraph(struct state *oldstate, struct state *state)
         return;
     }
 
-    graph.co2[state->graph_index] = state->co2_ppm;
-    graph.temperature[state->graph_index] = state->temperature_celsius / 10.0;
-    graph.humidity[state->graph_index] = state->humidity_percent / 10.0;
     graph.batteryMah[state->graph_index] = state->battery_mah;
     state->graph_index = (state->graph_index + 1) % GRAPH_UNITS;
 }
 
 void updateCo2(struct state *state)
 {
-    if (((cycle + 2) % (2 * target_fps)) != 0)
+    // the hub knows when each sensor is due, run it every frame
+    sensorHub.run(millis());
+}
+
+void onSensorReadings(uint8_t sensorId, const struct sensorReadings *readings, uint32_t nowMs)
+{
+    if (sensorId != SENSOR_ID_AIR)
     {
+#if SNMP_LWIP_RESPONSE_CACHE
+        snmp_cache_advance_epoch();
+#endif /* SNMP_LWIP_RESPONSE_CACHE */
+        health_record_sample((uint32_t)(esp_timer_get_time() - readings->readyUs));
         return;
     }
-    if (currentAirSensor == &airSensorSCD30 && airSensorSCD30.dataAvailable())
-    {
-        Serial.println("Reading Data from SCD30...");
 
-        state->co2_ppm = airSensorSCD30.getCO2();
-        state->temperature_celsius = airSensorSCD30.getTemperature() * 10;
-        state->humidity_percent = airSensorSCD30.getHumidity() * 10;
+    Serial.println("Reading Data from " + (String)airSensor->name() + "...");
+
+    // state holds the filtered values, the raw ones stay in the filter
+    uint32_t sampleMs = (uint32_t)(readings->timestampUs / 1000);
+    for (uint8_t i = 0; i < readings->len; i++)
+    {
+        trace_sensor(sampleMs, sensorId, readings->reading[i].type, readings->reading[i].value);
     }
-    else if (currentAirSensor == &airSensorSCD40 && airSensorSCD40.readMeasurement())
+    for (uint8_t i = 0; i < readings->len; i++)
     {
-        Serial.println("Reading Data from SCD40...");
+        int32_t value = filter_process(readings->reading[i].type, readings->reading[i].value, sampleMs);
 
-        state->co2_ppm = airSensorSCD40.getCO2();
-        state->temperature_celsius = airSensorSCD40.getTemperature() * 10;
-        state->humidity_percent = airSensorSCD40.getHumidity() * 10;
+        switch (readings->reading[i].type)
+        {
+        case CO2_PPM_MEASUREMENT:
+            state.co2_ppm = value;
+            break;
+        case TEMPERATURE_MEASUREMENT:
+            state.temperature_celsius = value;
+            break;
+        case HUMIDITY_MEASUREMENT:
+            state.humidity_percent = value;
+            break;
+        }
     }
+
+    alerts_evaluate(ALERT_METRIC_CO2, state.co2_ppm, millis(), onAlert);
+    alerts_evaluate(ALERT_METRIC_TEMPERATURE, state.temperature_celsius, millis(), onAlert);
+    alerts_evaluate(ALERT_METRIC_HUMIDITY, state.humidity_percent, millis(), onAlert);
+
+    uint32_t now = time(NULL);
+    history_add_sample(CO2_PPM_MEASUREMENT, now, get_measurement(1, CO2_PPM_MEASUREMENT));
+    history_add_sample(TEMPERATURE_MEASUREMENT, now, get_measurement(1, TEMPERATURE_MEASUREMENT));
+    history_add_sample(HUMIDITY_MEASUREMENT, now, get_measurement(1, HUMIDITY_MEASUREMENT));
+#if SNMP_LWIP_RESPONSE_CACHE
+    snmp_cache_advance_epoch();
+#endif /* SNMP_LWIP_RESPONSE_CACHE */
+
+    // the sample reached all consumers
+    health_record_sample((uint32_t)(esp_timer_get_time() - readings->readyUs));
 }
 
 void setPassword(struct state *state)
@@ -1893,21 +2920,44 @@ void drawScreen(struct state *oldstate, struct state *state)
 
 void drawHeader(struct state *oldstate, struct state *state)
 {
+    static bool drawn = false;
+    bool redraw = !drawn ||
+                  state->display_sleep != oldstate->display_sleep ||
+                  state->is_screen_rotated != oldstate->is_screen_rotated;
+
     if (
         state->current_time.tm_sec == oldstate->current_time.tm_sec &&
         state->battery_percent == oldstate->battery_percent &&
         state->in_ac == oldstate->in_ac &&
-        state->display_sleep == oldstate->display_sleep)
+        !redraw)
     {
         return;
     }
+    drawn = true;
 
-    DisbuffHeader.fillRect(0, 0, 320, 24, BLACK);
     char strftime_buf[64];
     strftime(strftime_buf, sizeof(strftime_buf) - 1, "%c", &(state->current_time));
+    String battery = String(state->battery_percent) + "%" + (state->in_ac ? "+" : "-");
+
+    if (headerGlyphs.ready())
+    {
+        // each second only the digits of the clock which changed are copied
+        if (redraw)
+        {
+            M5.Lcd.fillRect(0, 0, 320, 25, BLACK);
+            M5.Lcd.drawLine(0, 25, 320, 25, WHITE);
+            clockField.invalidate();
+            batteryField.invalidate();
+        }
+        clockField.draw(M5.Lcd, strftime_buf, WHITE);
+        batteryField.draw(M5.Lcd, battery.c_str(), WHITE);
+        return;
+    }
+
+    DisbuffHeader.fillRect(0, 0, 320, 24, BLACK);
     DisbuffHeader.drawString(String(strftime_buf), 0, 1);
     DisbuffHeader.setTextDatum(TR_DATUM);
-    DisbuffHeader.drawString(String(state->battery_percent) + "%" + (state->in_ac ? "+" : "-"), 320, 1);
+    DisbuffHeader.drawString(battery, 320, 1);
     DisbuffHeader.setTextDatum(TL_DATUM);
     DisbuffHeader.drawLine(0, 25, 320, 25, WHITE);
     DisbuffHeader.pushSprite(0, 0);
@@ -1915,21 +2965,41 @@ void drawHeader(struct state *oldstate, struct state *state)
 
 void drawValues(struct state *oldstate, struct state *state)
 {
+    static bool drawn = false;
+    bool redraw = !drawn ||
+                  state->display_sleep != oldstate->display_sleep ||
+                  state->menu_mode != oldstate->menu_mode ||
+                  state->is_screen_rotated != oldstate->is_screen_rotated;
+
     if (state->temperature_celsius == oldstate->temperature_celsius &&
         state->humidity_percent == oldstate->humidity_percent &&
         state->co2_ppm == oldstate->co2_ppm &&
-        state->display_sleep == oldstate->display_sleep &&
-        state->menu_mode == oldstate->menu_mode)
+        !redraw)
         return;
+    drawn = true;
 
-    DisbuffValue.fillRect(0, 0, 320, 116, BLACK);
-    DisbuffValue.setFreeFont(&FreeMonoBold18pt7b);
-    DisbuffValue.setTextColor(co2color(state->co2_ppm));
+    String co2 = String(state->co2_ppm) + "ppm";
+
+    if (co2Glyphs.ready())
+    {
+        if (redraw)
+        {
+            M5.Lcd.fillRect(0, 26, 320, 117, BLACK);
+            co2Field.invalidate();
+        }
+        co2Field.draw(M5.Lcd, co2.c_str(), co2color(state->co2_ppm));
+    }
+    else
+    {
+        DisbuffValue.fillRect(0, 0, 320, 116, BLACK);
+        DisbuffValue.setFreeFont(&FreeMonoBold18pt7b);
+        DisbuffValue.setTextColor(co2color(state->co2_ppm));
 
-    DisbuffValue.setTextSize(2);
-    DisbuffValue.drawString(String(state->co2_ppm) + "ppm", 160, 10);
+        DisbuffValue.setTextSize(2);
+        DisbuffValue.drawString(co2, 160, 10);
 
-    DisbuffValue.pushSprite(0, 26);
+        DisbuffValue.pushSprite(0, 26);
+    }
 
     String temperature = String(state->temperature_celsius / 10.0, 1) + "C";
     String humidity = String(state->humidity_percent / 10.0, 1) + "%";
@@ -1946,32 +3016,31 @@ void drawValues(struct state *oldstate, struct state *state)
 
 void drawGraph(struct state *oldstate, struct state *state)
 {
-    if (state->graph_mode == oldstate->graph_mode &&
+    if (state->profile_overlay)
+    {
+        drawProfileOverlay(oldstate, state);
+        return;
+    }
+
+    if (state->profile_overlay == oldstate->profile_overlay &&
+        state->graph_mode == oldstate->graph_mode &&
         state->graph_index == oldstate->graph_index &&
+        state->graph_zoom == oldstate->graph_zoom &&
+        state->graph_offset == oldstate->graph_offset &&
         state->display_sleep == oldstate->display_sleep &&
         state->menu_mode == oldstate->menu_mode)
         return;
 
-    DisbuffGraph.fillRect(0, 0, 320, 97, BLACK);
-
-    float *values = graph.co2;
-    if (state->graph_mode == graphModeBatteryMah)
-    {
-        values = graph.batteryMah;
-    }
-    else if (state->graph_mode == graphModeTemperature)
-    {
-        values = graph.temperature;
-    }
-    else if (state->graph_mode == graphModeHumidity)
-    {
-        values = graph.humidity;
-    }
-    else if (state->graph_mode == graphModeCo2)
+    if (state->graph_mode != graphModeBatteryMah)
     {
-        values = graph.co2;
+        drawHistoryGraph(state);
+        return;
     }
 
+    DisbuffGraph.fillRect(0, 0, 320, 97, BLACK);
+
+    float *values = graph.batteryMah;
+
     int i;
     float sorted[GRAPH_UNITS];
     int value_count = 0;
@@ -2011,10 +3080,9 @@ void drawGraph(struct state *oldstate, struct state *state)
         {
             int y = min(max(96 - int(factor * (value - min_value)), 0), 96);
             int x = 320 - (((state->graph_index - i) % GRAPH_UNITS + GRAPH_UNITS) % GRAPH_UNITS);
-            uint16_t color = state->graph_mode == graphModeCo2 ? co2color(value) : WHITE;
             for (int j = y; j < 96; j++)
             {
-                DisbuffGraph.drawPixel(x, j, color);
+                DisbuffGraph.drawPixel(x, j, WHITE);
             }
         }
     }
@@ -2023,6 +3091,110 @@ void drawGraph(struct state *oldstate, struct state *state)
     DisbuffGraph.pushSprite(0, 144);
 }
 
+/*
+ * CO2, temperature and humidity from the history. The columns come from the
+ * coarsest resolution still finer than the zoom level, so a redraw reads at
+ * most PLOT_BUCKETS_MAX buckets and draws GRAPH_UNITS columns at any zoom.
+ */
+void drawHistoryGraph(struct state *state)
+{
+    static const uint32_t spans[GRAPH_ZOOMS] = GRAPH_SPANS;
+    static struct plot_column columns[GRAPH_UNITS];
+    uint8_t measurementType = CO2_PPM_MEASUREMENT;
+    float scale = 1;
+
+    if (state->graph_mode == graphModeTemperature || state->graph_mode == graphModeHumidity)
+    {
+        measurementType = state->graph_mode == graphModeTemperature ? TEMPERATURE_MEASUREMENT : HUMIDITY_MEASUREMENT;
+        // tenths in the history
+        scale = 10;
+    }
+
+    uint32_t span = spans[state->graph_zoom];
+    uint32_t end = time(NULL) - state->graph_offset;
+    const struct history_series *series = history_get_series(measurementType, plot_resolution(span));
+    int16_t low;
+    int16_t high;
+
+    DisbuffGraph.fillRect(0, 0, 320, 97, BLACK);
+    String label = graphSpanLabel(span);
+    if (state->graph_offset > 0)
+    {
+        label += " -" + graphSpanLabel(state->graph_offset);
+    }
+    DisbuffGraph.drawString(label, 0, 36);
+
+    if (plot_decimate(series, end - span, span, columns, GRAPH_UNITS) == 0 ||
+        !plot_bounds(columns, GRAPH_UNITS, &low, &high))
+    {
+        DisbuffGraph.pushSprite(0, 144);
+        return;
+    }
+
+    high = max(high, (int16_t)(low + 1));
+    float factor = 96.0 / (high - low);
+    DisbuffGraph.drawString(String(high / scale, 1), 0, 2);
+    DisbuffGraph.drawString(String(low / scale, 1), 0, 70);
+
+    for (int i = 0; i < GRAPH_UNITS; i++)
+    {
+        if (!columns[i].valid)
+        {
+            continue;
+        }
+
+        int x = 320 - GRAPH_UNITS + i;
+        int top = 96 - int(factor * (columns[i].max - low));
+        int bottom = 96 - int(factor * (columns[i].min - low));
+        uint16_t color = measurementType == CO2_PPM_MEASUREMENT ? co2color(columns[i].mean) : WHITE;
+
+        // the range of the column and, at half the brightness, the area below it
+        DisbuffGraph.drawFastVLine(x, top, bottom - top + 1, color);
+        DisbuffGraph.drawFastVLine(x, bottom + 1, 95 - bottom, (color >> 1) & 0x7bef);
+    }
+
+    DisbuffGraph.pushSprite(0, 144);
+}
+
+// fps, the frame time percentiles and the slowest frame with the section which took longest in it
+void drawProfileOverlay(struct state *oldstate, struct state *state)
+{
+    struct profile_summary summary;
+
+    if (state->current_time.tm_sec == oldstate->current_time.tm_sec &&
+        state->profile_overlay == oldstate->profile_overlay &&
+        state->display_sleep == oldstate->display_sleep &&
+        state->menu_mode == oldstate->menu_mode)
+        return;
+
+    DisbuffGraph.fillRect(0, 0, 320, 97, BLACK);
+    if (profiler_summary(&summary))
+    {
+        DisbuffGraph.drawString(String(summary.fps, 1) + " fps", 160, 2);
+        DisbuffGraph.drawString("p50 " + String(summary.p50_us / 1000.0, 1) + "ms  p99 " +
+                                    String(summary.p99_us / 1000.0, 1) + "ms",
+                                160, 26);
+        DisbuffGraph.drawString("max " + String(summary.slowest.duration_us / 1000.0, 1) + "ms", 160, 50);
+        DisbuffGraph.drawString(String(profiler_section_name(summary.slowest.worst)) + " " +
+                                    String(summary.slowest.worst_us / 1000.0, 1) + "ms",
+                                160, 74);
+    }
+    DisbuffGraph.pushSprite(0, 144);
+}
+
+String graphSpanLabel(uint32_t seconds)
+{
+    if (seconds % 86400 == 0)
+    {
+        return String(seconds / 86400) + "d";
+    }
+    if (seconds % 3600 == 0)
+    {
+        return String(seconds / 3600) + "h";
+    }
+    return String(seconds / 60) + "m";
+}
+
 void drawCalibrationPpmSettings(struct state *oldstate, struct state *state)
 {
     if (state->display_sleep == oldstate->display_sleep &&
@@ -2456,27 +3628,147 @@ void writeSsd(struct state *state)
     {
         return;
     }
-    if (SD.cardType() == CARD_NONE)
+
+    // queued while the card is out
+    struct dataRecord record = {
+        (uint32_t)time(NULL),
+        state->co2_ppm,
+        state->temperature_celsius,
+        state->humidity_percent,
+        state->battery_mah};
+    dataLogWriter.submit(&record);
+}
+
+// the history of the last day from the data log, so the graphs and the SNMP history survive a restart
+void restoreHistory()
+{
+    dataLogWriter.lock();
+    if (dataLogWriter.mounted())
+    {
+        restoreHistory(time(NULL));
+    }
+    dataLogWriter.unlock();
+}
+
+void restoreHistory(uint32_t now)
+{
+    unsigned long start = millis();
+    DataLogQuery query(dataLog, now - HISTORY_RESTORE_SECONDS, now + 1);
+    struct dataRecord record;
+    uint32_t count = 0;
+
+    while (query.next(&record))
+    {
+        history_add_sample(CO2_PPM_MEASUREMENT, record.time, record.co2Ppm);
+        history_add_sample(TEMPERATURE_MEASUREMENT, record.time, record.temperature);
+        history_add_sample(HUMIDITY_MEASUREMENT, record.time, record.humidity);
+        count++;
+    }
+    Serial.println("history restored from " + String(count) + " of " + String(query.scanned()) + " lines in " +
+                   String(millis() - start) + " ms");
+}
+
+/*
+ * GET /export?from=&to= streams the lines of the data log between the two
+ * unix times as CSV, by default the last day. Beyond the raw window the lines
+ * are the means of each minute or hour.
+ */
+void handleExport(AsyncWebServerRequest *request)
+{
+    // on the async_tcp task, the data log writer might be in the middle of a step
+    if (!dataLogWriter.lock(pdMS_TO_TICKS(EXPORT_LOCK_MS)))
+    {
+        request->send(503, "text/plain", "SD card busy");
+        return;
+    }
+    if (!dataLogWriter.mounted())
+    {
+        dataLogWriter.unlock();
+        request->send(503, "text/plain", "no SD card");
+        return;
+    }
+
+    uint32_t to = request->hasParam("to") ? request->getParam("to")->value().toInt() : time(NULL) + 1;
+    uint32_t from = request->hasParam("from") ? request->getParam("from")->value().toInt()
+                                              : to - EXPORT_DEFAULT_SECONDS;
+    // owned by the response, released when it is done or the client went away
+    std::shared_ptr<DataLogQuery> query(new DataLogQuery(dataRetention.logs(), DATA_RETENTION_LOGS, from, to),
+                                        [](DataLogQuery *query) {
+                                            dataLogWriter.lock();
+                                            delete query;
+                                            dataLogWriter.unlock();
+                                        });
+    dataLogWriter.unlock();
+
+    AsyncWebServerResponse *response = request->beginChunkedResponse(
+        "text/csv", [query](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+            // asked for again while the writer holds the card
+            if (!dataLogWriter.lock(0))
+            {
+                return RESPONSE_TRY_AGAIN;
+            }
+            size_t len = dataLogWriter.mounted() ? query->read(buffer, maxLen) : 0;
+            dataLogWriter.unlock();
+            return len;
+        });
+    response->addHeader("Content-Disposition", "attachment; filename=data.csv");
+    request->send(response);
+}
+
+void startTrace()
+{
+    // waits for the data log writer, which removes the last trace
+    if (!dataLogWriter.restartTrace())
+    {
+        Serial.println("no SD card for the trace");
+        return;
+    }
+
+    trace_start(millis(), time(NULL));
+    trace_connectivity(millis(), state.wifi_status, state.is_mqtt_connected);
+    Serial.println("trace started");
+}
+
+void stopTrace()
+{
+    if (!trace_running())
+    {
+        return;
+    }
+
+    trace_stop();
+    Serial.println("trace stopped, " + String(trace_dropped()) + " events dropped");
+}
+
+// queues the recorded events for the trace file every two seconds or when the buffer fills up
+void updateTrace(struct state *oldstate, struct state *state)
+{
+    if (oldstate->wifi_status != state->wifi_status || oldstate->is_mqtt_connected != state->is_mqtt_connected)
+    {
+        trace_connectivity(millis(), state->wifi_status, state->is_mqtt_connected);
+    }
+
+    const uint8_t *data;
+    size_t len = trace_pending(&data);
+    if (len == 0 || (trace_running() && len < TRACE_BUFFER_SIZE / 2 && ((cycle + 5) % (2 * target_fps)) != 0))
+    {
+        return;
+    }
+    if (!dataLogWriter.mounted())
     {
+        Serial.println("trace stopped, the SD card was removed");
+        stopTrace();
+        trace_consumed();
         return;
     }
 
-    String dateTime = String(
-                          state->current_time.tm_year + 1900) +
-                      "-" +
-                      padTwo(String(state->current_time.tm_mon + 1)) + "-" +
-                      padTwo(String(state->current_time.tm_mday)) + "-" +
-                      padTwo(String(state->current_time.tm_hour)) + "-" +
-                      padTwo(String(state->current_time.tm_min)) + "-" +
-                      padTwo(String(state->current_time.tm_sec));
-    String dataMessage =
-        dateTime + "," +
-        String(state->co2_ppm) + "," +
-        String(state->temperature_celsius / 10.0, 2) + "," +
-        String(state->humidity_percent / 10.0, 2) + "," +
-        String(state->battery_mah) + "\r\n";
-    // Serial.println(dataMessage);
-    appendFile(SD, "/data.txt", dataMessage.c_str());
+    // written by the data log writer, full or failed stops the trace
+    if (!dataLogWriter.submitTrace(data, len))
+    {
+        Serial.println("trace write failed");
+        stopTrace();
+    }
+    trace_consumed();
 }
 
 String padTwo(String input)
@@ -2648,30 +3940,66 @@ void setDisplayPower(bool state)
         M5.Lcd.setBrightness(255);
         M5.Lcd.wakeup();
         // Enable DC-DC3, enable backlight
-        WriteByte(0x12, (ReadByte(0x12) | 2));
+        uint8_t power;
+        if (ReadByte(0x12, &power))
+        {
+            WriteByte(0x12, power | 2);
+        }
     }
     else
     {
         M5.Lcd.setBrightness(0);
         M5.Lcd.sleep();
         // Disable DC-DC3, display backlight
-        WriteByte(0x12, (ReadByte(0x12) & (~2)));
+        uint8_t power;
+        if (ReadByte(0x12, &power))
+        {
+            WriteByte(0x12, power & ~2);
+        }
+    }
+}
+
+// brightness in %, the backlight runs from DC-DC3 between 2.5 and 3.3 V
+void setBacklight(uint8_t level)
+{
+    M5.Axp.SetLcdVoltage(2500 + min((int)level, 100) * 8);
+}
+
+void updateDisplayPower(struct state *oldstate, struct state *state)
+{
+    enum backlight_state power = backlight_update(millis(), state->current_time.tm_hour, state->in_ac);
+
+    state->display_sleep = power == BACKLIGHT_ASLEEP;
+    state->backlight_level = backlight_level();
+    if (state->display_sleep != oldstate->display_sleep)
+    {
+        setDisplayPower(!state->display_sleep);
+    }
+    if (!state->display_sleep && state->backlight_level != oldstate->backlight_level)
+    {
+        setBacklight(state->backlight_level);
     }
 }
 
-uint32_t ReadByte(uint8_t Addr)
+// false if the bus failed, the register then must not be written back, it switches the supply of the ESP32 too
+bool ReadByte(uint8_t Addr, uint8_t *Data)
 {
-    Wire1.beginTransmission(0x34);
-    Wire1.write(Addr);
-    Wire1.endTransmission();
-    Wire1.requestFrom(0x34, 1);
-    return Wire1.read();
+    struct i2cTransaction transaction;
+
+    i2cPrepare(&transaction, AXP192_ADDRESS, &Addr, 1, 0, 1);
+    if (!axpBus.transfer(&transaction))
+    {
+        return false;
+    }
+    *Data = transaction.rx[0];
+    return true;
 }
 
 void WriteByte(uint8_t Addr, uint8_t Data)
 {
-    Wire1.beginTransmission(0x34);
-    Wire1.write(Addr);
-    Wire1.write(Data);
-    Wire1.endTransmission();
+    struct i2cTransaction transaction;
+    const uint8_t tx[] = {Addr, Data};
+
+    i2cPrepare(&transaction, AXP192_ADDRESS, tx, sizeof(tx), 0, 0);
+    axpBus.transfer(&transaction);
 }
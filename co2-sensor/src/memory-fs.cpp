@@ -0,0 +1,324 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "memory-fs.h"
+
+#include <FSImpl.h>
+#include <string.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+typedef std::vector<uint8_t> memoryData;
+typedef std::map<std::string, std::shared_ptr<memoryData>> memoryFiles;
+
+class MemoryFileImpl : public fs::FileImpl
+{
+public:
+    // a file, with the mode of fopen()
+    MemoryFileImpl(const std::string &path, std::shared_ptr<memoryData> data, const char *mode);
+    // the root directory, it lists the files there were when it was opened
+    explicit MemoryFileImpl(std::shared_ptr<memoryFiles> files);
+
+    size_t write(const uint8_t *buf, size_t size);
+    size_t read(uint8_t *buf, size_t size);
+    void flush();
+    bool seek(uint32_t pos, fs::SeekMode mode);
+    size_t position() const;
+    size_t size() const;
+    bool setBufferSize(size_t size);
+    void close();
+    time_t getLastWrite();
+    const char *path() const;
+    const char *name() const;
+    boolean isDirectory(void);
+    fs::FileImplPtr openNextFile(const char *mode);
+    boolean seekDir(long position);
+    String getNextFileName(void);
+    void rewindDirectory(void);
+    operator bool();
+
+private:
+    std::string filePath;
+    std::shared_ptr<memoryData> data;
+    std::shared_ptr<memoryFiles> files;
+    std::vector<std::string> entries;
+    size_t next;
+    size_t pos;
+    bool readable;
+    bool writable;
+    bool append;
+    bool isOpen;
+};
+
+class MemoryFSImpl : public fs::FSImpl
+{
+public:
+    MemoryFSImpl();
+
+    fs::FileImplPtr open(const char *path, const char *mode, const bool create);
+    bool exists(const char *path);
+    bool rename(const char *pathFrom, const char *pathTo);
+    bool remove(const char *path);
+    bool mkdir(const char *path);
+    bool rmdir(const char *path);
+
+    void clear();
+
+private:
+    std::shared_ptr<memoryFiles> files;
+};
+
+MemoryFileImpl::MemoryFileImpl(const std::string &path, std::shared_ptr<memoryData> data, const char *mode)
+    : filePath(path), data(data), next(0), pos(0), readable(mode[0] == 'r' || strchr(mode, '+') != NULL),
+      writable(mode[0] != 'r' || strchr(mode, '+') != NULL), append(mode[0] == 'a'), isOpen(true)
+{
+}
+
+MemoryFileImpl::MemoryFileImpl(std::shared_ptr<memoryFiles> files)
+    : filePath("/"), files(files), next(0), pos(0), readable(false), writable(false), append(false), isOpen(true)
+{
+    for (const auto &file : *files)
+    {
+        entries.push_back(file.first);
+    }
+}
+
+size_t MemoryFileImpl::write(const uint8_t *buf, size_t size)
+{
+    if (!isOpen || !writable || data == nullptr)
+    {
+        return 0;
+    }
+
+    if (append)
+    {
+        pos = data->size();
+    }
+    if (pos + size > data->size())
+    {
+        data->resize(pos + size);
+    }
+    memcpy(data->data() + pos, buf, size);
+    pos += size;
+    return size;
+}
+
+size_t MemoryFileImpl::read(uint8_t *buf, size_t size)
+{
+    if (!isOpen || !readable || data == nullptr || pos >= data->size())
+    {
+        return 0;
+    }
+
+    if (size > data->size() - pos)
+    {
+        size = data->size() - pos;
+    }
+    memcpy(buf, data->data() + pos, size);
+    pos += size;
+    return size;
+}
+
+void MemoryFileImpl::flush()
+{
+}
+
+bool MemoryFileImpl::seek(uint32_t position, fs::SeekMode mode)
+{
+    if (data == nullptr)
+    {
+        return false;
+    }
+
+    size_t start = mode == fs::SeekCur ? pos : mode == fs::SeekEnd ? data->size() : 0;
+    if (start + position > data->size())
+    {
+        return false;
+    }
+    pos = start + position;
+    return true;
+}
+
+size_t MemoryFileImpl::position() const
+{
+    return pos;
+}
+
+size_t MemoryFileImpl::size() const
+{
+    return data != nullptr ? data->size() : 0;
+}
+
+bool MemoryFileImpl::setBufferSize(size_t /* size */)
+{
+    return true;
+}
+
+void MemoryFileImpl::close()
+{
+    isOpen = false;
+}
+
+time_t MemoryFileImpl::getLastWrite()
+{
+    return 0;
+}
+
+const char *MemoryFileImpl::path() const
+{
+    return filePath.c_str();
+}
+
+const char *MemoryFileImpl::name() const
+{
+    const char *slash = strrchr(filePath.c_str(), '/');
+    return slash != NULL && slash[1] != '\0' ? slash + 1 : filePath.c_str();
+}
+
+boolean MemoryFileImpl::isDirectory(void)
+{
+    return files != nullptr;
+}
+
+fs::FileImplPtr MemoryFileImpl::openNextFile(const char *mode)
+{
+    while (isOpen && files != nullptr && next < entries.size())
+    {
+        // files removed since the directory was opened are left out
+        auto file = files->find(entries[next++]);
+        if (file != files->end())
+        {
+            return std::make_shared<MemoryFileImpl>(file->first, file->second, mode);
+        }
+    }
+    return nullptr;
+}
+
+boolean MemoryFileImpl::seekDir(long position)
+{
+    if (files == nullptr || position < 0 || (size_t)position > entries.size())
+    {
+        return false;
+    }
+    next = position;
+    return true;
+}
+
+String MemoryFileImpl::getNextFileName(void)
+{
+    if (!isOpen || files == nullptr || next >= entries.size())
+    {
+        return "";
+    }
+    return String(entries[next++].c_str());
+}
+
+void MemoryFileImpl::rewindDirectory(void)
+{
+    next = 0;
+}
+
+MemoryFileImpl::operator bool()
+{
+    return isOpen;
+}
+
+MemoryFSImpl::MemoryFSImpl() : files(std::make_shared<memoryFiles>())
+{
+}
+
+fs::FileImplPtr MemoryFSImpl::open(const char *path, const char *mode, const bool /* create */)
+{
+    if (strcmp(path, "/") == 0)
+    {
+        return std::make_shared<MemoryFileImpl>(files);
+    }
+    if (path[0] != '/')
+    {
+        return nullptr;
+    }
+
+    auto file = files->find(path);
+    if (mode[0] == 'w')
+    {
+        // a new buffer, files still open on the old one keep it
+        std::shared_ptr<memoryData> data = std::make_shared<memoryData>();
+        (*files)[path] = data;
+        return std::make_shared<MemoryFileImpl>(path, data, mode);
+    }
+    if (file == files->end())
+    {
+        if (mode[0] != 'a')
+        {
+            return nullptr;
+        }
+        file = files->emplace(path, std::make_shared<memoryData>()).first;
+    }
+    return std::make_shared<MemoryFileImpl>(file->first, file->second, mode);
+}
+
+bool MemoryFSImpl::exists(const char *path)
+{
+    return strcmp(path, "/") == 0 || files->count(path) > 0;
+}
+
+bool MemoryFSImpl::rename(const char *pathFrom, const char *pathTo)
+{
+    auto file = files->find(pathFrom);
+    if (file == files->end() || pathTo[0] != '/')
+    {
+        return false;
+    }
+
+    std::shared_ptr<memoryData> data = file->second;
+    files->erase(file);
+    (*files)[pathTo] = data;
+    return true;
+}
+
+bool MemoryFSImpl::remove(const char *path)
+{
+    return files->erase(path) > 0;
+}
+
+bool MemoryFSImpl::mkdir(const char * /* path */)
+{
+    return false;
+}
+
+bool MemoryFSImpl::rmdir(const char * /* path */)
+{
+    return false;
+}
+
+void MemoryFSImpl::clear()
+{
+    files->clear();
+}
+
+MemoryFS::MemoryFS() : fs::FS(std::make_shared<MemoryFSImpl>())
+{
+}
+
+void MemoryFS::clear()
+{
+    std::static_pointer_cast<MemoryFSImpl>(_impl)->clear();
+}
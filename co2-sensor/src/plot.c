@@ -0,0 +1,116 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "plot.h"
+
+#include <stddef.h>
+
+static const uint32_t periods[HISTORY_RESOLUTIONS] = { 60, 3600, 86400 };
+
+/* weighted means of the columns, off the stack of the caller */
+static float means[PLOT_COLUMNS_MAX];
+static uint32_t samples[PLOT_COLUMNS_MAX];
+
+uint8_t plot_resolution(uint32_t span)
+{
+    for (uint8_t resolution = 1; resolution < HISTORY_RESOLUTIONS; resolution++) {
+        if (span / periods[resolution - 1] <= PLOT_BUCKETS_MAX) {
+            return resolution;
+        }
+    }
+    return HISTORY_RESOLUTIONS;
+}
+
+uint16_t plot_decimate(const struct history_series *series, uint32_t start, uint32_t span,
+                       struct plot_column *columns, uint16_t len)
+{
+    uint16_t valid = 0;
+
+    if (len > PLOT_COLUMNS_MAX) {
+        len = PLOT_COLUMNS_MAX;
+    }
+    for (uint16_t i = 0; i < len; i++) {
+        columns[i].valid = false;
+        means[i] = 0;
+        samples[i] = 0;
+    }
+    if (series == NULL || len == 0 || span == 0) {
+        return 0;
+    }
+
+    /* the first bucket which can reach into the range */
+    uint16_t index = history_series_upper_bound(series, start > series->period ? start - series->period : 0);
+
+    for (; index < series->len; index++) {
+        const struct history_bucket *bucket = history_series_at(series, index);
+        uint64_t from;
+        uint64_t to;
+
+        if (bucket->start >= start + span) {
+            break;
+        }
+        if (bucket->start + series->period <= start || bucket->samples == 0) {
+            continue;
+        }
+
+        /* columns overlapping [bucket->start, bucket->start + period) */
+        from = bucket->start > start ? (uint64_t)(bucket->start - start) * len / span : 0;
+        to = ((uint64_t)(bucket->start + series->period - start) * len + span - 1) / span;
+        if (to > len) {
+            to = len;
+        }
+
+        for (uint16_t i = (uint16_t)from; i < to; i++) {
+            struct plot_column *column = &columns[i];
+
+            if (!column->valid) {
+                column->valid = true;
+                column->min = bucket->min;
+                column->max = bucket->max;
+                valid++;
+            } else {
+                column->min = bucket->min < column->min ? bucket->min : column->min;
+                column->max = bucket->max > column->max ? bucket->max : column->max;
+            }
+            samples[i] += bucket->samples;
+            means[i] += (bucket->mean - means[i]) * bucket->samples / samples[i];
+            column->mean = (int16_t)(means[i] + (means[i] < 0 ? -0.5f : 0.5f));
+        }
+    }
+
+    return valid;
+}
+
+bool plot_bounds(const struct plot_column *columns, uint16_t len, int16_t *min, int16_t *max)
+{
+    bool found = false;
+
+    for (uint16_t i = 0; i < len; i++) {
+        if (!columns[i].valid) {
+            continue;
+        }
+        if (!found || columns[i].min < *min) {
+            *min = columns[i].min;
+        }
+        if (!found || columns[i].max > *max) {
+            *max = columns[i].max;
+        }
+        found = true;
+    }
+    return found;
+}
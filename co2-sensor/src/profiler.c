@@ -0,0 +1,225 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "profiler.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* the summary is recomputed once per interval of frames */
+#define PROFILE_SUMMARY_MS 1000
+
+static const char *const section_names[PROFILE_SECTIONS + 1] = {
+    "updateTouch",
+    "updateTime",
+    "updateBattery",
+    "updateCo2",
+    "updateGraph",
+    "updateLed",
+    "updateTimeState",
+    "updateMQTT",
+    "handleWifiMqtt",
+    "updateScreenRotation",
+    "updateDisplayPower",
+    "drawScreen",
+    "syncData",
+    "writeSsd",
+    "updateTrace",
+    "other"
+};
+
+static const uint32_t bucket_limits[PROFILE_BUCKETS] = {
+    100, 200, 500, 1000, 2000, 5000, 10000, 20000, 50000, UINT32_MAX
+};
+
+static uint32_t cycles_per_us = 1;
+static struct profile_stats stats[PROFILE_SECTIONS + 1];
+static uint32_t buckets[PROFILE_SECTIONS + 1][PROFILE_BUCKETS];
+/* section times of the frame running */
+static uint32_t current_us[PROFILE_SECTIONS];
+
+/* the loop is the only writer of the ring */
+static struct profile_frame frames[PROFILE_FRAMES];
+static uint32_t frames_head;
+static uint32_t next_summary_ms;
+
+/*
+ * The summary is published to other tasks with a sequence count, odd while it
+ * is written. A reader copies it and retries if the count changed meanwhile.
+ */
+static struct profile_summary summary;
+static uint32_t summary_sequence;
+
+static void record(uint8_t section, uint32_t duration_us)
+{
+    struct profile_stats *s = &stats[section];
+    uint8_t bucket = 0;
+
+    s->count++;
+    s->last_us = duration_us;
+    s->total_us += duration_us;
+    if (duration_us > s->max_us) {
+        s->max_us = duration_us;
+    }
+
+    while (duration_us > bucket_limits[bucket]) {
+        bucket++;
+    }
+    buckets[section][bucket]++;
+}
+
+static int compare_us(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static void summarize(void)
+{
+    static uint32_t durations[PROFILE_FRAMES];
+    struct profile_summary next;
+    uint16_t len = frames_head < PROFILE_FRAMES ? frames_head : PROFILE_FRAMES;
+    uint32_t first = frames_head - len;
+    uint32_t span_ms;
+
+    memset(&next, 0, sizeof(next));
+    next.frames = len;
+    for (uint16_t i = 0; i < len; i++) {
+        const struct profile_frame *frame = &frames[(first + i) % PROFILE_FRAMES];
+
+        durations[i] = frame->duration_us;
+        if (i == 0 || frame->duration_us > next.slowest.duration_us) {
+            next.slowest = *frame;
+        }
+    }
+
+    if (len >= 2) {
+        span_ms = frames[(frames_head - 1) % PROFILE_FRAMES].start_ms - frames[first % PROFILE_FRAMES].start_ms;
+        next.fps = span_ms > 0 ? (len - 1) * 1000.0f / span_ms : 0;
+
+        qsort(durations, len, sizeof(durations[0]), compare_us);
+        next.p50_us = durations[(len - 1) / 2];
+        next.p99_us = durations[(len - 1) * 99 / 100];
+    }
+
+    __atomic_add_fetch(&summary_sequence, 1, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    summary = next;
+    __atomic_add_fetch(&summary_sequence, 1, __ATOMIC_RELEASE);
+}
+
+void profiler_reset(uint32_t cpu_cycles_per_us)
+{
+    cycles_per_us = cpu_cycles_per_us > 0 ? cpu_cycles_per_us : 1;
+    memset(stats, 0, sizeof(stats));
+    memset(buckets, 0, sizeof(buckets));
+    memset(current_us, 0, sizeof(current_us));
+    frames_head = 0;
+    next_summary_ms = 0;
+    summarize();
+}
+
+void profiler_record(enum profile_section section, uint32_t cycles)
+{
+    uint32_t duration_us = cycles / cycles_per_us;
+
+    if (section >= PROFILE_SECTIONS) {
+        return;
+    }
+
+    record(section, duration_us);
+    current_us[section] += duration_us;
+}
+
+void profiler_frame(uint32_t start_ms, uint32_t cycles)
+{
+    struct profile_frame *frame = &frames[frames_head % PROFILE_FRAMES];
+    uint32_t timed_us = 0;
+
+    frame->start_ms = start_ms;
+    frame->duration_us = cycles / cycles_per_us;
+    frame->worst = PROFILE_SECTIONS;
+    frame->worst_us = 0;
+    for (uint8_t i = 0; i < PROFILE_SECTIONS; i++) {
+        timed_us += current_us[i];
+        if (current_us[i] > frame->worst_us) {
+            frame->worst = i;
+            frame->worst_us = current_us[i];
+        }
+    }
+
+    /* the frame beyond the timed sections, the state file and the rarely busy handlers */
+    timed_us = frame->duration_us > timed_us ? frame->duration_us - timed_us : 0;
+    record(PROFILE_SECTIONS, timed_us);
+    if (timed_us > frame->worst_us) {
+        frame->worst = PROFILE_SECTIONS;
+        frame->worst_us = timed_us;
+    }
+
+    memset(current_us, 0, sizeof(current_us));
+    frames_head++;
+
+    if ((int32_t)(start_ms - next_summary_ms) >= 0) {
+        next_summary_ms = start_ms + PROFILE_SUMMARY_MS;
+        summarize();
+    }
+}
+
+const char *profiler_section_name(uint8_t section)
+{
+    return section <= PROFILE_SECTIONS ? section_names[section] : "";
+}
+
+uint32_t profiler_bucket_limit(uint8_t bucket)
+{
+    return bucket < PROFILE_BUCKETS ? bucket_limits[bucket] : UINT32_MAX;
+}
+
+uint32_t profiler_bucket_count(uint8_t section, uint8_t bucket)
+{
+    return section <= PROFILE_SECTIONS && bucket < PROFILE_BUCKETS ? buckets[section][bucket] : 0;
+}
+
+const struct profile_stats *profiler_stats(uint8_t section)
+{
+    return section <= PROFILE_SECTIONS ? &stats[section] : NULL;
+}
+
+bool profiler_last_frame(struct profile_frame *frame)
+{
+    if (frames_head == 0) {
+        return false;
+    }
+
+    *frame = frames[(frames_head - 1) % PROFILE_FRAMES];
+    return true;
+}
+
+bool profiler_summary(struct profile_summary *copy)
+{
+    uint32_t sequence;
+
+    do {
+        sequence = __atomic_load_n(&summary_sequence, __ATOMIC_ACQUIRE);
+        *copy = summary;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((sequence & 1) != 0 || __atomic_load_n(&summary_sequence, __ATOMIC_RELAXED) != sequence);
+
+    return copy->frames >= 2;
+}
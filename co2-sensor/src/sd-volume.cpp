@@ -0,0 +1,43 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sd-volume.h"
+
+#include <M5Core2.h>
+
+bool SdVolume::mount()
+{
+    if (SD.cardType() != CARD_NONE)
+    {
+        return true;
+    }
+    if (!SD.begin(TFCARD_CS_PIN, SPI, 40000000))
+    {
+        return false;
+    }
+    if (SD.cardType() == CARD_NONE)
+    {
+        SD.end();
+        return false;
+    }
+    return true;
+}
+
+void SdVolume::unmount()
+{
+    SD.end();
+}
@@ -0,0 +1,722 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sensor-drivers.h"
+#include "sensorhub-mib.h"
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <string.h>
+
+static const uint8_t airSensorTypes[] = { CO2_PPM_MEASUREMENT, TEMPERATURE_MEASUREMENT, HUMIDITY_MEASUREMENT };
+static const uint8_t bme280Types[] = { TEMPERATURE_MEASUREMENT, HUMIDITY_MEASUREMENT, PRESSURE_MEASUREMENT };
+
+static void addReading(struct sensorReadings *readings, uint8_t type, int32_t value)
+{
+    if (readings->len < SENSOR_HUB_READINGS_MAX)
+    {
+        readings->reading[readings->len].type = type;
+        readings->reading[readings->len].value = value;
+        readings->len++;
+    }
+}
+
+// --- Sensirion -----------------------------------------------------------
+
+// CRC-8, polynomial 0x31, init 0xff
+static uint8_t sensirionCrc(const uint8_t *data, uint8_t len)
+{
+    uint8_t crc = 0xff;
+
+    for (uint8_t i = 0; i < len; i++)
+    {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++)
+        {
+            crc = crc & 0x80 ? (crc << 1) ^ 0x31 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+SensirionDriver::SensirionDriver(I2cBus &bus, const struct sensirionProtocol *protocol)
+    : bus(bus), protocol(protocol), state(SENSIRION_IDLE), readyAtUs(0), keptLen(0)
+{
+    memset(commands, 0, sizeof(commands));
+    memset(&transaction, 0, sizeof(transaction));
+}
+
+void SensirionDriver::prepare(struct i2cTransaction *transaction, uint16_t command, uint16_t delayMs, uint8_t rxWords)
+{
+    const uint8_t tx[] = { (uint8_t)(command >> 8), (uint8_t)command };
+
+    i2cPrepare(transaction, protocol->address, tx, sizeof(tx), delayMs, 3 * rxWords);
+}
+
+void SensirionDriver::prepareArgument(struct i2cTransaction *transaction, uint16_t command, uint16_t argument, uint16_t delayMs)
+{
+    uint8_t tx[] = { (uint8_t)(command >> 8), (uint8_t)command, (uint8_t)(argument >> 8), (uint8_t)argument, 0 };
+
+    tx[4] = sensirionCrc(&tx[2], 2);
+    i2cPrepare(transaction, protocol->address, tx, sizeof(tx), delayMs, 0);
+}
+
+bool SensirionDriver::words(const struct i2cTransaction *transaction, uint16_t *words, uint8_t len)
+{
+    if (transaction->status != I2C_DONE || transaction->rxLen < 3 * len)
+    {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < len; i++)
+    {
+        const uint8_t *word = &transaction->rx[3 * i];
+
+        if (sensirionCrc(word, 2) != word[2])
+        {
+            return false;
+        }
+        words[i] = word[0] << 8 | word[1];
+    }
+    return true;
+}
+
+bool SensirionDriver::commandsDone() const
+{
+    for (uint8_t i = 0; i < SENSIRION_COMMANDS_MAX; i++)
+    {
+        if (commands[i].status == I2C_QUEUED)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SensirionDriver::submitCommands(uint8_t len)
+{
+    for (uint8_t i = 0; i < len; i++)
+    {
+        if (!bus.submit(&commands[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void SensirionDriver::submitSetting(uint16_t command, uint16_t argument)
+{
+    if (keptLen == 0 && commandsDone())
+    {
+        submitCommands(prepareSetting(command, argument));
+        return;
+    }
+
+    // a later value of a kept setting replaces it, at its place in the order
+    uint8_t i = 0;
+    while (i < keptLen && kept[i].command != command)
+    {
+        i++;
+    }
+    if (i == SENSIRION_SETTINGS_MAX)
+    {
+        Serial.printf("%s busy, setting dropped.\n", name());
+        return;
+    }
+    kept[i].command = command;
+    kept[i].argument = argument;
+    if (i == keptLen)
+    {
+        keptLen++;
+    }
+}
+
+void SensirionDriver::submitKept()
+{
+    if (keptLen == 0 || !commandsDone())
+    {
+        return;
+    }
+
+    submitCommands(prepareSetting(kept[0].command, kept[0].argument));
+    keptLen--;
+    memmove(&kept[0], &kept[1], keptLen * sizeof(kept[0]));
+}
+
+bool SensirionDriver::pending()
+{
+    return state != SENSIRION_IDLE && transaction.status != I2C_QUEUED;
+}
+
+/*
+ * Sensors measure continuously: poll the data ready status, unless an
+ * interrupt signalled it, then read the measurement. The command execution
+ * times elapse on the bus while the frame goes on.
+ */
+uint32_t SensirionDriver::step(struct sensorReadings *readings)
+{
+    uint16_t data[I2C_RX_MAX / 3];
+
+    submitKept();
+    if (state != SENSIRION_IDLE && transaction.status == I2C_QUEUED)
+    {
+        return SENSOR_READY_POLL_MS;
+    }
+
+    switch (state)
+    {
+    case SENSIRION_IDLE:
+        if (interrupted(&readyAtUs))
+        {
+            prepare(&transaction, protocol->readMeasurement, protocol->readDelayMs, protocol->measurementWords);
+            state = SENSIRION_READING;
+        }
+        else
+        {
+            prepare(&transaction, protocol->dataReady, protocol->readDelayMs, 1);
+            state = SENSIRION_POLLING;
+        }
+        break;
+
+    case SENSIRION_POLLING:
+        if (!words(&transaction, data, 1))
+        {
+            state = SENSIRION_IDLE;
+            return SENSOR_RETRY_MS;
+        }
+
+        if ((data[0] & 0x07ff) == 0)
+        {
+            state = SENSIRION_IDLE;
+            return nextStepMs(false);
+        }
+
+        // the data was ready at the latest when the poll saw it
+        readyAtUs = transaction.doneUs;
+        prepare(&transaction, protocol->readMeasurement, protocol->readDelayMs, protocol->measurementWords);
+        state = SENSIRION_READING;
+        break;
+
+    case SENSIRION_READING:
+        state = SENSIRION_IDLE;
+        if (!words(&transaction, data, protocol->measurementWords))
+        {
+            return SENSOR_RETRY_MS;
+        }
+
+        readings->readyUs = readyAtUs;
+        readings->timestampUs = transaction.doneUs;
+        convert(data, readings);
+        return nextStepMs(true);
+    }
+
+    if (!bus.submit(&transaction))
+    {
+        state = SENSIRION_IDLE;
+        return SENSOR_RETRY_MS;
+    }
+    return SENSOR_TRANSACTION_TIMEOUT_MS;
+}
+
+// --- SCD30 ---------------------------------------------------------------
+
+#define SCD30_CONTINUOUS_MEASUREMENT 0x0010
+#define SCD30_MEASUREMENT_INTERVAL 0x4600
+#define SCD30_DATA_READY 0x0202
+#define SCD30_READ_MEASUREMENT 0x0300
+#define SCD30_AUTO_CALIBRATION 0x5306
+#define SCD30_FORCED_CALIBRATION 0x5204
+#define SCD30_TEMPERATURE_OFFSET 0x5403
+#define SCD30_ALTITUDE 0x5102
+#define SCD30_FIRMWARE_VERSION 0xd100
+// minimum time between a read command and its response
+#define SCD30_READ_DELAY_MS 3
+
+static const struct sensirionProtocol scd30Protocol = {
+    0x61, SCD30_DATA_READY, SCD30_READ_MEASUREMENT, SCD30_READ_DELAY_MS, 6
+};
+
+Scd30Driver::Scd30Driver(I2cBus &bus)
+    : SensirionDriver(bus, &scd30Protocol), autoCalibration(false), temperatureOffset(0), altitude(0),
+      readyPin(-1), ready(false), readyUs(0)
+{
+}
+
+void Scd30Driver::configure(bool autoCalibration, float temperatureOffset, uint16_t altitude, int8_t readyPin)
+{
+    this->autoCalibration = autoCalibration;
+    this->temperatureOffset = temperatureOffset;
+    this->altitude = altitude;
+    this->readyPin = readyPin;
+}
+
+void IRAM_ATTR Scd30Driver::onReady(void *arg)
+{
+    Scd30Driver *driver = (Scd30Driver *)arg;
+
+    driver->readyUs = esp_timer_get_time();
+    driver->ready = true;
+}
+
+const char *Scd30Driver::name() const
+{
+    return "SCD30";
+}
+
+uint8_t Scd30Driver::measurementTypes(const uint8_t **types) const
+{
+    *types = airSensorTypes;
+    return sizeof(airSensorTypes);
+}
+
+bool Scd30Driver::begin()
+{
+    uint16_t version;
+
+    prepare(&commands[0], SCD30_FIRMWARE_VERSION, SCD30_READ_DELAY_MS, 1);
+    if (!bus.transfer(&commands[0]) || !words(&commands[0], &version, 1))
+    {
+        return false;
+    }
+
+    // no ambient pressure compensation, the altitude is set instead
+    const uint16_t settings[][2] = {
+        { SCD30_CONTINUOUS_MEASUREMENT, 0 },
+        { SCD30_MEASUREMENT_INTERVAL, SCD30_INTERVAL_MS / 1000 },
+        { SCD30_AUTO_CALIBRATION, autoCalibration },
+        { SCD30_ALTITUDE, altitude },
+    };
+    for (uint8_t i = 0; i < sizeof(settings) / sizeof(settings[0]); i++)
+    {
+        prepareArgument(&commands[0], settings[i][0], settings[i][1], 0);
+        if (!bus.transfer(&commands[0]))
+        {
+            return false;
+        }
+    }
+
+    setTemperatureOffset(temperatureOffset);
+
+    if (readyPin >= 0)
+    {
+        pinMode(readyPin, INPUT);
+        attachInterruptArg(readyPin, onReady, this, RISING);
+    }
+    return true;
+}
+
+bool Scd30Driver::pending()
+{
+    return ready || SensirionDriver::pending();
+}
+
+bool Scd30Driver::interrupted(int64_t *readyAtUs)
+{
+    if (!ready)
+    {
+        return false;
+    }
+
+    *readyAtUs = readyUs;
+    ready = false;
+    return true;
+}
+
+static float scd30Float(const uint16_t *words)
+{
+    uint32_t bits = (uint32_t)words[0] << 16 | words[1];
+    float value;
+
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void Scd30Driver::convert(const uint16_t *words, struct sensorReadings *readings)
+{
+    addReading(readings, CO2_PPM_MEASUREMENT, scd30Float(&words[0]));
+    addReading(readings, TEMPERATURE_MEASUREMENT, scd30Float(&words[2]) * 10);
+    addReading(readings, HUMIDITY_MEASUREMENT, scd30Float(&words[4]) * 10);
+}
+
+// with the interrupt the poll only catches a missed edge, RDY stays high until the read
+uint32_t Scd30Driver::nextStepMs(bool sampled)
+{
+    if (readyPin >= 0)
+    {
+        return 2 * SCD30_INTERVAL_MS;
+    }
+    return sampled ? SCD30_INTERVAL_MS - SENSOR_READY_EARLY_MS : SENSOR_READY_POLL_MS;
+}
+
+uint8_t Scd30Driver::prepareSetting(uint16_t command, uint16_t argument)
+{
+    prepareArgument(&commands[0], command, argument, 0);
+    return 1;
+}
+
+void Scd30Driver::setAutoCalibration(bool enabled)
+{
+    submitSetting(SCD30_AUTO_CALIBRATION, enabled);
+}
+
+// the SCD30 only takes positive offsets
+void Scd30Driver::setTemperatureOffset(float offset)
+{
+    if (offset >= 0)
+    {
+        submitSetting(SCD30_TEMPERATURE_OFFSET, offset * 100);
+    }
+}
+
+void Scd30Driver::forceCalibration(uint16_t ppm)
+{
+    submitSetting(SCD30_FORCED_CALIBRATION, ppm);
+}
+
+// --- SCD4x ---------------------------------------------------------------
+
+#define SCD4X_START_PERIODIC_MEASUREMENT 0x21b1
+#define SCD4X_STOP_PERIODIC_MEASUREMENT 0x3f86
+#define SCD4X_DATA_READY 0xe4b8
+#define SCD4X_READ_MEASUREMENT 0xec05
+#define SCD4X_AUTO_CALIBRATION 0x2416
+#define SCD4X_FORCED_CALIBRATION 0x362f
+#define SCD4X_TEMPERATURE_OFFSET 0x241d
+#define SCD4X_ALTITUDE 0x2427
+#define SCD4X_SERIAL_NUMBER 0x3682
+// command execution times
+#define SCD4X_COMMAND_DELAY_MS 1
+#define SCD4X_STOP_DELAY_MS 500
+#define SCD4X_FORCED_CALIBRATION_DELAY_MS 400
+
+static const struct sensirionProtocol scd4xProtocol = {
+    0x62, SCD4X_DATA_READY, SCD4X_READ_MEASUREMENT, SCD4X_COMMAND_DELAY_MS, 3
+};
+
+Scd4xDriver::Scd4xDriver(I2cBus &bus)
+    : SensirionDriver(bus, &scd4xProtocol), autoCalibration(false), temperatureOffset(0), altitude(0)
+{
+}
+
+void Scd4xDriver::configure(bool autoCalibration, float temperatureOffset, uint16_t altitude)
+{
+    this->autoCalibration = autoCalibration;
+    this->temperatureOffset = temperatureOffset;
+    this->altitude = altitude;
+}
+
+const char *Scd4xDriver::name() const
+{
+    return "SCD4x";
+}
+
+uint8_t Scd4xDriver::measurementTypes(const uint8_t **types) const
+{
+    *types = airSensorTypes;
+    return sizeof(airSensorTypes);
+}
+
+// offset in °C as the sensor word, 175 °C full scale
+static uint16_t scd4xTemperatureOffset(float offset)
+{
+    return offset <= 0 ? 0 : offset >= 175 ? 0xffff : offset * 65536 / 175;
+}
+
+bool Scd4xDriver::begin()
+{
+    uint16_t serial[3];
+
+    // the sensor may still measure from before a reset
+    prepare(&commands[0], SCD4X_STOP_PERIODIC_MEASUREMENT, SCD4X_STOP_DELAY_MS, 0);
+    if (!bus.transfer(&commands[0]))
+    {
+        return false;
+    }
+
+    prepare(&commands[0], SCD4X_SERIAL_NUMBER, SCD4X_COMMAND_DELAY_MS, 3);
+    if (!bus.transfer(&commands[0]) || !words(&commands[0], serial, 3))
+    {
+        return false;
+    }
+
+    const uint16_t settings[][2] = {
+        { SCD4X_AUTO_CALIBRATION, autoCalibration },
+        { SCD4X_TEMPERATURE_OFFSET, scd4xTemperatureOffset(temperatureOffset) },
+        { SCD4X_ALTITUDE, altitude },
+    };
+    for (uint8_t i = 0; i < sizeof(settings) / sizeof(settings[0]); i++)
+    {
+        prepareArgument(&commands[0], settings[i][0], settings[i][1], SCD4X_COMMAND_DELAY_MS);
+        if (!bus.transfer(&commands[0]))
+        {
+            return false;
+        }
+    }
+
+    prepare(&commands[0], SCD4X_START_PERIODIC_MEASUREMENT, 0, 0);
+    return bus.transfer(&commands[0]);
+}
+
+void Scd4xDriver::convert(const uint16_t *words, struct sensorReadings *readings)
+{
+    // T = -45 + 175 * word / 2^16, RH = 100 * word / 2^16, both in 1/10
+    addReading(readings, CO2_PPM_MEASUREMENT, words[0]);
+    addReading(readings, TEMPERATURE_MEASUREMENT, (int32_t)((1750 * (uint32_t)words[1]) >> 16) - 450);
+    addReading(readings, HUMIDITY_MEASUREMENT, (1000 * (uint32_t)words[2]) >> 16);
+}
+
+uint32_t Scd4xDriver::nextStepMs(bool sampled)
+{
+    return sampled ? SCD4X_INTERVAL_MS - SENSOR_READY_EARLY_MS : SENSOR_READY_POLL_MS;
+}
+
+uint8_t Scd4xDriver::prepareSetting(uint16_t command, uint16_t argument)
+{
+    // the forced recalibration answers the correction, 0xffff if it failed
+    bool forced = command == SCD4X_FORCED_CALIBRATION;
+
+    prepare(&commands[0], SCD4X_STOP_PERIODIC_MEASUREMENT, SCD4X_STOP_DELAY_MS, 0);
+    prepareArgument(&commands[1], command, argument,
+                    forced ? SCD4X_FORCED_CALIBRATION_DELAY_MS : SCD4X_COMMAND_DELAY_MS);
+    commands[1].rxLen = forced ? 3 : 0;
+    prepare(&commands[2], SCD4X_START_PERIODIC_MEASUREMENT, 0, 0);
+    return 3;
+}
+
+void Scd4xDriver::setAutoCalibration(bool enabled)
+{
+    submitSetting(SCD4X_AUTO_CALIBRATION, enabled);
+}
+
+void Scd4xDriver::setTemperatureOffset(float offset)
+{
+    submitSetting(SCD4X_TEMPERATURE_OFFSET, scd4xTemperatureOffset(offset));
+}
+
+void Scd4xDriver::forceCalibration(uint16_t ppm)
+{
+    submitSetting(SCD4X_FORCED_CALIBRATION, ppm);
+}
+
+// --- BME280 --------------------------------------------------------------
+
+#define BME280_CHIP_ID 0x60
+#define BME280_REG_CALIB00 0x88
+#define BME280_REG_ID 0xd0
+#define BME280_REG_CALIB26 0xe1
+#define BME280_REG_CTRL_HUM 0xf2
+#define BME280_REG_STATUS 0xf3
+#define BME280_REG_CTRL_MEAS 0xf4
+#define BME280_REG_DATA 0xf7
+#define BME280_STATUS_MEASURING 0x08
+// osrs_t = osrs_p = 1x, forced mode
+#define BME280_CTRL_MEAS_FORCED 0x25
+// osrs_h = 1x
+#define BME280_CTRL_HUM_1X 0x01
+// maximum conversion time with 1x oversampling of all three values
+#define BME280_CONVERSION_MS 10
+
+Bme280Driver::Bme280Driver(I2cBus &bus, uint8_t address)
+    : bus(bus), address(address), state(BME280_IDLE)
+{
+    memset(&transaction, 0, sizeof(transaction));
+}
+
+const char *Bme280Driver::name() const
+{
+    return "BME280";
+}
+
+uint8_t Bme280Driver::measurementTypes(const uint8_t **types) const
+{
+    *types = bme280Types;
+    return sizeof(bme280Types);
+}
+
+bool Bme280Driver::readRegisters(uint8_t reg, uint8_t *data, uint8_t len)
+{
+    i2cPrepare(&transaction, address, &reg, 1, 0, len);
+    if (!bus.transfer(&transaction))
+    {
+        return false;
+    }
+
+    memcpy(data, transaction.rx, len);
+    return true;
+}
+
+bool Bme280Driver::begin()
+{
+    uint8_t id;
+    uint8_t c[26];
+    uint8_t h[7];
+
+    if (!readRegisters(BME280_REG_ID, &id, 1) || id != BME280_CHIP_ID)
+    {
+        return false;
+    }
+
+    if (!readRegisters(BME280_REG_CALIB00, c, sizeof(c)) || !readRegisters(BME280_REG_CALIB26, h, sizeof(h)))
+    {
+        return false;
+    }
+
+    calibration.t1 = c[0] | c[1] << 8;
+    calibration.t2 = c[2] | c[3] << 8;
+    calibration.t3 = c[4] | c[5] << 8;
+    calibration.p1 = c[6] | c[7] << 8;
+    calibration.p2 = c[8] | c[9] << 8;
+    calibration.p3 = c[10] | c[11] << 8;
+    calibration.p4 = c[12] | c[13] << 8;
+    calibration.p5 = c[14] | c[15] << 8;
+    calibration.p6 = c[16] | c[17] << 8;
+    calibration.p7 = c[18] | c[19] << 8;
+    calibration.p8 = c[20] | c[21] << 8;
+    calibration.p9 = c[22] | c[23] << 8;
+    calibration.h1 = c[25];
+    calibration.h2 = h[0] | h[1] << 8;
+    calibration.h3 = h[2];
+    calibration.h4 = (int16_t)((int8_t)h[3] << 4 | (h[4] & 0x0f));
+    calibration.h5 = (int16_t)((int8_t)h[5] << 4 | h[4] >> 4);
+    calibration.h6 = (int8_t)h[6];
+
+    state = BME280_IDLE;
+    return true;
+}
+
+bool Bme280Driver::pending()
+{
+    return (state == BME280_TRIGGERING || state == BME280_READING) && transaction.status != I2C_QUEUED;
+}
+
+/*
+ * Forced mode: the first step starts a conversion, the step
+ * BME280_CONVERSION_MS after it completed reads the status register together
+ * with the result and retries if the conversion is not done yet.
+ */
+uint32_t Bme280Driver::step(struct sensorReadings *readings)
+{
+    if ((state == BME280_TRIGGERING || state == BME280_READING) && transaction.status == I2C_QUEUED)
+    {
+        return SENSOR_READY_POLL_MS;
+    }
+
+    switch (state)
+    {
+    case BME280_IDLE:
+    {
+        // ctrl_hum only takes effect with the following write of ctrl_meas, register / value pairs in one write
+        const uint8_t trigger[] = { BME280_REG_CTRL_HUM, BME280_CTRL_HUM_1X, BME280_REG_CTRL_MEAS, BME280_CTRL_MEAS_FORCED };
+
+        i2cPrepare(&transaction, address, trigger, sizeof(trigger), 0, 0);
+        state = BME280_TRIGGERING;
+        break;
+    }
+
+    case BME280_TRIGGERING:
+        if (transaction.status != I2C_DONE)
+        {
+            state = BME280_IDLE;
+            return SENSOR_RETRY_MS;
+        }
+
+        state = BME280_CONVERTING;
+        return BME280_CONVERSION_MS;
+
+    case BME280_CONVERTING:
+    {
+        // status up to the end of the humidity data in one transaction
+        const uint8_t reg = BME280_REG_STATUS;
+
+        i2cPrepare(&transaction, address, &reg, 1, 0, BME280_REG_DATA - BME280_REG_STATUS + 8);
+        state = BME280_READING;
+        break;
+    }
+
+    case BME280_READING:
+        if (transaction.status != I2C_DONE)
+        {
+            state = BME280_IDLE;
+            return SENSOR_RETRY_MS;
+        }
+
+        if (transaction.rx[0] & BME280_STATUS_MEASURING)
+        {
+            state = BME280_CONVERTING;
+            return 1;
+        }
+
+        state = BME280_IDLE;
+        readings->readyUs = transaction.doneUs;
+        readings->timestampUs = transaction.doneUs;
+        compensate(&transaction.rx[BME280_REG_DATA - BME280_REG_STATUS], readings);
+        return BME280_INTERVAL_MS - BME280_CONVERSION_MS;
+    }
+
+    if (!bus.submit(&transaction))
+    {
+        state = BME280_IDLE;
+        return SENSOR_RETRY_MS;
+    }
+    return SENSOR_TRANSACTION_TIMEOUT_MS;
+}
+
+// BME280 datasheet section 4.2.3, integer versions
+void Bme280Driver::compensate(const uint8_t *data, struct sensorReadings *readings)
+{
+    int32_t adcP = (int32_t)data[0] << 12 | data[1] << 4 | data[2] >> 4;
+    int32_t adcT = (int32_t)data[3] << 12 | data[4] << 4 | data[5] >> 4;
+    int32_t adcH = (int32_t)data[6] << 8 | data[7];
+    const struct calibration *cal = &calibration;
+
+    int32_t var1 = ((((adcT >> 3) - ((int32_t)cal->t1 << 1))) * cal->t2) >> 11;
+    int32_t var2 = (((((adcT >> 4) - cal->t1) * ((adcT >> 4) - cal->t1)) >> 12) * cal->t3) >> 14;
+    int32_t tFine = var1 + var2;
+    // 1/100 °C
+    int32_t temperature = (tFine * 5 + 128) >> 8;
+
+    int64_t p1 = (int64_t)tFine - 128000;
+    int64_t p2 = p1 * p1 * cal->p6;
+    p2 = p2 + ((p1 * cal->p5) << 17);
+    p2 = p2 + ((int64_t)cal->p4 << 35);
+    p1 = ((p1 * p1 * cal->p3) >> 8) + ((p1 * cal->p2) << 12);
+    p1 = ((((int64_t)1) << 47) + p1) * cal->p1 >> 33;
+    int64_t pressure = 0;
+    if (p1 != 0)
+    {
+        // Q24.8 Pa
+        pressure = 1048576 - adcP;
+        pressure = (((pressure << 31) - p2) * 3125) / p1;
+        p1 = ((int64_t)cal->p9 * (pressure >> 13) * (pressure >> 13)) >> 25;
+        p2 = ((int64_t)cal->p8 * pressure) >> 19;
+        pressure = ((pressure + p1 + p2) >> 8) + ((int64_t)cal->p7 << 4);
+    }
+
+    int32_t h = tFine - 76800;
+    h = (((((adcH << 14) - ((int32_t)cal->h4 << 20) - ((int32_t)cal->h5 * h)) + 16384) >> 15) *
+         (((((((h * cal->h6) >> 10) * (((h * (int32_t)cal->h3) >> 11) + 32768)) >> 10) + 2097152) *
+               cal->h2 + 8192) >> 14));
+    h = h - (((((h >> 15) * (h >> 15)) >> 7) * (int32_t)cal->h1) >> 4);
+    h = h < 0 ? 0 : h > 419430400 ? 419430400 : h;
+    // Q22.10 %
+    int32_t humidity = h >> 12;
+
+    addReading(readings, TEMPERATURE_MEASUREMENT, temperature / 10);
+    addReading(readings, HUMIDITY_MEASUREMENT, humidity * 10 / 1024);
+    addReading(readings, PRESSURE_MEASUREMENT, (int32_t)(pressure / 256));
+}
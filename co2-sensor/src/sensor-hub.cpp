@@ -0,0 +1,164 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sensor-hub.h"
+
+#include <string.h>
+
+SensorHub::SensorHub(sensorReadingsCallback callback)
+    : callback(callback), entriesLen(0)
+{
+}
+
+bool SensorHub::add(uint8_t id, SensorDriver *driver)
+{
+    if (entriesLen >= SENSOR_HUB_SENSORS_MAX || entryById(id) != NULL)
+    {
+        return false;
+    }
+
+    if (!driver->begin())
+    {
+        return false;
+    }
+
+    struct entry *entry = &entries[entriesLen++];
+    memset(entry, 0, sizeof(*entry));
+    entry->id = id;
+    entry->driver = driver;
+    return true;
+}
+
+void SensorHub::run(uint32_t nowMs)
+{
+    for (uint8_t steps = 0; steps < SENSOR_HUB_STEPS_PER_RUN; steps++)
+    {
+        struct entry *due = NULL;
+
+        int32_t dueOverdue = 0;
+
+        // signed difference, survives the millis() wrap around
+        for (uint8_t i = 0; i < entriesLen; i++)
+        {
+            int32_t overdue = entries[i].driver->pending() ? INT32_MAX : (int32_t)(nowMs - entries[i].dueMs);
+            if (overdue >= 0 && (due == NULL || overdue > dueOverdue))
+            {
+                due = &entries[i];
+                dueOverdue = overdue;
+            }
+        }
+
+        if (due == NULL)
+        {
+            return;
+        }
+
+        struct sensorReadings readings;
+        memset(&readings, 0, sizeof(readings));
+        due->dueMs = nowMs + due->driver->step(&readings);
+
+        if (readings.len > 0)
+        {
+            __atomic_add_fetch(&due->sequence, 1, __ATOMIC_RELEASE);
+            __atomic_thread_fence(__ATOMIC_RELEASE);
+            memcpy(&due->latest, &readings, sizeof(readings));
+            __atomic_add_fetch(&due->sequence, 1, __ATOMIC_RELEASE);
+            if (callback != NULL)
+            {
+                callback(due->id, &readings, nowMs);
+            }
+        }
+    }
+}
+
+uint8_t SensorHub::count() const
+{
+    return entriesLen;
+}
+
+SensorDriver *SensorHub::get(uint8_t id) const
+{
+    const struct entry *entry = entryById(id);
+    return entry != NULL ? entry->driver : NULL;
+}
+
+SensorDriver *SensorHub::find(uint8_t type) const
+{
+    for (uint8_t i = 0; i < entriesLen; i++)
+    {
+        const uint8_t *types;
+        uint8_t typesLen = entries[i].driver->measurementTypes(&types);
+
+        for (uint8_t j = 0; j < typesLen; j++)
+        {
+            if (types[j] == type)
+            {
+                return entries[i].driver;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+bool SensorHub::value(uint8_t id, uint8_t type, int32_t *value) const
+{
+    const struct entry *entry = entryById(id);
+    struct sensorReadings latest;
+    uint32_t sequence;
+
+    if (entry == NULL)
+    {
+        return false;
+    }
+
+    do
+    {
+        sequence = __atomic_load_n(&entry->sequence, __ATOMIC_ACQUIRE);
+        memcpy(&latest, &entry->latest, sizeof(latest));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((sequence & 1) != 0 || __atomic_load_n(&entry->sequence, __ATOMIC_RELAXED) != sequence);
+
+    for (uint8_t i = 0; i < latest.len && i < SENSOR_HUB_READINGS_MAX; i++)
+    {
+        if (latest.reading[i].type == type)
+        {
+            *value = latest.reading[i].value;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+struct SensorHub::entry *SensorHub::entryById(uint8_t id)
+{
+    for (uint8_t i = 0; i < entriesLen; i++)
+    {
+        if (entries[i].id == id)
+        {
+            return &entries[i];
+        }
+    }
+
+    return NULL;
+}
+
+const struct SensorHub::entry *SensorHub::entryById(uint8_t id) const
+{
+    return const_cast<SensorHub *>(this)->entryById(id);
+}
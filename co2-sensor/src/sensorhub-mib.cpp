@@ -0,0 +1,530 @@
+/*
+ * SENSORHUB-MIB, see snmp-mib/sensorhub.mib. The lwIP node structures are
+ * built at compile time by the templates in mib-builder.h, the tree is
+ * declared at the end of this file.
+ */
+
+#include "lwip/apps/snmp_opts.h"
+#if LWIP_SNMP
+
+#include "sensorhub-mib.h"
+#include "mib-builder.h"
+#include "history.h"
+#include "health.h"
+#include "backlight.h"
+#include "snmpv3-users.h"
+#include "snmp/snmp_cache.h"
+#include "lwip/apps/snmp.h"
+#include "lwip/apps/snmp_core.h"
+#include "lwip/apps/snmp_scalar.h"
+#include "lwip/apps/snmp_table.h"
+#include "lwip/sys.h"
+
+#define SENSORS_MAX 10
+#define SENSOR_MEASUREMENT_TYPES_MAX 10
+
+/* sensors are looked up by id with get_sensor_name() / get_sensor_measurement_types() */
+
+static const struct snmp_oid_range sensor_table_oid_ranges[] = {
+    { 1, SENSORS_MAX }
+};
+
+static const struct snmp_oid_range measurement_table_oid_ranges[] = {
+    { 1, SENSORS_MAX }, { 1, SENSOR_MEASUREMENT_TYPES_MAX }
+};
+
+static const struct snmp_oid_range history_table_oid_ranges[] = {
+    { 1, HISTORY_MEASUREMENTS }, { 1, HISTORY_RESOLUTIONS }, { 1, 0xffffffff }
+};
+
+static const struct snmp_oid_range histogram_table_oid_ranges[] = {
+    { 1, HEALTH_HISTOGRAM_BUCKETS }
+};
+
+/* --- shSensorTable ----------------------------------------------------- */
+
+static snmp_err_t shsensortable_get_instance(const u32_t *column, const u32_t *row_oid, u8_t row_oid_len, struct snmp_node_instance *cell_instance)
+{
+    u8_t sensor_id;
+
+    LWIP_UNUSED_ARG(column);
+
+    /* check if incoming OID length and if values are in plausible range */
+    if (!snmp_oid_in_range(row_oid, row_oid_len, sensor_table_oid_ranges,
+        LWIP_ARRAYSIZE(sensor_table_oid_ranges))) {
+        return SNMP_ERR_NOSUCHINSTANCE;
+    }
+
+    sensor_id = row_oid[0];
+    if (get_sensor_name(sensor_id) == NULL) {
+        return SNMP_ERR_NOSUCHINSTANCE;
+    }
+
+    /* store sensor id for subsequent operations (get/test/set) */
+    cell_instance->reference.u32 = sensor_id;
+    return SNMP_ERR_NOERROR;
+}
+static snmp_err_t shsensortable_get_next_instance(const u32_t *column, struct snmp_obj_id *row_oid, struct snmp_node_instance *cell_instance)
+{
+    struct snmp_next_oid_state state;
+    u32_t result_temp[LWIP_ARRAYSIZE(sensor_table_oid_ranges)];
+    size_t sensor_id;
+
+    LWIP_UNUSED_ARG(column);
+
+    /* init struct to search next oid */
+    snmp_next_oid_init(&state, row_oid->id, row_oid->len, result_temp,
+        LWIP_ARRAYSIZE(sensor_table_oid_ranges));
+
+    /* iterate over all possible OIDs to find the next one */
+    for (sensor_id = 1; sensor_id <= SENSORS_MAX; sensor_id++) {
+        u32_t test_oid[LWIP_ARRAYSIZE(sensor_table_oid_ranges)];
+
+        if (get_sensor_name(sensor_id) == NULL) {
+            continue;
+        }
+        test_oid[0] = sensor_id;
+
+        /* check generated OID: is it a candidate for the next one? */
+        snmp_next_oid_check(&state, test_oid,
+            LWIP_ARRAYSIZE(sensor_table_oid_ranges), (void*)sensor_id);
+    }
+
+    /* did we find a next one? */
+    if (state.status == SNMP_NEXT_OID_STATUS_SUCCESS) {
+        snmp_oid_assign(row_oid, state.next_oid, state.next_oid_len);
+        /* store sensor id for subsequent operations (get/test/set) */
+        cell_instance->reference.u32 = LWIP_CONST_CAST(u32_t, state.reference);
+        return SNMP_ERR_NOERROR;
+    }
+
+    /* not found */
+    return SNMP_ERR_NOSUCHINSTANCE;
+}
+
+static const char *shsensorname(struct snmp_node_instance *cell_instance)
+{
+    return get_sensor_name(cell_instance->reference.u32);
+}
+
+/* --- shMeasurementTable ------------------------------------------------ */
+
+static snmp_err_t shmeasurementtable_get_instance(const u32_t *column, const u32_t *row_oid, u8_t row_oid_len, struct snmp_node_instance *cell_instance)
+{
+    u8_t sensor_id;
+    u8_t measurement_type;
+    const u8_t *types;
+    u8_t types_len;
+
+    LWIP_UNUSED_ARG(column);
+    LWIP_UNUSED_ARG(cell_instance);
+
+    /* check if incoming OID length and if values are in plausible range */
+    if (!snmp_oid_in_range(row_oid, row_oid_len, measurement_table_oid_ranges,
+            LWIP_ARRAYSIZE(measurement_table_oid_ranges))) {
+        return SNMP_ERR_NOSUCHINSTANCE;
+    }
+
+    sensor_id = row_oid[0];
+    measurement_type = row_oid[1];
+    types_len = get_sensor_measurement_types(sensor_id, &types);
+
+    for (u8_t j = 0; j < types_len; j++) {
+        if (types[j] == measurement_type) {
+            return SNMP_ERR_NOERROR;
+        }
+    }
+
+    return SNMP_ERR_NOSUCHINSTANCE;
+}
+
+static snmp_err_t shmeasurementtable_get_next_instance(const u32_t *column, struct snmp_obj_id *row_oid, struct snmp_node_instance *cell_instance)
+{
+    struct snmp_next_oid_state state;
+    u32_t result_temp[LWIP_ARRAYSIZE(measurement_table_oid_ranges)];
+    u8_t sensor_id;
+    u8_t j;
+
+    LWIP_UNUSED_ARG(column);
+    LWIP_UNUSED_ARG(cell_instance);
+
+    /* init struct to search next oid */
+    snmp_next_oid_init(&state, row_oid->id, row_oid->len, result_temp,
+        LWIP_ARRAYSIZE(measurement_table_oid_ranges));
+
+    /* iterate over all possible OIDs to find the next one */
+    for (sensor_id = 1; sensor_id <= SENSORS_MAX; sensor_id++) {
+        const u8_t *types;
+        u8_t types_len = get_sensor_measurement_types(sensor_id, &types);
+
+        for (j = 0; j < types_len; j++) {
+            u32_t test_oid[LWIP_ARRAYSIZE(measurement_table_oid_ranges)];
+
+            test_oid[0] = sensor_id;
+            test_oid[1] = types[j];
+
+            snmp_next_oid_check(&state, test_oid,
+                LWIP_ARRAYSIZE(measurement_table_oid_ranges), NULL);
+        }
+    }
+    /* did we find a next one? */
+    if (state.status == SNMP_NEXT_OID_STATUS_SUCCESS) {
+        snmp_oid_assign(row_oid, state.next_oid, state.next_oid_len);
+
+        return SNMP_ERR_NOERROR;
+    }
+
+    /* not found */
+    return SNMP_ERR_NOSUCHINSTANCE;
+}
+
+/* the instance oid is column entry, column, sensor id, measurement type */
+static s32_t shmeasurementtype(struct snmp_node_instance *cell_instance)
+{
+    return (s32_t)cell_instance->instance_oid.id[3];
+}
+
+static s32_t shmeasurementvalue(struct snmp_node_instance *cell_instance)
+{
+    return get_measurement(cell_instance->instance_oid.id[2], cell_instance->instance_oid.id[3]);
+}
+
+static s32_t shmeasurementrawvalue(struct snmp_node_instance *cell_instance)
+{
+    return get_measurement_raw(cell_instance->instance_oid.id[2], cell_instance->instance_oid.id[3]);
+}
+
+/* --- shHistoryTable ---------------------------------------------------- */
+
+/*
+ * The rings are written by the loop task, so every row is copied out under the
+ * history sequence count. Varbinds are processed one at a time on the tcpip
+ * thread, so one copy is enough for the columns of the current row.
+ */
+static struct history_bucket history_row;
+
+static snmp_err_t shhistorytable_get_instance(const u32_t *column, const u32_t *row_oid, u8_t row_oid_len, struct snmp_node_instance *cell_instance)
+{
+    LWIP_UNUSED_ARG(column);
+
+    if (!snmp_oid_in_range(row_oid, row_oid_len, history_table_oid_ranges,
+            LWIP_ARRAYSIZE(history_table_oid_ranges))) {
+        return SNMP_ERR_NOSUCHINSTANCE;
+    }
+
+    if (!history_find(row_oid[0], row_oid[1], row_oid[2], &history_row)) {
+        return SNMP_ERR_NOSUCHINSTANCE;
+    }
+
+    /* store bucket for subsequent operations (get/test/set) */
+    cell_instance->reference.const_ptr = &history_row;
+    return SNMP_ERR_NOERROR;
+}
+
+/*
+ * Rows are ordered by (measurement, resolution, bucket start) and every series
+ * is sorted by time, so the next row is found with a binary search instead of
+ * offering every bucket to snmp_next_oid_check().
+ */
+static snmp_err_t shhistorytable_get_next_instance(const u32_t *column, struct snmp_obj_id *row_oid, struct snmp_node_instance *cell_instance)
+{
+    u8_t measurement_type;
+    u8_t resolution;
+
+    LWIP_UNUSED_ARG(column);
+
+    for (measurement_type = 1; measurement_type <= HISTORY_MEASUREMENTS; measurement_type++) {
+        for (resolution = 1; resolution <= HISTORY_RESOLUTIONS; resolution++) {
+            u32_t prefix[2] = { measurement_type, resolution };
+            u32_t next_oid[LWIP_ARRAYSIZE(history_table_oid_ranges)];
+            u32_t start = 0;
+            s8_t cmp;
+
+            cmp = snmp_oid_compare(prefix, 2, row_oid->id, LWIP_MIN(row_oid->len, 2));
+            if (cmp < 0) {
+                continue;
+            }
+            if (cmp == 0 && row_oid->len > 2) {
+                if (row_oid->id[2] == 0xFFFFFFFFUL) {
+                    continue;
+                }
+                start = row_oid->id[2] + 1;
+            }
+
+            if (!history_next(measurement_type, resolution, start, &history_row)) {
+                continue;
+            }
+
+            next_oid[0] = measurement_type;
+            next_oid[1] = resolution;
+            next_oid[2] = history_row.start;
+
+            snmp_oid_assign(row_oid, next_oid, LWIP_ARRAYSIZE(next_oid));
+            /* store bucket for subsequent operations (get/test/set) */
+            cell_instance->reference.const_ptr = &history_row;
+            return SNMP_ERR_NOERROR;
+        }
+    }
+
+    /* not found */
+    return SNMP_ERR_NOSUCHINSTANCE;
+}
+
+static const struct history_bucket *shhistorybucket(struct snmp_node_instance *cell_instance)
+{
+    return (const struct history_bucket *)cell_instance->reference.const_ptr;
+}
+
+static s32_t shhistorymin(struct snmp_node_instance *cell_instance)
+{
+    return shhistorybucket(cell_instance)->min;
+}
+
+static s32_t shhistorymean(struct snmp_node_instance *cell_instance)
+{
+    return shhistorybucket(cell_instance)->mean;
+}
+
+static s32_t shhistorymax(struct snmp_node_instance *cell_instance)
+{
+    return shhistorybucket(cell_instance)->max;
+}
+
+static u32_t shhistorysamples(struct snmp_node_instance *cell_instance)
+{
+    return shhistorybucket(cell_instance)->samples;
+}
+
+/* --- shAgent ----------------------------------------------------------- */
+
+#if !LWIP_SNMP_V3
+/* without SNMPv3 nothing is authenticated or encrypted, the counters stay 0 */
+#define SNMPV3_TIMING_AUTH 0
+#define SNMPV3_TIMING_PRIV 1
+#endif /* !LWIP_SNMP_V3 */
+
+template <u8_t Kind>
+static u32_t shv3count(void)
+{
+#if LWIP_SNMP_V3
+    return snmpv3_timing_get(Kind)->count;
+#else
+    return 0;
+#endif /* LWIP_SNMP_V3 */
+}
+
+template <u8_t Kind>
+static u32_t shv3time(void)
+{
+#if LWIP_SNMP_V3
+    return snmpv3_timing_get(Kind)->total_us;
+#else
+    return 0;
+#endif /* LWIP_SNMP_V3 */
+}
+
+template <u8_t Kind>
+static u32_t shv3timemax(void)
+{
+#if LWIP_SNMP_V3
+    return snmpv3_timing_get(Kind)->max_us;
+#else
+    return 0;
+#endif /* LWIP_SNMP_V3 */
+}
+
+static u32_t shcachehits(void)
+{
+#if SNMP_LWIP_RESPONSE_CACHE
+    return snmp_cache_get_stats()->hits;
+#else
+    return 0;
+#endif /* SNMP_LWIP_RESPONSE_CACHE */
+}
+
+static u32_t shcachemisses(void)
+{
+#if SNMP_LWIP_RESPONSE_CACHE
+    return snmp_cache_get_stats()->misses;
+#else
+    return 0;
+#endif /* SNMP_LWIP_RESPONSE_CACHE */
+}
+
+static u32_t shratelimited(void)
+{
+#if SNMP_LWIP_RESPONSE_CACHE
+    return snmp_cache_get_stats()->rate_limited;
+#else
+    return 0;
+#endif /* SNMP_LWIP_RESPONSE_CACHE */
+}
+
+/* --- shHealth ---------------------------------------------------------- */
+
+template <const struct health_latency *(*Latency)(void)>
+static u32_t latencycount(void)
+{
+    return Latency()->count;
+}
+
+template <const struct health_latency *(*Latency)(void)>
+static u32_t latencylast(void)
+{
+    return Latency()->last_us;
+}
+
+template <const struct health_latency *(*Latency)(void)>
+static u32_t latencymax(void)
+{
+    return Latency()->max_us;
+}
+
+template <enum backlight_state State>
+static u32_t displaytime(void)
+{
+    return backlight_time(State, sys_now());
+}
+
+/* --- shLoopTable, shSampleLatencyTable ---------------------------------- */
+
+static snmp_err_t histogramtable_get_instance(const u32_t *column, const u32_t *row_oid, u8_t row_oid_len, struct snmp_node_instance *cell_instance)
+{
+    LWIP_UNUSED_ARG(column);
+
+    if (!snmp_oid_in_range(row_oid, row_oid_len, histogram_table_oid_ranges,
+            LWIP_ARRAYSIZE(histogram_table_oid_ranges))) {
+        return SNMP_ERR_NOSUCHINSTANCE;
+    }
+
+    /* store bucket for subsequent operations (get/test/set) */
+    cell_instance->reference.u32 = row_oid[0] - 1;
+    return SNMP_ERR_NOERROR;
+}
+
+static snmp_err_t histogramtable_get_next_instance(const u32_t *column, struct snmp_obj_id *row_oid, struct snmp_node_instance *cell_instance)
+{
+    u32_t bucket;
+
+    LWIP_UNUSED_ARG(column);
+
+    /* rows are 1..HEALTH_HISTOGRAM_BUCKETS without gaps */
+    if (row_oid->len == 0) {
+        bucket = 0;
+    } else if (row_oid->id[0] < HEALTH_HISTOGRAM_BUCKETS) {
+        bucket = row_oid->id[0];
+    } else {
+        return SNMP_ERR_NOSUCHINSTANCE;
+    }
+
+    row_oid->id[0] = bucket + 1;
+    row_oid->len = 1;
+    cell_instance->reference.u32 = bucket;
+    return SNMP_ERR_NOERROR;
+}
+
+static u32_t histogrambucketlimit(struct snmp_node_instance *cell_instance)
+{
+    return health_bucket_limit((u8_t)cell_instance->reference.u32);
+}
+
+template <uint32_t (*BucketCount)(uint8_t)>
+static u32_t histogrambucketcount(struct snmp_node_instance *cell_instance)
+{
+    return BucketCount((u8_t)cell_instance->reference.u32);
+}
+
+/* --- sensorHubMIB ------------------------------------------------------ */
+
+using shsensortable = mib::table<1, shsensortable_get_instance, shsensortable_get_next_instance,
+    mib::column<2, SNMP_ASN1_TYPE_OCTET_STRING, shsensorname>>;
+
+using shmeasurementtable = mib::table<2, shmeasurementtable_get_instance, shmeasurementtable_get_next_instance,
+    mib::column<1, SNMP_ASN1_TYPE_INTEGER, shmeasurementtype>,
+    mib::column<2, SNMP_ASN1_TYPE_INTEGER, shmeasurementvalue>,
+    mib::column<3, SNMP_ASN1_TYPE_INTEGER, shmeasurementrawvalue>>;
+
+using shhistorytable = mib::table<4, shhistorytable_get_instance, shhistorytable_get_next_instance,
+    mib::column<4, SNMP_ASN1_TYPE_INTEGER, shhistorymin>,
+    mib::column<5, SNMP_ASN1_TYPE_INTEGER, shhistorymean>,
+    mib::column<6, SNMP_ASN1_TYPE_INTEGER, shhistorymax>,
+    mib::column<7, SNMP_ASN1_TYPE_GAUGE, shhistorysamples>>;
+
+using shagent = mib::scalar_array<6,
+    mib::scalar<1, SNMP_ASN1_TYPE_COUNTER, shv3count<SNMPV3_TIMING_AUTH>>,
+    mib::scalar<2, SNMP_ASN1_TYPE_COUNTER, shv3time<SNMPV3_TIMING_AUTH>>,
+    mib::scalar<3, SNMP_ASN1_TYPE_GAUGE, shv3timemax<SNMPV3_TIMING_AUTH>>,
+    mib::scalar<4, SNMP_ASN1_TYPE_COUNTER, shv3count<SNMPV3_TIMING_PRIV>>,
+    mib::scalar<5, SNMP_ASN1_TYPE_COUNTER, shv3time<SNMPV3_TIMING_PRIV>>,
+    mib::scalar<6, SNMP_ASN1_TYPE_GAUGE, shv3timemax<SNMPV3_TIMING_PRIV>>,
+    mib::scalar<7, SNMP_ASN1_TYPE_COUNTER, shcachehits>,
+    mib::scalar<8, SNMP_ASN1_TYPE_COUNTER, shcachemisses>,
+    mib::scalar<9, SNMP_ASN1_TYPE_COUNTER, shratelimited>>;
+
+using shhealth = mib::scalar_array<7,
+    mib::scalar<1, SNMP_ASN1_TYPE_GAUGE, health_free_heap>,
+    mib::scalar<2, SNMP_ASN1_TYPE_GAUGE, health_min_free_heap>,
+    mib::scalar<3, SNMP_ASN1_TYPE_GAUGE, health_largest_free_block>,
+    mib::scalar<4, SNMP_ASN1_TYPE_GAUGE, health_free_psram>,
+    mib::scalar<5, SNMP_ASN1_TYPE_GAUGE, health_uptime>,
+    mib::scalar<6, SNMP_ASN1_TYPE_COUNTER, health_missed_frames>,
+    mib::scalar<7, SNMP_ASN1_TYPE_INTEGER, health_wifi_rssi>,
+    mib::scalar<8, SNMP_ASN1_TYPE_COUNTER, health_wifi_reconnects>,
+    mib::scalar<9, SNMP_ASN1_TYPE_COUNTER, latencycount<health_mqtt_publish>>,
+    mib::scalar<10, SNMP_ASN1_TYPE_GAUGE, latencylast<health_mqtt_publish>>,
+    mib::scalar<11, SNMP_ASN1_TYPE_GAUGE, latencymax<health_mqtt_publish>>,
+    mib::scalar<12, SNMP_ASN1_TYPE_COUNTER, latencycount<health_sd_write>>,
+    mib::scalar<13, SNMP_ASN1_TYPE_GAUGE, latencylast<health_sd_write>>,
+    mib::scalar<14, SNMP_ASN1_TYPE_GAUGE, latencymax<health_sd_write>>,
+    mib::scalar<15, SNMP_ASN1_TYPE_COUNTER, latencycount<health_sample>>,
+    mib::scalar<16, SNMP_ASN1_TYPE_GAUGE, latencylast<health_sample>>,
+    mib::scalar<17, SNMP_ASN1_TYPE_GAUGE, latencymax<health_sample>>,
+    mib::scalar<18, SNMP_ASN1_TYPE_COUNTER, latencycount<health_i2c>>,
+    mib::scalar<19, SNMP_ASN1_TYPE_GAUGE, latencylast<health_i2c>>,
+    mib::scalar<20, SNMP_ASN1_TYPE_GAUGE, latencymax<health_i2c>>,
+    mib::scalar<21, SNMP_ASN1_TYPE_COUNTER, health_i2c_errors>,
+    mib::scalar<22, SNMP_ASN1_TYPE_COUNTER, displaytime<BACKLIGHT_ON>>,
+    mib::scalar<23, SNMP_ASN1_TYPE_COUNTER, displaytime<BACKLIGHT_DIMMED>>,
+    mib::scalar<24, SNMP_ASN1_TYPE_COUNTER, displaytime<BACKLIGHT_ASLEEP>>,
+    mib::scalar<25, SNMP_ASN1_TYPE_COUNTER, latencycount<health_tap>>,
+    mib::scalar<26, SNMP_ASN1_TYPE_GAUGE, latencylast<health_tap>>,
+    mib::scalar<27, SNMP_ASN1_TYPE_GAUGE, latencymax<health_tap>>,
+    mib::scalar<28, SNMP_ASN1_TYPE_COUNTER, health_sd_mounts>,
+    mib::scalar<29, SNMP_ASN1_TYPE_GAUGE, health_sd_backlog>,
+    mib::scalar<30, SNMP_ASN1_TYPE_COUNTER, health_sd_dropped>>;
+
+using shlooptable = mib::table<8, histogramtable_get_instance, histogramtable_get_next_instance,
+    mib::column<2, SNMP_ASN1_TYPE_GAUGE, histogrambucketlimit>,
+    mib::column<3, SNMP_ASN1_TYPE_COUNTER, histogrambucketcount<health_loop_bucket_count>>>;
+
+using shsamplelatencytable = mib::table<9, histogramtable_get_instance, histogramtable_get_next_instance,
+    mib::column<2, SNMP_ASN1_TYPE_GAUGE, histogrambucketlimit>,
+    mib::column<3, SNMP_ASN1_TYPE_COUNTER, histogrambucketcount<health_sample_bucket_count>>>;
+
+using sensorhubmib = mib::tree<1,
+    shsensortable,
+    shmeasurementtable,
+    shhistorytable,
+    shagent,
+    shhealth,
+    shlooptable,
+    shsamplelatencytable>;
+
+const struct snmp_mib sensorhub_mib = mib::definition<sensorhubmib, 1, 3, 6, 1, 4, 1, 58049, 1>::value;
+
+void sensorhub_mib_init(void)
+{
+#if SNMP_LWIP_RESPONSE_CACHE
+    /* the tables only change with new samples, see snmp_cache_advance_epoch() */
+    static const u32_t sensor_table_oid[] = {1, 3, 6, 1, 4, 1, 58049, 1, shsensortable::oid};
+    static const u32_t measurement_table_oid[] = {1, 3, 6, 1, 4, 1, 58049, 1, shmeasurementtable::oid};
+    static const u32_t history_table_oid[] = {1, 3, 6, 1, 4, 1, 58049, 1, shhistorytable::oid};
+
+    snmp_cache_add_subtree(sensor_table_oid, LWIP_ARRAYSIZE(sensor_table_oid));
+    snmp_cache_add_subtree(measurement_table_oid, LWIP_ARRAYSIZE(measurement_table_oid));
+    snmp_cache_add_subtree(history_table_oid, LWIP_ARRAYSIZE(history_table_oid));
+#endif /* SNMP_LWIP_RESPONSE_CACHE */
+}
+
+#endif /* LWIP_SNMP */
+
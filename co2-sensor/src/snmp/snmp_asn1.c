@@ -607,7 +607,8 @@ snmp_asn1_dec_s32t(struct snmp_pbuf_stream *pbuf_stream, u16_t len, s32_t *value
       len--;
 
 #if BYTE_ORDER == LITTLE_ENDIAN
-      *value <<= 8;
+      /* unsigned, shifting a negative value is undefined */
+      *value = (s32_t)((u32_t)*value << 8);
 #endif
 #if BYTE_ORDER == BIG_ENDIAN
       *value >>= 8;
@@ -64,6 +64,7 @@ extern "C" {
 #define SNMP_ASN1_CONTEXT_PDU_SET_REQ      3
 #define SNMP_ASN1_CONTEXT_PDU_TRAP         4
 #define SNMP_ASN1_CONTEXT_PDU_GET_BULK_REQ 5
+#define SNMP_ASN1_CONTEXT_PDU_REPORT       8
 
 #define SNMP_ASN1_CONTEXT_VARBIND_NO_SUCH_OBJECT      0
 #define SNMP_ASN1_CONTEXT_VARBIND_END_OF_MIB_VIEW     2
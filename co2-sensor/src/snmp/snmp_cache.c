@@ -0,0 +1,323 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "snmp_cache.h"
+
+#if LWIP_SNMP && SNMP_LWIP_RESPONSE_CACHE
+
+#include "lwip/sys.h"
+#include <string.h>
+
+struct snmp_cache_entry {
+  u32_t epoch;          /* 0: unused */
+  u8_t  get_next;
+  u8_t  oid_len;
+  u8_t  type;
+  u8_t  data_len;
+  u32_t oid[SNMP_CACHE_MAX_OID_LEN];
+  u8_t  data[SNMP_CACHE_MAX_VARBIND_LEN];
+};
+
+struct snmp_rate_limit_source {
+  ip_addr_t addr;
+  u32_t     last_seen;
+  u32_t     tokens;     /* in 1/1000 requests */
+  u32_t     walk_hash;  /* of the last OID a GETBULK response to the source ended with, 0: not walking */
+  u8_t      used;
+};
+
+static struct snmp_cache_entry snmp_cache[SNMP_CACHE_ENTRIES];
+static struct snmp_obj_id snmp_cache_subtrees[SNMP_CACHE_SUBTREES];
+static u8_t snmp_cache_subtree_count;
+
+/* written by the application, read in the tcpip thread; an aligned u32 store is atomic */
+static volatile u32_t snmp_cache_epoch = 1;
+/* epoch seen by the last miss, so values resolved before an epoch change are not stored as current */
+static u32_t snmp_cache_miss_epoch;
+
+static struct snmp_cache_stats snmp_cache_stats;
+
+/* burst in the upper, requests per second in the lower half; written by the application, read in the tcpip thread */
+static volatile u32_t snmp_rate_limit = ((u32_t)SNMP_RATE_LIMIT_BURST << 16) | SNMP_RATE_LIMIT_PER_SEC;
+
+#if SNMP_RATE_LIMIT_SOURCES > 0
+static struct snmp_rate_limit_source snmp_rate_limit_sources[SNMP_RATE_LIMIT_SOURCES];
+#endif
+
+/**
+ * Registers a subtree whose values only change with the sample epoch.
+ * Call before snmp_init().
+ */
+err_t
+snmp_cache_add_subtree(const u32_t *oid, u8_t oid_len)
+{
+  if (snmp_cache_subtree_count >= SNMP_CACHE_SUBTREES) {
+    return ERR_MEM;
+  }
+
+  snmp_oid_assign(&snmp_cache_subtrees[snmp_cache_subtree_count], oid, oid_len);
+  snmp_cache_subtree_count++;
+  return ERR_OK;
+}
+
+/** Invalidates all cached varbinds, call whenever new samples are available. */
+void
+snmp_cache_advance_epoch(void)
+{
+  u32_t epoch = snmp_cache_epoch + 1;
+
+  /* 0 marks unused entries */
+  snmp_cache_epoch = (epoch == 0) ? 1 : epoch;
+}
+
+const struct snmp_cache_stats *
+snmp_cache_get_stats(void)
+{
+  return &snmp_cache_stats;
+}
+
+/**
+ * Sets the requests per second and the burst a single source may send,
+ * 0 requests per second disables rate limiting.
+ */
+void
+snmp_rate_limit_set(u16_t per_sec, u16_t burst)
+{
+  /* with a burst below one request nothing would pass */
+  snmp_rate_limit = ((u32_t)LWIP_MAX(burst, 1) << 16) | per_sec;
+}
+
+/** Requests per second a single source may send, 0 if not limited */
+u16_t
+snmp_rate_limit_get(void)
+{
+  return (u16_t)(snmp_rate_limit & 0xFFFF);
+}
+
+/* FNV-1a over the sub-ids */
+static u32_t
+snmp_cache_hash(const u32_t *oid, u8_t oid_len, u32_t seed)
+{
+  u32_t hash = 2166136261UL ^ seed;
+  u8_t i;
+
+  for (i = 0; i < oid_len; i++) {
+    hash = (hash ^ oid[i]) * 16777619UL;
+  }
+
+  return hash;
+}
+
+static struct snmp_cache_entry *
+snmp_cache_slot(const u32_t *oid, u8_t oid_len, u8_t get_next)
+{
+  return &snmp_cache[snmp_cache_hash(oid, oid_len, get_next) % SNMP_CACHE_ENTRIES];
+}
+
+static u8_t
+snmp_cache_in_subtree(const struct snmp_obj_id *oid)
+{
+  u8_t i;
+
+  for (i = 0; i < snmp_cache_subtree_count; i++) {
+    const struct snmp_obj_id *subtree = &snmp_cache_subtrees[i];
+
+    if ((oid->len >= subtree->len) && (memcmp(oid->id, subtree->id, subtree->len * sizeof(u32_t)) == 0)) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+/** Returns 1 and the encoded varbind if oid was answered before in the current epoch */
+u8_t
+snmp_cache_lookup(const u32_t *oid, u8_t oid_len, u8_t get_next, u8_t *type, const u8_t **data, u16_t *len)
+{
+  const struct snmp_cache_entry *entry;
+
+  if ((snmp_cache_subtree_count == 0) || (oid_len > SNMP_CACHE_MAX_OID_LEN)) {
+    return 0;
+  }
+
+  snmp_cache_miss_epoch = snmp_cache_epoch;
+  entry = snmp_cache_slot(oid, oid_len, get_next);
+  if ((entry->epoch != snmp_cache_miss_epoch) || (entry->get_next != get_next) ||
+      !snmp_oid_equal(entry->oid, entry->oid_len, oid, oid_len)) {
+    snmp_cache_stats.misses++;
+    return 0;
+  }
+
+  snmp_cache_stats.hits++;
+  *type = entry->type;
+  *data = entry->data;
+  *len  = entry->data_len;
+  return 1;
+}
+
+/** Keeps len bytes at offset of p, the varbind encoded for oid, if its result is cacheable */
+void
+snmp_cache_store(const u32_t *oid, u8_t oid_len, u8_t get_next, const struct snmp_obj_id *result_oid, u8_t type, struct pbuf *p, u16_t offset, u16_t len)
+{
+  struct snmp_cache_entry *entry;
+
+  if ((oid_len > SNMP_CACHE_MAX_OID_LEN) || (len > SNMP_CACHE_MAX_VARBIND_LEN) || !snmp_cache_in_subtree(result_oid)) {
+    return;
+  }
+
+  entry = snmp_cache_slot(oid, oid_len, get_next);
+  if (pbuf_copy_partial(p, entry->data, len, offset) != len) {
+    entry->epoch = 0;
+    return;
+  }
+
+  entry->epoch    = snmp_cache_miss_epoch;
+  entry->get_next = get_next;
+  entry->type     = type;
+  entry->data_len = (u8_t)len;
+  entry->oid_len  = oid_len;
+  MEMCPY(entry->oid, oid, oid_len * sizeof(u32_t));
+}
+
+#if SNMP_RATE_LIMIT_SOURCES > 0
+static struct snmp_rate_limit_source *
+snmp_rate_limit_find(const ip_addr_t *source_ip)
+{
+  u8_t i;
+
+  for (i = 0; i < SNMP_RATE_LIMIT_SOURCES; i++) {
+    struct snmp_rate_limit_source *s = &snmp_rate_limit_sources[i];
+
+    if (s->used && ip_addr_cmp(&s->addr, source_ip)) {
+      return s;
+    }
+  }
+
+  return NULL;
+}
+#endif
+
+/**
+ * Token bucket per source address.
+ * Returns SNMP_RATE_LIMIT_DROP (counted in rate_limited) if the request shall
+ * be dropped and SNMP_RATE_LIMIT_WALKING if it is over the limit, but the
+ * source is walking the tree with GETBULK.
+ */
+u8_t
+snmp_rate_limit_accept(const ip_addr_t *source_ip)
+{
+#if SNMP_RATE_LIMIT_SOURCES > 0
+  struct snmp_rate_limit_source *source;
+  struct snmp_rate_limit_source *oldest = &snmp_rate_limit_sources[0];
+  u32_t limit   = snmp_rate_limit;
+  u32_t per_sec = limit & 0xFFFF;
+  u32_t burst   = (limit >> 16) * 1000UL;
+  u32_t now;
+  u8_t i;
+
+  if (per_sec == 0) {
+    return SNMP_RATE_LIMIT_ACCEPT;
+  }
+
+  now    = sys_now();
+  source = snmp_rate_limit_find(source_ip);
+  if (source == NULL) {
+    for (i = 0; i < SNMP_RATE_LIMIT_SOURCES; i++) {
+      struct snmp_rate_limit_source *s = &snmp_rate_limit_sources[i];
+
+      if (!s->used || (oldest->used && ((now - s->last_seen) > (now - oldest->last_seen)))) {
+        oldest = s;
+      }
+    }
+
+    source = oldest;
+    ip_addr_copy(source->addr, *source_ip);
+    source->tokens    = burst;
+    source->last_seen = now;
+    source->walk_hash = 0;
+    source->used      = 1;
+  }
+
+  /* refill, capped at the burst size */
+  if ((now - source->last_seen) >= burst / per_sec) {
+    source->tokens = burst;
+  } else {
+    source->tokens = LWIP_MIN(source->tokens + (now - source->last_seen) * per_sec, burst);
+  }
+  source->last_seen = now;
+
+  if (source->tokens < 1000) {
+    if (source->walk_hash != 0) {
+      return SNMP_RATE_LIMIT_WALKING;
+    }
+    snmp_cache_stats.rate_limited++;
+    return SNMP_RATE_LIMIT_DROP;
+  }
+
+  source->tokens -= 1000;
+#else
+  LWIP_UNUSED_ARG(source_ip);
+#endif
+  return SNMP_RATE_LIMIT_ACCEPT;
+}
+
+/**
+ * For requests over the limit from a walking source: returns 1 if oid, the
+ * last OID of the request, continues the walk. Otherwise the request shall be
+ * dropped and is counted in rate_limited. Pass NULL for other requests.
+ */
+u8_t
+snmp_rate_limit_continues(const ip_addr_t *source_ip, const u32_t *oid, u8_t oid_len)
+{
+#if SNMP_RATE_LIMIT_SOURCES > 0
+  const struct snmp_rate_limit_source *source = snmp_rate_limit_find(source_ip);
+
+  if ((oid != NULL) && (source != NULL) && (source->walk_hash == (snmp_cache_hash(oid, oid_len, 0) | 1))) {
+    return 1;
+  }
+#else
+  LWIP_UNUSED_ARG(source_ip);
+  LWIP_UNUSED_ARG(oid);
+  LWIP_UNUSED_ARG(oid_len);
+#endif
+
+  snmp_cache_stats.rate_limited++;
+  return 0;
+}
+
+/**
+ * Remembers oid, the last OID of a GETBULK response, as the start of the
+ * next request of the source; NULL when the walk reached the end of the MIB.
+ */
+void
+snmp_rate_limit_walked(const ip_addr_t *source_ip, const u32_t *oid, u8_t oid_len)
+{
+#if SNMP_RATE_LIMIT_SOURCES > 0
+  struct snmp_rate_limit_source *source = snmp_rate_limit_find(source_ip);
+
+  if (source != NULL) {
+    /* never 0, that marks a source that is not walking */
+    source->walk_hash = (oid != NULL) ? (snmp_cache_hash(oid, oid_len, 0) | 1) : 0;
+  }
+#else
+  LWIP_UNUSED_ARG(source_ip);
+  LWIP_UNUSED_ARG(oid);
+  LWIP_UNUSED_ARG(oid_len);
+#endif
+}
+
+#endif /* LWIP_SNMP && SNMP_LWIP_RESPONSE_CACHE */
@@ -0,0 +1,112 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Response cache and per source rate limiting for the SNMP agent.
+ *
+ * Encoded varbinds of GET/GETNEXT (and GETBULK repetitions) are kept per
+ * request OID until the application advances the sample epoch, a repeated
+ * poll within an epoch is answered by copying the encoded bytes.
+ * Only results below subtrees registered with snmp_cache_add_subtree()
+ * are cached, everything else (e.g. sysUpTime) is always resolved.
+ */
+
+#ifndef LWIP_HDR_APPS_SNMP_CACHE_H
+#define LWIP_HDR_APPS_SNMP_CACHE_H
+
+#include "lwip/apps/snmp_opts.h"
+
+#ifndef SNMP_LWIP_RESPONSE_CACHE
+#define SNMP_LWIP_RESPONSE_CACHE 0
+#endif
+
+#if LWIP_SNMP && SNMP_LWIP_RESPONSE_CACHE
+
+#include "lwip/apps/snmp_core.h"
+#include "lwip/ip_addr.h"
+#include "lwip/pbuf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** number of cached varbinds (direct mapped by OID hash) */
+#ifndef SNMP_CACHE_ENTRIES
+#define SNMP_CACHE_ENTRIES 32
+#endif
+
+/** longer request OIDs are not cached */
+#ifndef SNMP_CACHE_MAX_OID_LEN
+#define SNMP_CACHE_MAX_OID_LEN 20
+#endif
+
+/** longer encoded varbinds are not cached */
+#ifndef SNMP_CACHE_MAX_VARBIND_LEN
+#define SNMP_CACHE_MAX_VARBIND_LEN 64
+#endif
+
+#ifndef SNMP_CACHE_SUBTREES
+#define SNMP_CACHE_SUBTREES 4
+#endif
+
+/** requests per second a single source may send until snmp_rate_limit_set(), 0 disables rate limiting */
+#ifndef SNMP_RATE_LIMIT_PER_SEC
+#define SNMP_RATE_LIMIT_PER_SEC 0
+#endif
+
+/** requests a source may send at once after being idle, until snmp_rate_limit_set() */
+#ifndef SNMP_RATE_LIMIT_BURST
+#define SNMP_RATE_LIMIT_BURST (2 * SNMP_RATE_LIMIT_PER_SEC)
+#endif
+
+/** number of tracked sources, the least recently seen one is replaced, 0 compiles rate limiting out */
+#ifndef SNMP_RATE_LIMIT_SOURCES
+#define SNMP_RATE_LIMIT_SOURCES 8
+#endif
+
+/* results of snmp_rate_limit_accept() */
+#define SNMP_RATE_LIMIT_DROP     0
+#define SNMP_RATE_LIMIT_ACCEPT   1
+/** over the limit, but the source walks with GETBULK; accept only the continuation, see snmp_rate_limit_continues() */
+#define SNMP_RATE_LIMIT_WALKING  2
+
+struct snmp_cache_stats {
+  u32_t hits;
+  u32_t misses;
+  u32_t rate_limited;
+};
+
+err_t snmp_cache_add_subtree(const u32_t *oid, u8_t oid_len);
+void snmp_cache_advance_epoch(void);
+const struct snmp_cache_stats *snmp_cache_get_stats(void);
+void snmp_rate_limit_set(u16_t per_sec, u16_t burst);
+u16_t snmp_rate_limit_get(void);
+
+/* used by snmp_msg.c */
+u8_t snmp_cache_lookup(const u32_t *oid, u8_t oid_len, u8_t get_next, u8_t *type, const u8_t **data, u16_t *len);
+void snmp_cache_store(const u32_t *oid, u8_t oid_len, u8_t get_next, const struct snmp_obj_id *result_oid, u8_t type, struct pbuf *p, u16_t offset, u16_t len);
+u8_t snmp_rate_limit_accept(const ip_addr_t *source_ip);
+u8_t snmp_rate_limit_continues(const ip_addr_t *source_ip, const u32_t *oid, u8_t oid_len);
+void snmp_rate_limit_walked(const ip_addr_t *source_ip, const u32_t *oid, u8_t oid_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LWIP_SNMP && SNMP_LWIP_RESPONSE_CACHE */
+
+#endif /* LWIP_HDR_APPS_SNMP_CACHE_H */
@@ -176,6 +176,7 @@
 #include "lwip/apps/snmp_core.h"
 #include "snmp_core_priv.h"
 #include "lwip/netif.h"
+#include "lwip/mem.h"
 #include <string.h>
 
 
@@ -206,6 +207,201 @@ static u8_t snmp_num_mibs                          = 0;
 /* List of known mibs */
 static struct snmp_mib const * const *snmp_mibs = default_mibs;
 
+/*
+ * Lookup index over the known mibs, built by snmp_set_mibs().
+ * The mibs are sorted by base OID and the subnodes of every tree node are
+ * copied into a sorted array, so resolving an OID takes a binary search per
+ * level instead of a linear scan. Without index (snmp_set_mibs() not called
+ * or out of memory) the trees are walked directly.
+ */
+struct snmp_mib_index_entry {
+  const struct snmp_node *node;
+  u32_t oid;         /* copy of node->oid, saves a dereference per compare */
+  u16_t children;    /* first child in snmp_mib_index_entries, sorted by oid, 0 for leaf nodes */
+  u16_t child_count;
+};
+
+/* saves dereferencing the node, the children of a tree never start at entry 0 */
+#define SNMP_MIB_INDEX_IS_TREE(entry) ((entry)->children != 0)
+
+struct snmp_mib_index_mib {
+  const struct snmp_mib *mib;
+  u16_t root;        /* entry of mib->root_node */
+};
+
+static struct snmp_mib_index_entry *snmp_mib_index_entries;
+static struct snmp_mib_index_mib *snmp_mib_index_mibs; /* sorted by base OID, snmp_num_mibs long */
+
+static u32_t
+snmp_mib_index_count(const struct snmp_node *node)
+{
+  u32_t count = 1;
+
+  if (node->node_type == SNMP_NODE_TREE) {
+    const struct snmp_tree_node *tree = (const struct snmp_tree_node*)(const void*)node;
+    u16_t i;
+
+    for (i = 0; i < tree->subnode_count; i++) {
+      count += snmp_mib_index_count(tree->subnodes[i]);
+    }
+  }
+
+  return count;
+}
+
+/* entry must already reference its node, appends the sorted children at *next and descends into them */
+static void
+snmp_mib_index_fill(u16_t entry, u16_t *next)
+{
+  struct snmp_mib_index_entry *e = &snmp_mib_index_entries[entry];
+  const struct snmp_tree_node *tree;
+  u16_t i, j;
+
+  e->oid         = e->node->oid;
+  e->children    = 0;
+  e->child_count = 0;
+  if (e->node->node_type != SNMP_NODE_TREE) {
+    return;
+  }
+
+  tree           = (const struct snmp_tree_node*)(const void*)e->node;
+  e->children    = *next;
+  e->child_count = tree->subnode_count;
+  *next         += tree->subnode_count;
+
+  /* insertion sort, the generated subnode arrays are usually sorted already */
+  for (i = 0; i < tree->subnode_count; i++) {
+    const struct snmp_node *subnode = tree->subnodes[i];
+
+    j = i;
+    while ((j > 0) && (snmp_mib_index_entries[e->children + j - 1].node->oid > subnode->oid)) {
+      snmp_mib_index_entries[e->children + j].node = snmp_mib_index_entries[e->children + j - 1].node;
+      j--;
+    }
+    snmp_mib_index_entries[e->children + j].node = subnode;
+  }
+
+  for (i = 0; i < e->child_count; i++) {
+    snmp_mib_index_fill(e->children + i, next);
+  }
+}
+
+static void
+snmp_mib_index_build(void)
+{
+  u32_t count = 0;
+  u16_t next = 0;
+  u8_t i, j;
+
+  if (snmp_mib_index_entries != NULL) {
+    mem_free(snmp_mib_index_entries);
+    snmp_mib_index_entries = NULL;
+    snmp_mib_index_mibs    = NULL;
+  }
+
+  for (i = 0; i < snmp_num_mibs; i++) {
+    count += snmp_mib_index_count(snmp_mibs[i]->root_node);
+  }
+  if (count > 0xFFFF) {
+    return;
+  }
+
+  /* one block, the entries come first so both arrays are aligned */
+  snmp_mib_index_entries = (struct snmp_mib_index_entry*)mem_malloc(
+    (mem_size_t)(count * sizeof(struct snmp_mib_index_entry) + snmp_num_mibs * sizeof(struct snmp_mib_index_mib)));
+  if (snmp_mib_index_entries == NULL) {
+    LWIP_DEBUGF(SNMP_DEBUG, ("snmp_mib_index_build(): out of memory, resolving without index\n"));
+    return;
+  }
+  snmp_mib_index_mibs = (struct snmp_mib_index_mib*)(void*)&snmp_mib_index_entries[count];
+
+  for (i = 0; i < snmp_num_mibs; i++) {
+    const struct snmp_mib *mib = snmp_mibs[i];
+
+    j = i;
+    while ((j > 0) && (snmp_oid_compare(snmp_mib_index_mibs[j - 1].mib->base_oid, snmp_mib_index_mibs[j - 1].mib->base_oid_len,
+                                        mib->base_oid, mib->base_oid_len) > 0)) {
+      snmp_mib_index_mibs[j] = snmp_mib_index_mibs[j - 1];
+      j--;
+    }
+    snmp_mib_index_mibs[j].mib  = mib;
+    snmp_mib_index_mibs[j].root = next;
+
+    snmp_mib_index_entries[next].node = mib->root_node;
+    next++;
+    snmp_mib_index_fill(next - 1, &next);
+  }
+}
+
+static const struct snmp_mib_index_entry*
+snmp_mib_index_root(const struct snmp_mib *mib)
+{
+  u8_t i;
+
+  if (snmp_mib_index_mibs == NULL) {
+    return NULL;
+  }
+
+  for (i = 0; i < snmp_num_mibs; i++) {
+    if (snmp_mib_index_mibs[i].mib == mib) {
+      return &snmp_mib_index_entries[snmp_mib_index_mibs[i].root];
+    }
+  }
+
+  return NULL;
+}
+
+/* position of the first child with an oid >= subnode_oid, child_count if there is none */
+static inline u16_t
+snmp_mib_index_lower_bound(const struct snmp_mib_index_entry *entry, u32_t subnode_oid)
+{
+  const struct snmp_mib_index_entry *first = &snmp_mib_index_entries[entry->children];
+  const struct snmp_mib_index_entry *base  = first;
+  u16_t count = entry->child_count;
+
+  if (count <= 8) {
+    /* small ranges are faster counted than bisected, the loop does not depend on the data */
+    u16_t below = 0;
+    u16_t i;
+
+    for (i = 0; i < count; i++) {
+      below += (first[i].oid < subnode_oid);
+    }
+    return below;
+  }
+
+  /* halving without a data dependent branch, the compiler selects base with a conditional move */
+  while (count > 1) {
+    u16_t half = count >> 1;
+
+    base   = (base[half].oid < subnode_oid) ? &base[half] : base;
+    count -= half;
+  }
+
+  return (u16_t)((base - first) + (base->oid < subnode_oid));
+}
+
+/* position of the first mib with a base OID behind oid, snmp_num_mibs if there is none */
+static u8_t
+snmp_mib_index_upper_bound(const u32_t *oid, u8_t oid_len)
+{
+  u8_t low  = 0;
+  u8_t high = snmp_num_mibs;
+
+  while (low < high) {
+    u8_t mid = low + ((high - low) >> 1);
+    const struct snmp_mib *mib = snmp_mib_index_mibs[mid].mib;
+
+    if (snmp_oid_compare(mib->base_oid, mib->base_oid_len, oid, oid_len) <= 0) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+
+  return low;
+}
+
 /**
  * @ingroup snmp_core
  * Sets the MIBs to use.
@@ -223,6 +419,7 @@ snmp_set_mibs(const struct snmp_mib **mibs, u8_t num_mibs)
   LWIP_ASSERT("num_mibs pointer must be != 0", (num_mibs != 0));
   snmp_mibs     = mibs;
   snmp_num_mibs = num_mibs;
+  snmp_mib_index_build();
 }
 
 /**
@@ -688,6 +885,20 @@ snmp_get_mib_from_oid(const u32_t *oid, u8_t oid_len)
     return NULL;
   }
 
+  if (snmp_mib_index_mibs != NULL) {
+    /* prefixes of oid sort before it and the longer the prefix the closer to oid, so the first match is the longest */
+    i = snmp_mib_index_upper_bound(oid, oid_len);
+    while (i > 0) {
+      i--;
+      matched_mib = snmp_mib_index_mibs[i].mib;
+      if ((oid_len >= matched_mib->base_oid_len) &&
+          (memcmp(matched_mib->base_oid, oid, matched_mib->base_oid_len * sizeof(u32_t)) == 0)) {
+        return matched_mib;
+      }
+    }
+    return NULL;
+  }
+
   for (i = 0; i < snmp_num_mibs; i++) {
     LWIP_ASSERT("MIB array not initialized correctly", (snmp_mibs[i] != NULL));
     LWIP_ASSERT("MIB array not initialized correctly - base OID is NULL", (snmp_mibs[i]->base_oid != NULL));
@@ -729,6 +940,11 @@ snmp_get_next_mib(const u32_t *oid, u8_t oid_len)
     return NULL;
   }
 
+  if (snmp_mib_index_mibs != NULL) {
+    i = snmp_mib_index_upper_bound(oid, oid_len);
+    return (i < snmp_num_mibs) ? snmp_mib_index_mibs[i].mib : NULL;
+  }
+
   for (i = 0; i < snmp_num_mibs; i++) {
     if (snmp_mibs[i]->base_oid != NULL) {
       /* check if mib is located behind starting point */
@@ -970,6 +1186,80 @@ snmp_get_next_node_instance_from_oid(const u32_t *oid, u8_t oid_len, snmp_valida
   return SNMP_ERR_NOERROR;
 }
 
+/* same as snmp_mib_tree_resolve_next(), using the index of the mib */
+static const struct snmp_node*
+snmp_mib_index_resolve_next(const struct snmp_mib *mib, const u32_t *oid, u8_t oid_len, struct snmp_obj_id* oidret)
+{
+  u8_t  oid_offset = mib->base_oid_len;
+  const struct snmp_mib_index_entry* entry_stack[SNMP_MAX_OBJ_ID_LEN];
+  const struct snmp_mib_index_entry* entry;
+  s32_t nsi = 0; /* NodeStackIndex */
+  u32_t subnode_oid;
+  u16_t i;
+
+  /* first build entry stack related to passed oid (as far as possible), then go backwards to determine the next node */
+  entry_stack[nsi] = snmp_mib_index_root(mib);
+  while (oid_offset < oid_len) {
+    i = snmp_mib_index_lower_bound(entry_stack[nsi], oid[oid_offset]);
+    if (i == entry_stack[nsi]->child_count) {
+      break;
+    }
+
+    entry = &snmp_mib_index_entries[entry_stack[nsi]->children + i];
+    if ((entry->oid != oid[oid_offset]) || !SNMP_MIB_INDEX_IS_TREE(entry)) {
+      /* no (matching) tree-subnode found */
+      break;
+    }
+    nsi++;
+    entry_stack[nsi] = entry;
+
+    oid_offset++;
+  }
+
+  if (oid_offset >= oid_len) {
+    /* passed oid references a tree node -> return first useable sub node of it */
+    subnode_oid = 0;
+  } else {
+    subnode_oid = *(oid + oid_offset) + 1;
+  }
+
+  while (nsi >= 0) {
+    /* find next node on current level */
+    i = snmp_mib_index_lower_bound(entry_stack[nsi], subnode_oid);
+
+    if (i == entry_stack[nsi]->child_count) {
+      /* no further node found on this level, go one level up and start searching with index of current node*/
+      subnode_oid = entry_stack[nsi]->node->oid + 1;
+      nsi--;
+    } else {
+      entry = &snmp_mib_index_entries[entry_stack[nsi]->children + i];
+
+      if (SNMP_MIB_INDEX_IS_TREE(entry)) {
+        /* next is a tree node, go into it and start searching */
+        nsi++;
+        entry_stack[nsi] = entry;
+        subnode_oid = 0;
+      } else {
+        /* we found a leaf node -> fill oidret and return it */
+        s32_t level;
+
+        snmp_oid_assign(oidret, mib->base_oid, mib->base_oid_len);
+        for (level = 1; level <= nsi; level++) {
+          oidret->id[oidret->len] = entry_stack[level]->node->oid;
+          oidret->len++;
+        }
+
+        oidret->id[oidret->len] = entry->node->oid;
+        oidret->len++;
+
+        return entry->node;
+      }
+    }
+  }
+
+  return NULL;
+}
+
 /**
  * Searches tree for the supplied object identifier.
  *
@@ -979,6 +1269,30 @@ snmp_mib_tree_resolve_exact(const struct snmp_mib *mib, const u32_t *oid, u8_t o
 {
   const struct snmp_node* const* node = &mib->root_node;
   u8_t oid_offset = mib->base_oid_len;
+  const struct snmp_mib_index_entry *entry = snmp_mib_index_root(mib);
+
+  if (entry != NULL) {
+    while ((oid_offset < oid_len) && SNMP_MIB_INDEX_IS_TREE(entry)) {
+      u16_t i = snmp_mib_index_lower_bound(entry, oid[oid_offset]);
+      const struct snmp_mib_index_entry *child = &snmp_mib_index_entries[entry->children + i];
+
+      if ((i == entry->child_count) || (child->oid != oid[oid_offset])) {
+        /* no matching subnode found */
+        return NULL;
+      }
+
+      entry = child;
+      oid_offset++;
+    }
+
+    if (!SNMP_MIB_INDEX_IS_TREE(entry)) {
+      /* we found a leaf node */
+      *oid_instance_len = oid_len - oid_offset;
+      return entry->node;
+    }
+
+    return NULL;
+  }
 
   while ((oid_offset < oid_len) && ((*node)->node_type == SNMP_NODE_TREE)) {
     /* search for matching sub node */
@@ -1022,6 +1336,10 @@ snmp_mib_tree_resolve_next(const struct snmp_mib *mib, const u32_t *oid, u8_t oi
     return NULL;
   }
 
+  if (snmp_mib_index_root(mib) != NULL) {
+    return snmp_mib_index_resolve_next(mib, oid, oid_len, oidret);
+  }
+
   /* first build node stack related to passed oid (as far as possible), then go backwards to determine the next node */
   node_stack[nsi] = (const struct snmp_tree_node*)(const void*)mib->root_node;
   while (oid_offset < oid_len) {
@@ -42,6 +42,7 @@
 #include "snmp_msg.h"
 #include "snmp_asn1.h"
 #include "snmp_core_priv.h"
+#include "snmp_cache.h"
 #include "lwip/ip_addr.h"
 #include "lwip/stats.h"
 
@@ -53,8 +54,31 @@
 #endif
 #endif
 
+/* the engine may provide these to measure authentication and encryption */
+#ifndef SNMPV3_TIMING_BEGIN
+#define SNMPV3_TIMING_BEGIN(start)
+#define SNMPV3_TIMING_END(kind, start)
+#endif
+
+/* the engine may refuse v1/v2c communities, e.g. once SNMPv3 users are configured */
+#ifndef SNMPV3_COMMUNITY_ALLOWED
+#define SNMPV3_COMMUNITY_ALLOWED() 1
+#endif
+
+#if LWIP_SNMP_V3
+#define SNMP_RESPONSE_PDU_TYPE(request) (((request)->request_type == SNMP_ASN1_CONTEXT_PDU_REPORT) ? \
+    SNMP_ASN1_CONTEXT_PDU_REPORT : SNMP_ASN1_CONTEXT_PDU_GET_RESP)
+#else
+#define SNMP_RESPONSE_PDU_TYPE(request) SNMP_ASN1_CONTEXT_PDU_GET_RESP
+#endif
+
 #include <string.h>
 
+/* upper bound of an encoded OID: compressed first two sub-ids, then up to 5 octets per sub-id */
+#define SNMP_ASN1_OID_MAX_ENC_LEN(oid_len) (1 + ((oid_len) - 2) * 5)
+/* 'VarBind' sequence with a two sub-id OID and an empty value (exception) */
+#define SNMP_MIN_VARBIND_LEN (2 + 3 + 2)
+
 /* public (non-static) constants */
 /** SNMP community string */
 const char *snmp_community = SNMP_COMMUNITY;
@@ -169,6 +193,15 @@ static err_t snmp_parse_inbound_frame(struct snmp_request *request);
 static err_t snmp_prepare_outbound_frame(struct snmp_request *request);
 static err_t snmp_complete_outbound_frame(struct snmp_request *request);
 static void snmp_execute_write_callbacks(struct snmp_request *request);
+#if LWIP_SNMP_V3
+static err_t snmp_append_report_varbind(struct snmp_request *request);
+
+/* indexed by SNMP_V3_USM_STATS_* */
+static u32_t snmpv3_usm_stats[SNMP_V3_USM_STATS_DECRYPTION_ERRORS + 1];
+#endif
+#if SNMP_LWIP_RESPONSE_CACHE
+static u8_t snmp_msg_last_oid(struct pbuf *p, u16_t offset, u16_t len, struct snmp_varbind *vb);
+#endif
 
 
 /* ----------------------------------------------------------------------- */
@@ -180,6 +213,16 @@ snmp_receive(void *handle, struct pbuf *p, const ip_addr_t *source_ip, u16_t por
 {
   err_t err;
   struct snmp_request request;
+#if SNMP_LWIP_RESPONSE_CACHE
+  struct snmp_varbind vb;
+  u8_t rate_limit = snmp_rate_limit_accept(source_ip);
+
+  if (rate_limit == SNMP_RATE_LIMIT_DROP) {
+    /* drop silently, answering would cost the same as processing */
+    snmp_stats.inpkts++;
+    return;
+  }
+#endif
    
   memset(&request, 0, sizeof(request));
   request.handle       = handle;
@@ -190,10 +233,29 @@ snmp_receive(void *handle, struct pbuf *p, const ip_addr_t *source_ip, u16_t por
   snmp_stats.inpkts++;
 
   err = snmp_parse_inbound_frame(&request);
+#if SNMP_LWIP_RESPONSE_CACHE
+  if ((err == ERR_OK) && (rate_limit == SNMP_RATE_LIMIT_WALKING)) {
+    /* over the limit, only the next GETBULK of a walk passes */
+    if ((request.request_type == SNMP_ASN1_CONTEXT_PDU_GET_BULK_REQ) &&
+        snmp_msg_last_oid(request.inbound_pbuf, request.inbound_varbind_offset, request.inbound_varbind_len, &vb)) {
+      rate_limit = snmp_rate_limit_continues(source_ip, vb.oid.id, vb.oid.len);
+    } else {
+      rate_limit = snmp_rate_limit_continues(source_ip, NULL, 0);
+    }
+    if (!rate_limit) {
+      return;
+    }
+  }
+#endif
   if (err == ERR_OK) {
     err = snmp_prepare_outbound_frame(&request);
     if (err == ERR_OK) {
 
+#if LWIP_SNMP_V3
+      if (request.request_type == SNMP_ASN1_CONTEXT_PDU_REPORT) {
+        err = snmp_append_report_varbind(&request);
+      } else
+#endif
       if (request.error_status == SNMP_ERR_NOERROR) {
         /* only process frame if we do not already have an error to return (e.g. all readonly) */
         if (request.request_type == SNMP_ASN1_CONTEXT_PDU_GET_REQ) {
@@ -202,8 +264,24 @@ snmp_receive(void *handle, struct pbuf *p, const ip_addr_t *source_ip, u16_t por
           err = snmp_process_getnext_request(&request);
         } else if (request.request_type == SNMP_ASN1_CONTEXT_PDU_GET_BULK_REQ) {
           err = snmp_process_getbulk_request(&request);
+#if SNMP_LWIP_RESPONSE_CACHE
+          if ((err == ERR_OK) && (snmp_rate_limit_get() != 0)) {
+            /* a walk ends when the last varbind is an exception, e.g. endOfMibView */
+            if (snmp_msg_last_oid(request.outbound_pbuf, request.outbound_varbind_offset,
+                                  request.outbound_pbuf_stream.offset - request.outbound_varbind_offset, &vb) &&
+                ((vb.type & SNMP_ASN1_CLASS_CONTEXT) == 0)) {
+              snmp_rate_limit_walked(source_ip, vb.oid.id, vb.oid.len);
+            } else {
+              snmp_rate_limit_walked(source_ip, NULL, 0);
+            }
+          }
+#endif
         } else if (request.request_type == SNMP_ASN1_CONTEXT_PDU_SET_REQ) {
           err = snmp_process_set_request(&request);
+#if SNMP_LWIP_RESPONSE_CACHE
+          /* a written value may show up anywhere */
+          snmp_cache_advance_epoch();
+#endif
         }
       }
 
@@ -249,6 +327,26 @@ snmp_process_varbind(struct snmp_request *request, struct snmp_varbind *vb, u8_t
 {
   err_t err;
   struct snmp_node_instance node_instance;
+#if SNMP_LWIP_RESPONSE_CACHE
+  u32_t request_oid[SNMP_CACHE_MAX_OID_LEN];
+  u8_t request_oid_len = vb->oid.len;
+  u16_t vb_offset = request->outbound_pbuf_stream.offset;
+  const u8_t *cached;
+  u16_t cached_len;
+
+  if (snmp_cache_lookup(vb->oid.id, vb->oid.len, get_next, &vb->type, &cached, &cached_len)) {
+    if (cached_len > request->outbound_pbuf_stream.length) {
+      request->error_status = SNMP_ERR_TOOBIG;
+    } else if (snmp_pbuf_stream_writebuf(&request->outbound_pbuf_stream, cached, cached_len) != ERR_OK) {
+      request->error_status = SNMP_ERR_GENERROR;
+    }
+    return;
+  }
+
+  if (request_oid_len <= SNMP_CACHE_MAX_OID_LEN) {
+    MEMCPY(request_oid, vb->oid.id, request_oid_len * sizeof(u32_t));
+  }
+#endif
   memset(&node_instance, 0, sizeof(node_instance));
 
   if (get_next) {
@@ -280,7 +378,7 @@ snmp_process_varbind(struct snmp_request *request, struct snmp_varbind *vb, u8_t
         vb->type = (SNMP_ASN1_CONTENTTYPE_PRIMITIVE | SNMP_ASN1_CLASS_CONTEXT | (request->error_status & SNMP_VARBIND_EXCEPTION_MASK));
         vb->value_len = 0;
 
-        err = snmp_append_outbound_varbind(&(request->outbound_pbuf_stream), vb);
+        err = snmp_append_response_varbind(&(request->outbound_pbuf_stream), vb);
         if (err == ERR_OK) {
           /* we stored the exception in varbind -> go on */
           request->error_status = SNMP_ERR_NOERROR;
@@ -302,7 +400,7 @@ snmp_process_varbind(struct snmp_request *request, struct snmp_varbind *vb, u8_t
       vb->value_len = (u16_t)len; /* cast is OK because we checked >= 0 above */
 
       LWIP_ASSERT("SNMP_MAX_VALUE_SIZE is configured too low", (vb->value_len & ~SNMP_GET_VALUE_RAW_DATA) <= SNMP_MAX_VALUE_SIZE);
-      err = snmp_append_outbound_varbind(&request->outbound_pbuf_stream, vb);
+      err = snmp_append_response_varbind(&request->outbound_pbuf_stream, vb);
 
       if (err == ERR_BUF) {
         request->error_status = SNMP_ERR_TOOBIG;
@@ -317,6 +415,14 @@ snmp_process_varbind(struct snmp_request *request, struct snmp_varbind *vb, u8_t
       node_instance.release_instance(&node_instance);
     }
   }
+
+#if SNMP_LWIP_RESPONSE_CACHE
+  /* exceptions are not cached, SNMPv1 reports them in the header instead of the varbind */
+  if ((request->error_status == SNMP_ERR_NOERROR) && ((vb->type & SNMP_ASN1_CLASS_CONTEXT) == 0)) {
+    snmp_cache_store(request_oid, request_oid_len, get_next, &vb->oid, vb->type,
+      request->outbound_pbuf, vb_offset, request->outbound_pbuf_stream.offset - vb_offset);
+  }
+#endif
 }
 
 
@@ -452,6 +558,12 @@ snmp_process_getbulk_request(struct snmp_request *request)
     repetition_offset = request->outbound_pbuf_stream.offset; /* for next loop */
 
     while (request->error_status == SNMP_ERR_NOERROR) {
+      if (request->outbound_pbuf_stream.length < SNMP_MIN_VARBIND_LEN) {
+        /* not even the smallest varbind fits anymore, save the lookup */
+        request->error_status = SNMP_ERR_TOOBIG;
+        break;
+      }
+
       vb.value = NULL; /* do NOT decode value (we enumerate outbound buffer here, so all varbinds have values assigned) */
       err = snmp_vb_enumerator_get_next(&repetition_varbind_enumerator, &vb);
       if (err == SNMP_VB_ENUMERATOR_ERR_OK) {
@@ -599,6 +711,82 @@ snmp_process_set_request(struct snmp_request *request)
 #define IF_PARSE_EXEC(code)   PARSE_EXEC(code, ERR_ARG)
 #define IF_PARSE_ASSERT(code) PARSE_ASSERT(code, ERR_ARG)
 
+#if LWIP_SNMP_V3
+/**
+ * RFC3414 3.2 steps 3 to 5: checks the engine ID, user name and security level.
+ *
+ * @return usmStats counter to report, 0 if the request may be processed
+ */
+static u8_t
+snmp_usm_check(const struct snmp_request *request)
+{
+  const char *engine_id;
+  u8_t engine_id_len;
+  u8_t auth_algo;
+  u8_t priv_algo;
+  u8_t key[20];
+  u8_t level = 0;
+
+  /* discovery requests come with an empty engine ID */
+  snmpv3_get_engine_id(&engine_id, &engine_id_len);
+  if ((request->msg_authoritative_engine_id_len != engine_id_len) ||
+      (memcmp(request->msg_authoritative_engine_id, engine_id, engine_id_len) != 0)) {
+    return SNMP_V3_USM_STATS_UNKNOWN_ENGINE_IDS;
+  }
+
+  if ((request->msg_user_name_len == 0) ||
+      (strlen((const char*)request->msg_user_name) != request->msg_user_name_len) ||
+      (snmpv3_get_user((const char*)request->msg_user_name, &auth_algo, key, &priv_algo, key) != ERR_OK)) {
+    return SNMP_V3_USM_STATS_UNKNOWN_USER_NAMES;
+  }
+
+  /* a user is only accepted with exactly the level it was configured for */
+  if (auth_algo != SNMP_V3_AUTH_ALGO_INVAL) {
+    level |= SNMP_V3_AUTH_FLAG;
+  }
+  if (priv_algo != SNMP_V3_PRIV_ALGO_INVAL) {
+    level |= SNMP_V3_PRIV_FLAG;
+  }
+  if ((request->msg_flags & (SNMP_V3_AUTH_FLAG | SNMP_V3_PRIV_FLAG)) != level) {
+    return SNMP_V3_USM_STATS_UNSUPPORTED_SEC_LEVELS;
+  }
+
+  return 0;
+}
+
+#if LWIP_SNMP_V3_CRYPTO
+/** RFC3414 3.2 step 7: the window around the local engine time */
+#define SNMP_USM_TIME_WINDOW 150
+
+/**
+ * RFC3414 3.2 step 7: checks the timeliness of an authenticated request,
+ * after its authentication passed.
+ *
+ * @return usmStats counter to report, 0 if the request is in the time window
+ */
+static u8_t
+snmp_usm_check_time(const struct snmp_request *request)
+{
+  u32_t boots = snmpv3_get_engine_boots();
+  s64_t skew = (s64_t)request->msg_authoritative_engine_time - (s64_t)snmpv3_get_engine_time();
+
+  /* boots latched at its maximum can't be in any window */
+  if ((boots >= 2147483647UL) || (request->msg_authoritative_engine_boots != (s32_t)boots) ||
+      (skew > SNMP_USM_TIME_WINDOW) || (skew < -SNMP_USM_TIME_WINDOW)) {
+    return SNMP_V3_USM_STATS_NOT_IN_TIME_WINDOWS;
+  }
+  return 0;
+}
+#endif
+
+/** RFC3412 7.1 3): only notInTimeWindows is reported authenticated, for the manager to take over the time */
+static u8_t
+snmp_usm_report_flags(const struct snmp_request *request)
+{
+  return (request->report == SNMP_V3_USM_STATS_NOT_IN_TIME_WINDOWS) ? SNMP_V3_AUTH_FLAG : 0;
+}
+#endif
+
 /**
  * Checks and decodes incoming SNMP message header, logs header errors.
  *
@@ -643,6 +831,12 @@ snmp_parse_inbound_frame(struct snmp_request *request)
   }
   request->version = (u8_t)s32_value;
 
+  if ((request->version < SNMP_VERSION_3) && !SNMPV3_COMMUNITY_ALLOWED()) {
+    /* communities are disabled by the engine */
+    snmp_stats.inbadversions++;
+    return ERR_ARG;
+  }
+
 #if LWIP_SNMP_V3
   if (request->version == SNMP_VERSION_3) {
     u16_t u16_value;
@@ -685,6 +879,8 @@ snmp_parse_inbound_frame(struct snmp_request *request)
 
     IF_PARSE_EXEC(snmp_asn1_dec_s32t(&pbuf_stream, tlv.value_len, &s32_value));
     request->msg_flags = (u8_t)s32_value;
+    /* RFC3412 7.2 5): privacy without authentication is invalid */
+    IF_PARSE_ASSERT((request->msg_flags & (SNMP_V3_AUTH_FLAG | SNMP_V3_PRIV_FLAG)) != SNMP_V3_PRIV_FLAG);
 
     /* decode msgSecurityModel */
     IF_PARSE_EXEC(snmp_asn1_dec_tlv(&pbuf_stream, &tlv));
@@ -736,7 +932,6 @@ snmp_parse_inbound_frame(struct snmp_request *request)
     parent_tlv_value_len -= SNMP_ASN1_TLV_LENGTH(tlv);
     IF_PARSE_ASSERT(parent_tlv_value_len > 0);
     IF_PARSE_EXEC(snmp_asn1_dec_s32t(&pbuf_stream, tlv.value_len, &request->msg_authoritative_engine_time));
-    /* @todo: Implement time window checking */
 
     /* msgUserName */
     IF_PARSE_EXEC(snmp_asn1_dec_tlv(&pbuf_stream, &tlv));
@@ -747,8 +942,13 @@ snmp_parse_inbound_frame(struct snmp_request *request)
     IF_PARSE_EXEC(snmp_asn1_dec_raw(&pbuf_stream, tlv.value_len, request->msg_user_name,
         &u16_value, SNMP_V3_MAX_USER_LENGTH));
     request->msg_user_name_len = (u8_t)u16_value;
-    /* @todo: Implement unknown user error response */
-    IF_PARSE_EXEC(snmpv3_get_user((char*)request->msg_user_name, NULL, NULL, NULL, NULL));
+    request->report = snmp_usm_check(request);
+    if (request->report != 0) {
+      snmpv3_usm_stats[request->report]++;
+      if (!(request->msg_flags & SNMP_V3_REPORT_FLAG)) {
+        return ERR_ARG;
+      }
+    }
 
     /* msgAuthenticationParameters */
     memset(request->msg_authentication_parameters, 0, SNMP_V3_MAX_AUTH_PARAM_LENGTH);
@@ -765,7 +965,7 @@ snmp_parse_inbound_frame(struct snmp_request *request)
         &u16_value, tlv.value_len));
 
 #if LWIP_SNMP_V3_CRYPTO
-    if (request->msg_flags & SNMP_V3_AUTH_FLAG) {
+    if ((request->report == 0) && (request->msg_flags & SNMP_V3_AUTH_FLAG)) {
       const u8_t zero_arr[SNMP_V3_MAX_AUTH_PARAM_LENGTH] = { 0 };
       u8_t key[20];
       u8_t algo;
@@ -782,9 +982,21 @@ snmp_parse_inbound_frame(struct snmp_request *request)
       IF_PARSE_EXEC(snmp_pbuf_stream_init(&auth_stream, request->inbound_pbuf, 0, request->inbound_pbuf->tot_len));
 
       IF_PARSE_EXEC(snmpv3_get_user((char*)request->msg_user_name, &algo, key, NULL, NULL));
-      IF_PARSE_EXEC(snmpv3_auth(&auth_stream, request->inbound_pbuf->tot_len, key, algo, hmac));
+      {
+        SNMPV3_TIMING_BEGIN(start);
+        IF_PARSE_EXEC(snmpv3_auth(&auth_stream, request->inbound_pbuf->tot_len, key, algo, hmac));
+        SNMPV3_TIMING_END(SNMPV3_TIMING_AUTH, start);
+      }
       /* @todo: Implement error response */
       IF_PARSE_EXEC(memcmp(request->msg_authentication_parameters, hmac, SNMP_V3_MAX_AUTH_PARAM_LENGTH));
+
+      request->report = snmp_usm_check_time(request);
+      if (request->report != 0) {
+        snmpv3_usm_stats[request->report]++;
+        if (!(request->msg_flags & SNMP_V3_REPORT_FLAG)) {
+          return ERR_ARG;
+        }
+      }
     }
 #else
     /* Ungraceful exit if we encounter cryptography and don't support it.
@@ -809,15 +1021,26 @@ snmp_parse_inbound_frame(struct snmp_request *request)
       u8_t key[20];
       u8_t algo;
 
+      if (request->report != 0) {
+        /* can't decrypt the scoped PDU, the report goes out without request ID */
+        request->request_type = SNMP_ASN1_CONTEXT_PDU_REPORT;
+        request->msg_flags = snmp_usm_report_flags(request);
+        return ERR_OK;
+      }
+
       IF_PARSE_EXEC(snmp_asn1_dec_tlv(&pbuf_stream, &tlv));
       IF_PARSE_ASSERT(tlv.type == SNMP_ASN1_TYPE_OCTET_STRING);
       parent_tlv_value_len -= SNMP_ASN1_TLV_HDR_LENGTH(tlv);
       IF_PARSE_ASSERT(parent_tlv_value_len > 0);
 
       IF_PARSE_EXEC(snmpv3_get_user((char*)request->msg_user_name, NULL, NULL, &algo, key));
-      IF_PARSE_EXEC(snmpv3_crypt(&pbuf_stream, tlv.value_len, key,
-          request->msg_privacy_parameters, request->msg_authoritative_engine_boots,
-          request->msg_authoritative_engine_time, algo, SNMP_V3_PRIV_MODE_DECRYPT));
+      {
+        SNMPV3_TIMING_BEGIN(start);
+        IF_PARSE_EXEC(snmpv3_crypt(&pbuf_stream, tlv.value_len, key,
+            request->msg_privacy_parameters, request->msg_authoritative_engine_boots,
+            request->msg_authoritative_engine_time, algo, SNMP_V3_PRIV_MODE_DECRYPT));
+        SNMPV3_TIMING_END(SNMPV3_TIMING_PRIV, start);
+      }
     }
 #endif
 
@@ -904,6 +1127,18 @@ snmp_parse_inbound_frame(struct snmp_request *request)
   }
   request->request_type = tlv.type & SNMP_ASN1_DATATYPE_MASK;
 
+#if LWIP_SNMP_V3
+  if (request->report != 0) {
+    /* RFC3412 7.1 3): the report only takes over the request ID */
+    IF_PARSE_EXEC(snmp_asn1_dec_tlv(&pbuf_stream, &tlv));
+    IF_PARSE_ASSERT(tlv.type == SNMP_ASN1_TYPE_INTEGER);
+    IF_PARSE_EXEC(snmp_asn1_dec_s32t(&pbuf_stream, tlv.value_len, &request->request_id));
+    request->request_type = SNMP_ASN1_CONTEXT_PDU_REPORT;
+    request->msg_flags = snmp_usm_report_flags(request);
+    return ERR_OK;
+  }
+#endif
+
   /* validate community (do this after decoding PDU type because we don't want to increase 'inbadcommunitynames' for wrong frame types */
   if (request->community_strlen == 0) {
     /* community string was too long or really empty*/
@@ -986,6 +1221,26 @@ snmp_parse_inbound_frame(struct snmp_request *request)
 
 #define OF_BUILD_EXEC(code) BUILD_EXEC(code, ERR_ARG)
 
+#if LWIP_SNMP_V3
+/** Appends the usmStats counter that caused the report as its only varbind. */
+static err_t
+snmp_append_report_varbind(struct snmp_request *request)
+{
+  static const u32_t usm_stats_oid[] = { 1, 3, 6, 1, 6, 3, 15, 1, 1, 0, 0 };
+  struct snmp_varbind vb;
+  u32_t value = snmpv3_usm_stats[request->report];
+
+  memset(&vb, 0, sizeof(vb));
+  snmp_oid_assign(&vb.oid, usm_stats_oid, LWIP_ARRAYSIZE(usm_stats_oid));
+  vb.oid.id[9] = request->report;
+  vb.type      = SNMP_ASN1_TYPE_COUNTER;
+  vb.value     = &value;
+  vb.value_len = sizeof(value);
+
+  return snmp_append_response_varbind(&request->outbound_pbuf_stream, &vb);
+}
+#endif
+
 static err_t
 snmp_prepare_outbound_frame(struct snmp_request *request)
 {
@@ -1152,7 +1407,7 @@ snmp_prepare_outbound_frame(struct snmp_request *request)
 
   /* 'PDU' sequence */
   request->outbound_pdu_offset = pbuf_stream->offset;
-  SNMP_ASN1_SET_TLV_PARAMS(tlv, (SNMP_ASN1_CLASS_CONTEXT | SNMP_ASN1_CONTENTTYPE_CONSTRUCTED | SNMP_ASN1_CONTEXT_PDU_GET_RESP), 3, 0);
+  SNMP_ASN1_SET_TLV_PARAMS(tlv, (SNMP_ASN1_CLASS_CONTEXT | SNMP_ASN1_CONTENTTYPE_CONSTRUCTED | SNMP_RESPONSE_PDU_TYPE(request)), 3, 0);
   OF_BUILD_EXEC( snmp_ans1_enc_tlv(pbuf_stream, &tlv) );
 
   /* request ID */
@@ -1182,25 +1437,21 @@ snmp_prepare_outbound_frame(struct snmp_request *request)
   return ERR_OK;
 }
 
-/** Calculate the length of a varbind list */
-err_t
-snmp_varbind_length(struct snmp_varbind *varbind, struct snmp_varbind_len *len)
+/** Calculate the length of a varbind value */
+static err_t
+snmp_varbind_value_length(struct snmp_varbind *varbind, u16_t *value_value_len)
 {
-  /* calculate required lengths */
-  snmp_asn1_enc_oid_cnt(varbind->oid.id, varbind->oid.len, &len->oid_value_len);
-  snmp_asn1_enc_length_cnt(len->oid_value_len, &len->oid_len_len);
-
   if (varbind->value_len == 0) {
-    len->value_value_len = 0;
+    *value_value_len = 0;
   } else if (varbind->value_len & SNMP_GET_VALUE_RAW_DATA) {
-    len->value_value_len = varbind->value_len & (~SNMP_GET_VALUE_RAW_DATA);
+    *value_value_len = varbind->value_len & (~SNMP_GET_VALUE_RAW_DATA);
   } else {
     switch (varbind->type) {
       case SNMP_ASN1_TYPE_INTEGER:
         if (varbind->value_len != sizeof (s32_t)) {
           return ERR_VAL;
         }
-        snmp_asn1_enc_s32t_cnt(*((s32_t*) varbind->value), &len->value_value_len);
+        snmp_asn1_enc_s32t_cnt(*((s32_t*) varbind->value), value_value_len);
         break;
       case SNMP_ASN1_TYPE_COUNTER:
       case SNMP_ASN1_TYPE_GAUGE:
@@ -1208,103 +1459,96 @@ snmp_varbind_length(struct snmp_varbind *varbind, struct snmp_varbind_len *len)
         if (varbind->value_len != sizeof (u32_t)) {
           return ERR_VAL;
         }
-        snmp_asn1_enc_u32t_cnt(*((u32_t*) varbind->value), &len->value_value_len);
+        snmp_asn1_enc_u32t_cnt(*((u32_t*) varbind->value), value_value_len);
         break;
       case SNMP_ASN1_TYPE_OCTET_STRING:
       case SNMP_ASN1_TYPE_IPADDR:
       case SNMP_ASN1_TYPE_OPAQUE:
-        len->value_value_len = varbind->value_len;
+        *value_value_len = varbind->value_len;
         break;
       case SNMP_ASN1_TYPE_NULL:
         if (varbind->value_len != 0) {
           return ERR_VAL;
         }
-        len->value_value_len = 0;
+        *value_value_len = 0;
         break;
       case SNMP_ASN1_TYPE_OBJECT_ID:
         if ((varbind->value_len & 0x03) != 0) {
           return ERR_VAL;
         }
-        snmp_asn1_enc_oid_cnt((u32_t*) varbind->value, varbind->value_len >> 2, &len->value_value_len);
+        snmp_asn1_enc_oid_cnt((u32_t*) varbind->value, varbind->value_len >> 2, value_value_len);
         break;
       case SNMP_ASN1_TYPE_COUNTER64:
         if (varbind->value_len != (2 * sizeof (u32_t))) {
           return ERR_VAL;
         }
-        snmp_asn1_enc_u64t_cnt((u32_t*) varbind->value, &len->value_value_len);
+        snmp_asn1_enc_u64t_cnt((u32_t*) varbind->value, value_value_len);
         break;
       default:
         /* unsupported type */
         return ERR_VAL;
     }
   }
-  snmp_asn1_enc_length_cnt(len->value_value_len, &len->value_len_len);
-
-  len->vb_value_len = 1 + len->oid_len_len + len->oid_value_len + 1 + len->value_len_len + len->value_value_len;
-  snmp_asn1_enc_length_cnt(len->vb_value_len, &len->vb_len_len);
 
   return ERR_OK;
 }
 
-#define OVB_BUILD_EXEC(code) BUILD_EXEC(code, ERR_ARG)
-
+/** Calculate the length of a varbind list */
 err_t
-snmp_append_outbound_varbind(struct snmp_pbuf_stream *pbuf_stream, struct snmp_varbind* varbind)
+snmp_varbind_length(struct snmp_varbind *varbind, struct snmp_varbind_len *len)
 {
-  struct snmp_asn1_tlv tlv;
-  struct snmp_varbind_len len;
   err_t err;
 
-  err = snmp_varbind_length(varbind, &len);
+  /* calculate required lengths */
+  snmp_asn1_enc_oid_cnt(varbind->oid.id, varbind->oid.len, &len->oid_value_len);
+  snmp_asn1_enc_length_cnt(len->oid_value_len, &len->oid_len_len);
 
+  err = snmp_varbind_value_length(varbind, &len->value_value_len);
   if (err != ERR_OK) {
     return err;
   }
+  snmp_asn1_enc_length_cnt(len->value_value_len, &len->value_len_len);
 
-  /* check length already before adding first data because in case of GetBulk,
-   *  data added so far is returned and therefore no partial data shall be added
-   */
-  if ((1 + len.vb_len_len + len.vb_value_len) > pbuf_stream->length) {
-    return ERR_BUF;
-  }
+  len->vb_value_len = 1 + len->oid_len_len + len->oid_value_len + 1 + len->value_len_len + len->value_value_len;
+  snmp_asn1_enc_length_cnt(len->vb_value_len, &len->vb_len_len);
 
-  /* 'VarBind' sequence */
-  SNMP_ASN1_SET_TLV_PARAMS(tlv, SNMP_ASN1_TYPE_SEQUENCE, len.vb_len_len, len.vb_value_len);
-  OVB_BUILD_EXEC(snmp_ans1_enc_tlv(pbuf_stream, &tlv));
+  return ERR_OK;
+}
 
-  /* VarBind OID */
-  SNMP_ASN1_SET_TLV_PARAMS(tlv, SNMP_ASN1_TYPE_OBJECT_ID, len.oid_len_len, len.oid_value_len);
-  OVB_BUILD_EXEC(snmp_ans1_enc_tlv(pbuf_stream, &tlv));
-  OVB_BUILD_EXEC(snmp_asn1_enc_oid(pbuf_stream, varbind->oid.id, varbind->oid.len));
+#define OVB_BUILD_EXEC(code) BUILD_EXEC(code, ERR_ARG)
 
-  /* VarBind value */
-  SNMP_ASN1_SET_TLV_PARAMS(tlv, varbind->type, len.value_len_len, len.value_value_len);
+/** Append the value TLV of a varbind, value_value_len is taken from snmp_varbind_value_length() */
+static err_t
+snmp_append_varbind_value(struct snmp_pbuf_stream *pbuf_stream, struct snmp_varbind* varbind, u8_t value_len_len, u16_t value_value_len)
+{
+  struct snmp_asn1_tlv tlv;
+
+  SNMP_ASN1_SET_TLV_PARAMS(tlv, varbind->type, value_len_len, value_value_len);
   OVB_BUILD_EXEC(snmp_ans1_enc_tlv(pbuf_stream, &tlv));
 
-  if (len.value_value_len > 0) {
+  if (value_value_len > 0) {
     if (varbind->value_len & SNMP_GET_VALUE_RAW_DATA) {
-      OVB_BUILD_EXEC(snmp_asn1_enc_raw(pbuf_stream, (u8_t*) varbind->value, len.value_value_len));
+      OVB_BUILD_EXEC(snmp_asn1_enc_raw(pbuf_stream, (u8_t*) varbind->value, value_value_len));
     } else {
       switch (varbind->type) {
         case SNMP_ASN1_TYPE_INTEGER:
-          OVB_BUILD_EXEC(snmp_asn1_enc_s32t(pbuf_stream, len.value_value_len, *((s32_t*) varbind->value)));
+          OVB_BUILD_EXEC(snmp_asn1_enc_s32t(pbuf_stream, value_value_len, *((s32_t*) varbind->value)));
           break;
         case SNMP_ASN1_TYPE_COUNTER:
         case SNMP_ASN1_TYPE_GAUGE:
         case SNMP_ASN1_TYPE_TIMETICKS:
-          OVB_BUILD_EXEC(snmp_asn1_enc_u32t(pbuf_stream, len.value_value_len, *((u32_t*) varbind->value)));
+          OVB_BUILD_EXEC(snmp_asn1_enc_u32t(pbuf_stream, value_value_len, *((u32_t*) varbind->value)));
           break;
         case SNMP_ASN1_TYPE_OCTET_STRING:
         case SNMP_ASN1_TYPE_IPADDR:
         case SNMP_ASN1_TYPE_OPAQUE:
-          OVB_BUILD_EXEC(snmp_asn1_enc_raw(pbuf_stream, (u8_t*) varbind->value, len.value_value_len));
-          len.value_value_len = varbind->value_len;
+          OVB_BUILD_EXEC(snmp_asn1_enc_raw(pbuf_stream, (u8_t*) varbind->value, value_value_len));
           break;
         case SNMP_ASN1_TYPE_OBJECT_ID:
           OVB_BUILD_EXEC(snmp_asn1_enc_oid(pbuf_stream, (u32_t*) varbind->value, varbind->value_len / sizeof (u32_t)));
           break;
         case SNMP_ASN1_TYPE_COUNTER64:
-          OVB_BUILD_EXEC(snmp_asn1_enc_u64t(pbuf_stream, len.value_value_len, (u32_t*) varbind->value));
+          OVB_BUILD_EXEC(snmp_asn1_enc_u64t(pbuf_stream, value_value_len, (u32_t*) varbind->value));
           break;
         default:
           LWIP_ASSERT("Unknown variable type", 0);
@@ -1316,6 +1560,114 @@ snmp_append_outbound_varbind(struct snmp_pbuf_stream *pbuf_stream, struct snmp_v
   return ERR_OK;
 }
 
+err_t
+snmp_append_outbound_varbind(struct snmp_pbuf_stream *pbuf_stream, struct snmp_varbind* varbind)
+{
+  struct snmp_asn1_tlv tlv;
+  struct snmp_varbind_len len;
+  err_t err;
+
+  err = snmp_varbind_length(varbind, &len);
+
+  if (err != ERR_OK) {
+    return err;
+  }
+
+  /* check length already before adding first data because in case of GetBulk,
+   *  data added so far is returned and therefore no partial data shall be added
+   */
+  if ((1 + len.vb_len_len + len.vb_value_len) > pbuf_stream->length) {
+    return ERR_BUF;
+  }
+
+  /* 'VarBind' sequence */
+  SNMP_ASN1_SET_TLV_PARAMS(tlv, SNMP_ASN1_TYPE_SEQUENCE, len.vb_len_len, len.vb_value_len);
+  OVB_BUILD_EXEC(snmp_ans1_enc_tlv(pbuf_stream, &tlv));
+
+  /* VarBind OID */
+  SNMP_ASN1_SET_TLV_PARAMS(tlv, SNMP_ASN1_TYPE_OBJECT_ID, len.oid_len_len, len.oid_value_len);
+  OVB_BUILD_EXEC(snmp_ans1_enc_tlv(pbuf_stream, &tlv));
+  OVB_BUILD_EXEC(snmp_asn1_enc_oid(pbuf_stream, varbind->oid.id, varbind->oid.len));
+
+  /* VarBind value */
+  return snmp_append_varbind_value(pbuf_stream, varbind, len.value_len_len, len.value_value_len);
+}
+
+/** Rewrite a TLV header written before with the final value length */
+static err_t
+snmp_patch_outbound_tlv(struct pbuf *p, u16_t offset, u8_t type, u8_t length_len, u16_t value_len)
+{
+  struct snmp_pbuf_stream patch_stream;
+  struct snmp_asn1_tlv tlv;
+
+  OVB_BUILD_EXEC(snmp_pbuf_stream_init(&patch_stream, p, offset, 1 + length_len));
+  SNMP_ASN1_SET_TLV_PARAMS(tlv, type, length_len, value_len);
+  OVB_BUILD_EXEC(snmp_ans1_enc_tlv(&patch_stream, &tlv));
+
+  return ERR_OK;
+}
+
+/**
+ * Append a varbind to a response in a single pass.
+ *
+ * Unlike snmp_append_outbound_varbind() the OID is not counted before it
+ * is encoded: the 'VarBind' and OID headers are sized from an upper bound
+ * and their lengths are patched once the content is written. If the bound
+ * is larger than the exact length the header may use the long form with a
+ * non-minimal length, which is valid BER. Traps can't use this because
+ * they sum up the exact varbind lengths before encoding.
+ */
+err_t
+snmp_append_response_varbind(struct snmp_pbuf_stream *pbuf_stream, struct snmp_varbind* varbind)
+{
+  u16_t value_value_len;
+  u16_t oid_max_len;
+  u16_t vb_max_len;
+  u16_t vb_offset;
+  u16_t oid_offset;
+  u8_t value_len_len;
+  u8_t oid_len_len;
+  u8_t vb_len_len;
+  err_t err;
+
+  if (varbind->oid.len < 2) {
+    return ERR_ARG;
+  }
+
+  err = snmp_varbind_value_length(varbind, &value_value_len);
+  if (err != ERR_OK) {
+    return err;
+  }
+  snmp_asn1_enc_length_cnt(value_value_len, &value_len_len);
+
+  oid_max_len = SNMP_ASN1_OID_MAX_ENC_LEN(varbind->oid.len);
+  snmp_asn1_enc_length_cnt(oid_max_len, &oid_len_len);
+  vb_max_len = 1 + oid_len_len + oid_max_len + 1 + value_len_len + value_value_len;
+  snmp_asn1_enc_length_cnt(vb_max_len, &vb_len_len);
+
+  if ((1 + vb_len_len + vb_max_len) > pbuf_stream->length) {
+    /* the bound doesn't fit, the exact length might (GetBulk fills up the response) */
+    return snmp_append_outbound_varbind(pbuf_stream, varbind);
+  }
+
+  /* 'VarBind' sequence, header is written at the end */
+  vb_offset = pbuf_stream->offset;
+  OVB_BUILD_EXEC(snmp_pbuf_stream_seek(pbuf_stream, 1 + vb_len_len));
+
+  /* VarBind OID */
+  oid_offset = pbuf_stream->offset;
+  OVB_BUILD_EXEC(snmp_pbuf_stream_seek(pbuf_stream, 1 + oid_len_len));
+  OVB_BUILD_EXEC(snmp_asn1_enc_oid(pbuf_stream, varbind->oid.id, varbind->oid.len));
+  OVB_BUILD_EXEC(snmp_patch_outbound_tlv(pbuf_stream->pbuf, oid_offset, SNMP_ASN1_TYPE_OBJECT_ID, oid_len_len,
+      pbuf_stream->offset - oid_offset - 1 - oid_len_len));
+
+  /* VarBind value */
+  OVB_BUILD_EXEC(snmp_append_varbind_value(pbuf_stream, varbind, value_len_len, value_value_len));
+
+  return snmp_patch_outbound_tlv(pbuf_stream->pbuf, vb_offset, SNMP_ASN1_TYPE_SEQUENCE, vb_len_len,
+      pbuf_stream->offset - vb_offset - 1 - vb_len_len);
+}
+
 static err_t
 snmp_complete_outbound_frame(struct snmp_request *request)
 {
@@ -1433,7 +1785,7 @@ snmp_complete_outbound_frame(struct snmp_request *request)
 #endif
 
   /* complete missing length in 'PDU' sequence */
-  SNMP_ASN1_SET_TLV_PARAMS(tlv, (SNMP_ASN1_CLASS_CONTEXT | SNMP_ASN1_CONTENTTYPE_CONSTRUCTED | SNMP_ASN1_CONTEXT_PDU_GET_RESP), 3,
+  SNMP_ASN1_SET_TLV_PARAMS(tlv, (SNMP_ASN1_CLASS_CONTEXT | SNMP_ASN1_CONTENTTYPE_CONSTRUCTED | SNMP_RESPONSE_PDU_TYPE(request)), 3,
       frame_size - request->outbound_pdu_offset - 1 - 3); /* - type - length_len(fixed, see snmp_prepare_outbound_frame()) */
   OF_BUILD_EXEC( snmp_pbuf_stream_seek_abs(&(request->outbound_pbuf_stream), request->outbound_pdu_offset) );
   OF_BUILD_EXEC( snmp_ans1_enc_tlv(&(request->outbound_pbuf_stream), &tlv) );
@@ -1513,9 +1865,13 @@ snmp_complete_outbound_frame(struct snmp_request *request)
 
     OF_BUILD_EXEC(snmpv3_get_user((char*)request->msg_user_name, NULL, NULL, &algo, key));
 
-    OF_BUILD_EXEC(snmpv3_crypt(&request->outbound_pbuf_stream, tlv.value_len, key,
-        request->msg_privacy_parameters, request->msg_authoritative_engine_boots,
-        request->msg_authoritative_engine_time, algo, SNMP_V3_PRIV_MODE_ENCRYPT));
+    {
+      SNMPV3_TIMING_BEGIN(start);
+      OF_BUILD_EXEC(snmpv3_crypt(&request->outbound_pbuf_stream, tlv.value_len, key,
+          request->msg_privacy_parameters, request->msg_authoritative_engine_boots,
+          request->msg_authoritative_engine_time, algo, SNMP_V3_PRIV_MODE_ENCRYPT));
+      SNMPV3_TIMING_END(SNMPV3_TIMING_PRIV, start);
+    }
   }
 
   if (request->version == SNMP_VERSION_3 && (request->msg_flags & SNMP_V3_AUTH_FLAG)) {
@@ -1526,7 +1882,11 @@ snmp_complete_outbound_frame(struct snmp_request *request)
     OF_BUILD_EXEC(snmpv3_get_user((char*)request->msg_user_name, &algo, key, NULL, NULL));
     OF_BUILD_EXEC(snmp_pbuf_stream_init(&(request->outbound_pbuf_stream),
         request->outbound_pbuf, 0, request->outbound_pbuf->tot_len));
-    OF_BUILD_EXEC(snmpv3_auth(&request->outbound_pbuf_stream, frame_size + outbound_padding, key, algo, hmac));
+    {
+      SNMPV3_TIMING_BEGIN(start);
+      OF_BUILD_EXEC(snmpv3_auth(&request->outbound_pbuf_stream, frame_size + outbound_padding, key, algo, hmac));
+      SNMPV3_TIMING_END(SNMPV3_TIMING_AUTH, start);
+    }
 
     MEMCPY(request->msg_authentication_parameters, hmac, SNMP_V3_MAX_AUTH_PARAM_LENGTH);
     OF_BUILD_EXEC(snmp_pbuf_stream_init(&request->outbound_pbuf_stream,
@@ -1564,6 +1924,28 @@ snmp_execute_write_callbacks(struct snmp_request *request)
 }
 
 
+#if SNMP_LWIP_RESPONSE_CACHE
+/** Decodes the OID and type of the last varbind in len bytes at offset of p, returns 0 if there is none */
+static u8_t
+snmp_msg_last_oid(struct pbuf *p, u16_t offset, u16_t len, struct snmp_varbind *vb)
+{
+  struct snmp_varbind_enumerator enumerator;
+  snmp_vb_enumerator_err_t err;
+  u8_t found = 0;
+
+  snmp_vb_enumerator_init(&enumerator, p, offset, len);
+  do {
+    vb->value = NULL; /* skip the values */
+    err = snmp_vb_enumerator_get_next(&enumerator, vb);
+    if (err == SNMP_VB_ENUMERATOR_ERR_OK) {
+      found = 1;
+    }
+  } while (err == SNMP_VB_ENUMERATOR_ERR_OK);
+
+  return found && (err == SNMP_VB_ENUMERATOR_ERR_EOVB);
+}
+#endif
+
 /* ----------------------------------------------------------------------- */
 /* VarBind enumerator methods */
 /* ----------------------------------------------------------------------- */
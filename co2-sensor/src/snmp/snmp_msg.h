@@ -125,7 +125,8 @@ struct snmp_request
   u8_t  msg_authoritative_engine_id_len;
   s32_t msg_authoritative_engine_boots;
   s32_t msg_authoritative_engine_time;
-  u8_t  msg_user_name[SNMP_V3_MAX_USER_LENGTH];
+  /* zero terminated */
+  u8_t  msg_user_name[SNMP_V3_MAX_USER_LENGTH + 1];
   u8_t  msg_user_name_len;
   u8_t  msg_authentication_parameters[SNMP_V3_MAX_AUTH_PARAM_LENGTH];
   u8_t  msg_privacy_parameters[SNMP_V3_MAX_PRIV_PARAM_LENGTH];
@@ -133,6 +134,8 @@ struct snmp_request
   u8_t  context_engine_id_len;
   u8_t  context_name[SNMP_V3_MAX_ENGINE_ID_LENGTH];
   u8_t  context_name_len;
+  /* usmStats counter sent back in a report instead of processing the PDU, 0 if none */
+  u8_t  report;
 #endif
 
   struct pbuf *inbound_pbuf;
@@ -184,6 +187,7 @@ err_t snmp_sendto(void *handle, struct pbuf *p, const ip_addr_t *dst, u16_t port
 u8_t snmp_get_local_ip_for_dst(void* handle, const ip_addr_t *dst, ip_addr_t *result);
 err_t snmp_varbind_length(struct snmp_varbind *varbind, struct snmp_varbind_len *len);
 err_t snmp_append_outbound_varbind(struct snmp_pbuf_stream *pbuf_stream, struct snmp_varbind* varbind);
+err_t snmp_append_response_varbind(struct snmp_pbuf_stream *pbuf_stream, struct snmp_varbind* varbind);
 
 #ifdef __cplusplus
 }
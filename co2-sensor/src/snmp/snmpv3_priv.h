@@ -50,6 +50,15 @@
 
 #define SNMP_V3_AUTH_FLAG      0x01
 #define SNMP_V3_PRIV_FLAG      0x02
+#define SNMP_V3_REPORT_FLAG    0x04
+
+/* RFC3414 usmStats counters (last sub-id of 1.3.6.1.6.3.15.1.1) */
+#define SNMP_V3_USM_STATS_UNSUPPORTED_SEC_LEVELS  1
+#define SNMP_V3_USM_STATS_NOT_IN_TIME_WINDOWS     2
+#define SNMP_V3_USM_STATS_UNKNOWN_USER_NAMES      3
+#define SNMP_V3_USM_STATS_UNKNOWN_ENGINE_IDS      4
+#define SNMP_V3_USM_STATS_WRONG_DIGESTS           5
+#define SNMP_V3_USM_STATS_DECRYPTION_ERRORS       6
 
 #define SNMP_V3_MD5_LEN        16
 #define SNMP_V3_SHA_LEN        20
@@ -0,0 +1,257 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * SNMPv3 engine and user table, replaces snmp/snmpv3_dummy.c.
+ */
+
+#include "lwip/apps/snmp_opts.h"
+#if LWIP_SNMP && LWIP_SNMP_V3
+
+#include "snmpv3-users.h"
+#include <string.h>
+#include <esp_timer.h>
+
+#define SNMPV3_PASSWORD_MIN_LEN 8
+
+static struct snmpv3_user users[SNMPV3_USERS_MAX];
+static u8_t users_len;
+/* v1/v2c communities are refused while a user exists */
+static u8_t users_v3_only = 1;
+
+static struct snmpv3_timing timings[2];
+
+/* RFC 3411 snmpEngineID: enterprise 58049 followed by the MAC address */
+static u8_t engine_id[SNMPV3_ENGINE_ID_LEN] = { 0x80, 0x00, 0xe2, 0xc1, 0x03 };
+static u32_t engine_boots;
+/* esp_timer is 64 bit, sys_now() in ms would wrap after 49.7 days */
+static int64_t engine_time_start_us;
+
+void snmpv3_users_init(const u8_t *mac, u32_t boots)
+{
+    MEMCPY(&engine_id[5], mac, 6);
+    engine_boots = boots;
+    engine_time_start_us = esp_timer_get_time();
+}
+
+void snmpv3_users_get_engine_id(const u8_t **id, u8_t *len)
+{
+    *id = engine_id;
+    *len = sizeof(engine_id);
+}
+
+void snmpv3_users_clear(void)
+{
+    memset(users, 0, sizeof(users));
+    users_len = 0;
+}
+
+u8_t snmpv3_users_count(void)
+{
+    return users_len;
+}
+
+const struct snmpv3_user *snmpv3_users_get(u8_t index)
+{
+    return index < users_len ? &users[index] : NULL;
+}
+
+/* a user with the same name is replaced */
+err_t snmpv3_users_add(const struct snmpv3_user *user)
+{
+    u8_t i;
+
+    if (user->name[0] == '\0') {
+        return ERR_VAL;
+    }
+
+    for (i = 0; i < users_len; i++) {
+        if (strcmp(users[i].name, user->name) == 0) {
+            break;
+        }
+    }
+
+    if (i == users_len) {
+        if (users_len >= SNMPV3_USERS_MAX) {
+            return ERR_MEM;
+        }
+        users_len++;
+    }
+
+    MEMCPY(&users[i], user, sizeof(*user));
+    return ERR_OK;
+}
+
+static err_t localize_key(u8_t algo, const char *password, u8_t *key)
+{
+    size_t len = strlen(password);
+
+    if (len < SNMPV3_PASSWORD_MIN_LEN || len > 0xff) {
+        return ERR_VAL;
+    }
+
+    /* 1 MB of hashing, only done when a user is configured */
+    if (algo == SNMP_V3_AUTH_ALGO_MD5) {
+        snmpv3_password_to_key_md5((const u8_t *)password, (u8_t)len, engine_id, sizeof(engine_id), key);
+    } else if (algo == SNMP_V3_AUTH_ALGO_SHA) {
+        snmpv3_password_to_key_sha((const u8_t *)password, (u8_t)len, engine_id, sizeof(engine_id), key);
+    } else {
+        return ERR_VAL;
+    }
+
+    return ERR_OK;
+}
+
+/* the privacy key is derived with the hash function of the authentication protocol (RFC 3414 2.6) */
+err_t snmpv3_users_add_password(const char *name, u8_t auth_algo, const char *auth_password, u8_t priv_algo, const char *priv_password)
+{
+    struct snmpv3_user user;
+
+    memset(&user, 0, sizeof(user));
+    if (strlen(name) > SNMPV3_USER_NAME_LEN) {
+        return ERR_VAL;
+    }
+    strcpy(user.name, name);
+
+    user.auth_algo = auth_algo;
+    if (localize_key(auth_algo, auth_password, user.auth_key) != ERR_OK) {
+        return ERR_VAL;
+    }
+
+    user.priv_algo = priv_algo;
+    if (priv_algo != SNMP_V3_PRIV_ALGO_INVAL &&
+        localize_key(auth_algo, priv_password, user.priv_key) != ERR_OK) {
+        return ERR_VAL;
+    }
+
+    return snmpv3_users_add(&user);
+}
+
+void snmpv3_users_set_v3_only(u8_t v3_only)
+{
+    users_v3_only = v3_only;
+}
+
+u8_t snmpv3_users_get_v3_only(void)
+{
+    return users_v3_only;
+}
+
+u8_t snmpv3_users_community_allowed(void)
+{
+    return !users_v3_only || users_len == 0;
+}
+
+u32_t snmpv3_timing_now(void)
+{
+    return (u32_t)esp_timer_get_time();
+}
+
+void snmpv3_timing_record(u8_t kind, u32_t start_us)
+{
+    struct snmpv3_timing *timing = &timings[kind];
+    u32_t duration = snmpv3_timing_now() - start_us;
+
+    timing->count++;
+    timing->total_us += duration;
+    if (duration > timing->max_us) {
+        timing->max_us = duration;
+    }
+}
+
+const struct snmpv3_timing *snmpv3_timing_get(u8_t kind)
+{
+    return &timings[kind];
+}
+
+/* --- lwIP snmpv3 engine callbacks ----------------------------------------- */
+
+err_t snmpv3_get_user(const char *username, u8_t *auth_algo, u8_t *auth_key, u8_t *priv_algo, u8_t *priv_key)
+{
+    const struct snmpv3_user *user = NULL;
+
+    for (u8_t i = 0; i < users_len; i++) {
+        if (strcmp(users[i].name, username) == 0) {
+            user = &users[i];
+            break;
+        }
+    }
+
+    if (user == NULL) {
+        return ERR_VAL;
+    }
+
+    if (auth_key != NULL) {
+        MEMCPY(auth_key, user->auth_key, SNMPV3_KEY_LEN);
+        *auth_algo = user->auth_algo;
+    }
+    if (priv_key != NULL) {
+        MEMCPY(priv_key, user->priv_key, SNMPV3_KEY_LEN);
+        *priv_algo = user->priv_algo;
+    }
+    return ERR_OK;
+}
+
+void snmpv3_get_engine_id(const char **id, u8_t *len)
+{
+    *id = (const char *)engine_id;
+    *len = sizeof(engine_id);
+}
+
+/* the engine id is derived from the MAC address and can not be changed */
+err_t snmpv3_set_engine_id(const char *id, u8_t len)
+{
+    LWIP_UNUSED_ARG(id);
+    LWIP_UNUSED_ARG(len);
+    return ERR_VAL;
+}
+
+u32_t snmpv3_get_engine_boots(void)
+{
+    return engine_boots;
+}
+
+void snmpv3_set_engine_boots(u32_t boots)
+{
+    engine_boots = boots;
+}
+
+/*
+ * RFC 3414 2.2.2: before snmpEngineTime would pass 2^31-1 it starts over
+ * and snmpEngineBoots goes up, which then stays at 2^31-1. saveSnmpv3Boots()
+ * in main.cpp persists the new boots.
+ */
+u32_t snmpv3_get_engine_time(void)
+{
+    int64_t seconds = (esp_timer_get_time() - engine_time_start_us) / 1000000;
+
+    if (seconds >= SNMPV3_ENGINE_MAX) {
+        engine_time_start_us += seconds * 1000000;
+        seconds = 0;
+        if (engine_boots < SNMPV3_ENGINE_MAX) {
+            engine_boots++;
+        }
+    }
+    return (u32_t)seconds;
+}
+
+void snmpv3_reset_engine_time(void)
+{
+    engine_time_start_us = esp_timer_get_time();
+}
+
+#endif /* LWIP_SNMP && LWIP_SNMP_V3 */
@@ -0,0 +1,333 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "storage.h"
+#include "flash-wear.h"
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <SD.h>
+#include <SPIFFS.h>
+#include <string.h>
+
+const char *SpiffsStorage::name() const
+{
+    return "SPIFFS";
+}
+
+bool SpiffsStorage::mount(bool format)
+{
+    return SPIFFS.begin(format);
+}
+
+void SpiffsStorage::unmount()
+{
+    SPIFFS.end();
+}
+
+fs::FS &SpiffsStorage::fs()
+{
+    return SPIFFS;
+}
+
+const char *LittleFsStorage::name() const
+{
+    return "LittleFS";
+}
+
+bool LittleFsStorage::mount(bool format)
+{
+    // the partition keeps its label from the SPIFFS partition table
+    return LittleFS.begin(format, "/littlefs", 10, "spiffs");
+}
+
+void LittleFsStorage::unmount()
+{
+    LittleFS.end();
+}
+
+fs::FS &LittleFsStorage::fs()
+{
+    return LittleFS;
+}
+
+const char *MemoryStorage::name() const
+{
+    return "memory";
+}
+
+bool MemoryStorage::mount(bool format)
+{
+    if (format)
+    {
+        memory.clear();
+    }
+    return true;
+}
+
+void MemoryStorage::unmount()
+{
+}
+
+fs::FS &MemoryStorage::fs()
+{
+    return memory;
+}
+
+SdStorage::SdStorage(RemovableVolume &volume) : volume(volume)
+{
+}
+
+const char *SdStorage::name() const
+{
+    return "SD card";
+}
+
+bool SdStorage::mount(bool /* format */)
+{
+    return volume.mount();
+}
+
+void SdStorage::unmount()
+{
+    // the data log keeps using the card
+}
+
+fs::FS &SdStorage::fs()
+{
+    return SD;
+}
+
+bool copyStorage(fs::FS &from, const char *fromPrefix, fs::FS &to, const char *toPrefix)
+{
+    uint8_t buffer[STORAGE_COPY_BUFFER];
+    char path[STORAGE_PATH_MAX];
+    size_t prefixLen = strlen(fromPrefix);
+    bool copied = true;
+    File root = from.open("/");
+
+    if (!root || !root.isDirectory())
+    {
+        return false;
+    }
+
+    for (File file = root.openNextFile(); file; file = root.openNextFile())
+    {
+        if (file.isDirectory() || strncmp(file.path(), fromPrefix, prefixLen) != 0)
+        {
+            continue;
+        }
+
+        // a short read is an error, not the end of the file
+        size_t size = file.size();
+        size_t done = 0;
+        size_t len;
+        int pathLen = snprintf(path, sizeof(path), "%s%s", toPrefix, file.path() + prefixLen);
+        File copy = pathLen < (int)sizeof(path) ? to.open(path, FILE_WRITE) : File();
+        copied = copied && copy;
+        while (copy && done < size && (len = file.read(buffer, sizeof(buffer))) > 0)
+        {
+            copied = copy.write(buffer, len) == len && copied;
+            done += len;
+        }
+        copied = copied && done == size;
+        copy.close();
+        file.close();
+    }
+    root.close();
+    return copied;
+}
+
+// removes the staged files, then the marker, a start after a reset in between copies the rest again
+static bool removeStaged(fs::FS &stage)
+{
+    size_t prefixLen = strlen(STORAGE_STAGE_PREFIX);
+    char path[STORAGE_PATH_MAX];
+
+    // one at a time, the directory is not listed while it changes
+    for (;;)
+    {
+        File root = stage.open("/");
+        path[0] = '\0';
+        for (File file = root.openNextFile(); file && path[0] == '\0'; file = root.openNextFile())
+        {
+            if (!file.isDirectory() && strncmp(file.path(), STORAGE_STAGE_PREFIX, prefixLen) == 0)
+            {
+                strncpy(path, file.path(), sizeof(path) - 1);
+                path[sizeof(path) - 1] = '\0';
+            }
+            file.close();
+        }
+        root.close();
+
+        if (path[0] == '\0')
+        {
+            return !stage.exists(STORAGE_STAGE_DONE) || stage.remove(STORAGE_STAGE_DONE);
+        }
+        if (!stage.remove(path))
+        {
+            return false;
+        }
+    }
+}
+
+// copies the files of legacy to stage and marks the copy complete
+static bool stageFiles(fs::FS &legacy, fs::FS &stage)
+{
+    if (!removeStaged(stage) || !copyStorage(legacy, "/", stage, STORAGE_STAGE_PREFIX))
+    {
+        return false;
+    }
+
+    File done = stage.open(STORAGE_STAGE_DONE, FILE_WRITE);
+    bool marked = done && done.write((const uint8_t *)"1", 1) == 1;
+    done.close();
+    return marked;
+}
+
+// formats primary and copies the staged files to it, from here on a reset continues at the next start
+static StorageBackend &finishMove(StorageBackend &primary, StorageBackend &stage, MemoryStorage &scratch)
+{
+    Serial.printf("Moving the settings from %s to %s\n", stage.name(), primary.name());
+    if (primary.mount(true) && copyStorage(stage.fs(), STORAGE_STAGE_PREFIX, primary.fs(), "/"))
+    {
+        if (!removeStaged(stage.fs()))
+        {
+            Serial.printf("The settings staged on %s could not be removed\n", stage.name());
+        }
+        stage.unmount();
+        return primary;
+    }
+
+    // the staged files stay for the next start, until then the settings are used from memory
+    copyStorage(stage.fs(), STORAGE_STAGE_PREFIX, scratch.fs(), "/");
+    stage.unmount();
+    return scratch;
+}
+
+StorageBackend &mountStorage(StorageBackend &primary, StorageBackend &legacy, MemoryStorage &scratch,
+                             StorageBackend *stage)
+{
+    scratch.mount(true);
+    if (stage != NULL && !stage->mount(false))
+    {
+        stage = NULL;
+    }
+
+    // a move interrupted by a reset, the partition may be formatted already
+    if (stage != NULL && stage->fs().exists(STORAGE_STAGE_DONE))
+    {
+        return finishMove(primary, *stage, scratch);
+    }
+
+    if (primary.mount(false))
+    {
+        if (stage != NULL)
+        {
+            stage->unmount();
+        }
+        return primary;
+    }
+
+    if (legacy.mount(false))
+    {
+        // the partition is only formatted once its files are safe elsewhere
+        bool staged = stage != NULL && stageFiles(legacy.fs(), stage->fs());
+        if (!staged)
+        {
+            if (stage != NULL)
+            {
+                stage->unmount();
+            }
+            Serial.printf("The settings stay on %s until they can be staged\n", legacy.name());
+            return legacy;
+        }
+        legacy.unmount();
+        return finishMove(primary, *stage, scratch);
+    }
+
+    if (stage != NULL)
+    {
+        stage->unmount();
+    }
+    return primary.mount(true) ? primary : scratch;
+}
+
+struct benchTime
+{
+    uint32_t total;
+    uint32_t max;
+    // bytes of the flash erased and written
+    uint32_t erased;
+    uint32_t written;
+};
+
+static void addTime(struct benchTime *time, uint32_t start, const struct flash_wear *before)
+{
+    struct flash_wear after;
+    uint32_t us = micros() - start;
+
+    flash_wear_read(&after);
+    time->total += us;
+    time->max = max(time->max, us);
+    time->erased += after.erased_bytes - before->erased_bytes;
+    time->written += after.written_bytes - before->written_bytes;
+}
+
+void benchmarkStorage(Print &out, StorageBackend &backend)
+{
+    uint8_t data[STORAGE_BENCH_REWRITE];
+    struct benchTime open = {0, 0, 0, 0};
+    struct benchTime append = {0, 0, 0, 0};
+    struct benchTime rewrite = {0, 0, 0, 0};
+    struct flash_wear wear;
+    fs::FS &fs = backend.fs();
+
+    memset(data, 0x55, sizeof(data));
+    for (uint8_t round = 0; round < STORAGE_BENCH_ROUNDS; round++)
+    {
+        // a settings file being saved, then loaded
+        flash_wear_read(&wear);
+        uint32_t start = micros();
+        File file = fs.open(STORAGE_BENCH_FILENAME, FILE_WRITE);
+        file.write(data, STORAGE_BENCH_REWRITE);
+        file.close();
+        addTime(&rewrite, start, &wear);
+
+        flash_wear_read(&wear);
+        start = micros();
+        file = fs.open(STORAGE_BENCH_FILENAME, FILE_READ);
+        file.close();
+        addTime(&open, start, &wear);
+
+        flash_wear_read(&wear);
+        start = micros();
+        file = fs.open(STORAGE_BENCH_FILENAME, FILE_APPEND);
+        file.write(data, STORAGE_BENCH_APPEND);
+        file.close();
+        addTime(&append, start, &wear);
+    }
+    fs.remove(STORAGE_BENCH_FILENAME);
+
+    out.printf("%s open %u/%u append %u/%u rewrite %u/%u (mean/max us)\n", backend.name(),
+               open.total / STORAGE_BENCH_ROUNDS, open.max, append.total / STORAGE_BENCH_ROUNDS, append.max,
+               rewrite.total / STORAGE_BENCH_ROUNDS, rewrite.max);
+    out.printf("%s erased/written per append %u/%u rewrite %u/%u (bytes)\n", backend.name(),
+               append.erased / STORAGE_BENCH_ROUNDS, append.written / STORAGE_BENCH_ROUNDS,
+               rewrite.erased / STORAGE_BENCH_ROUNDS, rewrite.written / STORAGE_BENCH_ROUNDS);
+}
@@ -0,0 +1,123 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "touch-panel.h"
+#include "touch.h"
+
+#include <Arduino.h>
+#include <esp_timer.h>
+
+TouchPanel::TouchPanel(I2cBus &bus, int8_t interruptPin)
+    : bus(bus), interruptPin(interruptPin), rotated(false), interruptUs(0), handle(NULL)
+{
+}
+
+bool TouchPanel::begin()
+{
+    if (handle != NULL)
+    {
+        return true;
+    }
+
+    touch_reset();
+    if (xTaskCreate(task, "touch", TOUCH_PANEL_STACK, this, TOUCH_PANEL_PRIORITY, &handle) != pdPASS)
+    {
+        handle = NULL;
+        return false;
+    }
+
+    pinMode(interruptPin, INPUT);
+    attachInterruptArg(interruptPin, onInterrupt, this, FALLING);
+    return true;
+}
+
+void TouchPanel::setRotated(bool rotated)
+{
+    this->rotated = rotated;
+}
+
+void IRAM_ATTR TouchPanel::onInterrupt(void *arg)
+{
+    TouchPanel *panel = (TouchPanel *)arg;
+    BaseType_t woken = pdFALSE;
+
+    panel->interruptUs = esp_timer_get_time();
+    vTaskNotifyGiveFromISR(panel->handle, &woken);
+    if (woken == pdTRUE)
+    {
+        portYIELD_FROM_ISR();
+    }
+}
+
+bool TouchPanel::read(bool *pressed, int16_t *x, int16_t *y)
+{
+    const uint8_t reg = FT6336_REG_STATUS;
+
+    i2cPrepare(&transaction, FT6336_ADDRESS, &reg, 1, 0, 5);
+    if (!bus.transfer(&transaction))
+    {
+        return false;
+    }
+
+    *pressed = (transaction.rx[0] & 0x0f) > 0;
+    *x = (transaction.rx[1] & 0x0f) << 8 | transaction.rx[2];
+    *y = (transaction.rx[3] & 0x0f) << 8 | transaction.rx[4];
+    if (rotated)
+    {
+        // the touch buttons below the screen end up at negative y, like M5.BtnA.set()
+        *x = 319 - *x;
+        *y = 239 - *y;
+    }
+    return true;
+}
+
+void TouchPanel::task(void *arg)
+{
+    TouchPanel *panel = (TouchPanel *)arg;
+    bool pressed = false;
+    int16_t x = 0;
+    int16_t y = 0;
+
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // the first sample at the time of the interrupt, then until no bounce can follow
+        int64_t sampleUs = panel->interruptUs;
+        int64_t releasedUs = 0;
+        do
+        {
+            if (panel->read(&pressed, &x, &y))
+            {
+                touch_sample(sampleUs, pressed, x, y);
+            }
+            if (pressed)
+            {
+                releasedUs = 0;
+            }
+            else if (releasedUs == 0)
+            {
+                releasedUs = sampleUs;
+            }
+
+            vTaskDelay(pdMS_TO_TICKS(TOUCH_PANEL_SAMPLE_MS));
+            sampleUs = esp_timer_get_time();
+        } while (releasedUs == 0 || sampleUs - releasedUs < TOUCH_DEBOUNCE_US);
+
+        touch_poll(sampleUs);
+    }
+}
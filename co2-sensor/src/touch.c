@@ -0,0 +1,149 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "touch.h"
+
+#include <stdlib.h>
+
+struct touch_state {
+    bool down;
+    bool released;
+    bool long_pressed;
+    int16_t x;
+    int16_t y;
+    int64_t start_us;
+    int16_t last_x;
+    int16_t last_y;
+    int64_t last_us;
+};
+
+static struct touch_state touch;
+
+/* written by the producer only, head by the consumer only */
+static struct touch_event queue[TOUCH_QUEUE_LEN];
+static uint8_t queue_head;
+static uint8_t queue_tail;
+static uint32_t dropped;
+
+static void emit(uint8_t gesture)
+{
+    uint8_t tail = queue_tail;
+    uint8_t next = (tail + 1) % TOUCH_QUEUE_LEN;
+    struct touch_event *event = &queue[tail];
+
+    if (next == __atomic_load_n(&queue_head, __ATOMIC_ACQUIRE)) {
+        dropped++;
+        return;
+    }
+
+    event->gesture = gesture;
+    event->x = touch.x;
+    event->y = touch.y;
+    event->end_x = touch.last_x;
+    event->end_y = touch.last_y;
+    event->start_us = touch.start_us;
+    event->end_us = touch.last_us;
+    __atomic_store_n(&queue_tail, next, __ATOMIC_RELEASE);
+}
+
+static bool moved(void)
+{
+    return abs(touch.last_x - touch.x) >= TOUCH_SWIPE_PX || abs(touch.last_y - touch.y) >= TOUCH_SWIPE_PX;
+}
+
+static void complete(void)
+{
+    int dx = touch.last_x - touch.x;
+    int dy = touch.last_y - touch.y;
+
+    touch.released = false;
+    if (touch.long_pressed) {
+        return;
+    }
+    if (!moved()) {
+        emit(TOUCH_TAP);
+    } else if (abs(dx) >= abs(dy)) {
+        emit(dx > 0 ? TOUCH_SWIPE_RIGHT : TOUCH_SWIPE_LEFT);
+    } else {
+        emit(dy > 0 ? TOUCH_SWIPE_DOWN : TOUCH_SWIPE_UP);
+    }
+}
+
+void touch_reset(void)
+{
+    touch.down = false;
+    touch.released = false;
+    dropped = 0;
+    __atomic_store_n(&queue_head, __atomic_load_n(&queue_tail, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+}
+
+void touch_poll(int64_t now_us)
+{
+    if (touch.released && now_us - touch.last_us >= TOUCH_DEBOUNCE_US) {
+        complete();
+    }
+}
+
+void touch_sample(int64_t time_us, bool pressed, int16_t x, int16_t y)
+{
+    if (!pressed) {
+        if (touch.down) {
+            touch.down = false;
+            touch.released = true;
+            touch.last_us = time_us;
+        }
+        touch_poll(time_us);
+        return;
+    }
+
+    touch_poll(time_us);
+    if (!touch.down && !touch.released) {
+        touch.x = x;
+        touch.y = y;
+        touch.start_us = time_us;
+        touch.long_pressed = false;
+    }
+    touch.down = true;
+    touch.released = false;
+    touch.last_x = x;
+    touch.last_y = y;
+    touch.last_us = time_us;
+
+    if (!touch.long_pressed && !moved() && time_us - touch.start_us >= TOUCH_LONG_PRESS_US) {
+        touch.long_pressed = true;
+        emit(TOUCH_LONG_PRESS);
+    }
+}
+
+bool touch_next(struct touch_event *event)
+{
+    uint8_t head = queue_head;
+
+    if (head == __atomic_load_n(&queue_tail, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+
+    *event = queue[head];
+    __atomic_store_n(&queue_head, (head + 1) % TOUCH_QUEUE_LEN, __ATOMIC_RELEASE);
+    return true;
+}
+
+uint32_t touch_dropped(void)
+{
+    return dropped;
+}
@@ -0,0 +1,298 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "trace.h"
+
+#include <math.h>
+#include <string.h>
+
+/* longest record: type, delta and a battery payload */
+#define TRACE_RECORD_MAX 24
+
+static uint8_t buffer[TRACE_BUFFER_SIZE];
+static size_t buffer_len;
+static bool running;
+static uint32_t last_ms;
+static uint32_t dropped;
+
+static size_t put_varint(uint8_t *data, uint32_t value)
+{
+    size_t len = 0;
+
+    while (value >= 0x80) {
+        data[len++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    data[len++] = (uint8_t)value;
+    return len;
+}
+
+static uint32_t zigzag(int32_t value)
+{
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value)
+{
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+/* starts a record, events out of order are recorded at the time of the previous one */
+static size_t begin(uint8_t *record, uint8_t type, uint32_t *now_ms)
+{
+    if ((int32_t)(*now_ms - last_ms) < 0) {
+        *now_ms = last_ms;
+    }
+    record[0] = type;
+    return 1 + put_varint(record + 1, *now_ms - last_ms);
+}
+
+static void commit(const uint8_t *record, size_t len, uint32_t now_ms)
+{
+    if (buffer_len + len > TRACE_BUFFER_SIZE) {
+        dropped++;
+        return;
+    }
+    memcpy(buffer + buffer_len, record, len);
+    buffer_len += len;
+    last_ms = now_ms;
+}
+
+void trace_start(uint32_t now_ms, uint32_t unix_time)
+{
+    memcpy(buffer, TRACE_MAGIC, 4);
+    buffer[4] = TRACE_VERSION;
+    for (uint8_t i = 0; i < 4; i++) {
+        buffer[5 + i] = (uint8_t)(unix_time >> (8 * i));
+    }
+    buffer_len = TRACE_HEADER_LEN;
+    last_ms = now_ms;
+    dropped = 0;
+    running = true;
+}
+
+void trace_stop(void)
+{
+    running = false;
+}
+
+bool trace_running(void)
+{
+    return running;
+}
+
+void trace_sensor(uint32_t now_ms, uint8_t sensor_id, uint8_t measurement_type, int32_t value)
+{
+    uint8_t record[TRACE_RECORD_MAX];
+    size_t len;
+
+    if (!running) {
+        return;
+    }
+    len = begin(record, TRACE_SENSOR, &now_ms);
+    record[len++] = sensor_id;
+    record[len++] = measurement_type;
+    len += put_varint(record + len, zigzag(value));
+    commit(record, len, now_ms);
+}
+
+void trace_battery(const struct battery_sample *sample)
+{
+    uint8_t record[TRACE_RECORD_MAX];
+    uint32_t now_ms = sample->time_ms;
+    size_t len;
+
+    if (!running) {
+        return;
+    }
+    len = begin(record, TRACE_BATTERY, &now_ms);
+    len += put_varint(record + len, (uint32_t)lroundf(sample->voltage * 1000));
+    len += put_varint(record + len, zigzag((int32_t)lroundf(sample->current * 2)));
+    len += put_varint(record + len, zigzag((int32_t)lroundf(sample->coulomb_mah * 100)));
+    record[len++] = (sample->ac ? 1 : 0) | (sample->charging ? 2 : 0);
+    commit(record, len, now_ms);
+}
+
+void trace_touch(uint32_t now_ms, int16_t x, int16_t y, bool pressed)
+{
+    uint8_t record[TRACE_RECORD_MAX];
+    size_t len;
+
+    if (!running) {
+        return;
+    }
+    len = begin(record, TRACE_TOUCH, &now_ms);
+    len += put_varint(record + len, zigzag(x));
+    len += put_varint(record + len, zigzag(y));
+    record[len++] = pressed ? 1 : 0;
+    commit(record, len, now_ms);
+}
+
+void trace_connectivity(uint32_t now_ms, uint8_t wifi_status, bool mqtt_connected)
+{
+    uint8_t record[TRACE_RECORD_MAX];
+    size_t len;
+
+    if (!running) {
+        return;
+    }
+    len = begin(record, TRACE_CONNECTIVITY, &now_ms);
+    record[len++] = wifi_status;
+    record[len++] = mqtt_connected ? 1 : 0;
+    commit(record, len, now_ms);
+}
+
+size_t trace_pending(const uint8_t **data)
+{
+    *data = buffer;
+    return buffer_len;
+}
+
+void trace_consumed(void)
+{
+    buffer_len = 0;
+}
+
+uint32_t trace_dropped(void)
+{
+    return dropped;
+}
+
+bool trace_reader_init(struct trace_reader *reader, const uint8_t *data, size_t len)
+{
+    if (len < TRACE_HEADER_LEN || memcmp(data, TRACE_MAGIC, 4) != 0 || data[4] != TRACE_VERSION) {
+        return false;
+    }
+
+    reader->data = data;
+    reader->len = len;
+    reader->pos = TRACE_HEADER_LEN;
+    reader->time_ms = 0;
+    reader->unix_time = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        reader->unix_time |= (uint32_t)data[5 + i] << (8 * i);
+    }
+    return true;
+}
+
+static bool get_byte(struct trace_reader *reader, uint8_t *value)
+{
+    if (reader->pos >= reader->len) {
+        return false;
+    }
+    *value = reader->data[reader->pos++];
+    return true;
+}
+
+static bool get_varint(struct trace_reader *reader, uint32_t *value)
+{
+    uint8_t byte;
+
+    *value = 0;
+    for (uint8_t shift = 0; shift < 35; shift += 7) {
+        if (!get_byte(reader, &byte)) {
+            return false;
+        }
+        *value |= (uint32_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int trace_next(struct trace_reader *reader, struct trace_event *event)
+{
+    uint32_t delta, a, b, c;
+    uint8_t x, y;
+
+    if (reader->pos >= reader->len) {
+        return 0;
+    }
+    if (!get_byte(reader, &event->type) || !get_varint(reader, &delta)) {
+        return -1;
+    }
+    reader->time_ms += delta;
+    event->time_ms = reader->time_ms;
+
+    switch (event->type) {
+    case TRACE_SENSOR:
+        if (!get_byte(reader, &x) || !get_byte(reader, &y) || !get_varint(reader, &a)) {
+            return -1;
+        }
+        event->sensor.sensor_id = x;
+        event->sensor.measurement_type = y;
+        event->sensor.value = unzigzag(a);
+        return 1;
+    case TRACE_BATTERY:
+        if (!get_varint(reader, &a) || !get_varint(reader, &b) || !get_varint(reader, &c) || !get_byte(reader, &x)) {
+            return -1;
+        }
+        event->battery.time_ms = event->time_ms;
+        event->battery.voltage = a / 1000.0f;
+        event->battery.current = unzigzag(b) / 2.0f;
+        event->battery.coulomb_mah = unzigzag(c) / 100.0f;
+        event->battery.ac = (x & 1) != 0;
+        event->battery.charging = (x & 2) != 0;
+        return 1;
+    case TRACE_TOUCH:
+        if (!get_varint(reader, &a) || !get_varint(reader, &b) || !get_byte(reader, &x)) {
+            return -1;
+        }
+        event->touch.x = (int16_t)unzigzag(a);
+        event->touch.y = (int16_t)unzigzag(b);
+        event->touch.pressed = x != 0;
+        return 1;
+    case TRACE_CONNECTIVITY:
+        if (!get_byte(reader, &x) || !get_byte(reader, &y)) {
+            return -1;
+        }
+        event->connectivity.wifi_status = x;
+        event->connectivity.mqtt_connected = y != 0;
+        return 1;
+    default:
+        return -1;
+    }
+}
+
+long trace_replay(const uint8_t *data, size_t len, uint32_t tick_ms, const struct trace_handlers *handlers,
+                  void *context)
+{
+    struct trace_reader reader;
+    struct trace_event event;
+    uint32_t next_tick = 0;
+    long events = 0;
+    int result;
+
+    if (!trace_reader_init(&reader, data, len)) {
+        return -1;
+    }
+
+    while ((result = trace_next(&reader, &event)) > 0) {
+        while (handlers->tick != NULL && tick_ms > 0 && next_tick <= event.time_ms) {
+            handlers->tick(context, next_tick);
+            next_tick += tick_ms;
+        }
+        if (handlers->event != NULL) {
+            handlers->event(context, &event);
+        }
+        events++;
+    }
+
+    return result < 0 ? -1 : events;
+}
@@ -0,0 +1,132 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "wire-i2c-bus.h"
+#include "health.h"
+
+#include <esp_timer.h>
+
+WireI2cBus::WireI2cBus(TwoWire &wire, const char *name)
+    : wire(wire), name(name), queue(NULL)
+{
+}
+
+bool WireI2cBus::begin()
+{
+    if (queue != NULL)
+    {
+        return true;
+    }
+
+    queue = xQueueCreate(I2C_QUEUE_LEN, sizeof(struct i2cTransaction *));
+    if (queue == NULL)
+    {
+        return false;
+    }
+
+    if (xTaskCreate(task, name, WIRE_I2C_BUS_STACK, this, WIRE_I2C_BUS_PRIORITY, NULL) != pdPASS)
+    {
+        vQueueDelete(queue);
+        queue = NULL;
+        return false;
+    }
+    return true;
+}
+
+bool WireI2cBus::submit(struct i2cTransaction *transaction)
+{
+    if (queue == NULL)
+    {
+        return false;
+    }
+
+    transaction->queuedUs = esp_timer_get_time();
+    transaction->status = I2C_QUEUED;
+    if (xQueueSend(queue, &transaction, 0) != pdTRUE)
+    {
+        transaction->status = I2C_ERROR;
+        return false;
+    }
+    return true;
+}
+
+bool WireI2cBus::transfer(struct i2cTransaction *transaction)
+{
+    if (!submit(transaction))
+    {
+        return false;
+    }
+
+    while (transaction->status == I2C_QUEUED)
+    {
+        vTaskDelay(1);
+    }
+    return transaction->status == I2C_DONE;
+}
+
+void WireI2cBus::task(void *arg)
+{
+    WireI2cBus *bus = (WireI2cBus *)arg;
+    struct i2cTransaction *transaction;
+
+    for (;;)
+    {
+        if (xQueueReceive(bus->queue, &transaction, portMAX_DELAY) == pdTRUE)
+        {
+            bus->execute(transaction);
+        }
+    }
+}
+
+void WireI2cBus::execute(struct i2cTransaction *transaction)
+{
+    int64_t startUs = esp_timer_get_time();
+    bool ok = true;
+
+    if (transaction->txLen > 0)
+    {
+        // repeated start unless the device needs time before the read
+        bool stop = transaction->rxLen == 0 || transaction->delayMs > 0;
+
+        wire.beginTransmission(transaction->address);
+        wire.write(transaction->tx, transaction->txLen);
+        ok = wire.endTransmission(stop) == 0;
+    }
+
+    int64_t delayUs = 0;
+    if (ok && transaction->delayMs > 0)
+    {
+        int64_t delayStartUs = esp_timer_get_time();
+        vTaskDelay(pdMS_TO_TICKS(transaction->delayMs));
+        delayUs = esp_timer_get_time() - delayStartUs;
+    }
+
+    if (ok && transaction->rxLen > 0)
+    {
+        ok = wire.requestFrom(transaction->address, transaction->rxLen) == transaction->rxLen;
+        for (uint8_t i = 0; ok && i < transaction->rxLen; i++)
+        {
+            transaction->rx[i] = wire.read();
+        }
+    }
+
+    transaction->doneUs = esp_timer_get_time();
+    transaction->waitUs = (uint32_t)(startUs - transaction->queuedUs);
+    transaction->busUs = (uint32_t)(transaction->doneUs - startUs - delayUs);
+    health_record_i2c(transaction->busUs, ok);
+    transaction->status = ok ? I2C_DONE : I2C_ERROR;
+}
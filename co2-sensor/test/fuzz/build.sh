@@ -0,0 +1,41 @@
+#!/bin/bash
+# Builds the fuzz target of the SNMP agent with the host sources of the native
+# env, from the co2-sensor directory:
+#
+#   test/fuzz/build.sh            clang: libFuzzer with ASan and UBSan
+#                                 ./snmp-frame-fuzz -max_len=1500 corpus/
+#   test/fuzz/build.sh afl        AFL++ (afl-clang-fast), afl-fuzz -i corpus -o findings ./snmp-frame-fuzz
+#   test/fuzz/build.sh standalone gcc with ASan and UBSan, mutates the seeds itself
+#                                 ./snmp-frame-fuzz [-n mutations] | [crash files...] | -w corpus/
+#
+# The standalone build writes the seed corpus for the other two.
+
+set -e
+
+mode=${1:-libfuzzer}
+out=${OUT:-snmp-frame-fuzz}
+sanitize="-fsanitize=address,undefined -fno-sanitize-recover=undefined"
+
+case $mode in
+    libfuzzer) cc=${CC:-clang}; cxx=${CXX:-clang++}; sanitize="$sanitize -fsanitize=fuzzer" ;;
+    afl) cc=${CC:-afl-clang-fast}; cxx=${CXX:-afl-clang-fast++}; sanitize="$sanitize -fsanitize=fuzzer" ;;
+    standalone) cc=${CC:-gcc}; cxx=${CXX:-g++}; sanitize="$sanitize -DFUZZ_STANDALONE" ;;
+    *) sed -n 2,12p "$0"; exit 1 ;;
+esac
+
+flags="-g -O1 -Wall -Wextra -Iinclude -Isrc -Itest/lib/host/include $sanitize"
+sources="src/snmp/snmp_asn1.c src/snmp/snmp_core.c src/snmp/snmp_msg.c src/snmp/snmp_pbuf_stream.c
+    src/snmp/snmp_scalar.c src/snmp/snmp_table.c src/snmp/snmp_cache.c src/snmp/snmp_traps.c
+    src/snmp/snmpv3.c src/snmp/snmpv3_mbedtls.c src/snmp/snmp_raw.c
+    src/snmpv3-users.c src/health.c src/backlight.c src/history.c
+    test/lib/host/src/*.c test/fuzz/snmp_frame.c"
+
+objects=$(mktemp -d)
+trap 'rm -rf "$objects"' EXIT
+
+for source in $sources; do
+    $cc $flags -c "$source" -o "$objects/$(basename "$source").o"
+done
+$cxx $flags -std=gnu++17 -c src/sensorhub-mib.cpp -o "$objects/sensorhub-mib.o"
+$cxx $sanitize -o "$out" "$objects"/*.o -lcrypto
+echo "built $out"
@@ -0,0 +1,231 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * Fuzz target for the SNMP agent: every input is handed to the agent as one
+ * datagram, so snmp_parse_inbound_frame() and everything behind it sees it
+ * like a frame from the network. Built with -fsanitize=fuzzer for libFuzzer
+ * or AFL++, with -DFUZZ_STANDALONE for a driver that replays files or
+ * mutates the seeds itself, see build.sh.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host-agent.h"
+#include "snmp-client.h"
+#include "snmpv3-users.h"
+#include "lwip/apps/snmpv3.h"
+
+#define USER "fuzz"
+#define AUTH_PASSWORD "auth-password"
+#define PRIV_PASSWORD "priv-password"
+
+static uint8_t answer[SNMP_CLIENT_FRAME_MAX];
+
+static void init(void)
+{
+    static int initialized;
+
+    if (!initialized) {
+        host_agent_init();
+        snmpv3_users_add_password(USER, SNMP_V3_AUTH_ALGO_SHA, AUTH_PASSWORD, SNMP_V3_PRIV_ALGO_AES, PRIV_PASSWORD);
+        /* keep the community path reachable */
+        snmpv3_users_set_v3_only(0);
+        initialized = 1;
+    }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    init();
+    host_agent_request(data, size, answer, sizeof(answer));
+    return 0;
+}
+
+#ifdef FUZZ_STANDALONE
+
+#define SEEDS_MAX 16
+#define MUTATIONS_DEFAULT 1000000
+
+struct seed {
+    uint8_t data[SNMP_CLIENT_FRAME_MAX];
+    size_t len;
+};
+
+static struct seed seeds[SEEDS_MAX];
+static size_t seeds_len;
+
+static void add_seed(struct snmp_client *client, uint8_t pdu_type, const char *text, int32_t max_repetitions)
+{
+    struct snmp_client_oid oid;
+    struct seed *seed = &seeds[seeds_len];
+
+    snmp_client_parse_oid(text, &oid);
+    seed->len = snmp_client_encode(client, pdu_type, &oid, 1, 0, max_repetitions, seed->data, sizeof(seed->data));
+    if (seed->len > 0 && seeds_len < SEEDS_MAX - 1) {
+        seeds_len++;
+    }
+}
+
+/* requests a manager sends, v3 with keys the agent knows */
+static void make_seeds(void)
+{
+    struct snmp_client client;
+    struct snmp_client_response response;
+    size_t len;
+
+    snmp_client_init(&client, SNMP_CLIENT_VERSION_2C, "public");
+    add_seed(&client, SNMP_CLIENT_GET, "1.3.6.1.4.1.58049.1.2.1.2.1.1", 0);
+    add_seed(&client, SNMP_CLIENT_GETNEXT, "1.3.6.1.4.1.58049.1.4", 0);
+    add_seed(&client, SNMP_CLIENT_GETBULK, "1.3.6.1.4.1.58049.1", 20);
+    add_seed(&client, SNMP_CLIENT_SET, "1.3.6.1.4.1.58049.1.1.1.2.1", 0);
+
+    snmp_client_init(&client, SNMP_CLIENT_VERSION_1, "public");
+    add_seed(&client, SNMP_CLIENT_GETNEXT, "1.3.6.1.4.1.58049.1.7", 0);
+
+    snmp_client_init_v3(&client, USER, SNMP_CLIENT_AUTH_SHA, AUTH_PASSWORD, SNMP_CLIENT_PRIV_AES, PRIV_PASSWORD);
+    seeds[seeds_len].len = snmp_client_encode_discovery(&client, seeds[seeds_len].data, sizeof(seeds[seeds_len].data));
+    len = host_agent_request(seeds[seeds_len].data, seeds[seeds_len].len, answer, sizeof(answer));
+    seeds_len++;
+    snmp_client_decode(&client, answer, len, &response);
+    add_seed(&client, SNMP_CLIENT_GET, "1.3.6.1.4.1.58049.1.2.1.2.1.1", 0);
+    add_seed(&client, SNMP_CLIENT_GETBULK, "1.3.6.1.4.1.58049.1.2", 10);
+}
+
+static uint32_t next_random(void)
+{
+    static uint32_t state = 0x2545f491;
+
+    /* xorshift32, the same run every time */
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static size_t mutate(uint8_t *data, size_t len)
+{
+    uint32_t count = 1 + next_random() % 4;
+
+    while (count-- > 0 && len > 0) {
+        size_t at = next_random() % len;
+
+        switch (next_random() % 5) {
+        case 0:
+            data[at] ^= (uint8_t)(1 << (next_random() % 8));
+            break;
+        case 1:
+            data[at] = (uint8_t)next_random();
+            break;
+        case 2:
+            /* lengths and counts at their limits */
+            data[at] = (const uint8_t[]){ 0x00, 0x7f, 0x80, 0x81, 0x82, 0xff }[next_random() % 6];
+            break;
+        case 3:
+            len = at;
+            break;
+        default:
+            if (len < SNMP_CLIENT_FRAME_MAX) {
+                memmove(&data[at + 1], &data[at], len - at);
+                data[at] = (uint8_t)next_random();
+                len++;
+            }
+            break;
+        }
+    }
+    return len;
+}
+
+static int replay(const char *path)
+{
+    static uint8_t data[65536];
+    FILE *file = fopen(path, "rb");
+    size_t len;
+
+    if (file == NULL) {
+        perror(path);
+        return 1;
+    }
+    len = fread(data, 1, sizeof(data), file);
+    fclose(file);
+    LLVMFuzzerTestOneInput(data, len);
+    return 0;
+}
+
+static int write_seeds(const char *dir)
+{
+    char path[512];
+
+    for (size_t i = 0; i < seeds_len; i++) {
+        FILE *file;
+
+        snprintf(path, sizeof(path), "%s/seed-%02u", dir, (unsigned)i);
+        file = fopen(path, "wb");
+        if (file == NULL || fwrite(seeds[i].data, 1, seeds[i].len, file) != seeds[i].len) {
+            perror(path);
+            return 1;
+        }
+        fclose(file);
+    }
+    printf("%u seeds written to %s\n", (unsigned)seeds_len, dir);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    uint8_t data[SNMP_CLIENT_FRAME_MAX];
+    unsigned long mutations = MUTATIONS_DEFAULT;
+    int first = 1;
+
+    init();
+    make_seeds();
+
+    if (argc > 2 && strcmp(argv[1], "-w") == 0) {
+        return write_seeds(argv[2]);
+    }
+    if (argc > 2 && strcmp(argv[1], "-n") == 0) {
+        mutations = strtoul(argv[2], NULL, 10);
+        first = 3;
+    }
+
+    if (first < argc) {
+        for (int i = first; i < argc; i++) {
+            if (replay(argv[i]) != 0) {
+                return 1;
+            }
+        }
+        printf("%d inputs replayed\n", argc - first);
+        return 0;
+    }
+
+    for (unsigned long i = 0; i < mutations; i++) {
+        const struct seed *seed = &seeds[next_random() % seeds_len];
+        size_t len;
+
+        memcpy(data, seed->data, seed->len);
+        len = mutate(data, seed->len);
+        LLVMFuzzerTestOneInput(data, len);
+    }
+    printf("%lu mutations of %u seeds\n", mutations, (unsigned)seeds_len);
+    return 0;
+}
+
+#endif /* FUZZ_STANDALONE */
@@ -0,0 +1,116 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARDUINO_H
+#define ARDUINO_H ARDUINO_H
+
+/* host stand-in for the parts of the Arduino core the sensor drivers, FS.h and storage.cpp use */
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <algorithm>
+#include <string>
+
+using std::max;
+using std::min;
+
+#define IRAM_ATTR
+
+typedef bool boolean;
+
+#define INPUT 0x01
+#define RISING 0x01
+
+static inline void pinMode(uint8_t pin, uint8_t mode)
+{
+    (void)pin;
+    (void)mode;
+}
+
+/* there are no pins, a test calls the handler itself */
+static inline void attachInterruptArg(uint8_t pin, void (*handler)(void *), void *arg, int mode)
+{
+    (void)pin;
+    (void)handler;
+    (void)arg;
+    (void)mode;
+}
+
+static inline unsigned long micros(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static inline unsigned long millis(void)
+{
+    return micros() / 1000;
+}
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(const uint8_t *buffer, size_t size) = 0;
+
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)))
+    {
+        char line[256];
+        va_list args;
+
+        va_start(args, format);
+        int len = vsnprintf(line, sizeof(line), format, args);
+        va_end(args);
+        return len > 0 ? write((const uint8_t *)line, (size_t)len < sizeof(line) ? len : sizeof(line) - 1) : 0;
+    }
+};
+
+class HostSerial : public Print
+{
+public:
+    /* a test turns off what the code under test logs */
+    bool muted = false;
+
+    size_t write(const uint8_t *buffer, size_t size) { return muted ? size : fwrite(buffer, 1, size, stdout); }
+    void println(const char *line)
+    {
+        if (!muted)
+        {
+            puts(line);
+        }
+    }
+};
+
+inline HostSerial Serial;
+
+class String
+{
+public:
+    String(const char *text = "") : text(text) {}
+    const char *c_str() const { return text.c_str(); }
+    size_t length() const { return text.size(); }
+
+private:
+    std::string text;
+};
+
+#endif /* ARDUINO_H */
@@ -0,0 +1,107 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FS_H
+#define FS_H FS_H
+
+/*
+ * host stand-in for the FS.h of the Arduino core, File and FS forward to the
+ * FileImpl and FSImpl of FSImpl.h like there, without the Stream parts
+ */
+
+#include <Arduino.h>
+
+#include <time.h>
+
+#include <memory>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+class FileImpl;
+typedef std::shared_ptr<FileImpl> FileImplPtr;
+class FSImpl;
+typedef std::shared_ptr<FSImpl> FSImplPtr;
+
+enum SeekMode
+{
+    SeekSet = 0,
+    SeekCur = 1,
+    SeekEnd = 2
+};
+
+class File
+{
+public:
+    File(FileImplPtr p = FileImplPtr()) : _p(p) {}
+
+    size_t write(const uint8_t *buf, size_t size);
+    size_t read(uint8_t *buf, size_t size);
+    void flush();
+    bool seek(uint32_t pos, SeekMode mode);
+    bool seek(uint32_t pos) { return seek(pos, SeekSet); }
+    size_t position() const;
+    size_t size() const;
+    bool setBufferSize(size_t size);
+    void close();
+    operator bool() const;
+    time_t getLastWrite();
+    const char *path() const;
+    const char *name() const;
+
+    boolean isDirectory(void);
+    boolean seekDir(long position);
+    File openNextFile(const char *mode = FILE_READ);
+    String getNextFileName(void);
+    void rewindDirectory(void);
+
+protected:
+    FileImplPtr _p;
+};
+
+class FS
+{
+public:
+    FS(FSImplPtr impl) : _impl(impl) {}
+
+    File open(const char *path, const char *mode = FILE_READ, const bool create = false);
+    bool exists(const char *path);
+    bool remove(const char *path);
+    bool rename(const char *pathFrom, const char *pathTo);
+    bool mkdir(const char *path);
+    bool rmdir(const char *path);
+
+protected:
+    FSImplPtr _impl;
+};
+
+} /* namespace fs */
+
+// the methods forward to the implementation, FSImpl.h defines them
+#include <FSImpl.h>
+
+using fs::File;
+using fs::FS;
+using fs::SeekCur;
+using fs::SeekEnd;
+using fs::SeekMode;
+using fs::SeekSet;
+
+#endif /* FS_H */
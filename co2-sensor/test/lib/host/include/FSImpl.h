@@ -0,0 +1,194 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FSIMPL_H
+#define FSIMPL_H FSIMPL_H
+
+/* host stand-in for the FSImpl.h of the Arduino core, the interface file systems implement */
+
+#include <FS.h>
+
+namespace fs {
+
+class FileImpl
+{
+public:
+    virtual ~FileImpl() {}
+    virtual size_t write(const uint8_t *buf, size_t size) = 0;
+    virtual size_t read(uint8_t *buf, size_t size) = 0;
+    virtual void flush() = 0;
+    virtual bool seek(uint32_t pos, SeekMode mode) = 0;
+    virtual size_t position() const = 0;
+    virtual size_t size() const = 0;
+    virtual bool setBufferSize(size_t size) = 0;
+    virtual void close() = 0;
+    virtual time_t getLastWrite() = 0;
+    virtual const char *path() const = 0;
+    virtual const char *name() const = 0;
+    virtual boolean isDirectory(void) = 0;
+    virtual FileImplPtr openNextFile(const char *mode) = 0;
+    virtual boolean seekDir(long position) = 0;
+    virtual String getNextFileName(void) = 0;
+    virtual void rewindDirectory(void) = 0;
+    virtual operator bool() = 0;
+};
+
+class FSImpl
+{
+public:
+    virtual ~FSImpl() {}
+    virtual FileImplPtr open(const char *path, const char *mode, const bool create) = 0;
+    virtual bool exists(const char *path) = 0;
+    virtual bool rename(const char *pathFrom, const char *pathTo) = 0;
+    virtual bool remove(const char *path) = 0;
+    virtual bool mkdir(const char *path) = 0;
+    virtual bool rmdir(const char *path) = 0;
+};
+
+} /* namespace fs */
+
+/* File and FS of FS.h forward to the interface */
+namespace fs {
+
+inline size_t File::write(const uint8_t *buf, size_t size)
+{
+    return _p ? _p->write(buf, size) : 0;
+}
+
+inline size_t File::read(uint8_t *buf, size_t size)
+{
+    return _p ? _p->read(buf, size) : 0;
+}
+
+inline void File::flush()
+{
+    if (_p)
+    {
+        _p->flush();
+    }
+}
+
+inline bool File::seek(uint32_t pos, SeekMode mode)
+{
+    return _p ? _p->seek(pos, mode) : false;
+}
+
+inline size_t File::position() const
+{
+    return _p ? _p->position() : 0;
+}
+
+inline size_t File::size() const
+{
+    return _p ? _p->size() : 0;
+}
+
+inline bool File::setBufferSize(size_t size)
+{
+    return _p ? _p->setBufferSize(size) : false;
+}
+
+inline void File::close()
+{
+    if (_p)
+    {
+        _p->close();
+        _p = nullptr;
+    }
+}
+
+inline File::operator bool() const
+{
+    return _p != nullptr && *_p != false;
+}
+
+inline time_t File::getLastWrite()
+{
+    return _p ? _p->getLastWrite() : 0;
+}
+
+inline const char *File::path() const
+{
+    return _p ? _p->path() : nullptr;
+}
+
+inline const char *File::name() const
+{
+    return _p ? _p->name() : nullptr;
+}
+
+inline boolean File::isDirectory(void)
+{
+    return _p ? _p->isDirectory() : false;
+}
+
+inline boolean File::seekDir(long position)
+{
+    return _p ? _p->seekDir(position) : false;
+}
+
+inline File File::openNextFile(const char *mode)
+{
+    return _p ? File(_p->openNextFile(mode)) : File();
+}
+
+inline String File::getNextFileName(void)
+{
+    return _p ? _p->getNextFileName() : String("");
+}
+
+inline void File::rewindDirectory(void)
+{
+    if (_p)
+    {
+        _p->rewindDirectory();
+    }
+}
+
+inline File FS::open(const char *path, const char *mode, const bool create)
+{
+    return _impl ? File(_impl->open(path, mode, create)) : File();
+}
+
+inline bool FS::exists(const char *path)
+{
+    return _impl ? _impl->exists(path) : false;
+}
+
+inline bool FS::remove(const char *path)
+{
+    return _impl ? _impl->remove(path) : false;
+}
+
+inline bool FS::rename(const char *pathFrom, const char *pathTo)
+{
+    return _impl ? _impl->rename(pathFrom, pathTo) : false;
+}
+
+inline bool FS::mkdir(const char *path)
+{
+    return _impl ? _impl->mkdir(path) : false;
+}
+
+inline bool FS::rmdir(const char *path)
+{
+    return _impl ? _impl->rmdir(path) : false;
+}
+
+} /* namespace fs */
+
+#endif /* FSIMPL_H */
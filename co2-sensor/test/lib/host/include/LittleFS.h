@@ -0,0 +1,40 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LITTLEFS_H
+#define LITTLEFS_H LITTLEFS_H
+
+/* host stand-in, there is no flash, LittleFS keeps its files in memory */
+
+#include <memory-fs.h>
+
+class LittleFSFS : public MemoryFS
+{
+public:
+    // mounts every time, so nothing is formatted
+    bool begin(bool /* formatOnFail */ = false, const char * /* basePath */ = "/littlefs", uint8_t /* maxOpenFiles */ = 10,
+               const char * /* partitionLabel */ = NULL)
+    {
+        return true;
+    }
+
+    void end() {}
+};
+
+inline LittleFSFS LittleFS;
+
+#endif /* LITTLEFS_H */
@@ -0,0 +1,296 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef M5CORE2_H
+#define M5CORE2_H M5CORE2_H
+
+/*
+ * host stand-in for the parts of M5Core2 / TFT_eSPI the glyph atlas uses. The
+ * panel is a frame buffer which counts the address windows and the bytes a
+ * real one receives over SPI. Text is rasterized from GFXfont bitmaps as
+ * TFT_eSPI does it: transparent, a rectangle per horizontal run of pixels.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+using std::max;
+using std::min;
+
+#define BLACK 0x0000
+#define WHITE 0xffff
+#define CYAN 0x07ff
+#define GREEN 0x07e0
+#define YELLOW 0xffe0
+#define ORANGE 0xfda0
+#define RED 0xf800
+
+#define TL_DATUM 0
+#define TC_DATUM 1
+#define TR_DATUM 2
+
+typedef struct {
+    uint16_t bitmapOffset;
+    uint8_t width;
+    uint8_t height;
+    uint8_t xAdvance;
+    int8_t xOffset;
+    int8_t yOffset;
+} GFXglyph;
+
+typedef struct {
+    uint8_t *bitmap;
+    GFXglyph *glyph;
+    uint16_t first;
+    uint16_t last;
+    uint8_t yAdvance;
+} GFXfont;
+
+class TFT_eSPI
+{
+public:
+    TFT_eSPI(int16_t width = 320, int16_t height = 240)
+        : frameWidth(width), frameHeight(height), frame(NULL), panel(true), windows(0), bytes(0), swapBytes(false),
+          font(NULL), textSize(1), textColor(WHITE), textDatum(TL_DATUM), baseline(0)
+    {
+        if (width > 0 && height > 0)
+        {
+            frame = (uint16_t *)calloc((size_t)width * height, sizeof(uint16_t));
+        }
+    }
+
+    virtual ~TFT_eSPI() { free(frame); }
+
+    void setSwapBytes(bool swap) { swapBytes = swap; }
+    bool getSwapBytes() const { return swapBytes; }
+
+    void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t color)
+    {
+        if (clip(&x, &y, &w, &h, NULL))
+        {
+            for (int32_t row = y; row < y + h; row++)
+            {
+                std::fill(frame + row * frameWidth + x, frame + row * frameWidth + x + w, color);
+            }
+            sent(w, h);
+        }
+    }
+
+    // only the horizontal lines the header uses
+    void drawLine(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint16_t color)
+    {
+        if (y0 == y1)
+        {
+            fillRect(min(x0, x1), y0, abs(x1 - x0) + 1, 1, color);
+        }
+    }
+
+    // data in the byte order of the colors needs swapped bytes, as on the device
+    void pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t *data)
+    {
+        int32_t stride = w;
+
+        if (clip(&x, &y, &w, &h, &data))
+        {
+            for (int32_t row = 0; row < h; row++)
+            {
+                for (int32_t col = 0; col < w; col++)
+                {
+                    uint16_t color = data[row * stride + col];
+                    frame[(y + row) * frameWidth + x + col] = swapBytes ? color : (uint16_t)(color << 8 | color >> 8);
+                }
+            }
+            sent(w, h);
+        }
+    }
+
+    void setFreeFont(const GFXfont *newFont)
+    {
+        font = newFont;
+        baseline = 0;
+        for (uint16_t c = font->first; c <= font->last; c++)
+        {
+            baseline = max(baseline, (int16_t)-font->glyph[c - font->first].yOffset);
+        }
+    }
+
+    void setTextSize(uint8_t size) { textSize = size; }
+    void setTextColor(uint16_t color) { textColor = color; }
+    void setTextDatum(uint8_t datum) { textDatum = datum; }
+
+    int16_t fontHeight() const { return font->yAdvance * textSize; }
+
+    int16_t textWidth(const char *text) const
+    {
+        int16_t width = 0;
+
+        for (; *text != '\0'; text++)
+        {
+            if (*text >= font->first && *text <= font->last)
+            {
+                width += font->glyph[*text - font->first].xAdvance * textSize;
+            }
+        }
+        return width;
+    }
+
+    int16_t drawString(const char *text, int32_t x, int32_t y)
+    {
+        int16_t width = textWidth(text);
+
+        x -= textDatum == TC_DATUM ? width / 2 : textDatum == TR_DATUM ? width : 0;
+        for (; *text != '\0'; text++)
+        {
+            if (*text >= font->first && *text <= font->last)
+            {
+                x += drawChar(*text, x, y + baseline * textSize);
+            }
+        }
+        return width;
+    }
+
+    uint16_t readPixel(int32_t x, int32_t y) const { return frame[y * frameWidth + x]; }
+
+    // SPI traffic since the last reset, an address window costs 11 command and argument bytes
+    uint32_t windowsSent() const { return windows; }
+    uint64_t bytesSent() const { return bytes + (uint64_t)windows * 11; }
+    void resetSent() { windows = 0; bytes = 0; }
+
+protected:
+    bool clip(int32_t *x, int32_t *y, int32_t *w, int32_t *h, const uint16_t **data)
+    {
+        int32_t stride = *w;
+        int32_t left = max(*x, (int32_t)0), top = max(*y, (int32_t)0);
+        int32_t right = min(*x + *w, (int32_t)frameWidth), bottom = min(*y + *h, (int32_t)frameHeight);
+
+        if (frame == NULL || right <= left || bottom <= top)
+        {
+            return false;
+        }
+        if (data != NULL)
+        {
+            *data += (top - *y) * stride + (left - *x);
+        }
+        *x = left;
+        *y = top;
+        *w = right - left;
+        *h = bottom - top;
+        return true;
+    }
+
+    void sent(int32_t w, int32_t h)
+    {
+        if (panel)
+        {
+            windows++;
+            bytes += (uint64_t)w * h * 2;
+        }
+    }
+
+    int16_t drawChar(char c, int32_t x, int32_t y)
+    {
+        const GFXglyph *glyph = &font->glyph[c - font->first];
+        const uint8_t *bitmap = font->bitmap + glyph->bitmapOffset;
+
+        // the rows of a glyph are packed without padding
+        for (uint8_t yy = 0; yy < glyph->height; yy++)
+        {
+            int16_t run = -1;
+
+            for (uint8_t xx = 0; xx <= glyph->width; xx++)
+            {
+                uint32_t bit = yy * glyph->width + xx;
+                bool set = xx < glyph->width && (bitmap[bit / 8] & (0x80 >> (bit % 8))) != 0;
+
+                if (set && run < 0)
+                {
+                    run = xx;
+                }
+                else if (!set && run >= 0)
+                {
+                    fillRect(x + (glyph->xOffset + run) * textSize, y + (glyph->yOffset + yy) * textSize,
+                             (xx - run) * textSize, textSize, textColor);
+                    run = -1;
+                }
+            }
+        }
+        return glyph->xAdvance * textSize;
+    }
+
+    int16_t frameWidth;
+    int16_t frameHeight;
+    uint16_t *frame;
+    bool panel;
+    uint32_t windows;
+    uint64_t bytes;
+    bool swapBytes;
+    const GFXfont *font;
+    uint8_t textSize;
+    uint16_t textColor;
+    uint8_t textDatum;
+    int16_t baseline;
+};
+
+// drawing into a sprite stays in memory, pushSprite() sends it to the panel
+class TFT_eSprite : public TFT_eSPI
+{
+public:
+    TFT_eSprite(TFT_eSPI *display) : TFT_eSPI(0, 0), display(display) { panel = false; }
+
+    void setColorDepth(int8_t depth) { (void)depth; }
+
+    void *createSprite(int16_t width, int16_t height)
+    {
+        free(frame);
+        frameWidth = width;
+        frameHeight = height;
+        frame = (uint16_t *)calloc((size_t)width * height, sizeof(uint16_t));
+        return frame;
+    }
+
+    void deleteSprite()
+    {
+        free(frame);
+        frame = NULL;
+    }
+
+    void fillSprite(uint16_t color) { fillRect(0, 0, frameWidth, frameHeight, color); }
+
+    void pushSprite(int32_t x, int32_t y)
+    {
+        bool swap = display->getSwapBytes();
+
+        display->setSwapBytes(true);
+        display->pushImage(x, y, frameWidth, frameHeight, frame);
+        display->setSwapBytes(swap);
+    }
+
+private:
+    TFT_eSPI *display;
+};
+
+struct M5Core2
+{
+    TFT_eSPI Lcd;
+};
+
+inline M5Core2 M5;
+
+#endif /* M5CORE2_H */
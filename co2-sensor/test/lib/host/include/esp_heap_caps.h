@@ -0,0 +1,54 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef ESP_HEAP_CAPS_H
+#define ESP_HEAP_CAPS_H ESP_HEAP_CAPS_H
+
+/* host stand-in for the ESP-IDF heap, there is only one kind of memory */
+
+#include <stdlib.h>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+
+static inline void *heap_caps_malloc(size_t size, unsigned int caps)
+{
+    (void)caps;
+    return malloc(size);
+}
+
+static inline size_t heap_caps_get_free_size(unsigned int caps)
+{
+    (void)caps;
+    return 0;
+}
+
+static inline size_t heap_caps_get_minimum_free_size(unsigned int caps)
+{
+    (void)caps;
+    return 0;
+}
+
+static inline size_t heap_caps_get_largest_free_block(unsigned int caps)
+{
+    (void)caps;
+    return 0;
+}
+
+#endif /* ESP_HEAP_CAPS_H */
@@ -0,0 +1,39 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ESP_TIMER_H
+#define ESP_TIMER_H ESP_TIMER_H
+
+/* host stand-in for the ESP-IDF timer */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* microseconds since the start, like on the device */
+int64_t esp_timer_get_time(void);
+
+/* host only: moves the clock ahead, for what happens after years of uptime */
+void esp_timer_advance(int64_t us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESP_TIMER_H */
@@ -0,0 +1,62 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SEMPHR_H
+#define SEMPHR_H SEMPHR_H
+
+/*
+ * host stand-in, a mutex only: with a single thread a mutex which is taken
+ * stays taken, so a take of it fails at once instead of waiting
+ */
+
+#include <freertos/FreeRTOS.h>
+
+#include <stdlib.h>
+
+struct host_mutex {
+    int taken;
+};
+
+typedef struct host_mutex *SemaphoreHandle_t;
+
+static inline SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return (SemaphoreHandle_t)calloc(1, sizeof(struct host_mutex));
+}
+
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t wait)
+{
+    (void)wait;
+    if (mutex->taken) {
+        return pdFALSE;
+    }
+    mutex->taken = 1;
+    return pdTRUE;
+}
+
+static inline BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex)
+{
+    mutex->taken = 0;
+    return pdTRUE;
+}
+
+static inline void vSemaphoreDelete(SemaphoreHandle_t mutex)
+{
+    free(mutex);
+}
+
+#endif /* SEMPHR_H */
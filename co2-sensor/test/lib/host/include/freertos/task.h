@@ -0,0 +1,56 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TASK_H
+#define TASK_H TASK_H
+
+/*
+ * host stand-in, tasks are created but never run: a test calls the step the
+ * task would loop over itself
+ */
+
+#include <freertos/FreeRTOS.h>
+
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+static inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char *name, uint32_t stack, void *arg,
+                                                 uint32_t priority, TaskHandle_t *handle, BaseType_t core)
+{
+    (void)code;
+    (void)name;
+    (void)stack;
+    (void)priority;
+    (void)core;
+    *handle = arg;
+    return pdPASS;
+}
+
+static inline BaseType_t xTaskNotifyGive(TaskHandle_t handle)
+{
+    (void)handle;
+    return pdPASS;
+}
+
+static inline uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait)
+{
+    (void)clear;
+    (void)wait;
+    return 0;
+}
+
+#endif /* TASK_H */
@@ -0,0 +1,51 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef HOST_AGENT_H
+#define HOST_AGENT_H HOST_AGENT_H
+
+/*
+ * The SNMP agent with the SENSORHUB-MIB in process: a request goes straight
+ * into the receive callback of the agent pcb and the response is captured
+ * from udp_sendto(), so no socket and no scheduler is in between.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* MAC address the engine id is derived from */
+#define HOST_AGENT_MAC { 0x24, 0x0a, 0xc4, 0x12, 0x34, 0x56 }
+
+/* starts the agent once, resets the sensors, users, the engine and the rate limit every time */
+void host_agent_init(void);
+
+/*
+ * Hands frame to the agent as a datagram from 127.0.0.1. Returns the length
+ * of the response, 0 if the agent did not answer.
+ */
+size_t host_agent_request(const uint8_t *frame, size_t len, uint8_t *response, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_AGENT_H */
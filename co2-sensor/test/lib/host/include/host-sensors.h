@@ -0,0 +1,50 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef HOST_SENSORS_H
+#define HOST_SENSORS_H HOST_SENSORS_H
+
+/*
+ * The sensor lookups of sensorhub-mib.h for the host build, in place of the
+ * ones of main.cpp. Sensor 1 is an air sensor with CO2, temperature and
+ * humidity, sensor 2 the battery, like on the device.
+ */
+
+#include "lwip/arch.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HOST_SENSORS_MAX 10
+
+/* back to the two sensors and their start values */
+void host_sensors_reset(void);
+
+/* adds or replaces a sensor, types is not copied */
+void host_sensors_add(u32_t sensor_id, const char *name, const u8_t *types, u8_t types_len);
+
+void host_sensors_set(u32_t sensor_id, u32_t measurement_type, int value);
+
+void host_sensors_set_raw(u32_t sensor_id, u32_t measurement_type, int raw);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_SENSORS_H */
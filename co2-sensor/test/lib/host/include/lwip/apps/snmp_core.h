@@ -0,0 +1,330 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LWIP_HDR_APPS_SNMP_CORE_H
+#define LWIP_HDR_APPS_SNMP_CORE_H
+
+#include "lwip/apps/snmp_opts.h"
+
+#if LWIP_SNMP
+
+#include "lwip/ip_addr.h"
+#include "lwip/err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* basic ASN1 defines */
+#define SNMP_ASN1_CLASS_UNIVERSAL 0x00
+#define SNMP_ASN1_CLASS_APPLICATION 0x40
+#define SNMP_ASN1_CLASS_CONTEXT 0x80
+#define SNMP_ASN1_CLASS_PRIVATE 0xC0
+
+#define SNMP_ASN1_CONTENTTYPE_PRIMITIVE 0x00
+#define SNMP_ASN1_CONTENTTYPE_CONSTRUCTED 0x20
+
+/* universal tags (from ASN.1 spec.) */
+#define SNMP_ASN1_UNIVERSAL_END_OF_CONTENT 0
+#define SNMP_ASN1_UNIVERSAL_INTEGER 2
+#define SNMP_ASN1_UNIVERSAL_OCTET_STRING 4
+#define SNMP_ASN1_UNIVERSAL_NULL 5
+#define SNMP_ASN1_UNIVERSAL_OBJECT_ID 6
+#define SNMP_ASN1_UNIVERSAL_SEQUENCE_OF 16
+
+/* application specific (SNMP) tags (from SNMPv2-SMI) */
+#define SNMP_ASN1_APPLICATION_IPADDR 0
+#define SNMP_ASN1_APPLICATION_COUNTER 1
+#define SNMP_ASN1_APPLICATION_GAUGE 2
+#define SNMP_ASN1_APPLICATION_TIMETICKS 3
+#define SNMP_ASN1_APPLICATION_OPAQUE 4
+#define SNMP_ASN1_APPLICATION_COUNTER64 6
+
+/* context specific (SNMP) tags (from RFC 1905) */
+#define SNMP_ASN1_CONTEXT_VARBIND_NO_SUCH_INSTANCE 1
+
+/* full ASN1 type defines */
+#define SNMP_ASN1_TYPE_END_OF_CONTENT (SNMP_ASN1_CLASS_UNIVERSAL | SNMP_ASN1_CONTENTTYPE_PRIMITIVE | SNMP_ASN1_UNIVERSAL_END_OF_CONTENT)
+#define SNMP_ASN1_TYPE_INTEGER (SNMP_ASN1_CLASS_UNIVERSAL | SNMP_ASN1_CONTENTTYPE_PRIMITIVE | SNMP_ASN1_UNIVERSAL_INTEGER)
+#define SNMP_ASN1_TYPE_OCTET_STRING (SNMP_ASN1_CLASS_UNIVERSAL | SNMP_ASN1_CONTENTTYPE_PRIMITIVE | SNMP_ASN1_UNIVERSAL_OCTET_STRING)
+#define SNMP_ASN1_TYPE_NULL (SNMP_ASN1_CLASS_UNIVERSAL | SNMP_ASN1_CONTENTTYPE_PRIMITIVE | SNMP_ASN1_UNIVERSAL_NULL)
+#define SNMP_ASN1_TYPE_OBJECT_ID (SNMP_ASN1_CLASS_UNIVERSAL | SNMP_ASN1_CONTENTTYPE_PRIMITIVE | SNMP_ASN1_UNIVERSAL_OBJECT_ID)
+#define SNMP_ASN1_TYPE_SEQUENCE (SNMP_ASN1_CLASS_UNIVERSAL | SNMP_ASN1_CONTENTTYPE_CONSTRUCTED | SNMP_ASN1_UNIVERSAL_SEQUENCE_OF)
+#define SNMP_ASN1_TYPE_IPADDR (SNMP_ASN1_CLASS_APPLICATION | SNMP_ASN1_CONTENTTYPE_PRIMITIVE | SNMP_ASN1_APPLICATION_IPADDR)
+#define SNMP_ASN1_TYPE_IPADDRESS SNMP_ASN1_TYPE_IPADDR
+#define SNMP_ASN1_TYPE_COUNTER (SNMP_ASN1_CLASS_APPLICATION | SNMP_ASN1_CONTENTTYPE_PRIMITIVE | SNMP_ASN1_APPLICATION_COUNTER)
+#define SNMP_ASN1_TYPE_COUNTER32 SNMP_ASN1_TYPE_COUNTER
+#define SNMP_ASN1_TYPE_GAUGE (SNMP_ASN1_CLASS_APPLICATION | SNMP_ASN1_CONTENTTYPE_PRIMITIVE | SNMP_ASN1_APPLICATION_GAUGE)
+#define SNMP_ASN1_TYPE_GAUGE32 SNMP_ASN1_TYPE_GAUGE
+#define SNMP_ASN1_TYPE_UNSIGNED32 SNMP_ASN1_TYPE_GAUGE
+#define SNMP_ASN1_TYPE_TIMETICKS (SNMP_ASN1_CLASS_APPLICATION | SNMP_ASN1_CONTENTTYPE_PRIMITIVE | SNMP_ASN1_APPLICATION_TIMETICKS)
+#define SNMP_ASN1_TYPE_OPAQUE (SNMP_ASN1_CLASS_APPLICATION | SNMP_ASN1_CONTENTTYPE_PRIMITIVE | SNMP_ASN1_APPLICATION_OPAQUE)
+#define SNMP_ASN1_TYPE_COUNTER64 (SNMP_ASN1_CLASS_APPLICATION | SNMP_ASN1_CONTENTTYPE_PRIMITIVE | SNMP_ASN1_APPLICATION_COUNTER64)
+
+#define SNMP_VARBIND_EXCEPTION_OFFSET 0xF0
+#define SNMP_VARBIND_EXCEPTION_MASK 0x0F
+
+/** error codes predefined by SNMP prot. */
+typedef enum {
+    SNMP_ERR_NOERROR = 0,
+    /* snmp v1 error codes */
+    SNMP_ERR_TOOBIG = 1,
+    SNMP_ERR_NOSUCHNAME = 2,
+    SNMP_ERR_BADVALUE = 3,
+    SNMP_ERR_READONLY = 4,
+    SNMP_ERR_GENERROR = 5,
+    /* snmp v2 error codes */
+    SNMP_ERR_NOACCESS = 6,
+    SNMP_ERR_WRONGTYPE = 7,
+    SNMP_ERR_WRONGLENGTH = 8,
+    SNMP_ERR_WRONGENCODING = 9,
+    SNMP_ERR_WRONGVALUE = 10,
+    SNMP_ERR_NOCREATION = 11,
+    SNMP_ERR_INCONSISTENTVALUE = 12,
+    SNMP_ERR_RESOURCEUNAVAILABLE = 13,
+    SNMP_ERR_COMMITFAILED = 14,
+    SNMP_ERR_UNDOFAILED = 15,
+    SNMP_ERR_AUTHORIZATIONERROR = 16,
+    SNMP_ERR_NOTWRITABLE = 17,
+    SNMP_ERR_INCONSISTENTNAME = 18,
+    /* varbind exceptions */
+    SNMP_ERR_NOSUCHOBJECT = SNMP_VARBIND_EXCEPTION_OFFSET + 0,
+    SNMP_ERR_NOSUCHINSTANCE = SNMP_VARBIND_EXCEPTION_OFFSET + 1,
+    SNMP_ERR_ENDOFMIBVIEW = SNMP_VARBIND_EXCEPTION_OFFSET + 2
+} snmp_err_t;
+
+/** internal object identifier representation */
+struct snmp_obj_id {
+    u8_t len;
+    u32_t id[SNMP_MAX_OBJ_ID_LEN];
+};
+
+struct snmp_obj_id_const_ref {
+    u8_t len;
+    const u32_t *id;
+};
+
+extern const struct snmp_obj_id_const_ref snmp_zero_dot_zero; /* administrative identifier from SNMPv2-SMI */
+
+/** SNMP variant value, used as reference in struct snmp_node_instance and table implementation */
+union snmp_variant_value {
+    void *ptr;
+    const void *const_ptr;
+    u32_t u32;
+    s32_t s32;
+    u64_t u64;
+};
+
+/* node types, a tree node is the only one the stack walks, all others are leafs */
+#define SNMP_NODE_TREE 0x00
+#define SNMP_NODE_SCALAR 0x01
+#define SNMP_NODE_SCALAR_ARRAY 0x02
+#define SNMP_NODE_TABLE 0x03
+#define SNMP_NODE_THREADSYNC 0x04
+
+/** node "base class" layout, the mandatory fields for a node */
+struct snmp_node {
+    /** one out of SNMP_NODE_TREE or any leaf node type (like SNMP_NODE_SCALAR) */
+    u8_t node_type;
+    /** the number assigned to this node which used as part of the full OID */
+    u32_t oid;
+};
+
+/** SNMP node instance access types */
+typedef enum {
+    SNMP_NODE_INSTANCE_ACCESS_READ = 1,
+    SNMP_NODE_INSTANCE_ACCESS_WRITE = 2,
+    SNMP_NODE_INSTANCE_READ_ONLY = SNMP_NODE_INSTANCE_ACCESS_READ,
+    SNMP_NODE_INSTANCE_READ_WRITE = (SNMP_NODE_INSTANCE_ACCESS_READ | SNMP_NODE_INSTANCE_ACCESS_WRITE),
+    SNMP_NODE_INSTANCE_WRITE_ONLY = SNMP_NODE_INSTANCE_ACCESS_WRITE,
+    SNMP_NODE_INSTANCE_NOT_ACCESSIBLE = 0
+} snmp_access_t;
+
+struct snmp_node_instance;
+
+typedef s16_t (*node_instance_get_value_method)(struct snmp_node_instance *, void *);
+typedef snmp_err_t (*node_instance_set_test_method)(struct snmp_node_instance *, u16_t, void *);
+typedef snmp_err_t (*node_instance_set_value_method)(struct snmp_node_instance *, u16_t, void *);
+typedef void (*node_instance_release_method)(struct snmp_node_instance *);
+
+/* do not use 0x8000, the return value of node_instance_get_value_method is signed */
+#define SNMP_GET_VALUE_RAW_DATA 0x4000
+
+/** SNMP node instance */
+struct snmp_node_instance {
+    /** prefilled with the node get_instance() is called on */
+    const struct snmp_node *node;
+    /** prefilled with the instance id requested */
+    struct snmp_obj_id instance_oid;
+
+    /** ASN type for this object */
+    u8_t asn1_type;
+    /** one out of the instance access types defined above */
+    snmp_access_t access;
+
+    /** returns object value for the given object identifier. Return values <0 to indicate an error */
+    node_instance_get_value_method get_value;
+    /** tests length and/or range BEFORE setting */
+    node_instance_set_test_method set_test;
+    /** sets object value, only called when set_test() was successful */
+    node_instance_set_value_method set_value;
+    /** called in any case when the instance is not required anymore by stack */
+    node_instance_release_method release_instance;
+
+    /** reference to pass arbitrary value between calls to get_instance() and get_value/test_value/set_value */
+    union snmp_variant_value reference;
+    /** see reference (if reference is a pointer, the length of underlying data may be stored here or anything else) */
+    u32_t reference_len;
+};
+
+/** SNMP tree node */
+struct snmp_tree_node {
+    /** inherited "base class" members */
+    struct snmp_node node;
+    u16_t subnode_count;
+    const struct snmp_node *const *subnodes;
+};
+
+#define SNMP_CREATE_TREE_NODE(oid, subnodes) \
+    {{ SNMP_NODE_TREE, (oid) }, \
+     (u16_t)LWIP_ARRAYSIZE(subnodes), (subnodes) }
+
+#define SNMP_CREATE_EMPTY_TREE_NODE(oid) \
+    {{ SNMP_NODE_TREE, (oid) }, \
+     0, NULL }
+
+/** SNMP leaf node */
+struct snmp_leaf_node {
+    /** inherited "base class" members */
+    struct snmp_node node;
+    snmp_err_t (*get_instance)(const u32_t *root_oid, u8_t root_oid_len, struct snmp_node_instance *instance);
+    snmp_err_t (*get_next_instance)(const u32_t *root_oid, u8_t root_oid_len, struct snmp_node_instance *instance);
+};
+
+/** represents a single mib with its base oid and root node */
+struct snmp_mib {
+    const u32_t *base_oid;
+    u8_t base_oid_len;
+    const struct snmp_node *root_node;
+};
+
+#define SNMP_MIB_CREATE(oid_list, root_node) { (oid_list), (u8_t)LWIP_ARRAYSIZE(oid_list), root_node }
+
+/** OID range structure */
+struct snmp_oid_range {
+    u32_t min;
+    u32_t max;
+};
+
+/** checks if incoming OID length and values are in allowed ranges */
+u8_t snmp_oid_in_range(const u32_t *oid_in, u8_t oid_len, const struct snmp_oid_range *oid_ranges, u8_t oid_ranges_len);
+
+typedef enum {
+    SNMP_NEXT_OID_STATUS_SUCCESS,
+    SNMP_NEXT_OID_STATUS_NO_MATCH,
+    SNMP_NEXT_OID_STATUS_BUF_TO_SMALL
+} snmp_next_oid_status_t;
+
+/** state for next_oid_init / next_oid_check functions */
+struct snmp_next_oid_state {
+    const u32_t *start_oid;
+    u8_t start_oid_len;
+
+    u32_t *next_oid;
+    u8_t next_oid_len;
+    u8_t next_oid_max_len;
+
+    snmp_next_oid_status_t status;
+    void *reference;
+};
+
+void snmp_next_oid_init(struct snmp_next_oid_state *state,
+                        const u32_t *start_oid, u8_t start_oid_len,
+                        u32_t *next_oid_buf, u8_t next_oid_max_len);
+u8_t snmp_next_oid_precheck(struct snmp_next_oid_state *state, const u32_t *oid, const u8_t oid_len);
+u8_t snmp_next_oid_check(struct snmp_next_oid_state *state, const u32_t *oid, const u8_t oid_len, void *reference);
+
+void snmp_oid_assign(struct snmp_obj_id *target, const u32_t *oid, u8_t oid_len);
+void snmp_oid_combine(struct snmp_obj_id *target, const u32_t *oid1, u8_t oid1_len, const u32_t *oid2, u8_t oid2_len);
+void snmp_oid_prefix(struct snmp_obj_id *target, const u32_t *oid, u8_t oid_len);
+void snmp_oid_append(struct snmp_obj_id *target, const u32_t *oid, u8_t oid_len);
+u8_t snmp_oid_equal(const u32_t *oid1, u8_t oid1_len, const u32_t *oid2, u8_t oid2_len);
+s8_t snmp_oid_compare(const u32_t *oid1, u8_t oid1_len, const u32_t *oid2, u8_t oid2_len);
+
+#if LWIP_IPV4
+u8_t snmp_oid_to_ip4(const u32_t *oid, ip4_addr_t *ip);
+void snmp_ip4_to_oid(const ip4_addr_t *ip, u32_t *oid);
+#endif /* LWIP_IPV4 */
+
+#if LWIP_IPV4 || LWIP_IPV6
+u8_t snmp_ip_to_oid(const ip_addr_t *ip, u32_t *oid);
+u8_t snmp_ip_port_to_oid(const ip_addr_t *ip, u16_t port, u32_t *oid);
+
+u8_t snmp_oid_to_ip(const u32_t *oid, u8_t oid_len, ip_addr_t *ip);
+u8_t snmp_oid_to_ip_port(const u32_t *oid, u8_t oid_len, ip_addr_t *ip, u16_t *port);
+#endif /* LWIP_IPV4 || LWIP_IPV6 */
+
+struct netif;
+u8_t netif_to_num(const struct netif *netif);
+
+/* generic function which can be used if test is always successful */
+snmp_err_t snmp_set_test_ok(struct snmp_node_instance *instance, u16_t value_len, void *value);
+
+err_t snmp_decode_bits(const u8_t *buf, u32_t buf_len, u32_t *bit_value);
+err_t snmp_decode_truthvalue(const s32_t *asn1_value, u8_t *bool_value);
+u8_t snmp_encode_bits(u8_t *buf, u32_t buf_len, u32_t bit_value, u8_t bit_count);
+u8_t snmp_encode_truthvalue(s32_t *asn1_value, u32_t bool_value);
+
+struct snmp_statistics {
+    u32_t inpkts;
+    u32_t outpkts;
+    u32_t inbadversions;
+    u32_t inbadcommunitynames;
+    u32_t inbadcommunityuses;
+    u32_t inasnparseerrs;
+    u32_t intoobigs;
+    u32_t innosuchnames;
+    u32_t inbadvalues;
+    u32_t inreadonlys;
+    u32_t ingenerrs;
+    u32_t intotalreqvars;
+    u32_t intotalsetvars;
+    u32_t ingetrequests;
+    u32_t ingetnexts;
+    u32_t insetrequests;
+    u32_t ingetresponses;
+    u32_t intraps;
+    u32_t outtoobigs;
+    u32_t outnosuchnames;
+    u32_t outbadvalues;
+    u32_t outgenerrs;
+    u32_t outgetrequests;
+    u32_t outgetnexts;
+    u32_t outsetrequests;
+    u32_t outgetresponses;
+    u32_t outtraps;
+};
+
+extern struct snmp_statistics snmp_stats;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LWIP_SNMP */
+
+#endif /* LWIP_HDR_APPS_SNMP_CORE_H */
@@ -0,0 +1,137 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LWIP_HDR_SNMP_OPTS_H
+#define LWIP_HDR_SNMP_OPTS_H
+
+/*
+ * The lwIP 2.1 SNMP headers for the host build. src/snmp is taken from lwIP
+ * 2.1, the firmware gets these headers from the ESP32 Arduino core.
+ */
+
+#include "lwip/opt.h"
+
+#ifndef LWIP_SNMP
+#define LWIP_SNMP 0
+#endif
+
+#ifndef SNMP_USE_NETCONN
+#define SNMP_USE_NETCONN 0
+#endif
+
+#ifndef SNMP_USE_RAW
+#define SNMP_USE_RAW 1
+#endif
+
+#ifndef SNMP_STACK_SIZE
+#define SNMP_STACK_SIZE 4096
+#endif
+
+#ifndef SNMP_THREAD_PRIO
+#define SNMP_THREAD_PRIO 1
+#endif
+
+#ifndef SNMP_TRAP_DESTINATIONS
+#define SNMP_TRAP_DESTINATIONS 1
+#endif
+
+#ifndef SNMP_SAFE_REQUESTS
+#define SNMP_SAFE_REQUESTS 1
+#endif
+
+#ifndef SNMP_MAX_OCTET_STRING_LEN
+#define SNMP_MAX_OCTET_STRING_LEN 127
+#endif
+
+#ifndef SNMP_MAX_OBJ_ID_LEN
+#define SNMP_MAX_OBJ_ID_LEN 50
+#endif
+
+#ifndef SNMP_COMMUNITY
+#define SNMP_COMMUNITY "public"
+#endif
+
+#ifndef SNMP_COMMUNITY_WRITE
+#define SNMP_COMMUNITY_WRITE "private"
+#endif
+
+#ifndef SNMP_COMMUNITY_TRAP
+#define SNMP_COMMUNITY_TRAP "public"
+#endif
+
+#ifndef SNMP_MAX_COMMUNITY_STR_LEN
+#define SNMP_MAX_COMMUNITY_STR_LEN LWIP_MAX(LWIP_MAX(sizeof(SNMP_COMMUNITY), sizeof(SNMP_COMMUNITY_WRITE)), sizeof(SNMP_COMMUNITY_TRAP))
+#endif
+
+#ifndef SNMP_MAX_VALUE_SIZE
+#define SNMP_MAX_VALUE_SIZE LWIP_MAX(LWIP_MAX((SNMP_MAX_OCTET_STRING_LEN), sizeof(u32_t) * (SNMP_MAX_OBJ_ID_LEN)), SNMP_MAX_COMMUNITY_STR_LEN)
+#endif
+
+#ifndef SNMP_LWIP_ENTERPRISE_OID
+#define SNMP_LWIP_ENTERPRISE_OID 26381
+#endif
+
+#ifndef SNMP_DEVICE_ENTERPRISE_OID
+#define SNMP_DEVICE_ENTERPRISE_OID { 1, 3, 6, 1, 4, 1, SNMP_LWIP_ENTERPRISE_OID }
+#define SNMP_DEVICE_ENTERPRISE_OID_LEN 7
+#endif
+
+#ifndef SNMP_DEBUG
+#define SNMP_DEBUG LWIP_DBG_OFF
+#endif
+
+#ifndef SNMP_MIB_DEBUG
+#define SNMP_MIB_DEBUG LWIP_DBG_OFF
+#endif
+
+#ifndef SNMP_LWIP_MIB2
+#define SNMP_LWIP_MIB2 LWIP_SNMP
+#endif
+
+#ifndef SNMP_LWIP_MIB2_SYSDESC
+#define SNMP_LWIP_MIB2_SYSDESC "lwIP"
+#endif
+
+#ifndef SNMP_LWIP_MIB2_SYSNAME
+#define SNMP_LWIP_MIB2_SYSNAME "FQDN-unk"
+#endif
+
+#ifndef SNMP_LWIP_MIB2_SYSCONTACT
+#define SNMP_LWIP_MIB2_SYSCONTACT ""
+#endif
+
+#ifndef SNMP_LWIP_MIB2_SYSLOCATION
+#define SNMP_LWIP_MIB2_SYSLOCATION ""
+#endif
+
+#ifndef SNMP_LWIP_GETBULK_MAX_REPETITIONS
+#define SNMP_LWIP_GETBULK_MAX_REPETITIONS 0
+#endif
+
+#ifndef LWIP_SNMP_V3
+#define LWIP_SNMP_V3 0
+#endif
+
+#ifndef LWIP_SNMP_V3_MBEDTLS
+#define LWIP_SNMP_V3_MBEDTLS LWIP_SNMP_V3
+#endif
+
+#ifndef LWIP_SNMP_V3_CRYPTO
+#define LWIP_SNMP_V3_CRYPTO LWIP_SNMP_V3_MBEDTLS
+#endif
+
+#endif /* LWIP_HDR_SNMP_OPTS_H */
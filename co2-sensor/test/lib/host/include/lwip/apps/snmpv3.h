@@ -0,0 +1,65 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LWIP_HDR_APPS_SNMP_V3_H
+#define LWIP_HDR_APPS_SNMP_V3_H
+
+#include "lwip/apps/snmp_opts.h"
+#include "lwip/err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if LWIP_SNMP && LWIP_SNMP_V3
+
+#define SNMP_V3_AUTH_ALGO_INVAL 0
+#define SNMP_V3_AUTH_ALGO_MD5 1
+#define SNMP_V3_AUTH_ALGO_SHA 2
+
+#define SNMP_V3_PRIV_ALGO_INVAL 0
+#define SNMP_V3_PRIV_ALGO_DES 1
+#define SNMP_V3_PRIV_ALGO_AES 2
+
+#define SNMP_V3_PRIV_MODE_DECRYPT 0
+#define SNMP_V3_PRIV_MODE_ENCRYPT 1
+
+/* implemented by the application, see snmpv3-users.c */
+void snmpv3_get_engine_id(const char **id, u8_t *len);
+err_t snmpv3_set_engine_id(const char *id, u8_t len);
+
+u32_t snmpv3_get_engine_boots(void);
+void snmpv3_set_engine_boots(u32_t boots);
+
+u32_t snmpv3_get_engine_time(void);
+void snmpv3_reset_engine_time(void);
+
+err_t snmpv3_get_user(const char *username, u8_t *auth_algo, u8_t *auth_key, u8_t *priv_algo, u8_t *priv_key);
+
+/* provided by the SNMPv3 agent */
+void snmpv3_engine_id_changed(void);
+
+void snmpv3_password_to_key_md5(const u8_t *password, u8_t passwordlen, const u8_t *engineID, u8_t engineLength, u8_t *key);
+void snmpv3_password_to_key_sha(const u8_t *password, u8_t passwordlen, const u8_t *engineID, u8_t engineLength, u8_t *key);
+
+#endif /* LWIP_SNMP && LWIP_SNMP_V3 */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LWIP_HDR_APPS_SNMP_V3_H */
@@ -0,0 +1,32 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LWIP_HDR_DEBUG_H
+#define LWIP_HDR_DEBUG_H
+
+#include "lwip/arch.h"
+
+#define LWIP_DBG_OFF 0x00U
+#define LWIP_DBG_ON 0x80U
+
+#define LWIP_ASSERT(message, assertion) do { if (!(assertion)) { LWIP_PLATFORM_ASSERT(message); } } while (0)
+
+#define LWIP_ERROR(message, expression, handler) do { if (!(expression)) { handler; } } while (0)
+
+#define LWIP_DEBUGF(debug, message) do { } while (0)
+
+#endif /* LWIP_HDR_DEBUG_H */
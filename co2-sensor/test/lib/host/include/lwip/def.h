@@ -0,0 +1,41 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LWIP_HDR_DEF_H
+#define LWIP_HDR_DEF_H
+
+#include "lwip/arch.h"
+#include "lwip/opt.h"
+
+#define LWIP_MAX(x, y) (((x) > (y)) ? (x) : (y))
+#define LWIP_MIN(x, y) (((x) < (y)) ? (x) : (y))
+
+#define LWIP_ARRAYSIZE(x) (sizeof(x) / sizeof((x)[0]))
+
+#define LWIP_MAKEU32(a, b, c, d) (((u32_t)((a) & 0xff) << 24) | ((u32_t)((b) & 0xff) << 16) | \
+                                  ((u32_t)((c) & 0xff) << 8) | (u32_t)((d) & 0xff))
+
+#define lwip_htons(x) ((u16_t)((((x) & 0x00ffU) << 8) | (((x) & 0xff00U) >> 8)))
+#define lwip_ntohs(x) lwip_htons(x)
+#define lwip_htonl(x) ((((x) & 0x000000ffUL) << 24) | (((x) & 0x0000ff00UL) << 8) | \
+                       (((x) & 0x00ff0000UL) >> 8) | (((x) & 0xff000000UL) >> 24))
+#define lwip_ntohl(x) lwip_htonl(x)
+
+#define PP_HTONL(x) lwip_htonl(x)
+#define PP_NTOHL(x) lwip_ntohl(x)
+
+#endif /* LWIP_HDR_DEF_H */
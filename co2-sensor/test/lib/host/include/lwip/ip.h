@@ -0,0 +1,33 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LWIP_HDR_IP_H
+#define LWIP_HDR_IP_H
+
+#include "lwip/opt.h"
+#include "lwip/ip_addr.h"
+#include "lwip/netif.h"
+
+/* replies leave through the only interface */
+#define ip_route_get_local_ip(src, dest, netif, ipaddr) do { \
+    LWIP_UNUSED_ARG(src); \
+    LWIP_UNUSED_ARG(dest); \
+    (netif) = netif_list; \
+    (ipaddr) = (netif) != NULL ? &(netif)->ip_addr : NULL; \
+} while (0)
+
+#endif /* LWIP_HDR_IP_H */
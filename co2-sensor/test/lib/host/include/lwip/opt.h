@@ -0,0 +1,50 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LWIP_HDR_OPT_H
+#define LWIP_HDR_OPT_H
+
+#include "lwipopts.h"
+#include "lwip/debug.h"
+
+#include <string.h>
+
+#ifndef MEMCPY
+#define MEMCPY(dst, src, len) memcpy(dst, src, len)
+#endif
+
+#ifndef SMEMCPY
+#define SMEMCPY(dst, src, len) memcpy(dst, src, len)
+#endif
+
+#ifndef MEMSET
+#define MEMSET(s, c, n) memset(s, c, n)
+#endif
+
+#ifndef LWIP_IPV4
+#define LWIP_IPV4 1
+#endif
+
+#ifndef LWIP_IPV6
+#define LWIP_IPV6 0
+#endif
+
+#ifndef LWIP_UDP
+#define LWIP_UDP 1
+#endif
+
+#endif /* LWIP_HDR_OPT_H */
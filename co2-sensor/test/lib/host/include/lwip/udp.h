@@ -0,0 +1,77 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LWIP_HDR_UDP_H
+#define LWIP_HDR_UDP_H
+
+/*
+ * The raw UDP API on top of a POSIX socket. Datagrams are only delivered to
+ * the receive callback from udp_poll() or udp_input(), so the caller decides
+ * which thread is the tcpip thread. With an output function set, sent
+ * datagrams go to it instead of the socket, so tests and benchmarks can run
+ * the agent without the network stack in between.
+ */
+
+#include "lwip/opt.h"
+#include "lwip/pbuf.h"
+#include "lwip/ip_addr.h"
+#include "lwip/err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct udp_pcb;
+
+typedef void (*udp_recv_fn)(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port);
+
+/* host only: receives every datagram sent from the pcb, p still belongs to the caller */
+typedef void (*udp_output_fn)(void *arg, struct pbuf *p, const ip_addr_t *dst_ip, u16_t dst_port);
+
+struct udp_pcb {
+    ip_addr_t local_ip;
+    u16_t local_port;
+    int fd;
+    udp_recv_fn recv;
+    void *recv_arg;
+    udp_output_fn output;
+    void *output_arg;
+};
+
+struct udp_pcb *udp_new_ip_type(u8_t type);
+void udp_remove(struct udp_pcb *pcb);
+err_t udp_bind(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port);
+void udp_recv(struct udp_pcb *pcb, udp_recv_fn recv, void *recv_arg);
+err_t udp_sendto(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *dst_ip, u16_t dst_port);
+
+/* host only: port to bind to instead of the one asked for, 0 picks a free one */
+void udp_set_port_override(u16_t port);
+
+/* host only: delivers at most one datagram to pcb, returns 0 on timeout */
+int udp_poll(struct udp_pcb *pcb, int timeout_ms);
+
+/* host only: sends the datagrams of pcb to output instead of the socket, NULL restores the socket */
+void udp_set_output(struct udp_pcb *pcb, udp_output_fn output, void *arg);
+
+/* host only: delivers data to the receive callback of pcb as if it came from src_ip:src_port */
+err_t udp_input(struct udp_pcb *pcb, const void *data, u16_t len, const ip_addr_t *src_ip, u16_t src_port);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LWIP_HDR_UDP_H */
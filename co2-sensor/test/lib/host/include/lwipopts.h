@@ -0,0 +1,38 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LWIPOPTS_H
+#define LWIPOPTS_H LWIPOPTS_H
+
+/* lwIP options of the host build, the same as the -D flags of the firmware */
+
+#define LWIP_IPV4 1
+#define LWIP_IPV6 0
+#define LWIP_UDP 1
+
+#define LWIP_SNMP 1
+#define LWIP_SNMP_V3 1
+#define LWIP_SNMP_V3_MBEDTLS 1
+#define LWIP_SNMPV3_INCLUDE_ENGINE "snmpv3-users.h"
+#define SNMP_LWIP_RESPONSE_CACHE 1
+#define SNMP_USE_RAW 1
+#define SNMP_LWIP_MIB2 0
+
+/* the tests and benchmarks send far more than a manager would */
+#define SNMP_RATE_LIMIT_PER_SEC 0
+
+#endif /* LWIPOPTS_H */
@@ -0,0 +1,52 @@
+#ifndef MOCK_I2C_BUS_H
+#define MOCK_I2C_BUS_H MOCK_I2C_BUS_H
+
+#include <i2c-bus.h>
+
+#define MOCK_I2C_DEVICES_MAX 4
+
+/*
+ * Bus without hardware for running the drivers on the host. Devices are
+ * handlers answering the transactions addressed to them, queued transactions
+ * only complete on run(), so a test decides when the bus makes progress. Time
+ * is virtual: every transaction advances it by its delay plus busUs.
+ */
+class MockI2cBus : public I2cBus
+{
+public:
+    // fills transaction->rx, false NACKs the transaction
+    typedef bool (*device)(void *context, struct i2cTransaction *transaction);
+
+    MockI2cBus(uint32_t busUs = 100);
+
+    bool attach(uint8_t address, device handler, void *context);
+
+    bool submit(struct i2cTransaction *transaction);
+    bool transfer(struct i2cTransaction *transaction);
+
+    // completes up to max queued transactions in order, returns how many
+    uint8_t run(uint8_t max = I2C_QUEUE_LEN);
+
+    uint8_t queued() const;
+
+    // virtual µs since the bus was created
+    int64_t now() const;
+
+private:
+    struct attached
+    {
+        uint8_t address;
+        device handler;
+        void *context;
+    };
+
+    uint32_t busUs;
+    int64_t nowUs;
+    struct attached devices[MOCK_I2C_DEVICES_MAX];
+    uint8_t devicesLen;
+    struct i2cTransaction *queue[I2C_QUEUE_LEN];
+    uint8_t head;
+    uint8_t len;
+};
+
+#endif /* MOCK_I2C_BUS_H */
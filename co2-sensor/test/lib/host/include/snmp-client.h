@@ -0,0 +1,168 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef SNMP_CLIENT_H
+#define SNMP_CLIENT_H SNMP_CLIENT_H
+
+/*
+ * A small SNMP manager for the host tests, benchmarks and the fuzz seeds.
+ * It encodes requests and decodes responses on its own, with OpenSSL for
+ * the USM, so a bug in the BER code or the crypto of the agent does not
+ * cancel itself out. v1, v2c and v3 (MD5 / SHA-96, DES / AES-128) are
+ * supported, see RFC 3416 and RFC 3414.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SNMP_CLIENT_VERSION_1 0
+#define SNMP_CLIENT_VERSION_2C 1
+#define SNMP_CLIENT_VERSION_3 3
+
+#define SNMP_CLIENT_GET 0xa0
+#define SNMP_CLIENT_GETNEXT 0xa1
+#define SNMP_CLIENT_RESPONSE 0xa2
+#define SNMP_CLIENT_SET 0xa3
+#define SNMP_CLIENT_GETBULK 0xa5
+#define SNMP_CLIENT_REPORT 0xa8
+
+#define SNMP_CLIENT_AUTH_NONE 0
+#define SNMP_CLIENT_AUTH_MD5 1
+#define SNMP_CLIENT_AUTH_SHA 2
+
+#define SNMP_CLIENT_PRIV_NONE 0
+#define SNMP_CLIENT_PRIV_DES 1
+#define SNMP_CLIENT_PRIV_AES 2
+
+/* value types of a varbind */
+#define SNMP_CLIENT_INTEGER 0x02
+#define SNMP_CLIENT_OCTET_STRING 0x04
+#define SNMP_CLIENT_NULL 0x05
+#define SNMP_CLIENT_OBJECT_ID 0x06
+#define SNMP_CLIENT_COUNTER 0x41
+#define SNMP_CLIENT_GAUGE 0x42
+#define SNMP_CLIENT_TIMETICKS 0x43
+#define SNMP_CLIENT_NO_SUCH_OBJECT 0x80
+#define SNMP_CLIENT_NO_SUCH_INSTANCE 0x81
+#define SNMP_CLIENT_END_OF_MIB_VIEW 0x82
+
+#define SNMP_CLIENT_OID_MAX 32
+#define SNMP_CLIENT_VALUE_MAX 256
+#define SNMP_CLIENT_VARBINDS_MAX 128
+#define SNMP_CLIENT_FRAME_MAX 1500
+#define SNMP_CLIENT_ENGINE_ID_MAX 32
+
+struct snmp_client_oid {
+    uint32_t id[SNMP_CLIENT_OID_MAX];
+    uint8_t len;
+};
+
+struct snmp_client_varbind {
+    struct snmp_client_oid oid;
+    uint8_t type;
+    /* INTEGER, Counter32, Gauge32 and TimeTicks */
+    int64_t integer;
+    /* OCTET STRING and IpAddress */
+    uint8_t octets[SNMP_CLIENT_VALUE_MAX];
+    uint16_t octets_len;
+    /* OBJECT IDENTIFIER */
+    struct snmp_client_oid object_id;
+};
+
+struct snmp_client_response {
+    uint8_t version;
+    uint8_t pdu_type;
+    uint8_t msg_flags;
+    int32_t request_id;
+    int32_t error_status;
+    int32_t error_index;
+    uint8_t varbinds_len;
+    struct snmp_client_varbind varbinds[SNMP_CLIENT_VARBINDS_MAX];
+};
+
+struct snmp_client {
+    uint8_t version;
+    char community[33];
+
+    char user[33];
+    uint8_t auth_algo;
+    uint8_t priv_algo;
+    char auth_password[65];
+    char priv_password[65];
+    /* flags to send below the level of the user, to test the agent */
+    uint8_t msg_flags_mask;
+
+    /* learnt by discovery, the keys are localized to the engine id */
+    uint8_t engine_id[SNMP_CLIENT_ENGINE_ID_MAX];
+    uint8_t engine_id_len;
+    int32_t engine_boots;
+    int32_t engine_time;
+    uint8_t auth_key[20];
+    uint8_t priv_key[20];
+
+    int32_t request_id;
+    uint64_t salt;
+};
+
+void snmp_client_init(struct snmp_client *client, uint8_t version, const char *community);
+
+/* auth_password and priv_password are only used with their algorithm */
+void snmp_client_init_v3(struct snmp_client *client, const char *user,
+                         uint8_t auth_algo, const char *auth_password,
+                         uint8_t priv_algo, const char *priv_password);
+
+/* localizes the keys, normally done by snmp_client_decode() of the discovery report */
+void snmp_client_set_engine(struct snmp_client *client, const uint8_t *engine_id, uint8_t engine_id_len,
+                            int32_t boots, int32_t time);
+
+/* RFC 3414 A.2, key has room for 20 bytes */
+void snmp_client_password_to_key(uint8_t auth_algo, const char *password,
+                                 const uint8_t *engine_id, uint8_t engine_id_len, uint8_t *key);
+
+/* "1.3.6.1.2.1.1.1.0", 0 if text is not an OID */
+int snmp_client_parse_oid(const char *text, struct snmp_client_oid *oid);
+
+/* v3 without engine id: empty user and noAuthNoPriv, the agent answers with a report */
+size_t snmp_client_encode_discovery(struct snmp_client *client, uint8_t *frame, size_t size);
+
+/*
+ * Encodes a request with NULL values, non_repeaters and max_repetitions only
+ * for GETBULK. Returns the length of the frame, 0 if it does not fit.
+ */
+size_t snmp_client_encode(struct snmp_client *client, uint8_t pdu_type,
+                          const struct snmp_client_oid *oids, uint8_t oids_len,
+                          int32_t non_repeaters, int32_t max_repetitions,
+                          uint8_t *frame, size_t size);
+
+/*
+ * Decodes and for v3 authenticates and decrypts a response or report. The
+ * engine id, boots and time of the agent are taken over. Returns 0 if the
+ * frame is malformed or its authentication is wrong.
+ */
+int snmp_client_decode(struct snmp_client *client, const uint8_t *frame, size_t len,
+                       struct snmp_client_response *response);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SNMP_CLIENT_H */
@@ -0,0 +1,120 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef TRACES_H
+#define TRACES_H TRACES_H
+
+#include <stdint.h>
+
+/*
+ * Sample traces in the order they arrive from the sensors, one value per
+ * sample period. They are replayed through alerts_evaluate() and
+ * filter_process() with the same timing as the loop.
+ */
+
+#define TRACE_CO2_PERIOD_MS 5000
+#define TRACE_BATTERY_PERIOD_MS 60000
+
+/* co2 ppm every 5 s: empty room, a meeting, window opened after 40 min */
+static const int16_t trace_meeting_room[] = {
+    509, 505, 528, 518, 541, 529, 514, 530, 523, 513, 532, 513,
+    544, 532, 516, 518, 531, 502, 519, 502, 522, 520, 537, 517,
+    520, 537, 511, 535, 516, 506, 530, 527, 514, 539, 539, 511,
+    513, 519, 518, 511, 527, 520, 522, 520, 522, 509, 509, 514,
+    515, 532, 524, 510, 507, 536, 525, 530, 506, 519, 530, 538,
+    515, 520, 518, 523, 517, 525, 520, 535, 516, 511, 506, 523,
+    498, 507, 524, 540, 496, 511, 520, 519, 540, 528, 515, 536,
+    533, 529, 509, 527, 546, 521, 531, 504, 514, 514, 528, 541,
+    514, 530, 528, 512, 528, 520, 526, 512, 529, 530, 523, 515,
+    500, 507, 534, 523, 515, 532, 526, 509, 517, 528, 523, 514,
+    519, 497, 534, 526, 570, 577, 569, 577, 578, 599, 611, 618,
+    639, 638, 638, 651, 644, 649, 684, 656, 660, 672, 696, 680,
+    704, 733, 717, 734, 706, 727, 728, 758, 757, 776, 770, 780,
+    758, 781, 815, 779, 797, 809, 801, 811, 826, 828, 840, 838,
+    866, 826, 849, 863, 869, 873, 871, 870, 913, 894, 900, 882,
+    910, 930, 933, 934, 928, 961, 970, 948, 969, 985, 973, 990,
+    955, 964, 993, 1007, 998, 1016, 1018, 1027, 1020, 1035, 1034, 1031,
+    1037, 1046, 1072, 1063, 1065, 1037, 1085, 1087, 1072, 1103, 1075, 1086,
+    1089, 1094, 1083, 1104, 1101, 1102, 1129, 1126, 1136, 1105, 1129, 1141,
+    1144, 1148, 1157, 1141, 1179, 1171, 1153, 1178, 1176, 1187, 1199, 1194,
+    1203, 1205, 1185, 1192, 1219, 1230, 1203, 1225, 1239, 1228, 1223, 1231,
+    1250, 1257, 1269, 1249, 1260, 1271, 1268, 1279, 1265, 1276, 1246, 1296,
+    1271, 1299, 1303, 1293, 1291, 1312, 1307, 1312, 1323, 1329, 1322, 1301,
+    1331, 1335, 1347, 1324, 1322, 1353, 1343, 1352, 1370, 1340, 1343, 1359,
+    1375, 1357, 1369, 1370, 1368, 1369, 1373, 1356, 1403, 1390, 1396, 1381,
+    1407, 1409, 1397, 1391, 1398, 1406, 1409, 1424, 1418, 1419, 1409, 1416,
+    1417, 1436, 1437, 1423, 1457, 1449, 1478, 1441, 1452, 1449, 1447, 1454,
+    1462, 1456, 1439, 1467, 1476, 1491, 1487, 1474, 1474, 1481, 1489, 1482,
+    1488, 1471, 1488, 1528, 1512, 1492, 1490, 1511, 1490, 1515, 1516, 1512,
+    1512, 1531, 1506, 1508, 1543, 1514, 1519, 1539, 1506, 1523, 1537, 1544,
+    1533, 1559, 1535, 1536, 1529, 1550, 1553, 1551, 1552, 1557, 1561, 1547,
+    1579, 1556, 1569, 1555, 1572, 1563, 1582, 1590, 1563, 1580, 1587, 1569,
+    1576, 1570, 1569, 1600, 1584, 1579, 1608, 1585, 1590, 1603, 1620, 1580,
+    1591, 1615, 1592, 1600, 1593, 1609, 1618, 1607, 1613, 1599, 1598, 1606,
+    1632, 1621, 1606, 1641, 1635, 1625, 1635, 1642, 1640, 1637, 1646, 1622,
+    1638, 1644, 1616, 1657, 1657, 1658, 1651, 1643, 1645, 1667, 1640, 1663,
+    1660, 1660, 1658, 1651, 1677, 1678, 1663, 1648, 1667, 1670, 1667, 1693,
+    1680, 1692, 1670, 1692, 1678, 1670, 1705, 1704, 1663, 1691, 1698, 1701,
+    1693, 1675, 1683, 1663, 1710, 1695, 1698, 1673, 1686, 1687, 1701, 1695,
+    1700, 1708, 1705, 1711, 1714, 1724, 1712, 1718, 1701, 1708, 1716, 1719,
+    1705, 1664, 1657, 1642, 1609, 1624, 1579, 1549, 1535, 1544, 1496, 1498,
+    1464, 1465, 1454, 1415, 1419, 1389, 1396, 1361, 1353, 1321, 1320, 1328,
+    1301, 1289, 1227, 1253, 1236, 1206, 1223, 1205, 1176, 1153, 1172, 1124,
+    1150, 1119, 1129, 1109, 1091, 1089, 1090, 1060, 1048, 1078, 1040, 1058,
+    1002, 1000, 1017, 991, 998, 991, 972, 955, 958, 950, 919, 938,
+    929, 912, 893, 902, 895, 886, 890, 875, 874, 871, 865, 877,
+    852, 859, 828, 830, 808, 836, 823, 800, 792, 775, 774, 757,
+    761, 749, 754, 773, 742, 756, 758, 761, 719, 728, 727, 714,
+    759, 722, 708, 706, 697, 697, 700, 703, 686, 683, 679, 674,
+    697, 683, 685, 671, 674, 671, 671, 646, 663, 637, 647, 651,
+    651, 621, 662, 641, 620, 606, 608, 635, 606, 627, 601, 609,
+    606, 608, 599, 606, 614, 606, 603, 610, 597, 589, 600, 618,
+    605, 567, 583, 568, 575, 582, 575, 561, 564, 565, 574, 549,
+    557, 557, 553, 575, 571, 559, 551, 579, 557, 570, 566, 553,
+    562, 569, 534, 539, 557, 539, 524, 552, 555, 546, 534, 558,
+    534, 540, 503, 526, 538, 537, 548, 549, 545, 531, 531, 515,
+    550, 532, 537, 537, 509, 529, 497, 515, 535, 494, 551, 525,
+    520, 538, 539, 519, 532, 498, 520, 511, 518, 496, 506, 509,
+    513, 497, 502, 511, 505, 510, 518, 498, 490, 504, 535, 508,
+    515, 506, 506, 494, 504, 488, 508, 503, 515, 522, 517, 517,
+};
+
+/* co2 ppm every 5 s hovering around 1400 ppm */
+static const int16_t trace_co2_noise[] = {
+    1386, 1442, 1402, 1401, 1422, 1420, 1437, 1421, 1428, 1437, 1413, 1458,
+    1449, 1409, 1427, 1384, 1435, 1428, 1443, 1403, 1374, 1391, 1382, 1357,
+    1427, 1408, 1359, 1382, 1400, 1403, 1391, 1346, 1361, 1376, 1377, 1312,
+    1410, 1393, 1382, 1378, 1408, 1402, 1386, 1382, 1383, 1445, 1385, 1381,
+    1384, 1443, 1391, 1400, 1420, 1374, 1399, 1453, 1403, 1417, 1399, 1432,
+    1412, 1424, 1392, 1415, 1409, 1455, 1417, 1385, 1360, 1354, 1378, 1400,
+    1400, 1373, 1379, 1353, 1342, 1382, 1395, 1388, 1395, 1382, 1366, 1406,
+    1391, 1421, 1388, 1379, 1423, 1414, 1441, 1420, 1409, 1410, 1384, 1414,
+    1433, 1435, 1404, 1404, 1390, 1444, 1414, 1430, 1431, 1430, 1423, 1396,
+    1431, 1392, 1429, 1393, 1375, 1399, 1418, 1377, 1394, 1361, 1371, 1315,
+};
+
+/* battery percent every minute, discharging and plugged in after 45 min */
+static const int16_t trace_battery_percent[] = {
+    16, 16, 15, 15, 15, 14, 16, 15, 14, 14, 14, 14,
+    15, 12, 14, 13, 13, 13, 13, 11, 12, 12, 12, 12,
+    11, 11, 10, 11, 11, 11, 10, 10, 10, 10, 11, 10,
+    9, 9, 10, 9, 8, 8, 7, 8, 9, 8, 9, 10,
+    10, 11, 10, 11, 12, 11, 13, 14, 14, 15, 15, 15,
+};
+
+#endif /* TRACES_H */
@@ -0,0 +1,86 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "host-agent.h"
+#include "host-sensors.h"
+#include "sensorhub-mib.h"
+#include "snmpv3-users.h"
+#include "lwip/apps/snmp.h"
+#include "lwip/udp.h"
+#include "snmp/snmp_cache.h"
+#include "snmp/snmp_msg.h"
+
+#include <string.h>
+
+#define SOURCE_PORT 50161
+
+struct capture {
+    uint8_t *buf;
+    size_t size;
+    size_t len;
+};
+
+static const struct snmp_mib *mibs[] = { &sensorhub_mib };
+static struct capture capture;
+
+static void capture_output(void *arg, struct pbuf *p, const ip_addr_t *dst_ip, u16_t dst_port)
+{
+    struct capture *c = (struct capture *)arg;
+
+    LWIP_UNUSED_ARG(dst_ip);
+    LWIP_UNUSED_ARG(dst_port);
+
+    c->len = p->tot_len <= c->size ? pbuf_copy_partial(p, c->buf, p->tot_len, 0) : 0;
+}
+
+void host_agent_init(void)
+{
+    static const u8_t mac[] = HOST_AGENT_MAC;
+
+    if (snmp_traps_handle == NULL) {
+        snmp_set_mibs(mibs, LWIP_ARRAYSIZE(mibs));
+        sensorhub_mib_init();
+        /* any free port, the requests do not come over the socket */
+        udp_set_port_override(0);
+        snmp_init();
+        udp_set_output((struct udp_pcb *)snmp_traps_handle, capture_output, &capture);
+    }
+
+    host_sensors_reset();
+    snmp_cache_advance_epoch();
+    snmp_rate_limit_set(0, 0);
+    snmpv3_users_clear();
+    snmpv3_users_set_v3_only(1);
+    snmpv3_users_init(mac, 1);
+}
+
+size_t host_agent_request(const uint8_t *frame, size_t len, uint8_t *response, size_t size)
+{
+    ip_addr_t source;
+
+    if (len > 0xffff) {
+        return 0;
+    }
+
+    IP4_ADDR(&source, 127, 0, 0, 1);
+    capture.buf = response;
+    capture.size = size;
+    capture.len = 0;
+    udp_input((struct udp_pcb *)snmp_traps_handle, frame, (u16_t)len, &source, SOURCE_PORT);
+    return capture.len;
+}
@@ -0,0 +1,324 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The mbed TLS functions of snmpv3_mbedtls.c on top of OpenSSL, link with
+ * -lcrypto. DES is only in the legacy provider of OpenSSL 3, so it uses the
+ * low level API which is still there.
+ */
+
+#define OPENSSL_SUPPRESS_DEPRECATED
+
+#include "mbedtls/cipher.h"
+#include "mbedtls/md.h"
+#include "mbedtls/md5.h"
+#include "mbedtls/sha1.h"
+
+#include <openssl/des.h>
+#include <openssl/evp.h>
+#include <string.h>
+
+#define HMAC_BLOCK_SIZE 64
+
+struct mbedtls_md_info_t {
+    mbedtls_md_type_t type;
+    const EVP_MD *(*evp)(void);
+};
+
+struct mbedtls_cipher_info_t {
+    mbedtls_cipher_type_t type;
+};
+
+static const struct mbedtls_md_info_t md5_info = { MBEDTLS_MD_MD5, EVP_md5 };
+static const struct mbedtls_md_info_t sha1_info = { MBEDTLS_MD_SHA1, EVP_sha1 };
+
+static const struct mbedtls_cipher_info_t des_cbc_info = { MBEDTLS_CIPHER_DES_CBC };
+static const struct mbedtls_cipher_info_t aes_cfb_info = { MBEDTLS_CIPHER_AES_128_CFB128 };
+
+/* --- digests ------------------------------------------------------------ */
+
+static int digest_starts(void **evp, const EVP_MD *md)
+{
+    if (*evp == NULL) {
+        *evp = EVP_MD_CTX_new();
+    }
+    return *evp != NULL && EVP_DigestInit_ex((EVP_MD_CTX *)*evp, md, NULL) == 1 ? 0 : -1;
+}
+
+static int digest_update(void *evp, const unsigned char *input, size_t ilen)
+{
+    return EVP_DigestUpdate((EVP_MD_CTX *)evp, input, ilen) == 1 ? 0 : -1;
+}
+
+static int digest_finish(void *evp, unsigned char *output)
+{
+    return EVP_DigestFinal_ex((EVP_MD_CTX *)evp, output, NULL) == 1 ? 0 : -1;
+}
+
+void mbedtls_md5_init(mbedtls_md5_context *ctx)
+{
+    ctx->evp = NULL;
+}
+
+void mbedtls_md5_free(mbedtls_md5_context *ctx)
+{
+    EVP_MD_CTX_free((EVP_MD_CTX *)ctx->evp);
+    ctx->evp = NULL;
+}
+
+int mbedtls_md5_starts(mbedtls_md5_context *ctx)
+{
+    return digest_starts(&ctx->evp, EVP_md5());
+}
+
+int mbedtls_md5_update(mbedtls_md5_context *ctx, const unsigned char *input, size_t ilen)
+{
+    return digest_update(ctx->evp, input, ilen);
+}
+
+int mbedtls_md5_finish(mbedtls_md5_context *ctx, unsigned char output[16])
+{
+    return digest_finish(ctx->evp, output);
+}
+
+void mbedtls_sha1_init(mbedtls_sha1_context *ctx)
+{
+    ctx->evp = NULL;
+}
+
+void mbedtls_sha1_free(mbedtls_sha1_context *ctx)
+{
+    EVP_MD_CTX_free((EVP_MD_CTX *)ctx->evp);
+    ctx->evp = NULL;
+}
+
+int mbedtls_sha1_starts(mbedtls_sha1_context *ctx)
+{
+    return digest_starts(&ctx->evp, EVP_sha1());
+}
+
+int mbedtls_sha1_update(mbedtls_sha1_context *ctx, const unsigned char *input, size_t ilen)
+{
+    return digest_update(ctx->evp, input, ilen);
+}
+
+int mbedtls_sha1_finish(mbedtls_sha1_context *ctx, unsigned char output[20])
+{
+    return digest_finish(ctx->evp, output);
+}
+
+/* --- HMAC (RFC 2104) ---------------------------------------------------- */
+
+const mbedtls_md_info_t *mbedtls_md_info_from_type(mbedtls_md_type_t md_type)
+{
+    switch (md_type) {
+    case MBEDTLS_MD_MD5:
+        return &md5_info;
+    case MBEDTLS_MD_SHA1:
+        return &sha1_info;
+    default:
+        return NULL;
+    }
+}
+
+void mbedtls_md_init(mbedtls_md_context_t *ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+void mbedtls_md_free(mbedtls_md_context_t *ctx)
+{
+    EVP_MD_CTX_free((EVP_MD_CTX *)ctx->inner);
+    EVP_MD_CTX_free((EVP_MD_CTX *)ctx->outer);
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+int mbedtls_md_setup(mbedtls_md_context_t *ctx, const mbedtls_md_info_t *md_info, int hmac)
+{
+    if (md_info == NULL || !hmac) {
+        return -1;
+    }
+    ctx->md_info = md_info;
+    ctx->inner = EVP_MD_CTX_new();
+    ctx->outer = EVP_MD_CTX_new();
+    return ctx->inner != NULL && ctx->outer != NULL ? 0 : -1;
+}
+
+int mbedtls_md_hmac_starts(mbedtls_md_context_t *ctx, const unsigned char *key, size_t keylen)
+{
+    unsigned char ipad[HMAC_BLOCK_SIZE];
+    unsigned char hashed[EVP_MAX_MD_SIZE];
+    unsigned int hashed_len;
+    const EVP_MD *md = ctx->md_info->evp();
+
+    if (keylen > HMAC_BLOCK_SIZE) {
+        if (EVP_Digest(key, keylen, hashed, &hashed_len, md, NULL) != 1) {
+            return -1;
+        }
+        key = hashed;
+        keylen = hashed_len;
+    }
+
+    memset(ipad, 0x36, sizeof(ipad));
+    memset(ctx->opad, 0x5c, sizeof(ctx->opad));
+    for (size_t i = 0; i < keylen; i++) {
+        ipad[i] ^= key[i];
+        ctx->opad[i] ^= key[i];
+    }
+
+    if (EVP_DigestInit_ex((EVP_MD_CTX *)ctx->inner, md, NULL) != 1 ||
+        EVP_DigestUpdate((EVP_MD_CTX *)ctx->inner, ipad, sizeof(ipad)) != 1) {
+        return -1;
+    }
+    return 0;
+}
+
+int mbedtls_md_hmac_update(mbedtls_md_context_t *ctx, const unsigned char *input, size_t ilen)
+{
+    return digest_update(ctx->inner, input, ilen);
+}
+
+int mbedtls_md_hmac_finish(mbedtls_md_context_t *ctx, unsigned char *output)
+{
+    unsigned char inner[EVP_MAX_MD_SIZE];
+    unsigned int inner_len;
+
+    if (EVP_DigestFinal_ex((EVP_MD_CTX *)ctx->inner, inner, &inner_len) != 1 ||
+        EVP_DigestInit_ex((EVP_MD_CTX *)ctx->outer, ctx->md_info->evp(), NULL) != 1 ||
+        EVP_DigestUpdate((EVP_MD_CTX *)ctx->outer, ctx->opad, sizeof(ctx->opad)) != 1 ||
+        EVP_DigestUpdate((EVP_MD_CTX *)ctx->outer, inner, inner_len) != 1) {
+        return -1;
+    }
+    return digest_finish(ctx->outer, output);
+}
+
+/* --- ciphers ------------------------------------------------------------ */
+
+struct des_state {
+    DES_key_schedule schedule;
+    DES_cblock iv;
+};
+
+const mbedtls_cipher_info_t *mbedtls_cipher_info_from_type(const mbedtls_cipher_type_t cipher_type)
+{
+    switch (cipher_type) {
+    case MBEDTLS_CIPHER_DES_CBC:
+        return &des_cbc_info;
+    case MBEDTLS_CIPHER_AES_128_CFB128:
+        return &aes_cfb_info;
+    default:
+        return NULL;
+    }
+}
+
+void mbedtls_cipher_init(mbedtls_cipher_context_t *ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->operation = MBEDTLS_OPERATION_NONE;
+}
+
+void mbedtls_cipher_free(mbedtls_cipher_context_t *ctx)
+{
+    if (ctx->cipher_info == &aes_cfb_info) {
+        EVP_CIPHER_CTX_free((EVP_CIPHER_CTX *)ctx->evp);
+    } else {
+        free(ctx->evp);
+    }
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+int mbedtls_cipher_setup(mbedtls_cipher_context_t *ctx, const mbedtls_cipher_info_t *cipher_info)
+{
+    if (cipher_info == NULL) {
+        return -1;
+    }
+    ctx->cipher_info = cipher_info;
+    ctx->evp = cipher_info == &aes_cfb_info ? (void *)EVP_CIPHER_CTX_new() : calloc(1, sizeof(struct des_state));
+    return ctx->evp != NULL ? 0 : -1;
+}
+
+int mbedtls_cipher_set_padding_mode(mbedtls_cipher_context_t *ctx, mbedtls_cipher_padding_t mode)
+{
+    /* both ciphers are only used without padding */
+    return ctx->cipher_info != NULL && mode == MBEDTLS_PADDING_NONE ? 0 : -1;
+}
+
+int mbedtls_cipher_setkey(mbedtls_cipher_context_t *ctx, const unsigned char *key, int key_bitlen, const mbedtls_operation_t operation)
+{
+    int expected = ctx->cipher_info == &aes_cfb_info ? 128 : 64;
+
+    if (ctx->cipher_info == NULL || key_bitlen != expected) {
+        return -1;
+    }
+    memcpy(ctx->key, key, key_bitlen / 8);
+    ctx->key_bitlen = key_bitlen;
+    ctx->operation = operation;
+    if (ctx->cipher_info == &des_cbc_info) {
+        DES_set_key_unchecked((const_DES_cblock *)ctx->key, &((struct des_state *)ctx->evp)->schedule);
+    }
+    return 0;
+}
+
+int mbedtls_cipher_set_iv(mbedtls_cipher_context_t *ctx, const unsigned char *iv, size_t iv_len)
+{
+    if (ctx->cipher_info == &des_cbc_info) {
+        if (iv_len != sizeof(DES_cblock)) {
+            return -1;
+        }
+        memcpy(((struct des_state *)ctx->evp)->iv, iv, iv_len);
+        return 0;
+    }
+
+    if (iv_len != 16 || ctx->key_bitlen != 128) {
+        return -1;
+    }
+    return EVP_CipherInit_ex((EVP_CIPHER_CTX *)ctx->evp, EVP_aes_128_cfb128(), NULL, ctx->key, iv,
+                             ctx->operation == MBEDTLS_ENCRYPT) == 1 ? 0 : -1;
+}
+
+int mbedtls_cipher_update(mbedtls_cipher_context_t *ctx, const unsigned char *input, size_t ilen, unsigned char *output, size_t *olen)
+{
+    int len = 0;
+
+    if (ctx->cipher_info == &des_cbc_info) {
+        struct des_state *des = (struct des_state *)ctx->evp;
+
+        if (ilen % sizeof(DES_cblock) != 0) {
+            return -1;
+        }
+        DES_ncbc_encrypt(input, output, (long)ilen, &des->schedule, &des->iv,
+                         ctx->operation == MBEDTLS_ENCRYPT ? DES_ENCRYPT : DES_DECRYPT);
+        *olen = ilen;
+        return 0;
+    }
+
+    if (EVP_CipherUpdate((EVP_CIPHER_CTX *)ctx->evp, output, &len, input, (int)ilen) != 1) {
+        return -1;
+    }
+    *olen = (size_t)len;
+    return 0;
+}
+
+int mbedtls_cipher_finish(mbedtls_cipher_context_t *ctx, unsigned char *output, size_t *olen)
+{
+    (void)ctx;
+    (void)output;
+
+    /* no padding, every block has been written by mbedtls_cipher_update() */
+    *olen = 0;
+    return 0;
+}
@@ -0,0 +1,109 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mock-i2c-bus.h"
+
+#include <stddef.h>
+
+MockI2cBus::MockI2cBus(uint32_t busUs)
+    : busUs(busUs), nowUs(0), devicesLen(0), head(0), len(0)
+{
+}
+
+bool MockI2cBus::attach(uint8_t address, device handler, void *context)
+{
+    if (devicesLen >= MOCK_I2C_DEVICES_MAX)
+    {
+        return false;
+    }
+
+    devices[devicesLen].address = address;
+    devices[devicesLen].handler = handler;
+    devices[devicesLen].context = context;
+    devicesLen++;
+    return true;
+}
+
+bool MockI2cBus::submit(struct i2cTransaction *transaction)
+{
+    if (len >= I2C_QUEUE_LEN)
+    {
+        transaction->status = I2C_ERROR;
+        return false;
+    }
+
+    transaction->queuedUs = nowUs;
+    transaction->status = I2C_QUEUED;
+    queue[(head + len) % I2C_QUEUE_LEN] = transaction;
+    len++;
+    return true;
+}
+
+bool MockI2cBus::transfer(struct i2cTransaction *transaction)
+{
+    if (!submit(transaction))
+    {
+        return false;
+    }
+
+    while (transaction->status == I2C_QUEUED)
+    {
+        run(1);
+    }
+    return transaction->status == I2C_DONE;
+}
+
+uint8_t MockI2cBus::run(uint8_t max)
+{
+    uint8_t done = 0;
+
+    while (len > 0 && done < max)
+    {
+        struct i2cTransaction *transaction = queue[head];
+        head = (head + 1) % I2C_QUEUE_LEN;
+        len--;
+
+        bool ok = false;
+        for (uint8_t i = 0; i < devicesLen; i++)
+        {
+            if (devices[i].address == transaction->address)
+            {
+                ok = devices[i].handler(devices[i].context, transaction);
+                break;
+            }
+        }
+
+        transaction->waitUs = (uint32_t)(nowUs - transaction->queuedUs);
+        transaction->busUs = busUs;
+        nowUs += (int64_t)transaction->delayMs * 1000 + busUs;
+        transaction->doneUs = nowUs;
+        transaction->status = ok ? I2C_DONE : I2C_ERROR;
+        done++;
+    }
+
+    return done;
+}
+
+uint8_t MockI2cBus::queued() const
+{
+    return len;
+}
+
+int64_t MockI2cBus::now() const
+{
+    return nowUs;
+}
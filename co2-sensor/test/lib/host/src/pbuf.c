@@ -0,0 +1,220 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The pbuf functions the SNMP agent uses, with the semantics of lwIP 2.1.
+ * PBUF_POOL is allocated as a chain, so the chained code paths of the agent
+ * are exercised as well.
+ */
+
+#include "lwip/pbuf.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static struct pbuf *pbuf_alloc_single(u16_t length, u16_t tot_len, pbuf_type type)
+{
+    struct pbuf *p = (struct pbuf *)malloc(sizeof(struct pbuf) + length);
+
+    if (p == NULL) {
+        return NULL;
+    }
+    p->next = NULL;
+    p->payload = p + 1;
+    p->tot_len = tot_len;
+    p->len = length;
+    p->type_internal = (u8_t)type;
+    p->flags = 0;
+    p->ref = 1;
+    return p;
+}
+
+struct pbuf *pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type)
+{
+    struct pbuf *head = NULL;
+    struct pbuf *last = NULL;
+    u16_t left = length;
+
+    LWIP_UNUSED_ARG(layer);
+
+    if (type != PBUF_POOL) {
+        return pbuf_alloc_single(length, length, type);
+    }
+
+    do {
+        u16_t len = left > PBUF_POOL_BUFSIZE ? PBUF_POOL_BUFSIZE : left;
+        struct pbuf *p = pbuf_alloc_single(len, left, type);
+
+        if (p == NULL) {
+            pbuf_free(head);
+            return NULL;
+        }
+        if (last == NULL) {
+            head = p;
+        } else {
+            last->next = p;
+        }
+        last = p;
+        left -= len;
+    } while (left > 0);
+
+    return head;
+}
+
+void pbuf_realloc(struct pbuf *p, u16_t new_len)
+{
+    u16_t rem_len = new_len;
+    s32_t grow;
+    struct pbuf *q;
+
+    if (new_len >= p->tot_len) {
+        return;
+    }
+
+    grow = (s32_t)new_len - p->tot_len;
+    q = p;
+    while (rem_len > q->len) {
+        rem_len -= q->len;
+        q->tot_len = (u16_t)(q->tot_len + grow);
+        q = q->next;
+    }
+    q->len = rem_len;
+    q->tot_len = rem_len;
+
+    if (q->next != NULL) {
+        pbuf_free(q->next);
+    }
+    q->next = NULL;
+}
+
+u8_t pbuf_free(struct pbuf *p)
+{
+    u8_t count = 0;
+
+    while (p != NULL) {
+        struct pbuf *next = p->next;
+
+        if (--p->ref > 0) {
+            break;
+        }
+        free(p);
+        count++;
+        p = next;
+    }
+    return count;
+}
+
+void pbuf_ref(struct pbuf *p)
+{
+    if (p != NULL) {
+        p->ref++;
+    }
+}
+
+void pbuf_cat(struct pbuf *head, struct pbuf *tail)
+{
+    struct pbuf *p;
+
+    for (p = head; p->next != NULL; p = p->next) {
+        p->tot_len = (u16_t)(p->tot_len + tail->tot_len);
+    }
+    p->tot_len = (u16_t)(p->tot_len + tail->tot_len);
+    p->next = tail;
+}
+
+u16_t pbuf_copy_partial(const struct pbuf *buf, void *dataptr, u16_t len, u16_t offset)
+{
+    const struct pbuf *p;
+    u16_t left = 0;
+    u16_t copied = 0;
+
+    for (p = buf; len != 0 && p != NULL; p = p->next) {
+        if (offset != 0 && offset >= p->len) {
+            offset = (u16_t)(offset - p->len);
+        } else {
+            u16_t buf_copy_len = (u16_t)(p->len - offset);
+
+            if (buf_copy_len > len) {
+                buf_copy_len = len;
+            }
+            memcpy((u8_t *)dataptr + left, (const u8_t *)p->payload + offset, buf_copy_len);
+            copied = (u16_t)(copied + buf_copy_len);
+            left = (u16_t)(left + buf_copy_len);
+            len = (u16_t)(len - buf_copy_len);
+            offset = 0;
+        }
+    }
+    return copied;
+}
+
+struct pbuf *pbuf_skip(struct pbuf *in, u16_t in_offset, u16_t *out_offset)
+{
+    struct pbuf *q = in;
+    u16_t offset_left = in_offset;
+
+    while (q != NULL && q->len <= offset_left) {
+        offset_left = (u16_t)(offset_left - q->len);
+        q = q->next;
+    }
+    if (out_offset != NULL) {
+        *out_offset = offset_left;
+    }
+    return q;
+}
+
+err_t pbuf_take(struct pbuf *buf, const void *dataptr, u16_t len)
+{
+    struct pbuf *p;
+    u16_t copied = 0;
+
+    if (buf == NULL || dataptr == NULL || buf->tot_len < len) {
+        return ERR_ARG;
+    }
+
+    for (p = buf; copied < len; p = p->next) {
+        u16_t buf_copy_len = (u16_t)(len - copied);
+
+        if (buf_copy_len > p->len) {
+            buf_copy_len = p->len;
+        }
+        memcpy(p->payload, (const u8_t *)dataptr + copied, buf_copy_len);
+        copied = (u16_t)(copied + buf_copy_len);
+    }
+    return ERR_OK;
+}
+
+err_t pbuf_take_at(struct pbuf *buf, const void *dataptr, u16_t len, u16_t offset)
+{
+    u16_t target_offset;
+    struct pbuf *q = pbuf_skip(buf, offset, &target_offset);
+    u16_t remaining_len = len;
+    const u8_t *src_ptr = (const u8_t *)dataptr;
+    u16_t first_copy_len;
+
+    if (q == NULL || q->tot_len < target_offset + len) {
+        return ERR_MEM;
+    }
+
+    first_copy_len = (u16_t)(q->len - target_offset) > len ? len : (u16_t)(q->len - target_offset);
+    memcpy((u8_t *)q->payload + target_offset, dataptr, first_copy_len);
+    remaining_len = (u16_t)(remaining_len - first_copy_len);
+    src_ptr += first_copy_len;
+    if (remaining_len > 0) {
+        return pbuf_take(q->next, src_ptr, remaining_len);
+    }
+    return ERR_OK;
+}
@@ -0,0 +1,127 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "host-sensors.h"
+#include "sensorhub-mib.h"
+
+#include <string.h>
+
+#define MEASUREMENT_TYPES_MAX 10
+
+struct host_sensor {
+    const char *name;
+    const u8_t *types;
+    u8_t types_len;
+    int values[MEASUREMENT_TYPES_MAX + 1];
+    int raws[MEASUREMENT_TYPES_MAX + 1];
+    u8_t has_raw[MEASUREMENT_TYPES_MAX + 1];
+};
+
+static const u8_t air_types[] = { CO2_PPM_MEASUREMENT, TEMPERATURE_MEASUREMENT, HUMIDITY_MEASUREMENT };
+static const u8_t battery_types[] = { BATTERY_VOLTAGE_MEASUREMENT, BATTERY_CURRENT_MEASUREMENT };
+
+/* indexed by sensor id */
+static struct host_sensor sensors[HOST_SENSORS_MAX + 1];
+
+static struct host_sensor *find(u32_t sensor_id)
+{
+    if (sensor_id == 0 || sensor_id > HOST_SENSORS_MAX || sensors[sensor_id].name == NULL) {
+        return NULL;
+    }
+    return &sensors[sensor_id];
+}
+
+void host_sensors_reset(void)
+{
+    memset(sensors, 0, sizeof(sensors));
+    host_sensors_add(1, "SCD30", air_types, sizeof(air_types));
+    host_sensors_add(2, "BATTERY", battery_types, sizeof(battery_types));
+    host_sensors_set(1, CO2_PPM_MEASUREMENT, 612);
+    host_sensors_set(1, TEMPERATURE_MEASUREMENT, 22);
+    host_sensors_set(1, HUMIDITY_MEASUREMENT, 43);
+    host_sensors_set(2, BATTERY_VOLTAGE_MEASUREMENT, 4);
+    host_sensors_set(2, BATTERY_CURRENT_MEASUREMENT, 276);
+}
+
+void host_sensors_add(u32_t sensor_id, const char *name, const u8_t *types, u8_t types_len)
+{
+    if (sensor_id == 0 || sensor_id > HOST_SENSORS_MAX) {
+        return;
+    }
+    memset(&sensors[sensor_id], 0, sizeof(sensors[sensor_id]));
+    sensors[sensor_id].name = name;
+    sensors[sensor_id].types = types;
+    sensors[sensor_id].types_len = types_len;
+}
+
+void host_sensors_set(u32_t sensor_id, u32_t measurement_type, int value)
+{
+    struct host_sensor *sensor = find(sensor_id);
+
+    if (sensor != NULL && measurement_type <= MEASUREMENT_TYPES_MAX) {
+        sensor->values[measurement_type] = value;
+    }
+}
+
+void host_sensors_set_raw(u32_t sensor_id, u32_t measurement_type, int raw)
+{
+    struct host_sensor *sensor = find(sensor_id);
+
+    if (sensor != NULL && measurement_type <= MEASUREMENT_TYPES_MAX) {
+        sensor->raws[measurement_type] = raw;
+        sensor->has_raw[measurement_type] = 1;
+    }
+}
+
+int get_measurement(u32_t sensor_id, u32_t measurement_type)
+{
+    struct host_sensor *sensor = find(sensor_id);
+
+    if (sensor == NULL || measurement_type > MEASUREMENT_TYPES_MAX) {
+        return 0;
+    }
+    return sensor->values[measurement_type];
+}
+
+int get_measurement_raw(u32_t sensor_id, u32_t measurement_type)
+{
+    struct host_sensor *sensor = find(sensor_id);
+
+    if (sensor == NULL || measurement_type > MEASUREMENT_TYPES_MAX) {
+        return 0;
+    }
+    return sensor->has_raw[measurement_type] ? sensor->raws[measurement_type] : sensor->values[measurement_type];
+}
+
+const char *get_sensor_name(u32_t sensor_id)
+{
+    struct host_sensor *sensor = find(sensor_id);
+
+    return sensor != NULL ? sensor->name : NULL;
+}
+
+u8_t get_sensor_measurement_types(u32_t sensor_id, const u8_t **types)
+{
+    struct host_sensor *sensor = find(sensor_id);
+
+    if (sensor == NULL) {
+        return 0;
+    }
+    *types = sensor->types;
+    return sensor->types_len;
+}
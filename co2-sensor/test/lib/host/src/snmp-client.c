@@ -0,0 +1,732 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * Requests are encoded back to front, so every length is known when its
+ * header is written. Responses are decoded front to back.
+ */
+
+#define OPENSSL_SUPPRESS_DEPRECATED
+
+#include "snmp-client.h"
+
+#include <openssl/des.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BER_SEQUENCE 0x30
+#define MSG_FLAG_AUTH 0x01
+#define MSG_FLAG_PRIV 0x02
+#define MSG_FLAG_REPORTABLE 0x04
+#define USM_SECURITY_MODEL 3
+#define AUTH_PARAMS_LEN 12
+#define PRIV_PARAMS_LEN 8
+#define MSG_MAX_SIZE 1472
+#define PASSWORD_HASH_BYTES 1048576
+
+struct ber_writer {
+    uint8_t *buf;
+    size_t size;
+    size_t pos;
+    int error;
+};
+
+struct ber_reader {
+    const uint8_t *data;
+    size_t len;
+    size_t pos;
+};
+
+/* --- encoding ----------------------------------------------------------- */
+
+static void ber_init(struct ber_writer *w, uint8_t *buf, size_t size)
+{
+    w->buf = buf;
+    w->size = size;
+    w->pos = size;
+    w->error = 0;
+}
+
+static size_t ber_mark(const struct ber_writer *w)
+{
+    return w->size - w->pos;
+}
+
+static void ber_put(struct ber_writer *w, const void *data, size_t len)
+{
+    if (w->error || len > w->pos) {
+        w->error = 1;
+        return;
+    }
+    w->pos -= len;
+    if (len > 0) {
+        memcpy(&w->buf[w->pos], data, len);
+    }
+}
+
+static void ber_put_byte(struct ber_writer *w, uint8_t byte)
+{
+    ber_put(w, &byte, 1);
+}
+
+/* the header of everything written since mark */
+static void ber_put_header(struct ber_writer *w, uint8_t type, size_t mark)
+{
+    size_t len = ber_mark(w) - mark;
+
+    if (len < 0x80) {
+        ber_put_byte(w, (uint8_t)len);
+    } else if (len <= 0xff) {
+        ber_put_byte(w, (uint8_t)len);
+        ber_put_byte(w, 0x81);
+    } else {
+        ber_put_byte(w, (uint8_t)len);
+        ber_put_byte(w, (uint8_t)(len >> 8));
+        ber_put_byte(w, 0x82);
+    }
+    ber_put_byte(w, type);
+}
+
+static void ber_put_octets(struct ber_writer *w, uint8_t type, const void *data, size_t len)
+{
+    size_t mark = ber_mark(w);
+
+    ber_put(w, data, len);
+    ber_put_header(w, type, mark);
+}
+
+/* shortest two's complement */
+static void ber_put_integer(struct ber_writer *w, uint8_t type, int64_t value)
+{
+    size_t mark = ber_mark(w);
+    uint8_t byte;
+
+    do {
+        byte = (uint8_t)value;
+        ber_put_byte(w, byte);
+        value >>= 8;
+    } while (!((value == 0 && !(byte & 0x80)) || (value == -1 && (byte & 0x80))));
+    ber_put_header(w, type, mark);
+}
+
+static void ber_put_oid(struct ber_writer *w, const struct snmp_client_oid *oid)
+{
+    size_t mark = ber_mark(w);
+    int i;
+
+    for (i = oid->len - 1; i >= 0; i--) {
+        uint32_t arc = oid->id[i];
+
+        if (i == 1) {
+            arc += oid->id[0] * 40;
+        } else if (i == 0) {
+            break;
+        }
+        ber_put_byte(w, arc & 0x7f);
+        for (arc >>= 7; arc != 0; arc >>= 7) {
+            ber_put_byte(w, 0x80 | (arc & 0x7f));
+        }
+    }
+    ber_put_header(w, SNMP_CLIENT_OBJECT_ID, mark);
+}
+
+static void ber_put_pdu(struct ber_writer *w, uint8_t pdu_type, int32_t request_id,
+                        const struct snmp_client_oid *oids, uint8_t oids_len,
+                        int32_t non_repeaters, int32_t max_repetitions)
+{
+    size_t pdu = ber_mark(w);
+    size_t varbinds;
+    int i;
+
+    varbinds = ber_mark(w);
+    for (i = oids_len - 1; i >= 0; i--) {
+        size_t varbind = ber_mark(w);
+
+        ber_put_octets(w, SNMP_CLIENT_NULL, NULL, 0);
+        ber_put_oid(w, &oids[i]);
+        ber_put_header(w, BER_SEQUENCE, varbind);
+    }
+    ber_put_header(w, BER_SEQUENCE, varbinds);
+
+    ber_put_integer(w, SNMP_CLIENT_INTEGER, pdu_type == SNMP_CLIENT_GETBULK ? max_repetitions : 0);
+    ber_put_integer(w, SNMP_CLIENT_INTEGER, pdu_type == SNMP_CLIENT_GETBULK ? non_repeaters : 0);
+    ber_put_integer(w, SNMP_CLIENT_INTEGER, request_id);
+    ber_put_header(w, pdu_type, pdu);
+}
+
+/* --- decoding ----------------------------------------------------------- */
+
+static int ber_get(struct ber_reader *r, uint8_t *type, struct ber_reader *value)
+{
+    size_t len;
+
+    if (r->pos + 2 > r->len) {
+        return 0;
+    }
+    *type = r->data[r->pos++];
+    len = r->data[r->pos++];
+    if (len == 0x81 || len == 0x82) {
+        size_t bytes = len & 0x7f;
+
+        if (r->pos + bytes > r->len) {
+            return 0;
+        }
+        len = 0;
+        while (bytes-- > 0) {
+            len = (len << 8) | r->data[r->pos++];
+        }
+    } else if (len & 0x80) {
+        return 0;
+    }
+    if (len > r->len - r->pos) {
+        return 0;
+    }
+
+    value->data = &r->data[r->pos];
+    value->len = len;
+    value->pos = 0;
+    r->pos += len;
+    return 1;
+}
+
+static int ber_get_expected(struct ber_reader *r, uint8_t type, struct ber_reader *value)
+{
+    uint8_t actual;
+
+    return ber_get(r, &actual, value) && actual == type;
+}
+
+static int64_t ber_integer(const struct ber_reader *value, int is_signed)
+{
+    int64_t result = is_signed && value->len > 0 && (value->data[0] & 0x80) ? -1 : 0;
+    size_t i;
+
+    for (i = 0; i < value->len; i++) {
+        result = (int64_t)((uint64_t)result << 8) | value->data[i];
+    }
+    return result;
+}
+
+static int ber_get_integer(struct ber_reader *r, int32_t *result)
+{
+    struct ber_reader value;
+
+    if (!ber_get_expected(r, SNMP_CLIENT_INTEGER, &value) || value.len == 0 || value.len > 4) {
+        return 0;
+    }
+    *result = (int32_t)ber_integer(&value, 1);
+    return 1;
+}
+
+static int ber_oid(const struct ber_reader *value, struct snmp_client_oid *oid)
+{
+    uint32_t arc = 0;
+    size_t i;
+
+    oid->len = 0;
+    for (i = 0; i < value->len; i++) {
+        arc = (arc << 7) | (value->data[i] & 0x7f);
+        if (value->data[i] & 0x80) {
+            continue;
+        }
+        if (oid->len == 0) {
+            oid->id[0] = arc < 80 ? arc / 40 : 2;
+            oid->id[1] = arc - oid->id[0] * 40;
+            oid->len = 2;
+        } else if (oid->len < SNMP_CLIENT_OID_MAX) {
+            oid->id[oid->len++] = arc;
+        } else {
+            return 0;
+        }
+        arc = 0;
+    }
+    return arc == 0;
+}
+
+static int decode_varbind(struct ber_reader *r, struct snmp_client_varbind *varbind)
+{
+    struct ber_reader sequence;
+    struct ber_reader name;
+    struct ber_reader value;
+
+    memset(varbind, 0, sizeof(*varbind));
+    if (!ber_get_expected(r, BER_SEQUENCE, &sequence) ||
+        !ber_get_expected(&sequence, SNMP_CLIENT_OBJECT_ID, &name) ||
+        !ber_oid(&name, &varbind->oid) ||
+        !ber_get(&sequence, &varbind->type, &value)) {
+        return 0;
+    }
+
+    switch (varbind->type) {
+    case SNMP_CLIENT_INTEGER:
+        varbind->integer = ber_integer(&value, 1);
+        return value.len > 0 && value.len <= 4;
+    case SNMP_CLIENT_COUNTER:
+    case SNMP_CLIENT_GAUGE:
+    case SNMP_CLIENT_TIMETICKS:
+        varbind->integer = ber_integer(&value, 0);
+        return value.len > 0 && value.len <= 5;
+    case SNMP_CLIENT_OBJECT_ID:
+        return ber_oid(&value, &varbind->object_id);
+    case SNMP_CLIENT_NULL:
+    case SNMP_CLIENT_NO_SUCH_OBJECT:
+    case SNMP_CLIENT_NO_SUCH_INSTANCE:
+    case SNMP_CLIENT_END_OF_MIB_VIEW:
+        return value.len == 0;
+    default:
+        if (value.len > sizeof(varbind->octets)) {
+            return 0;
+        }
+        memcpy(varbind->octets, value.data, value.len);
+        varbind->octets_len = (uint16_t)value.len;
+        return 1;
+    }
+}
+
+static int decode_pdu(struct ber_reader *r, struct snmp_client_response *response)
+{
+    struct ber_reader pdu;
+    struct ber_reader varbinds;
+
+    if (!ber_get(r, &response->pdu_type, &pdu) ||
+        (response->pdu_type != SNMP_CLIENT_RESPONSE && response->pdu_type != SNMP_CLIENT_REPORT) ||
+        !ber_get_integer(&pdu, &response->request_id) ||
+        !ber_get_integer(&pdu, &response->error_status) ||
+        !ber_get_integer(&pdu, &response->error_index) ||
+        !ber_get_expected(&pdu, BER_SEQUENCE, &varbinds)) {
+        return 0;
+    }
+
+    response->varbinds_len = 0;
+    while (varbinds.pos < varbinds.len) {
+        if (response->varbinds_len == SNMP_CLIENT_VARBINDS_MAX ||
+            !decode_varbind(&varbinds, &response->varbinds[response->varbinds_len])) {
+            return 0;
+        }
+        response->varbinds_len++;
+    }
+    return 1;
+}
+
+/* --- USM ---------------------------------------------------------------- */
+
+static const EVP_MD *auth_md(uint8_t auth_algo)
+{
+    return auth_algo == SNMP_CLIENT_AUTH_MD5 ? EVP_md5() : EVP_sha1();
+}
+
+static size_t auth_key_len(uint8_t auth_algo)
+{
+    return auth_algo == SNMP_CLIENT_AUTH_MD5 ? 16 : 20;
+}
+
+void snmp_client_password_to_key(uint8_t auth_algo, const char *password,
+                                 const uint8_t *engine_id, uint8_t engine_id_len, uint8_t *key)
+{
+    EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+    size_t password_len = strlen(password);
+    uint8_t block[64];
+    uint8_t ku[20];
+    size_t key_len = auth_key_len(auth_algo);
+    size_t index = 0;
+    size_t count;
+    size_t i;
+
+    EVP_DigestInit_ex(ctx, auth_md(auth_algo), NULL);
+    for (count = 0; count < PASSWORD_HASH_BYTES; count += sizeof(block)) {
+        for (i = 0; i < sizeof(block); i++) {
+            block[i] = (uint8_t)password[index++ % password_len];
+        }
+        EVP_DigestUpdate(ctx, block, sizeof(block));
+    }
+    EVP_DigestFinal_ex(ctx, ku, NULL);
+
+    EVP_DigestInit_ex(ctx, auth_md(auth_algo), NULL);
+    EVP_DigestUpdate(ctx, ku, key_len);
+    EVP_DigestUpdate(ctx, engine_id, engine_id_len);
+    EVP_DigestUpdate(ctx, ku, key_len);
+    EVP_DigestFinal_ex(ctx, key, NULL);
+    EVP_MD_CTX_free(ctx);
+}
+
+static void authenticate(const struct snmp_client *client, const uint8_t *frame, size_t len, uint8_t *mac)
+{
+    uint8_t digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_len;
+
+    HMAC(auth_md(client->auth_algo), client->auth_key, (int)auth_key_len(client->auth_algo),
+         frame, len, digest, &digest_len);
+    memcpy(mac, digest, AUTH_PARAMS_LEN);
+}
+
+/* in place, len is a multiple of 8 for DES */
+static int usm_crypt(const struct snmp_client *client, uint8_t *data, size_t len, const uint8_t *priv_params,
+                 int32_t boots, int32_t time, int encrypt)
+{
+    if (client->priv_algo == SNMP_CLIENT_PRIV_DES) {
+        DES_key_schedule schedule;
+        DES_cblock iv;
+        int i;
+
+        if (len % 8 != 0) {
+            return 0;
+        }
+        for (i = 0; i < 8; i++) {
+            iv[i] = client->priv_key[8 + i] ^ priv_params[i];
+        }
+        DES_set_key_unchecked((const_DES_cblock *)client->priv_key, &schedule);
+        DES_ncbc_encrypt(data, data, (long)len, &schedule, &iv, encrypt ? DES_ENCRYPT : DES_DECRYPT);
+        return 1;
+    } else {
+        EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+        uint8_t iv[16];
+        int out_len = 0;
+        int ok;
+
+        iv[0] = (uint8_t)(boots >> 24);
+        iv[1] = (uint8_t)(boots >> 16);
+        iv[2] = (uint8_t)(boots >> 8);
+        iv[3] = (uint8_t)boots;
+        iv[4] = (uint8_t)(time >> 24);
+        iv[5] = (uint8_t)(time >> 16);
+        iv[6] = (uint8_t)(time >> 8);
+        iv[7] = (uint8_t)time;
+        memcpy(&iv[8], priv_params, PRIV_PARAMS_LEN);
+        ok = EVP_CipherInit_ex(ctx, EVP_aes_128_cfb128(), NULL, client->priv_key, iv, encrypt) == 1 &&
+             EVP_CipherUpdate(ctx, data, &out_len, data, (int)len) == 1 && (size_t)out_len == len;
+        EVP_CIPHER_CTX_free(ctx);
+        return ok;
+    }
+}
+
+/* --- API ---------------------------------------------------------------- */
+
+void snmp_client_init(struct snmp_client *client, uint8_t version, const char *community)
+{
+    memset(client, 0, sizeof(*client));
+    client->version = version;
+    snprintf(client->community, sizeof(client->community), "%s", community);
+    client->request_id = 1;
+    client->salt = 0x5eed;
+}
+
+void snmp_client_init_v3(struct snmp_client *client, const char *user,
+                         uint8_t auth_algo, const char *auth_password,
+                         uint8_t priv_algo, const char *priv_password)
+{
+    snmp_client_init(client, SNMP_CLIENT_VERSION_3, "");
+    snprintf(client->user, sizeof(client->user), "%s", user);
+    client->auth_algo = auth_algo;
+    client->priv_algo = auth_algo != SNMP_CLIENT_AUTH_NONE ? priv_algo : SNMP_CLIENT_PRIV_NONE;
+    if (auth_algo != SNMP_CLIENT_AUTH_NONE) {
+        snprintf(client->auth_password, sizeof(client->auth_password), "%s", auth_password);
+    }
+    if (client->priv_algo != SNMP_CLIENT_PRIV_NONE) {
+        snprintf(client->priv_password, sizeof(client->priv_password), "%s", priv_password);
+    }
+    client->msg_flags_mask = 0xff;
+}
+
+void snmp_client_set_engine(struct snmp_client *client, const uint8_t *engine_id, uint8_t engine_id_len,
+                            int32_t boots, int32_t time)
+{
+    int changed = engine_id_len != client->engine_id_len || memcmp(engine_id, client->engine_id, engine_id_len) != 0;
+
+    if (engine_id_len > sizeof(client->engine_id)) {
+        return;
+    }
+    memcpy(client->engine_id, engine_id, engine_id_len);
+    client->engine_id_len = engine_id_len;
+    client->engine_boots = boots;
+    client->engine_time = time;
+
+    if (changed && client->auth_algo != SNMP_CLIENT_AUTH_NONE && engine_id_len > 0) {
+        snmp_client_password_to_key(client->auth_algo, client->auth_password, engine_id, engine_id_len, client->auth_key);
+        if (client->priv_algo != SNMP_CLIENT_PRIV_NONE) {
+            snmp_client_password_to_key(client->auth_algo, client->priv_password, engine_id, engine_id_len, client->priv_key);
+        }
+    }
+}
+
+int snmp_client_parse_oid(const char *text, struct snmp_client_oid *oid)
+{
+    char *end;
+
+    oid->len = 0;
+    while (*text != '\0') {
+        unsigned long arc = strtoul(text, &end, 10);
+
+        if (end == text || oid->len == SNMP_CLIENT_OID_MAX || arc > UINT32_MAX) {
+            return 0;
+        }
+        oid->id[oid->len++] = (uint32_t)arc;
+        text = *end == '.' ? end + 1 : end;
+        if (*end != '.' && *end != '\0') {
+            return 0;
+        }
+    }
+    return oid->len >= 2;
+}
+
+static size_t encode_v3(struct snmp_client *client, uint8_t msg_flags, const uint8_t *scoped_pdu, size_t scoped_pdu_len,
+                        uint8_t *frame, size_t size)
+{
+    static const uint8_t zeros[AUTH_PARAMS_LEN] = { 0 };
+    uint8_t encrypted[SNMP_CLIENT_FRAME_MAX];
+    uint8_t priv_params[PRIV_PARAMS_LEN];
+    const char *user = (msg_flags & MSG_FLAG_AUTH) || client->engine_id_len > 0 ? client->user : "";
+    struct ber_writer w;
+    size_t auth_params = 0;
+    size_t mark;
+    size_t len;
+    int i;
+
+    ber_init(&w, frame, size);
+
+    if (msg_flags & MSG_FLAG_PRIV) {
+        size_t padded = client->priv_algo == SNMP_CLIENT_PRIV_DES ? (scoped_pdu_len + 7) & ~(size_t)7 : scoped_pdu_len;
+
+        if (padded > sizeof(encrypted)) {
+            return 0;
+        }
+        client->salt++;
+        if (client->priv_algo == SNMP_CLIENT_PRIV_DES) {
+            /* RFC 3414 8.1.1.1: boots followed by a counter */
+            uint64_t salt = ((uint64_t)(uint32_t)client->engine_boots << 32) | (uint32_t)client->salt;
+
+            for (i = 0; i < PRIV_PARAMS_LEN; i++) {
+                priv_params[i] = (uint8_t)(salt >> (56 - 8 * i));
+            }
+        } else {
+            for (i = 0; i < PRIV_PARAMS_LEN; i++) {
+                priv_params[i] = (uint8_t)(client->salt >> (56 - 8 * i));
+            }
+        }
+        memset(encrypted, 0, padded);
+        memcpy(encrypted, scoped_pdu, scoped_pdu_len);
+        if (!usm_crypt(client, encrypted, padded, priv_params, client->engine_boots, client->engine_time, 1)) {
+            return 0;
+        }
+        ber_put_octets(&w, SNMP_CLIENT_OCTET_STRING, encrypted, padded);
+    } else {
+        ber_put(&w, scoped_pdu, scoped_pdu_len);
+    }
+
+    /* msgSecurityParameters */
+    mark = ber_mark(&w);
+    ber_put_octets(&w, SNMP_CLIENT_OCTET_STRING, priv_params, (msg_flags & MSG_FLAG_PRIV) ? PRIV_PARAMS_LEN : 0);
+    if (msg_flags & MSG_FLAG_AUTH) {
+        size_t params = ber_mark(&w);
+
+        ber_put(&w, zeros, AUTH_PARAMS_LEN);
+        auth_params = ber_mark(&w);
+        ber_put_header(&w, SNMP_CLIENT_OCTET_STRING, params);
+    } else {
+        ber_put_octets(&w, SNMP_CLIENT_OCTET_STRING, NULL, 0);
+    }
+    ber_put_octets(&w, SNMP_CLIENT_OCTET_STRING, user, strlen(user));
+    ber_put_integer(&w, SNMP_CLIENT_INTEGER, client->engine_time);
+    ber_put_integer(&w, SNMP_CLIENT_INTEGER, client->engine_boots);
+    ber_put_octets(&w, SNMP_CLIENT_OCTET_STRING, client->engine_id, client->engine_id_len);
+    ber_put_header(&w, BER_SEQUENCE, mark);
+    ber_put_header(&w, SNMP_CLIENT_OCTET_STRING, mark);
+
+    /* msgGlobalData */
+    mark = ber_mark(&w);
+    ber_put_integer(&w, SNMP_CLIENT_INTEGER, USM_SECURITY_MODEL);
+    ber_put_octets(&w, SNMP_CLIENT_OCTET_STRING, &msg_flags, 1);
+    ber_put_integer(&w, SNMP_CLIENT_INTEGER, MSG_MAX_SIZE);
+    ber_put_integer(&w, SNMP_CLIENT_INTEGER, client->request_id);
+    ber_put_header(&w, BER_SEQUENCE, mark);
+
+    ber_put_integer(&w, SNMP_CLIENT_INTEGER, SNMP_CLIENT_VERSION_3);
+    ber_put_header(&w, BER_SEQUENCE, 0);
+    if (w.error) {
+        return 0;
+    }
+
+    len = ber_mark(&w);
+    memmove(frame, &frame[w.pos], len);
+    if (msg_flags & MSG_FLAG_AUTH) {
+        authenticate(client, frame, len, &frame[len - auth_params]);
+    }
+    return len;
+}
+
+static size_t encode(struct snmp_client *client, uint8_t msg_flags, uint8_t pdu_type,
+                     const struct snmp_client_oid *oids, uint8_t oids_len,
+                     int32_t non_repeaters, int32_t max_repetitions, uint8_t *frame, size_t size)
+{
+    uint8_t scoped_pdu[SNMP_CLIENT_FRAME_MAX];
+    struct ber_writer w;
+    size_t len;
+
+    client->request_id++;
+
+    if (client->version != SNMP_CLIENT_VERSION_3) {
+        ber_init(&w, frame, size);
+        ber_put_pdu(&w, pdu_type, client->request_id, oids, oids_len, non_repeaters, max_repetitions);
+        ber_put_octets(&w, SNMP_CLIENT_OCTET_STRING, client->community, strlen(client->community));
+        ber_put_integer(&w, SNMP_CLIENT_INTEGER, client->version);
+        ber_put_header(&w, BER_SEQUENCE, 0);
+        if (w.error) {
+            return 0;
+        }
+        len = ber_mark(&w);
+        memmove(frame, &frame[w.pos], len);
+        return len;
+    }
+
+    ber_init(&w, scoped_pdu, sizeof(scoped_pdu));
+    ber_put_pdu(&w, pdu_type, client->request_id, oids, oids_len, non_repeaters, max_repetitions);
+    ber_put_octets(&w, SNMP_CLIENT_OCTET_STRING, NULL, 0);
+    ber_put_octets(&w, SNMP_CLIENT_OCTET_STRING, client->engine_id, client->engine_id_len);
+    ber_put_header(&w, BER_SEQUENCE, 0);
+    if (w.error) {
+        return 0;
+    }
+    return encode_v3(client, msg_flags, &scoped_pdu[w.pos], ber_mark(&w), frame, size);
+}
+
+size_t snmp_client_encode_discovery(struct snmp_client *client, uint8_t *frame, size_t size)
+{
+    uint8_t engine_id_len = client->engine_id_len;
+    size_t len;
+
+    client->engine_id_len = 0;
+    len = encode(client, MSG_FLAG_REPORTABLE, SNMP_CLIENT_GET, NULL, 0, 0, 0, frame, size);
+    client->engine_id_len = engine_id_len;
+    return len;
+}
+
+size_t snmp_client_encode(struct snmp_client *client, uint8_t pdu_type,
+                          const struct snmp_client_oid *oids, uint8_t oids_len,
+                          int32_t non_repeaters, int32_t max_repetitions,
+                          uint8_t *frame, size_t size)
+{
+    uint8_t msg_flags = MSG_FLAG_REPORTABLE;
+
+    if (client->auth_algo != SNMP_CLIENT_AUTH_NONE) {
+        msg_flags |= MSG_FLAG_AUTH;
+    }
+    if (client->priv_algo != SNMP_CLIENT_PRIV_NONE) {
+        msg_flags |= MSG_FLAG_PRIV;
+    }
+    msg_flags &= client->msg_flags_mask | MSG_FLAG_REPORTABLE;
+    return encode(client, msg_flags, pdu_type, oids, oids_len, non_repeaters, max_repetitions, frame, size);
+}
+
+static int decode_v3(struct snmp_client *client, struct ber_reader *message, const uint8_t *frame, size_t len,
+                     struct snmp_client_response *response)
+{
+    uint8_t plain[SNMP_CLIENT_FRAME_MAX];
+    uint8_t copy[SNMP_CLIENT_FRAME_MAX];
+    struct ber_reader global, flags, security, params;
+    struct ber_reader engine_id, user, auth_params, priv_params;
+    struct ber_reader scoped_pdu, context_engine_id, context_name;
+    int32_t msg_id, max_size, model, boots, time;
+    uint8_t mac[AUTH_PARAMS_LEN];
+
+    if (!ber_get_expected(message, BER_SEQUENCE, &global) ||
+        !ber_get_integer(&global, &msg_id) ||
+        !ber_get_integer(&global, &max_size) ||
+        !ber_get_expected(&global, SNMP_CLIENT_OCTET_STRING, &flags) || flags.len != 1 ||
+        !ber_get_integer(&global, &model) || model != USM_SECURITY_MODEL ||
+        !ber_get_expected(message, SNMP_CLIENT_OCTET_STRING, &security) ||
+        !ber_get_expected(&security, BER_SEQUENCE, &params) ||
+        !ber_get_expected(&params, SNMP_CLIENT_OCTET_STRING, &engine_id) ||
+        engine_id.len > SNMP_CLIENT_ENGINE_ID_MAX ||
+        !ber_get_integer(&params, &boots) ||
+        !ber_get_integer(&params, &time) ||
+        !ber_get_expected(&params, SNMP_CLIENT_OCTET_STRING, &user) ||
+        !ber_get_expected(&params, SNMP_CLIENT_OCTET_STRING, &auth_params) ||
+        !ber_get_expected(&params, SNMP_CLIENT_OCTET_STRING, &priv_params)) {
+        return 0;
+    }
+    response->msg_flags = flags.data[0];
+
+    snmp_client_set_engine(client, engine_id.data, (uint8_t)engine_id.len, boots, time);
+
+    if (response->msg_flags & MSG_FLAG_AUTH) {
+        size_t offset = (size_t)(auth_params.data - frame);
+
+        if (client->auth_algo == SNMP_CLIENT_AUTH_NONE || auth_params.len != AUTH_PARAMS_LEN || len > sizeof(copy)) {
+            return 0;
+        }
+        memcpy(copy, frame, len);
+        memset(&copy[offset], 0, AUTH_PARAMS_LEN);
+        authenticate(client, copy, len, mac);
+        if (memcmp(mac, auth_params.data, AUTH_PARAMS_LEN) != 0) {
+            return 0;
+        }
+    }
+
+    if (response->msg_flags & MSG_FLAG_PRIV) {
+        struct ber_reader encrypted;
+        struct ber_reader decrypted;
+
+        if (client->priv_algo == SNMP_CLIENT_PRIV_NONE || priv_params.len != PRIV_PARAMS_LEN ||
+            !ber_get_expected(message, SNMP_CLIENT_OCTET_STRING, &encrypted) || encrypted.len > sizeof(plain)) {
+            return 0;
+        }
+        memcpy(plain, encrypted.data, encrypted.len);
+        if (!usm_crypt(client, plain, encrypted.len, priv_params.data, boots, time, 0)) {
+            return 0;
+        }
+        /* DES pads the scoped PDU */
+        decrypted.data = plain;
+        decrypted.len = encrypted.len;
+        decrypted.pos = 0;
+        if (!ber_get_expected(&decrypted, BER_SEQUENCE, &scoped_pdu)) {
+            return 0;
+        }
+    } else if (!ber_get_expected(message, BER_SEQUENCE, &scoped_pdu)) {
+        return 0;
+    }
+
+    return ber_get_expected(&scoped_pdu, SNMP_CLIENT_OCTET_STRING, &context_engine_id) &&
+           ber_get_expected(&scoped_pdu, SNMP_CLIENT_OCTET_STRING, &context_name) &&
+           decode_pdu(&scoped_pdu, response);
+}
+
+int snmp_client_decode(struct snmp_client *client, const uint8_t *frame, size_t len,
+                       struct snmp_client_response *response)
+{
+    struct ber_reader r = { frame, len, 0 };
+    struct ber_reader message;
+    struct ber_reader community;
+    int32_t version;
+
+    memset(response, 0, sizeof(*response));
+    if (!ber_get_expected(&r, BER_SEQUENCE, &message) || r.pos != len ||
+        !ber_get_integer(&message, &version)) {
+        return 0;
+    }
+    response->version = (uint8_t)version;
+
+    if (version == SNMP_CLIENT_VERSION_3) {
+        return client->version == SNMP_CLIENT_VERSION_3 && decode_v3(client, &message, frame, len, response);
+    }
+
+    return version == client->version &&
+           ber_get_expected(&message, SNMP_CLIENT_OCTET_STRING, &community) &&
+           decode_pdu(&message, response);
+}
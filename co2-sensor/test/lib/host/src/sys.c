@@ -0,0 +1,69 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "esp_timer.h"
+#include "lwip/ip_addr.h"
+#include "lwip/netif.h"
+#include "lwip/sys.h"
+
+#include <time.h>
+
+const ip_addr_t ip_addr_any = { 0 };
+
+/* the loopback interface the agent socket is bound to */
+static struct netif loopback = { NULL, { PP_HTONL(LWIP_MAKEU32(127, 0, 0, 1)) }, 1 };
+struct netif *netif_list = &loopback;
+
+static u32_t fixed_now;
+static int64_t advanced_us;
+
+static int64_t monotonic_us(void)
+{
+    static int64_t start;
+    struct timespec ts;
+    int64_t now;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    now = (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    if (start == 0) {
+        start = now;
+    }
+    return now - start;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return monotonic_us() + advanced_us;
+}
+
+void esp_timer_advance(int64_t us)
+{
+    advanced_us += us;
+}
+
+u32_t sys_now(void)
+{
+    if (fixed_now != 0) {
+        return fixed_now;
+    }
+    return (u32_t)(monotonic_us() / 1000);
+}
+
+void sys_now_set(u32_t now)
+{
+    fixed_now = now;
+}
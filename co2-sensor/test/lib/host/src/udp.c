@@ -0,0 +1,153 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "lwip/udp.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define UDP_DATAGRAM_MAX 1500
+
+static u16_t port_override;
+static u8_t port_overridden;
+
+struct udp_pcb *udp_new_ip_type(u8_t type)
+{
+    struct udp_pcb *pcb = (struct udp_pcb *)calloc(1, sizeof(struct udp_pcb));
+
+    LWIP_UNUSED_ARG(type);
+
+    if (pcb == NULL) {
+        return NULL;
+    }
+    pcb->fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (pcb->fd < 0) {
+        free(pcb);
+        return NULL;
+    }
+    return pcb;
+}
+
+void udp_remove(struct udp_pcb *pcb)
+{
+    close(pcb->fd);
+    free(pcb);
+}
+
+void udp_set_port_override(u16_t port)
+{
+    port_override = port;
+    port_overridden = 1;
+}
+
+err_t udp_bind(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
+{
+    struct sockaddr_in addr = { 0 };
+    socklen_t len = sizeof(addr);
+
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = ip_addr_isany(ipaddr) ? htonl(INADDR_LOOPBACK) : ipaddr->addr;
+    addr.sin_port = htons(port_overridden ? port_override : port);
+    if (bind(pcb->fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        getsockname(pcb->fd, (struct sockaddr *)&addr, &len) != 0) {
+        return ERR_USE;
+    }
+
+    pcb->local_ip.addr = addr.sin_addr.s_addr;
+    pcb->local_port = ntohs(addr.sin_port);
+    return ERR_OK;
+}
+
+void udp_recv(struct udp_pcb *pcb, udp_recv_fn recv, void *recv_arg)
+{
+    pcb->recv = recv;
+    pcb->recv_arg = recv_arg;
+}
+
+err_t udp_sendto(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *dst_ip, u16_t dst_port)
+{
+    u8_t datagram[UDP_DATAGRAM_MAX];
+    struct sockaddr_in addr = { 0 };
+
+    if (p->tot_len > sizeof(datagram)) {
+        return ERR_VAL;
+    }
+    if (pcb->output != NULL) {
+        pcb->output(pcb->output_arg, p, dst_ip, dst_port);
+        return ERR_OK;
+    }
+
+    pbuf_copy_partial(p, datagram, p->tot_len, 0);
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = dst_ip->addr;
+    addr.sin_port = htons(dst_port);
+    if (sendto(pcb->fd, datagram, p->tot_len, 0, (struct sockaddr *)&addr, sizeof(addr)) != p->tot_len) {
+        return ERR_BUF;
+    }
+    return ERR_OK;
+}
+
+void udp_set_output(struct udp_pcb *pcb, udp_output_fn output, void *arg)
+{
+    pcb->output = output;
+    pcb->output_arg = arg;
+}
+
+err_t udp_input(struct udp_pcb *pcb, const void *data, u16_t len, const ip_addr_t *src_ip, u16_t src_port)
+{
+    /* like the WiFi driver, the datagram arrives as a chain of pool pbufs */
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, len, PBUF_POOL);
+
+    if (p == NULL) {
+        return ERR_MEM;
+    }
+    pbuf_take(p, data, len);
+    if (pcb->recv != NULL) {
+        /* the callback owns the pbuf */
+        pcb->recv(pcb->recv_arg, pcb, p, src_ip, src_port);
+    } else {
+        pbuf_free(p);
+    }
+    return ERR_OK;
+}
+
+int udp_poll(struct udp_pcb *pcb, int timeout_ms)
+{
+    u8_t datagram[UDP_DATAGRAM_MAX];
+    struct pollfd fds = { pcb->fd, POLLIN, 0 };
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    ip_addr_t source;
+    ssize_t len;
+
+    if (poll(&fds, 1, timeout_ms) <= 0) {
+        return 0;
+    }
+
+    len = recvfrom(pcb->fd, datagram, sizeof(datagram), 0, (struct sockaddr *)&addr, &addr_len);
+    if (len < 0) {
+        return 0;
+    }
+
+    source.addr = addr.sin_addr.s_addr;
+    udp_input(pcb, datagram, (u16_t)len, &source, ntohs(addr.sin_port));
+    return 1;
+}
@@ -0,0 +1,240 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * Load generator for the SNMP agent of the device. One UDP socket keeps a
+ * window of requests in flight, so the numbers are those of the agent and
+ * not of starting a process per request. v1, v2c and v3 are supported.
+ *
+ * gcc -O2 -Itest/lib/host/include test/load/snmp_load.c test/lib/host/src/snmp-client.c -lcrypto -o snmp-load
+ */
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "snmp-client.h"
+
+#define WINDOW_MAX 64
+
+/* shMeasurementValue of the co2 measurement, shMeasurementTable and sensorHubMIB */
+#define OID_GET "1.3.6.1.4.1.58049.1.2.1.2.1.1"
+#define OID_GETNEXT "1.3.6.1.4.1.58049.1.2"
+#define OID_GETBULK "1.3.6.1.4.1.58049.1"
+
+struct slot {
+    int32_t request_id;
+    uint64_t sent_us;
+};
+
+static const char usage[] =
+    "usage: snmp-load [-c window] [-n requests] [-m get:getnext:getbulk] [-r bulk repetitions]\n"
+    "                 [-t timeout ms] [-p port] [-v 1|2c|3] [-C community]\n"
+    "                 [-u user] [-a MD5|SHA] [-A auth password] [-x DES|AES] [-X priv password] host\n";
+
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static int open_socket(const char *host, const char *port)
+{
+    struct addrinfo hints = { 0 };
+    struct addrinfo *address;
+    int fd;
+
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    if (getaddrinfo(host, port, &hints, &address) != 0) {
+        fprintf(stderr, "unknown host %s\n", host);
+        return -1;
+    }
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0 || connect(fd, address->ai_addr, address->ai_addrlen) != 0) {
+        perror("socket");
+        freeaddrinfo(address);
+        return -1;
+    }
+    freeaddrinfo(address);
+    return fd;
+}
+
+/* v3 engine discovery, retried until timeout_ms passed */
+static int discover(int fd, struct snmp_client *client, int timeout_ms)
+{
+    struct snmp_client_response response;
+    uint8_t frame[SNMP_CLIENT_FRAME_MAX];
+    struct pollfd fds = { fd, POLLIN, 0 };
+    size_t len = snmp_client_encode_discovery(client, frame, sizeof(frame));
+    ssize_t received;
+
+    if (send(fd, frame, len, 0) != (ssize_t)len || poll(&fds, 1, timeout_ms) <= 0) {
+        return 0;
+    }
+    received = recv(fd, frame, sizeof(frame), 0);
+    return received > 0 && snmp_client_decode(client, frame, (size_t)received, &response) && client->engine_id_len > 0;
+}
+
+int main(int argc, char **argv)
+{
+    static struct snmp_client_response response;
+    struct snmp_client client;
+    struct snmp_client_oid oid_get, oid_getnext, oid_getbulk;
+    struct slot slots[WINDOW_MAX] = { { 0 } };
+    uint8_t frame[SNMP_CLIENT_FRAME_MAX];
+    uint32_t *latencies;
+    int window = 4, requests = 1000, repetitions = 10, timeout_ms = 2000;
+    int weight_get = 1, weight_getnext = 1, weight_getbulk = 1;
+    const char *port = "161", *community = "public", *version = "2c";
+    const char *user = NULL, *auth_password = "", *priv_password = "";
+    uint8_t auth = SNMP_CLIENT_AUTH_NONE, priv = SNMP_CLIENT_PRIV_NONE;
+    int sent = 0, ok = 0, failed = 0, opt, fd;
+    uint64_t start, elapsed;
+
+    while ((opt = getopt(argc, argv, "c:n:m:r:t:p:v:C:u:a:A:x:X:")) != -1) {
+        switch (opt) {
+        case 'c': window = atoi(optarg); break;
+        case 'n': requests = atoi(optarg); break;
+        case 'm': sscanf(optarg, "%d:%d:%d", &weight_get, &weight_getnext, &weight_getbulk); break;
+        case 'r': repetitions = atoi(optarg); break;
+        case 't': timeout_ms = atoi(optarg); break;
+        case 'p': port = optarg; break;
+        case 'v': version = optarg; break;
+        case 'C': community = optarg; break;
+        case 'u': user = optarg; break;
+        case 'a': auth = strcmp(optarg, "MD5") == 0 ? SNMP_CLIENT_AUTH_MD5 : SNMP_CLIENT_AUTH_SHA; break;
+        case 'A': auth_password = optarg; break;
+        case 'x': priv = strcmp(optarg, "DES") == 0 ? SNMP_CLIENT_PRIV_DES : SNMP_CLIENT_PRIV_AES; break;
+        case 'X': priv_password = optarg; break;
+        default: fputs(usage, stderr); return 1;
+        }
+    }
+    if (optind != argc - 1 || window < 1 || window > WINDOW_MAX || requests < 1 ||
+        weight_get + weight_getnext + weight_getbulk <= 0) {
+        fputs(usage, stderr);
+        return 1;
+    }
+
+    fd = open_socket(argv[optind], port);
+    if (fd < 0) {
+        return 1;
+    }
+
+    if (strcmp(version, "3") == 0) {
+        snmp_client_init_v3(&client, user != NULL ? user : "", auth, auth_password, priv, priv_password);
+        if (!discover(fd, &client, timeout_ms)) {
+            fprintf(stderr, "no engine discovery report from %s\n", argv[optind]);
+            return 1;
+        }
+    } else {
+        snmp_client_init(&client, strcmp(version, "1") == 0 ? SNMP_CLIENT_VERSION_1 : SNMP_CLIENT_VERSION_2C, community);
+    }
+
+    snmp_client_parse_oid(OID_GET, &oid_get);
+    snmp_client_parse_oid(OID_GETNEXT, &oid_getnext);
+    snmp_client_parse_oid(OID_GETBULK, &oid_getbulk);
+    latencies = (uint32_t *)calloc((size_t)requests, sizeof(uint32_t));
+    if (latencies == NULL) {
+        return 1;
+    }
+
+    printf("window %d, %d requests, mix get:getnext:getbulk %d:%d:%d, bulk repetitions %d, v%s\n",
+           window, requests, weight_get, weight_getnext, weight_getbulk, repetitions, version);
+
+    start = now_us();
+    while (ok + failed < requests) {
+        struct pollfd fds = { fd, POLLIN, 0 };
+        uint64_t now;
+
+        /* fill the window */
+        for (int i = 0; i < window && sent < requests; i++) {
+            int pick = rand() % (weight_get + weight_getnext + weight_getbulk);
+            size_t len;
+
+            if (slots[i].request_id != 0) {
+                continue;
+            }
+            if (pick < weight_get) {
+                len = snmp_client_encode(&client, SNMP_CLIENT_GET, &oid_get, 1, 0, 0, frame, sizeof(frame));
+            } else if (pick < weight_get + weight_getnext) {
+                len = snmp_client_encode(&client, SNMP_CLIENT_GETNEXT, &oid_getnext, 1, 0, 0, frame, sizeof(frame));
+            } else {
+                len = snmp_client_encode(&client, SNMP_CLIENT_GETBULK, &oid_getbulk, 1, 0, repetitions, frame, sizeof(frame));
+            }
+            slots[i].request_id = client.request_id;
+            slots[i].sent_us = now_us();
+            send(fd, frame, len, 0);
+            sent++;
+        }
+
+        if (poll(&fds, 1, 10) > 0) {
+            ssize_t received = recv(fd, frame, sizeof(frame), 0);
+
+            now = now_us();
+            if (received > 0 && snmp_client_decode(&client, frame, (size_t)received, &response)) {
+                for (int i = 0; i < window; i++) {
+                    if (slots[i].request_id != 0 && slots[i].request_id == response.request_id) {
+                        latencies[ok++] = (uint32_t)(now - slots[i].sent_us);
+                        slots[i].request_id = 0;
+                        break;
+                    }
+                }
+            }
+        }
+
+        /* a dropped request frees its slot after the timeout */
+        now = now_us();
+        for (int i = 0; i < window; i++) {
+            if (slots[i].request_id != 0 && now - slots[i].sent_us > (uint64_t)timeout_ms * 1000) {
+                slots[i].request_id = 0;
+                failed++;
+            }
+        }
+    }
+    elapsed = now_us() - start;
+    close(fd);
+
+    printf("requests: %d ok, %d failed in %.2f s\n", ok, failed, elapsed / 1e6);
+    if (ok == 0) {
+        return 1;
+    }
+    qsort(latencies, (size_t)ok, sizeof(latencies[0]), compare_u32);
+    printf("throughput: %.1f requests/s\n", ok / (elapsed / 1e6));
+    printf("latency ms: p50 %.1f  p90 %.1f  p99 %.1f  max %.1f\n",
+           latencies[(ok - 1) * 50 / 100] / 1e3, latencies[(ok - 1) * 90 / 100] / 1e3,
+           latencies[(ok - 1) * 99 / 100] / 1e3, latencies[ok - 1] / 1e3);
+    free(latencies);
+    return failed > 0 ? 2 : 0;
+}
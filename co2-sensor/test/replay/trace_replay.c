@@ -0,0 +1,418 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Replays a trace.bin recorded by the device through the filters, the alerts,
+ * the history and the graph decimation, in virtual time and as fast as they
+ * run. Each stage is timed on top of the previous ones, and a digest of all
+ * outputs changes whenever the behavior does.
+ *
+ * gcc -O2 -Iinclude -Itest/lib/host/include test/replay/trace_replay.c src/trace.c src/filter.c src/alerts.c \
+ *     src/history.c src/plot.c src/battery.c -lm -o trace-replay
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "alerts.h"
+#include "battery.h"
+#include "filter.h"
+#include "history.h"
+#include "plot.h"
+#include "sensorhub-mib.h"
+#include "trace.h"
+#include "traces.h"
+
+/* the default zoom of the graph on the display */
+#define GRAPH_COLUMNS 240
+#define GRAPH_SPAN 14400
+#define BATTERY_CAPACITY_MAH 700
+#define SYNTHETIC_START 1700000000
+
+enum stage {
+    STAGE_DECODE,
+    STAGE_FILTER,
+    STAGE_ALERTS,
+    STAGE_HISTORY,
+    STAGE_GRAPH,
+    STAGES
+};
+
+static const char *stage_names[STAGES] = { "decode", "+ filter, battery", "+ alerts", "+ history", "+ graph" };
+
+struct noise {
+    int32_t raw;
+    int32_t filtered;
+    double raw_sum;
+    double filtered_sum;
+    uint32_t len;
+};
+
+struct replay {
+    enum stage stage;
+    bool print;
+    uint32_t unix_time;
+    uint32_t types[TRACE_CONNECTIVITY + 1];
+    uint32_t raised;
+    uint32_t cleared;
+    struct noise noise[FILTER_METRICS];
+    uint32_t digest;
+};
+
+static const char usage[] =
+    "usage: trace-replay [-t tick ms] [-r repeats] [-v] trace.bin    -v prints the alerts\n"
+    "       trace-replay -w trace.bin    writes a trace of the recorded samples in traces.h\n";
+
+static struct replay *current;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+/* FNV-1a over the outputs */
+static void digest(struct replay *replay, int32_t value)
+{
+    for (uint8_t i = 0; i < 4; i++) {
+        replay->digest = (replay->digest ^ (uint8_t)(value >> (8 * i))) * 16777619;
+    }
+}
+
+static void on_alert(const struct alert_rule *rule, int32_t value, bool active)
+{
+    if (active) {
+        current->raised++;
+    } else {
+        current->cleared++;
+    }
+    digest(current, value);
+    if (current->print) {
+        printf("alert %s %s at %d\n", alerts_metric_name(rule->metric), active ? "raised" : "cleared", (int)value);
+    }
+}
+
+static void add_noise(struct noise *noise, int32_t raw, int32_t filtered)
+{
+    if (noise->len > 0) {
+        noise->raw_sum += (double)(raw - noise->raw) * (raw - noise->raw);
+        noise->filtered_sum += (double)(filtered - noise->filtered) * (filtered - noise->filtered);
+    }
+    noise->raw = raw;
+    noise->filtered = filtered;
+    noise->len++;
+}
+
+static void sensor(struct replay *replay, const struct trace_event *event)
+{
+    uint8_t type = event->sensor.measurement_type;
+    int32_t value = event->sensor.value;
+
+    if (replay->stage < STAGE_FILTER) {
+        return;
+    }
+    value = filter_process(type, event->sensor.value, event->time_ms);
+    digest(replay, value);
+    if (type >= 1 && type <= FILTER_METRICS) {
+        add_noise(&replay->noise[type - 1], event->sensor.value, value);
+        /* the alert metrics are numbered as the measurement types */
+        if (replay->stage >= STAGE_ALERTS) {
+            alerts_evaluate(type, value, event->time_ms, on_alert);
+        }
+    }
+    if (replay->stage >= STAGE_HISTORY) {
+        history_add_sample(type, replay->unix_time + event->time_ms / 1000, value);
+    }
+}
+
+static void battery(struct replay *replay, const struct trace_event *event)
+{
+    if (replay->stage < STAGE_FILTER) {
+        return;
+    }
+    battery_update(&event->battery);
+    digest(replay, battery_percent());
+    if (replay->stage >= STAGE_ALERTS) {
+        alerts_evaluate(ALERT_METRIC_BATTERY, battery_percent(), event->time_ms, on_alert);
+    }
+    if (replay->stage >= STAGE_HISTORY) {
+        uint32_t now = replay->unix_time + event->time_ms / 1000;
+
+        history_add_sample(BATTERY_VOLTAGE_MEASUREMENT, now, (int32_t)(event->battery.voltage * 1000));
+        history_add_sample(BATTERY_CURRENT_MEASUREMENT, now, (int32_t)event->battery.current);
+    }
+}
+
+static void on_event(void *context, const struct trace_event *event)
+{
+    struct replay *replay = context;
+
+    replay->types[event->type]++;
+    switch (event->type) {
+    case TRACE_SENSOR:
+        sensor(replay, event);
+        break;
+    case TRACE_BATTERY:
+        battery(replay, event);
+        break;
+    default:
+        /* touches and connectivity drive the UI and the network code, which only run on the device */
+        break;
+    }
+}
+
+/* a frame of the loop redraws the co2 graph */
+static void on_tick(void *context, uint32_t now_ms)
+{
+    static struct plot_column columns[GRAPH_COLUMNS];
+    struct replay *replay = context;
+    uint32_t end = replay->unix_time + now_ms / 1000;
+    int16_t low, high;
+
+    if (replay->stage < STAGE_GRAPH) {
+        return;
+    }
+    plot_decimate(history_get_series(CO2_PPM_MEASUREMENT, plot_resolution(GRAPH_SPAN)), end - GRAPH_SPAN, GRAPH_SPAN,
+                  columns, GRAPH_COLUMNS);
+    if (plot_bounds(columns, GRAPH_COLUMNS, &low, &high)) {
+        digest(replay, low << 16 | (uint16_t)high);
+    }
+}
+
+/* the state of a device after a start with the default settings */
+static void reset(struct replay *replay, enum stage stage, uint32_t unix_time)
+{
+    memset(replay, 0, sizeof(*replay));
+    replay->stage = stage;
+    replay->unix_time = unix_time;
+    replay->digest = 2166136261u;
+    current = replay;
+
+    filter_reset();
+    alerts_clear();
+    alerts_add_rule(ALERT_METRIC_CO2, ALERT_ABOVE, 1400, 100, 60000);
+    alerts_add_rule(ALERT_METRIC_BATTERY, ALERT_BELOW, 10, 5, 0);
+    battery_reset(BATTERY_CAPACITY_MAH);
+}
+
+static uint8_t *read_file(const char *path, size_t *len)
+{
+    FILE *file = fopen(path, "rb");
+    uint8_t *data = NULL;
+    long size;
+
+    if (file == NULL) {
+        perror(path);
+        return NULL;
+    }
+    if (fseek(file, 0, SEEK_END) == 0 && (size = ftell(file)) >= 0 && fseek(file, 0, SEEK_SET) == 0) {
+        data = malloc(size > 0 ? size : 1);
+        if (data != NULL && fread(data, 1, size, file) != (size_t)size) {
+            free(data);
+            data = NULL;
+        }
+        *len = size;
+    }
+    if (data == NULL) {
+        fprintf(stderr, "%s: cannot read\n", path);
+    }
+    fclose(file);
+    return data;
+}
+
+static bool flush(FILE *file, bool force)
+{
+    const uint8_t *data;
+    size_t len = trace_pending(&data);
+
+    if (len == 0 || (!force && len < TRACE_BUFFER_SIZE / 2)) {
+        return true;
+    }
+    if (fwrite(data, 1, len, file) != len) {
+        return false;
+    }
+    trace_consumed();
+    return true;
+}
+
+/* open circuit voltage of the state of charge, battery_ocv_soc() inverted by bisection */
+static float ocv(float soc)
+{
+    float low = 3.0f, high = 4.2f;
+
+    for (uint8_t i = 0; i < 20; i++) {
+        float mid = (low + high) / 2;
+
+        if (battery_ocv_soc(mid) < soc) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    return (low + high) / 2;
+}
+
+/*
+ * The meeting room and battery traces as the recorder writes them: co2 every
+ * 5 s with temperature and humidity, a battery sample every minute with the
+ * open circuit voltage of the recorded percent.
+ */
+static int write_synthetic(const char *path)
+{
+    const uint32_t battery_every = TRACE_BATTERY_PERIOD_MS / TRACE_CO2_PERIOD_MS;
+    FILE *file = fopen(path, "wb");
+    float coulomb_mah = 0;
+    bool ok = true;
+
+    if (file == NULL) {
+        perror(path);
+        return 1;
+    }
+
+    trace_start(0, SYNTHETIC_START);
+    trace_connectivity(0, 3, true);
+    for (uint32_t i = 0; i < sizeof(trace_meeting_room) / sizeof(trace_meeting_room[0]) && ok; i++) {
+        uint32_t now_ms = i * TRACE_CO2_PERIOD_MS;
+
+        trace_sensor(now_ms, 1, CO2_PPM_MEASUREMENT, trace_meeting_room[i]);
+        trace_sensor(now_ms, 1, TEMPERATURE_MEASUREMENT, 220 + (int32_t)(i * 7 % 11) - 5);
+        trace_sensor(now_ms, 1, HUMIDITY_MEASUREMENT, 430 + (int32_t)(i * 5 % 13) - 6);
+        if (i % battery_every == 0) {
+            uint32_t minute = (i / battery_every) % (sizeof(trace_battery_percent) / sizeof(trace_battery_percent[0]));
+            struct battery_sample sample = { now_ms, ocv(trace_battery_percent[minute] / 100.0f), -80, coulomb_mah, false, false };
+
+            coulomb_mah -= 80.0f / 60;
+            trace_battery(&sample);
+        }
+        if (i == 200) {
+            trace_touch(now_ms, 160, 200, true);
+            trace_touch(now_ms + 120, 160, 200, false);
+        }
+        ok = flush(file, false);
+    }
+    trace_stop();
+    ok = ok && trace_dropped() == 0 && flush(file, true);
+    if (fclose(file) != 0 || !ok) {
+        fprintf(stderr, "%s: cannot write\n", path);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    static const struct trace_handlers handlers = { on_tick, on_event };
+    struct trace_reader reader;
+    struct trace_event last;
+    struct replay replay;
+    uint32_t tick_ms = 1000;
+    bool verbose = false;
+    uint32_t span_ms = 0;
+    long repeats = 20;
+    long events = 0;
+    double previous_ns = 0;
+    uint8_t *data;
+    size_t len;
+    int option;
+
+    while ((option = getopt(argc, argv, "t:r:vw:")) != -1) {
+        switch (option) {
+        case 't':
+            tick_ms = strtoul(optarg, NULL, 10);
+            break;
+        case 'r':
+            repeats = strtol(optarg, NULL, 10);
+            break;
+        case 'v':
+            verbose = true;
+            break;
+        case 'w':
+            return write_synthetic(optarg);
+        default:
+            fputs(usage, stderr);
+            return 2;
+        }
+    }
+    if (optind != argc - 1 || repeats < 1) {
+        fputs(usage, stderr);
+        return 2;
+    }
+
+    data = read_file(argv[optind], &len);
+    if (data == NULL) {
+        return 1;
+    }
+    if (!trace_reader_init(&reader, data, len)) {
+        fprintf(stderr, "%s: not a trace\n", argv[optind]);
+        free(data);
+        return 1;
+    }
+    while (trace_next(&reader, &last) > 0) {
+        span_ms = last.time_ms;
+    }
+    if (!history_init()) {
+        fprintf(stderr, "no memory for the history\n");
+        free(data);
+        return 1;
+    }
+
+    /* every repeat continues where the previous one ended, the history only moves forward */
+    for (enum stage stage = STAGE_DECODE; stage < STAGES; stage++) {
+        uint64_t start_ns = now_ns();
+        double ns;
+
+        for (long r = 0; r < repeats; r++) {
+            reset(&replay, stage, reader.unix_time + ((uint32_t)stage * repeats + r) * (span_ms / 1000 + 86400));
+            replay.print = verbose && stage == STAGES - 1 && r == repeats - 1;
+            events = trace_replay(data, len, tick_ms, &handlers, &replay);
+            if (events < 0) {
+                fprintf(stderr, "%s: corrupt record after %u events\n", argv[optind],
+                        replay.types[TRACE_SENSOR] + replay.types[TRACE_BATTERY] + replay.types[TRACE_TOUCH] +
+                            replay.types[TRACE_CONNECTIVITY]);
+                free(data);
+                return 1;
+            }
+        }
+        ns = (double)(now_ns() - start_ns) / repeats / (events > 0 ? events : 1);
+        printf("%-18s %8.1f ns/event  %+8.1f ns  %10.0fx real time\n", stage_names[stage], ns, ns - previous_ns,
+               span_ms / (ns * (events > 0 ? events : 1) / 1e6));
+        previous_ns = ns;
+    }
+
+    printf("%ld events over %.1f h: %u sensor, %u battery, %u touch, %u connectivity\n", events, span_ms / 3.6e6,
+           replay.types[TRACE_SENSOR], replay.types[TRACE_BATTERY], replay.types[TRACE_TOUCH],
+           replay.types[TRACE_CONNECTIVITY]);
+    for (uint8_t i = 0; i < FILTER_METRICS; i++) {
+        const struct noise *noise = &replay.noise[i];
+
+        if (noise->len > 1) {
+            printf("%-12s noise raw %6.1f  filtered %6.1f\n", alerts_metric_name(i + 1),
+                   sqrt(noise->raw_sum / (noise->len - 1)), sqrt(noise->filtered_sum / (noise->len - 1)));
+        }
+    }
+    printf("alerts raised %u, cleared %u, battery %d %%, digest %08x\n", replay.raised, replay.cleared,
+           battery_percent(), replay.digest);
+
+    free(data);
+    return 0;
+}
@@ -0,0 +1,195 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <unity.h>
+
+#include "alerts.h"
+#include "traces.h"
+
+#define CHANGES_MAX 64
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+struct change {
+    uint32_t at_ms;
+    int32_t value;
+    bool active;
+};
+
+static struct change changes[CHANGES_MAX];
+static uint8_t changes_len;
+
+static void record_change(const struct alert_rule *rule, int32_t value, bool active)
+{
+    (void)rule;
+
+    if (changes_len < CHANGES_MAX) {
+        changes[changes_len].value = value;
+        changes[changes_len].active = active;
+        changes_len++;
+    }
+}
+
+/* replays the trace like the loop does, returns the time of the last sample */
+static uint32_t replay(uint8_t metric, const int16_t *trace, uint16_t len, uint32_t period_ms)
+{
+    uint32_t now_ms = 0;
+
+    for (uint16_t i = 0; i < len; i++) {
+        uint8_t before = changes_len;
+
+        now_ms = i * period_ms;
+        alerts_evaluate(metric, trace[i], now_ms, record_change);
+        if (changes_len != before) {
+            changes[changes_len - 1].at_ms = now_ms;
+        }
+    }
+
+    return now_ms;
+}
+
+void setUp(void)
+{
+    alerts_clear();
+    changes_len = 0;
+}
+
+void tearDown(void)
+{
+}
+
+static void test_meeting_room_raises_and_clears_once(void)
+{
+    /* the default co2 rule */
+    TEST_ASSERT_TRUE(alerts_add_rule(ALERT_METRIC_CO2, ALERT_ABOVE, 1400, 100, 60000));
+
+    replay(ALERT_METRIC_CO2, trace_meeting_room, ARRAY_SIZE(trace_meeting_room), TRACE_CO2_PERIOD_MS);
+
+    TEST_ASSERT_EQUAL_UINT8(2, changes_len);
+    TEST_ASSERT_TRUE(changes[0].active);
+    TEST_ASSERT_GREATER_THAN(1400, changes[0].value);
+    TEST_ASSERT_FALSE(changes[1].active);
+    TEST_ASSERT_LESS_THAN(1300, changes[1].value);
+    /* the window is opened after 40 min */
+    TEST_ASSERT_GREATER_THAN(40 * 60000, changes[1].at_ms);
+    TEST_ASSERT_FALSE(alerts_get_rule(0)->active);
+}
+
+static void test_meeting_room_waits_for_min_duration(void)
+{
+    uint32_t above_since_ms = 0;
+    bool above = false;
+
+    TEST_ASSERT_TRUE(alerts_add_rule(ALERT_METRIC_CO2, ALERT_ABOVE, 1400, 100, 60000));
+
+    /* the first sample that has been above the threshold for a minute */
+    for (uint16_t i = 0; i < ARRAY_SIZE(trace_meeting_room); i++) {
+        if (trace_meeting_room[i] <= 1400) {
+            above = false;
+        } else if (!above) {
+            above = true;
+            above_since_ms = i * TRACE_CO2_PERIOD_MS;
+        } else if (i * TRACE_CO2_PERIOD_MS - above_since_ms >= 60000) {
+            break;
+        }
+    }
+
+    replay(ALERT_METRIC_CO2, trace_meeting_room, ARRAY_SIZE(trace_meeting_room), TRACE_CO2_PERIOD_MS);
+
+    TEST_ASSERT_GREATER_THAN(0, changes_len);
+    TEST_ASSERT_EQUAL_UINT32(above_since_ms + 60000, changes[0].at_ms);
+}
+
+static void test_noise_chatters_without_hysteresis(void)
+{
+    TEST_ASSERT_TRUE(alerts_add_rule(ALERT_METRIC_CO2, ALERT_ABOVE, 1400, 0, 0));
+
+    replay(ALERT_METRIC_CO2, trace_co2_noise, ARRAY_SIZE(trace_co2_noise), TRACE_CO2_PERIOD_MS);
+
+    TEST_ASSERT_GREATER_THAN(10, changes_len);
+}
+
+static void test_noise_is_absorbed_by_hysteresis_and_duration(void)
+{
+    TEST_ASSERT_TRUE(alerts_add_rule(ALERT_METRIC_CO2, ALERT_ABOVE, 1400, 100, 60000));
+
+    replay(ALERT_METRIC_CO2, trace_co2_noise, ARRAY_SIZE(trace_co2_noise), TRACE_CO2_PERIOD_MS);
+
+    TEST_ASSERT_LESS_OR_EQUAL(1, changes_len);
+}
+
+static void test_battery_jitter_raises_once(void)
+{
+    /* the default battery rule */
+    TEST_ASSERT_TRUE(alerts_add_rule(ALERT_METRIC_BATTERY, ALERT_BELOW, 10, 5, 0));
+
+    replay(ALERT_METRIC_BATTERY, trace_battery_percent, ARRAY_SIZE(trace_battery_percent), TRACE_BATTERY_PERIOD_MS);
+
+    TEST_ASSERT_EQUAL_UINT8(1, changes_len);
+    TEST_ASSERT_TRUE(changes[0].active);
+    TEST_ASSERT_LESS_THAN(10, changes[0].value);
+    /* charging back to 15 % is still inside the hysteresis */
+    TEST_ASSERT_TRUE(alerts_get_rule(0)->active);
+}
+
+static void test_other_metrics_are_ignored(void)
+{
+    TEST_ASSERT_TRUE(alerts_add_rule(ALERT_METRIC_BATTERY, ALERT_BELOW, 10, 5, 0));
+
+    replay(ALERT_METRIC_CO2, trace_meeting_room, ARRAY_SIZE(trace_meeting_room), TRACE_CO2_PERIOD_MS);
+
+    TEST_ASSERT_EQUAL_UINT8(0, changes_len);
+}
+
+static void test_rules_are_validated(void)
+{
+    TEST_ASSERT_FALSE(alerts_add_rule(0, ALERT_ABOVE, 1000, 0, 0));
+    TEST_ASSERT_FALSE(alerts_add_rule(ALERT_METRIC_BATTERY + 1, ALERT_ABOVE, 1000, 0, 0));
+    TEST_ASSERT_FALSE(alerts_add_rule(ALERT_METRIC_CO2, ALERT_BELOW + 1, 1000, 0, 0));
+
+    for (uint8_t i = 0; i < ALERT_RULES_MAX; i++) {
+        TEST_ASSERT_TRUE(alerts_add_rule(ALERT_METRIC_CO2, ALERT_ABOVE, 1000 + i, -50, 0));
+    }
+    TEST_ASSERT_FALSE(alerts_add_rule(ALERT_METRIC_CO2, ALERT_ABOVE, 2000, 0, 0));
+    TEST_ASSERT_EQUAL_UINT8(ALERT_RULES_MAX, alerts_rule_count());
+    TEST_ASSERT_EQUAL_INT32(50, alerts_get_rule(0)->hysteresis);
+    TEST_ASSERT_NULL(alerts_get_rule(ALERT_RULES_MAX));
+}
+
+static void test_metric_names(void)
+{
+    for (uint8_t metric = ALERT_METRIC_CO2; metric <= ALERT_METRIC_BATTERY; metric++) {
+        TEST_ASSERT_EQUAL_INT(metric, alerts_metric_from_name(alerts_metric_name(metric)));
+    }
+    TEST_ASSERT_NULL(alerts_metric_name(0));
+    TEST_ASSERT_EQUAL_INT(-1, alerts_metric_from_name("pressure"));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_meeting_room_raises_and_clears_once);
+    RUN_TEST(test_meeting_room_waits_for_min_duration);
+    RUN_TEST(test_noise_chatters_without_hysteresis);
+    RUN_TEST(test_noise_is_absorbed_by_hysteresis_and_duration);
+    RUN_TEST(test_battery_jitter_raises_once);
+    RUN_TEST(test_other_metrics_are_ignored);
+    RUN_TEST(test_rules_are_validated);
+    RUN_TEST(test_metric_names);
+    return UNITY_END();
+}
@@ -0,0 +1,323 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <unity.h>
+
+#include <math.h>
+#include <stdio.h>
+
+#include "battery.h"
+
+/* a bigger cell than the 700 mAh the model starts with */
+#define CELL_MAH 1500.0f
+#define CELL_RESISTANCE_OHM 0.2f
+#define LOAD_MA 300.0f
+#define CHARGE_MA 500.0f
+/* the device turns off at this open circuit voltage */
+#define CUTOFF_VOLTAGE 3.3f
+#define SAMPLE_MS 10000
+#define CYCLES 6
+
+/* the cell of the script, the counter runs on from cycle to cycle */
+struct cell {
+    float soc;
+    float coulomb_mah;
+    uint32_t time_ms;
+};
+
+/* open circuit voltage of a state of charge, the inverse of battery_ocv_soc() */
+static float ocv(float soc)
+{
+    float low = 3.0f;
+    float high = 4.3f;
+
+    for (int i = 0; i < 30; i++) {
+        float middle = (low + high) / 2;
+        if (battery_ocv_soc(middle) < soc) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    return high;
+}
+
+/* one sample of the cell with current flowing for SAMPLE_MS, positive while charging */
+static void sample(struct cell *cell, float current, bool ac, struct battery_sample *out)
+{
+    float mah = current * SAMPLE_MS / 3600000.0f;
+
+    cell->soc = fminf(fmaxf(cell->soc + mah / CELL_MAH, 0), 1);
+    cell->coulomb_mah += mah;
+    cell->time_ms += SAMPLE_MS;
+
+    out->time_ms = cell->time_ms;
+    out->voltage = ocv(cell->soc) + current / 1000.0f * CELL_RESISTANCE_OHM;
+    out->current = current;
+    out->coulomb_mah = cell->coulomb_mah;
+    out->ac = ac;
+    out->charging = ac && current > 0;
+}
+
+/* discharges down to the cutoff, returns the samples it took */
+static uint32_t discharge(struct cell *cell)
+{
+    struct battery_sample s;
+    uint32_t samples = 0;
+
+    do {
+        sample(cell, -LOAD_MA, false, &s);
+        battery_update(&s);
+        samples++;
+        TEST_ASSERT_TRUE(samples < 10000);
+    } while (ocv(cell->soc) > CUTOFF_VOLTAGE);
+    return samples;
+}
+
+/* charges until the current tapered off at the end of charge */
+static void charge(struct cell *cell)
+{
+    struct battery_sample s;
+    uint32_t samples = 0;
+
+    do {
+        /* constant current, then constant voltage with the current tapering */
+        float current = cell->soc < 0.9f ? CHARGE_MA : CHARGE_MA * (1 - cell->soc) * 10;
+        sample(cell, fmaxf(current, 10), true, &s);
+        battery_update(&s);
+        samples++;
+        TEST_ASSERT_TRUE(samples < 10000);
+    } while (battery_percent() < 100 || s.current >= 20);
+}
+
+static struct battery_sample at_rest(uint32_t time_ms, float voltage, float coulomb_mah)
+{
+    struct battery_sample s = { time_ms, voltage, 0, coulomb_mah, false, false };
+    return s;
+}
+
+void setUp(void)
+{
+    battery_reset(700);
+}
+
+void tearDown(void)
+{
+}
+
+static void test_axp192_registers_are_decoded(void)
+{
+    /* ac present, charging */
+    const uint8_t power[BATTERY_AXP192_POWER_LEN] = { 0x80, 0x40 };
+    /* 3636 * 1.1 mV, 400 * 0.5 mA charging, 20 * 0.5 mA discharging */
+    const uint8_t adc[BATTERY_AXP192_ADC_LEN] = { 3636 >> 4, 3636 & 0x0f, 400 >> 5, 400 & 0x1f, 0, 20 };
+    /* 1000 counts charged, 100 discharged */
+    const uint8_t coulomb[BATTERY_AXP192_COULOMB_LEN] = { 0, 0, 0x03, 0xe8, 0, 0, 0, 100 };
+    struct battery_sample s;
+
+    battery_axp192_sample(&s, power, adc, coulomb, 1234);
+    TEST_ASSERT_EQUAL_UINT32(1234, s.time_ms);
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, 3.9996f, s.voltage);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 190.0f, s.current);
+    /* 65536 counts of 0.5 mA at 25 Hz each */
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 327.68f, s.coulomb_mah);
+    TEST_ASSERT_TRUE(s.ac);
+    TEST_ASSERT_TRUE(s.charging);
+}
+
+static void test_axp192_discharge_is_negative(void)
+{
+    const uint8_t power[BATTERY_AXP192_POWER_LEN] = { 0x00, 0x00 };
+    /* the upper bits of the low bytes are not part of the values */
+    const uint8_t adc[BATTERY_AXP192_ADC_LEN] = { 0, 0xf0, 0, 0xe0, 600 >> 5, 0xe0 | (600 & 0x1f) };
+    /* the discharge counter is ahead, both near the top of their range */
+    const uint8_t coulomb[BATTERY_AXP192_COULOMB_LEN] = { 0xff, 0xff, 0xff, 0x00, 0xff, 0xff, 0xff, 0x64 };
+    struct battery_sample s;
+
+    battery_axp192_sample(&s, power, adc, coulomb, 0);
+    TEST_ASSERT_EQUAL_FLOAT(0, s.voltage);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, -300.0f, s.current);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, -36.41f, s.coulomb_mah);
+    TEST_ASSERT_FALSE(s.ac);
+    TEST_ASSERT_FALSE(s.charging);
+}
+
+static void test_the_first_sample_starts_from_the_voltage(void)
+{
+    struct battery_sample s = at_rest(0, 3.84f, 123);
+
+    TEST_ASSERT_NULL(battery_last_sample(0));
+    battery_update(&s);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.5f, battery_soc());
+    TEST_ASSERT_EQUAL_INT(50, battery_percent());
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 350.0f, battery_remaining());
+
+    TEST_ASSERT_NOT_NULL(battery_last_sample(BATTERY_SAMPLE_MAX_AGE_MS));
+    TEST_ASSERT_NULL(battery_last_sample(BATTERY_SAMPLE_MAX_AGE_MS + 1));
+}
+
+static void test_the_end_of_charge_is_full(void)
+{
+    struct battery_sample s = at_rest(0, 3.84f, 0);
+
+    battery_update(&s);
+
+    /* charging, the current has not tapered off yet */
+    s = (struct battery_sample){ 1000, 4.18f, 100, 0.03f, true, true };
+    battery_update(&s);
+    TEST_ASSERT_TRUE(battery_percent() < 100);
+
+    /* the same voltage without the charger is no anchor */
+    s = (struct battery_sample){ 2000, 4.18f, 10, 0.03f, false, false };
+    battery_update(&s);
+    TEST_ASSERT_TRUE(battery_percent() < 100);
+
+    s = (struct battery_sample){ 3000, 4.18f, 10, 0.03f, true, false };
+    battery_update(&s);
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, battery_soc());
+}
+
+static void test_the_cutoff_is_empty(void)
+{
+    struct battery_sample s = at_rest(0, 3.84f, 0);
+
+    battery_update(&s);
+
+    /* the voltage drop of the load is not mistaken for the cutoff */
+    s = (struct battery_sample){ 1000, 3.25f, -400, -0.1f, false, false };
+    battery_update(&s);
+    TEST_ASSERT_TRUE(battery_soc() > 0.4f);
+
+    /* on the charger the voltage is no reference */
+    s = (struct battery_sample){ 2000, 3.28f, 0, -0.1f, true, false };
+    battery_update(&s);
+    TEST_ASSERT_TRUE(battery_soc() > 0.4f);
+
+    s = (struct battery_sample){ 3000, 3.25f, -100, -0.2f, false, false };
+    battery_update(&s);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, battery_soc());
+}
+
+static void test_a_counter_jump_is_not_counted(void)
+{
+    struct battery_sample s = at_rest(0, 3.84f, 1000);
+
+    battery_update(&s);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.5f, battery_soc());
+
+    /* the counter was cleared, the charge did not change */
+    s = at_rest(1000, 3.84f, 0);
+    battery_update(&s);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.5f, battery_soc());
+
+    /* from the new value on the counter is followed again */
+    s = at_rest(2000, 3.84f, -35);
+    battery_update(&s);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.45f, battery_soc());
+}
+
+static void test_a_long_rest_pulls_towards_the_voltage(void)
+{
+    struct battery_sample s = at_rest(0, 3.84f, 0);
+    uint32_t t;
+
+    battery_update(&s);
+    /* the counter claims 35 mAh more than the voltage shows */
+    s = at_rest(1000, 3.84f, 35);
+    battery_update(&s);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.55f, battery_soc());
+
+    /* only the gentle pull while the voltage settles */
+    for (t = 2000; t < 300000; t += 1000) {
+        s = at_rest(t, 3.84f, 35);
+        battery_update(&s);
+    }
+    TEST_ASSERT_TRUE(battery_soc() > 0.52f);
+
+    for (; t < 400000; t += 1000) {
+        s = at_rest(t, 3.84f, 35);
+        battery_update(&s);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.5f, battery_soc());
+}
+
+static void test_the_capacity_is_learned_over_cycles(void)
+{
+    struct cell cell = { 0.6f, 0, 0 };
+    struct battery_sample s;
+    char line[80];
+    float error = CELL_MAH;
+
+    sample(&cell, 0, false, &s);
+    battery_update(&s);
+    charge(&cell);
+    TEST_ASSERT_EQUAL_FLOAT(700, battery_capacity());
+
+    for (int cycle = 0; cycle < CYCLES; cycle++) {
+        uint32_t samples = discharge(&cell);
+        charge(&cell);
+
+        /* each anchor takes part of the way, the error only shrinks */
+        float next = fabsf(battery_capacity() - CELL_MAH);
+        snprintf(line, sizeof(line), "cycle %d: %.0f mAh learned, %u min on battery", cycle + 1,
+                 battery_capacity(), (unsigned)(samples * SAMPLE_MS / 60000));
+        TEST_MESSAGE(line);
+        TEST_ASSERT_TRUE(next < error);
+        error = next;
+    }
+    TEST_ASSERT_FLOAT_WITHIN(CELL_MAH * 0.03f, CELL_MAH, battery_capacity());
+
+    /* with the capacity learned the counted charge follows the cell */
+    for (int i = 0; i < 360; i++) {
+        sample(&cell, -LOAD_MA, false, &s);
+        battery_update(&s);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.03f, cell.soc, battery_soc());
+}
+
+static void test_implausible_capacities_are_ignored(void)
+{
+    struct battery_sample s = at_rest(0, 4.18f, 0);
+
+    battery_reset(BATTERY_CAPACITY_MAX_MAH + 1);
+    TEST_ASSERT_EQUAL_FLOAT(700, battery_capacity());
+    battery_reset(1200);
+    TEST_ASSERT_EQUAL_FLOAT(1200, battery_capacity());
+
+    /* full, then empty after only 20 mAh */
+    s = (struct battery_sample){ 0, 4.18f, 10, 0, true, false };
+    battery_update(&s);
+    s = (struct battery_sample){ 1000, 3.25f, -10, -20, false, false };
+    battery_update(&s);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, battery_soc());
+    TEST_ASSERT_EQUAL_FLOAT(1200, battery_capacity());
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_axp192_registers_are_decoded);
+    RUN_TEST(test_axp192_discharge_is_negative);
+    RUN_TEST(test_the_first_sample_starts_from_the_voltage);
+    RUN_TEST(test_the_end_of_charge_is_full);
+    RUN_TEST(test_the_cutoff_is_empty);
+    RUN_TEST(test_a_counter_jump_is_not_counted);
+    RUN_TEST(test_a_long_rest_pulls_towards_the_voltage);
+    RUN_TEST(test_the_capacity_is_learned_over_cycles);
+    RUN_TEST(test_implausible_capacities_are_ignored);
+    return UNITY_END();
+}
@@ -0,0 +1,233 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <unity.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "data-log.h"
+#include "memory-fs.h"
+#include "traces.h"
+
+/* five years of a record every minute, from 2020 on */
+#define LOG_START 1577836800
+#define LOG_MINUTES (5 * 365 * 24 * 60)
+#define LOG_END (LOG_START + LOG_MINUTES * 60)
+/* records the writer task appends at once */
+#define APPEND_BATCH 60
+
+#define HOUR 3600
+#define DAY (24 * HOUR)
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+struct range
+{
+    const char *name;
+    uint32_t seconds;
+};
+
+static MemoryFS memoryFs;
+static DataLog dataLog(memoryFs, "/log.bin", "/log.idx");
+static bool logged;
+
+static uint64_t nowNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* the meeting room trace over and over, with a daily temperature and battery cycle */
+static void makeRecord(uint32_t minute, struct dataRecord *record)
+{
+    record->time = LOG_START + minute * 60;
+    record->co2Ppm = trace_meeting_room[minute % ARRAY_SIZE(trace_meeting_room)];
+    record->temperature = 200 + (minute / 60) % 24 * 2;
+    record->humidity = 400 + minute % 97;
+    record->batteryMah = 2000.0f - minute % 1440 * 0.5f;
+}
+
+static void assertRecord(uint32_t minute, const struct dataRecord *record)
+{
+    struct dataRecord expected;
+
+    makeRecord(minute, &expected);
+    TEST_ASSERT_EQUAL_UINT32(expected.time, record->time);
+    TEST_ASSERT_EQUAL_INT32(expected.co2Ppm, record->co2Ppm);
+    TEST_ASSERT_EQUAL_INT32(expected.temperature, record->temperature);
+    TEST_ASSERT_EQUAL_INT32(expected.humidity, record->humidity);
+    TEST_ASSERT_EQUAL_FLOAT(expected.batteryMah, record->batteryMah);
+}
+
+void setUp(void)
+{
+    struct dataRecord records[APPEND_BATCH];
+    char line[120];
+
+    if (logged)
+    {
+        return;
+    }
+    TEST_ASSERT_TRUE(dataLog.begin());
+
+    uint64_t start = nowNs();
+    for (uint32_t minute = 0; minute < LOG_MINUTES; minute += APPEND_BATCH)
+    {
+        for (uint32_t i = 0; i < APPEND_BATCH; i++)
+        {
+            makeRecord(minute + i, &records[i]);
+        }
+        TEST_ASSERT_EQUAL(APPEND_BATCH, dataLog.append(records, APPEND_BATCH));
+    }
+    uint64_t ns = nowNs() - start;
+
+    // the segments of a day and the list of them
+    uint32_t dataSize = 0;
+    uint32_t indexSize = 0;
+    File root = memoryFs.open("/");
+    for (File file = root.openNextFile(); file; file = root.openNextFile())
+    {
+        const char *suffix = strrchr(file.name(), '.');
+        if (suffix != NULL && strcmp(suffix, ".bin") == 0)
+        {
+            dataSize += file.size();
+        }
+        else
+        {
+            indexSize += file.size();
+        }
+    }
+    snprintf(line, sizeof(line), "%u records appended in %.0f ms, log %.1f MB (%.2f bytes/record), index %.0f kB",
+             (unsigned)LOG_MINUTES, ns / 1e6, dataSize / 1e6, (double)dataSize / LOG_MINUTES, indexSize / 1e3);
+    TEST_MESSAGE(line);
+    logged = true;
+}
+
+void tearDown(void)
+{
+}
+
+/* ranges across the whole log come back complete and in order, nothing from outside of them */
+static void test_ranges_hold_what_was_logged(void)
+{
+    static const uint32_t starts[] = { LOG_START, LOG_START + 1, LOG_START + 400 * DAY + 1234,
+                                       LOG_END - 7 * DAY - 59, LOG_END - HOUR };
+    static const uint32_t lengths[] = { 60, DAY, 7 * DAY + 30, HOUR + 1 };
+    struct dataRecord record;
+
+    for (uint8_t i = 0; i < ARRAY_SIZE(starts); i++)
+    {
+        for (uint8_t j = 0; j < ARRAY_SIZE(lengths); j++)
+        {
+            uint32_t from = starts[i];
+            uint32_t to = from + lengths[j] < LOG_END ? from + lengths[j] : LOG_END;
+            uint32_t minute = (from - LOG_START + 59) / 60;
+            DataLogQuery query(dataLog, from, to);
+
+            while (query.next(&record))
+            {
+                assertRecord(minute++, &record);
+            }
+            TEST_ASSERT_EQUAL_UINT32((to - LOG_START + 59) / 60, minute);
+        }
+    }
+
+    uint32_t newest;
+    TEST_ASSERT_TRUE(dataLog.newest(&newest));
+    TEST_ASSERT_EQUAL_UINT32(LOG_END - 60, newest);
+}
+
+/* the last day, week, month and year through the index and by decoding the log from its start */
+static void test_range_query_cost(void)
+{
+    static const struct range ranges[] = {
+        { "day", DAY }, { "week", 7 * DAY }, { "month", 30 * DAY }, { "year", 365 * DAY }
+    };
+    struct dataRecord record;
+    char line[160];
+
+    for (uint8_t i = 0; i < ARRAY_SIZE(ranges); i++)
+    {
+        uint32_t from = LOG_END - ranges[i].seconds;
+        uint32_t found = 0;
+        uint64_t start = nowNs();
+        DataLogQuery indexed(dataLog, from, LOG_END);
+
+        while (indexed.next(&record))
+        {
+            found++;
+        }
+        uint64_t indexedNs = nowNs() - start;
+
+        uint32_t scannedFound = 0;
+        start = nowNs();
+        DataLogQuery scan(dataLog, 0, UINT32_MAX);
+        while (scan.next(&record))
+        {
+            scannedFound += record.time >= from;
+        }
+        uint64_t scanNs = nowNs() - start;
+
+        snprintf(line, sizeof(line),
+                 "last %-5s %7u records  index %8.2f ms %6u blocks %8u decoded  scan %7.1f ms %6u blocks %8u decoded",
+                 ranges[i].name, (unsigned)found, indexedNs / 1e6, (unsigned)indexed.blocks(),
+                 (unsigned)indexed.scanned(), scanNs / 1e6, (unsigned)scan.blocks(), (unsigned)scan.scanned());
+        TEST_MESSAGE(line);
+
+        TEST_ASSERT_EQUAL_UINT32(ranges[i].seconds / 60, found);
+        TEST_ASSERT_EQUAL_UINT32(found, scannedFound);
+        /* only the hours of the range are decoded */
+        TEST_ASSERT_EQUAL_UINT32(ranges[i].seconds / HOUR, indexed.blocks());
+        TEST_ASSERT_EQUAL_UINT32(found, indexed.scanned());
+        TEST_ASSERT_EQUAL_UINT32(LOG_MINUTES / 60, scan.blocks());
+    }
+}
+
+/* a week as the CSV of GET /export */
+static void test_csv_export_cost(void)
+{
+    uint8_t buffer[1024];
+    uint64_t bytes = 0;
+    size_t len;
+    char line[120];
+
+    uint64_t start = nowNs();
+    DataLogQuery query(dataLog, LOG_END - 7 * DAY, LOG_END);
+    while ((len = query.read(buffer, sizeof(buffer))) > 0)
+    {
+        bytes += len;
+    }
+    uint64_t ns = nowNs() - start;
+
+    snprintf(line, sizeof(line), "last week as CSV: %.0f kB in %.1f ms", bytes / 1e3, ns / 1e6);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL_UINT32(7 * DAY / 60, query.scanned());
+    TEST_ASSERT_GREATER_THAN(7 * DAY / 60 * 30, bytes);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_ranges_hold_what_was_logged);
+    RUN_TEST(test_range_query_cost);
+    RUN_TEST(test_csv_export_cost);
+    return UNITY_END();
+}
@@ -0,0 +1,355 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <unity.h>
+
+#include <FSImpl.h>
+
+#include <memory>
+
+#include "data-log-writer.h"
+#include "memory-fs.h"
+
+#define START 1577836800
+#define RECORDS 200
+#define TRACE_PATH "/trace.bin"
+
+// the card, it answers nothing while it is out of the slot
+static MemoryFS card;
+static bool inserted;
+
+class CardFileImpl : public fs::FileImpl
+{
+public:
+    explicit CardFileImpl(File file) : file(file) {}
+
+    size_t write(const uint8_t *buf, size_t size) { return inserted ? file.write(buf, size) : 0; }
+    size_t read(uint8_t *buf, size_t size) { return inserted ? file.read(buf, size) : 0; }
+    void flush() { file.flush(); }
+    bool seek(uint32_t pos, fs::SeekMode mode) { return inserted && file.seek(pos, mode); }
+    size_t position() const { return file.position(); }
+    size_t size() const { return file.size(); }
+    bool setBufferSize(size_t size) { return file.setBufferSize(size); }
+    void close() { file.close(); }
+    time_t getLastWrite() { return file.getLastWrite(); }
+    const char *path() const { return file.path(); }
+    const char *name() const { return file.name(); }
+    boolean isDirectory(void) { return file.isDirectory(); }
+    fs::FileImplPtr openNextFile(const char * /* mode */) { return nullptr; }
+    boolean seekDir(long /* position */) { return false; }
+    String getNextFileName(void) { return file.getNextFileName(); }
+    void rewindDirectory(void) { file.rewindDirectory(); }
+    operator bool() { return file; }
+
+private:
+    File file;
+};
+
+class CardFSImpl : public fs::FSImpl
+{
+public:
+    fs::FileImplPtr open(const char *path, const char *mode, const bool create)
+    {
+        File file = inserted ? card.open(path, mode, create) : File();
+        return file ? std::make_shared<CardFileImpl>(file) : nullptr;
+    }
+    bool exists(const char *path) { return inserted && card.exists(path); }
+    bool rename(const char *pathFrom, const char *pathTo) { return inserted && card.rename(pathFrom, pathTo); }
+    bool remove(const char *path) { return inserted && card.remove(path); }
+    bool mkdir(const char * /* path */) { return false; }
+    bool rmdir(const char * /* path */) { return false; }
+};
+
+class CardFS : public fs::FS
+{
+public:
+    CardFS() : fs::FS(std::make_shared<CardFSImpl>()) {}
+};
+
+// the slot, counts how often the card was mounted and given up
+class CardVolume : public RemovableVolume
+{
+public:
+    bool mount()
+    {
+        mounts++;
+        return inserted;
+    }
+    void unmount() { unmounts++; }
+
+    uint32_t mounts;
+    uint32_t unmounts;
+};
+
+static CardFS cardFs;
+static CardVolume volume;
+static DataLog dataLog(cardFs, "/log.bin", "/log.idx");
+static DataLogWriter *writer;
+
+static struct dataRecord makeRecord(uint32_t i)
+{
+    struct dataRecord record = {START + i * 2, (int32_t)(400 + i % 1000), (int32_t)(200 + i % 50),
+                                (int32_t)(400 + i % 300), 1000.0f};
+    return record;
+}
+
+static void submit(uint32_t from, uint32_t to)
+{
+    for (uint32_t i = from; i < to; i++)
+    {
+        struct dataRecord record = makeRecord(i);
+        TEST_ASSERT_TRUE(writer->submit(&record));
+    }
+}
+
+// steps the task until the ring is empty, returns the steps taken
+static uint32_t drain(uint32_t nowMs)
+{
+    uint32_t steps = 0;
+
+    while (writer->pending() > 0)
+    {
+        TEST_ASSERT_EQUAL_UINT32(0, writer->run(nowMs));
+        TEST_ASSERT_TRUE(++steps < 10000);
+    }
+    return steps;
+}
+
+// the log holds the records from..to-1 and nothing else
+static void assertLogged(uint32_t from, uint32_t to)
+{
+    DataLogQuery query(dataLog, 0, 0xffffffff);
+    struct dataRecord record;
+    uint32_t i = from;
+
+    while (query.next(&record))
+    {
+        struct dataRecord expected = makeRecord(i++);
+        TEST_ASSERT_EQUAL_UINT32(expected.time, record.time);
+        TEST_ASSERT_EQUAL_INT32(expected.co2Ppm, record.co2Ppm);
+    }
+    TEST_ASSERT_EQUAL_UINT32(to, i);
+}
+
+void setUp(void)
+{
+    card.clear();
+    inserted = true;
+    volume.mounts = 0;
+    volume.unmounts = 0;
+    writer = new DataLogWriter(dataLog, volume, NULL, &cardFs, TRACE_PATH);
+}
+
+void tearDown(void)
+{
+    delete writer;
+}
+
+static void test_records_are_written_in_batches(void)
+{
+    TEST_ASSERT_TRUE(writer->begin());
+    TEST_ASSERT_TRUE(writer->mounted());
+
+    submit(0, RECORDS);
+    TEST_ASSERT_EQUAL_UINT32(RECORDS, writer->pending());
+    TEST_ASSERT_EQUAL_UINT32((RECORDS + DATA_LOG_WRITE_BATCH - 1) / DATA_LOG_WRITE_BATCH, drain(0));
+    TEST_ASSERT_EQUAL_UINT32(DATA_LOG_IDLE_MS, writer->run(0));
+
+    assertLogged(0, RECORDS);
+    TEST_ASSERT_EQUAL_UINT32(0, volume.unmounts);
+}
+
+static void test_a_missing_card_is_looked_for(void)
+{
+    inserted = false;
+    TEST_ASSERT_TRUE(writer->begin());
+    TEST_ASSERT_FALSE(writer->mounted());
+    uint32_t nowMs = millis() + 1000;
+
+    submit(0, RECORDS);
+    uint32_t waitMs = writer->run(nowMs);
+    TEST_ASSERT_TRUE(waitMs > 0 && waitMs <= DATA_LOG_MOUNT_RETRY_MS);
+    TEST_ASSERT_EQUAL_UINT32(1, volume.mounts);
+
+    // not before the retry
+    inserted = true;
+    TEST_ASSERT_EQUAL_UINT32(1, writer->run(nowMs + waitMs - 1));
+    TEST_ASSERT_FALSE(writer->mounted());
+    TEST_ASSERT_EQUAL_UINT32(0, writer->run(nowMs + waitMs));
+    TEST_ASSERT_TRUE(writer->mounted());
+    TEST_ASSERT_EQUAL_UINT32(2, volume.mounts);
+    drain(nowMs + waitMs);
+
+    assertLogged(0, RECORDS);
+}
+
+static void test_a_removed_card_keeps_the_records_until_it_is_back(void)
+{
+    TEST_ASSERT_TRUE(writer->begin());
+    submit(0, RECORDS);
+    drain(0);
+
+    // taken out, the next batch fails and the card is given up
+    inserted = false;
+    submit(RECORDS, 2 * RECORDS);
+    TEST_ASSERT_EQUAL_UINT32(DATA_LOG_MOUNT_RETRY_MS, writer->run(1000));
+    TEST_ASSERT_FALSE(writer->mounted());
+    TEST_ASSERT_EQUAL_UINT32(1, volume.unmounts);
+    TEST_ASSERT_EQUAL_UINT32(RECORDS, writer->pending());
+
+    // still out at the retry, the backlog grows
+    submit(2 * RECORDS, 3 * RECORDS);
+    TEST_ASSERT_EQUAL_UINT32(DATA_LOG_MOUNT_RETRY_MS, writer->run(1000 + DATA_LOG_MOUNT_RETRY_MS));
+    TEST_ASSERT_EQUAL_UINT32(2 * RECORDS, writer->pending());
+
+    // back, mounted again and the backlog is flushed in order
+    inserted = true;
+    TEST_ASSERT_EQUAL_UINT32(0, writer->run(1000 + 2 * DATA_LOG_MOUNT_RETRY_MS));
+    TEST_ASSERT_TRUE(writer->mounted());
+    drain(1000 + 2 * DATA_LOG_MOUNT_RETRY_MS);
+
+    assertLogged(0, 3 * RECORDS);
+    TEST_ASSERT_EQUAL_UINT32(0, writer->dropped());
+}
+
+static void test_a_full_ring_drops_the_newest_records(void)
+{
+    inserted = false;
+    TEST_ASSERT_TRUE(writer->begin());
+    uint32_t retryMs = millis() + DATA_LOG_MOUNT_RETRY_MS;
+
+    submit(0, DATA_LOG_BACKLOG);
+    struct dataRecord record = makeRecord(DATA_LOG_BACKLOG);
+    TEST_ASSERT_FALSE(writer->submit(&record));
+    TEST_ASSERT_FALSE(writer->submit(&record));
+    TEST_ASSERT_EQUAL_UINT32(2, writer->dropped());
+    TEST_ASSERT_EQUAL_UINT32(DATA_LOG_BACKLOG, writer->pending());
+
+    inserted = true;
+    TEST_ASSERT_EQUAL_UINT32(0, writer->run(retryMs));
+    drain(retryMs);
+    assertLogged(0, DATA_LOG_BACKLOG);
+
+    // there is room again
+    TEST_ASSERT_TRUE(writer->submit(&record));
+    drain(retryMs);
+    assertLogged(0, DATA_LOG_BACKLOG + 1);
+}
+
+// byte i of a trace
+static uint8_t traceByte(uint32_t i)
+{
+    return (uint8_t)(i * 7 + i / 251);
+}
+
+static bool submitTrace(uint32_t from, uint32_t to)
+{
+    uint8_t data[DATA_LOG_TRACE_BUFFER + 1];
+
+    for (uint32_t i = from; i < to; i++)
+    {
+        data[i - from] = traceByte(i);
+    }
+    return writer->submitTrace(data, to - from);
+}
+
+static void assertTraced(uint32_t from, uint32_t to)
+{
+    File file = card.open(TRACE_PATH, "r");
+    uint8_t byte;
+    uint32_t i = from;
+
+    TEST_ASSERT_TRUE(file);
+    while (file.read(&byte, 1) == 1)
+    {
+        TEST_ASSERT_EQUAL_HEX8(traceByte(i++), byte);
+    }
+    file.close();
+    TEST_ASSERT_EQUAL_UINT32(to, i);
+}
+
+static void test_the_trace_is_written_by_the_task(void)
+{
+    TEST_ASSERT_TRUE(writer->begin());
+    TEST_ASSERT_TRUE(writer->restartTrace());
+
+    TEST_ASSERT_TRUE(submitTrace(0, 3000));
+    TEST_ASSERT_FALSE(card.exists(TRACE_PATH));
+    writer->run(0);
+    assertTraced(0, 3000);
+
+    // around the end of the ring
+    TEST_ASSERT_TRUE(submitTrace(3000, 6000));
+    TEST_ASSERT_FALSE(submitTrace(6000, 6000 + DATA_LOG_TRACE_BUFFER));
+    writer->run(0);
+    assertTraced(0, 6000);
+
+    // the next trace drops what is queued of the last one
+    TEST_ASSERT_TRUE(submitTrace(6000, 7000));
+    TEST_ASSERT_TRUE(writer->restartTrace());
+    TEST_ASSERT_FALSE(card.exists(TRACE_PATH));
+    TEST_ASSERT_TRUE(submitTrace(0, 100));
+    writer->run(0);
+    assertTraced(0, 100);
+}
+
+static void test_a_failed_trace_write_stops_the_trace(void)
+{
+    TEST_ASSERT_TRUE(writer->begin());
+    TEST_ASSERT_TRUE(writer->restartTrace());
+
+    inserted = false;
+    TEST_ASSERT_TRUE(submitTrace(0, 100));
+    writer->run(0);
+    TEST_ASSERT_FALSE(submitTrace(100, 200));
+
+    inserted = true;
+    TEST_ASSERT_TRUE(writer->restartTrace());
+    TEST_ASSERT_TRUE(submitTrace(0, 100));
+    writer->run(0);
+    assertTraced(0, 100);
+}
+
+static void test_the_task_waits_for_a_reader(void)
+{
+    TEST_ASSERT_TRUE(writer->begin());
+    submit(0, RECORDS);
+
+    TEST_ASSERT_TRUE(writer->lock());
+    // a take of a held mutex fails at once on the host
+    TEST_ASSERT_FALSE(writer->lock(0));
+    TEST_ASSERT_EQUAL_UINT32(0, writer->run(0));
+    TEST_ASSERT_EQUAL_UINT32(RECORDS, writer->pending());
+    TEST_ASSERT_FALSE(writer->restartTrace());
+    writer->unlock();
+
+    drain(0);
+    assertLogged(0, RECORDS);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_records_are_written_in_batches);
+    RUN_TEST(test_a_missing_card_is_looked_for);
+    RUN_TEST(test_a_removed_card_keeps_the_records_until_it_is_back);
+    RUN_TEST(test_a_full_ring_drops_the_newest_records);
+    RUN_TEST(test_the_trace_is_written_by_the_task);
+    RUN_TEST(test_a_failed_trace_write_stops_the_trace);
+    RUN_TEST(test_the_task_waits_for_a_reader);
+    return UNITY_END();
+}
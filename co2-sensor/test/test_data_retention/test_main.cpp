@@ -0,0 +1,358 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <unity.h>
+
+#include <string>
+
+#include "data-retention.h"
+#include "memory-fs.h"
+
+// 2020-01-01 00:00 UTC
+#define START 1577836800
+#define DAY 86400
+// a record a minute
+#define DAY_RECORDS 1440
+
+static MemoryFS memoryFs;
+
+static struct dataRecord makeRecord(uint32_t minute)
+{
+    struct dataRecord record = {START + minute * 60, (int32_t)(400 + minute % 1000), (int32_t)(200 + minute % 50),
+                                (int32_t)(400 + minute % 300), 1000.0f};
+    return record;
+}
+
+static void appendMinutes(DataLog &log, uint32_t from, uint32_t to)
+{
+    for (uint32_t minute = from; minute < to; minute++)
+    {
+        struct dataRecord record = makeRecord(minute);
+        TEST_ASSERT_EQUAL(1, log.append(&record, 1));
+    }
+}
+
+// the log holds the records of the minutes from..to-1 and nothing else
+static void assertMinutes(DataLog &log, uint32_t from, uint32_t to)
+{
+    DataLogQuery query(log, 0, 0xffffffff);
+    struct dataRecord record;
+    uint32_t minute = from;
+
+    while (query.next(&record))
+    {
+        struct dataRecord expected = makeRecord(minute++);
+        TEST_ASSERT_EQUAL_UINT32(expected.time, record.time);
+        TEST_ASSERT_EQUAL_INT32(expected.co2Ppm, record.co2Ppm);
+    }
+    TEST_ASSERT_EQUAL_UINT32(to, minute);
+}
+
+static std::string contents(const char *path)
+{
+    File file = memoryFs.open(path, FILE_READ);
+    std::string text;
+    uint8_t buffer[256];
+    size_t len;
+
+    while ((len = file.read(buffer, sizeof(buffer))) > 0)
+    {
+        text.append((const char *)buffer, len);
+    }
+    file.close();
+    return text;
+}
+
+void setUp(void)
+{
+    memoryFs.clear();
+}
+
+void tearDown(void)
+{
+}
+
+void test_each_day_has_a_segment(void)
+{
+    DataLog log(memoryFs, "/log.bin", "/log.idx");
+
+    TEST_ASSERT_TRUE(log.begin());
+    appendMinutes(log, 0, 3 * DAY_RECORDS);
+
+    TEST_ASSERT_TRUE(memoryFs.exists("/log-20200101.bin"));
+    TEST_ASSERT_TRUE(memoryFs.exists("/log-20200102.idx"));
+    TEST_ASSERT_TRUE(memoryFs.exists("/log-20200103.bin"));
+    TEST_ASSERT_FALSE(memoryFs.exists("/log-20200104.bin"));
+    TEST_ASSERT_FALSE(memoryFs.exists("/log.bin"));
+    TEST_ASSERT_EQUAL_UINT32(3 * sizeof(uint32_t), contents("/log.seg").size());
+    TEST_ASSERT_EQUAL_UINT32(START + DAY, log.segmentStart(START + DAY + 3600));
+    assertMinutes(log, 0, 3 * DAY_RECORDS);
+
+    // a range within the second day only opens its segment
+    DataLogQuery query(log, START + DAY + 3600, START + DAY + 7200);
+    struct dataRecord record;
+    uint32_t count = 0;
+    while (query.next(&record))
+    {
+        count++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(60, count);
+    TEST_ASSERT_EQUAL_UINT32(1, query.blocks());
+}
+
+void test_a_restart_continues_the_last_segment(void)
+{
+    {
+        DataLog log(memoryFs, "/log.bin", "/log.idx");
+        TEST_ASSERT_TRUE(log.begin());
+        appendMinutes(log, 0, DAY_RECORDS + 60);
+    }
+
+    DataLog log(memoryFs, "/log.bin", "/log.idx");
+    TEST_ASSERT_TRUE(log.begin());
+    appendMinutes(log, DAY_RECORDS + 60, 2 * DAY_RECORDS + 60);
+    TEST_ASSERT_EQUAL_UINT32(3 * sizeof(uint32_t), contents("/log.seg").size());
+    assertMinutes(log, 0, 2 * DAY_RECORDS + 60);
+
+    uint32_t newest;
+    TEST_ASSERT_TRUE(log.newest(&newest));
+    TEST_ASSERT_EQUAL_UINT32(makeRecord(2 * DAY_RECORDS + 59).time, newest);
+}
+
+void test_a_partly_listed_segment_is_left_out(void)
+{
+    {
+        DataLog log(memoryFs, "/log.bin", "/log.idx");
+        TEST_ASSERT_TRUE(log.begin());
+        appendMinutes(log, 0, DAY_RECORDS + 60);
+    }
+    // a reset while the third day was listed
+    File list = memoryFs.open("/log.seg", FILE_APPEND);
+    list.write((const uint8_t *)"\x01\x02", 2);
+    list.close();
+
+    DataLog log(memoryFs, "/log.bin", "/log.idx");
+    TEST_ASSERT_TRUE(log.begin());
+    appendMinutes(log, DAY_RECORDS + 60, 2 * DAY_RECORDS + 60);
+    TEST_ASSERT_EQUAL_UINT32(3 * sizeof(uint32_t), contents("/log.seg").size());
+    assertMinutes(log, 0, 2 * DAY_RECORDS + 60);
+}
+
+void test_a_drop_removes_whole_segments(void)
+{
+    DataLog log(memoryFs, "/log.bin", "/log.idx");
+
+    TEST_ASSERT_TRUE(log.begin());
+    appendMinutes(log, 0, 3 * DAY_RECORDS);
+    std::string kept = contents("/log-20200103.bin");
+    std::string keptIndex = contents("/log-20200103.idx");
+
+    // the second day only ends after the time
+    TEST_ASSERT_TRUE(log.dropBefore(START + DAY + 3600));
+    TEST_ASSERT_FALSE(memoryFs.exists("/log-20200101.bin"));
+    TEST_ASSERT_FALSE(memoryFs.exists("/log-20200101.idx"));
+    TEST_ASSERT_TRUE(memoryFs.exists("/log-20200102.bin"));
+    TEST_ASSERT_FALSE(memoryFs.exists("/log.seg.new"));
+    assertMinutes(log, DAY_RECORDS, 3 * DAY_RECORDS);
+
+    TEST_ASSERT_TRUE(log.dropBefore(START + 2 * DAY));
+    TEST_ASSERT_EQUAL_UINT32(sizeof(uint32_t), contents("/log.seg").size());
+    TEST_ASSERT_TRUE(kept == contents("/log-20200103.bin"));
+    TEST_ASSERT_TRUE(keptIndex == contents("/log-20200103.idx"));
+    assertMinutes(log, 2 * DAY_RECORDS, 3 * DAY_RECORDS);
+
+    // the records after it go on in the same segment
+    appendMinutes(log, 3 * DAY_RECORDS, 3 * DAY_RECORDS + 60);
+    assertMinutes(log, 2 * DAY_RECORDS, 3 * DAY_RECORDS + 60);
+}
+
+void test_dropping_everything_starts_over(void)
+{
+    DataLog log(memoryFs, "/log.bin", "/log.idx");
+
+    TEST_ASSERT_TRUE(log.begin());
+    appendMinutes(log, 0, 2 * DAY_RECORDS);
+    TEST_ASSERT_TRUE(log.dropBefore(START + 5 * DAY));
+    TEST_ASSERT_FALSE(memoryFs.exists("/log.seg"));
+    TEST_ASSERT_FALSE(memoryFs.exists("/log-20200102.bin"));
+    TEST_ASSERT_TRUE(log.dropBefore(START + 5 * DAY));
+
+    uint32_t newest;
+    TEST_ASSERT_FALSE(log.newest(&newest));
+    appendMinutes(log, 6 * DAY_RECORDS, 6 * DAY_RECORDS + 10);
+    TEST_ASSERT_TRUE(memoryFs.exists("/log-20200107.bin"));
+    assertMinutes(log, 6 * DAY_RECORDS, 6 * DAY_RECORDS + 10);
+}
+
+void test_a_drop_waits_for_queries(void)
+{
+    DataLog log(memoryFs, "/log.bin", "/log.idx");
+    struct dataRecord record;
+
+    TEST_ASSERT_TRUE(log.begin());
+    appendMinutes(log, 0, 2 * DAY_RECORDS);
+    {
+        DataLogQuery query(log, 0, 0xffffffff);
+        TEST_ASSERT_TRUE(query.next(&record));
+        TEST_ASSERT_FALSE(log.dropBefore(START + DAY));
+        TEST_ASSERT_TRUE(memoryFs.exists("/log-20200101.bin"));
+    }
+    TEST_ASSERT_TRUE(log.dropBefore(START + DAY));
+    assertMinutes(log, DAY_RECORDS, 2 * DAY_RECORDS);
+}
+
+void test_a_log_of_older_firmware_becomes_the_last_segment(void)
+{
+    {
+        // one segment for all of it, in the files the older firmware wrote
+        DataLog old(memoryFs, "/old.bin", "/old.idx", DATA_LOG_INDEX_PERIOD, 0xffffffff);
+        TEST_ASSERT_TRUE(old.begin());
+        appendMinutes(old, 0, 2 * DAY_RECORDS + 60);
+    }
+    TEST_ASSERT_TRUE(memoryFs.rename("/old-19700101.bin", "/log.bin"));
+    TEST_ASSERT_TRUE(memoryFs.rename("/old-19700101.idx", "/log.idx"));
+    TEST_ASSERT_TRUE(memoryFs.remove("/old.seg"));
+
+    DataLog log(memoryFs, "/log.bin", "/log.idx");
+    TEST_ASSERT_TRUE(log.begin());
+    TEST_ASSERT_FALSE(memoryFs.exists("/log.bin"));
+    TEST_ASSERT_FALSE(memoryFs.exists("/log.idx"));
+    TEST_ASSERT_TRUE(memoryFs.exists("/log-20200103.bin"));
+    assertMinutes(log, 0, 2 * DAY_RECORDS + 60);
+
+    appendMinutes(log, 2 * DAY_RECORDS + 60, 3 * DAY_RECORDS + 60);
+    TEST_ASSERT_TRUE(memoryFs.exists("/log-20200104.bin"));
+    assertMinutes(log, 0, 3 * DAY_RECORDS + 60);
+
+    // the older records go with the segment they were moved into
+    TEST_ASSERT_TRUE(log.dropBefore(START + 3 * DAY));
+    assertMinutes(log, 3 * DAY_RECORDS, 3 * DAY_RECORDS + 60);
+}
+
+void test_a_move_interrupted_after_the_index_is_finished(void)
+{
+    {
+        DataLog old(memoryFs, "/old.bin", "/old.idx", DATA_LOG_INDEX_PERIOD, 0xffffffff);
+        TEST_ASSERT_TRUE(old.begin());
+        appendMinutes(old, 0, DAY_RECORDS);
+    }
+    TEST_ASSERT_TRUE(memoryFs.rename("/old-19700101.bin", "/log.bin"));
+    TEST_ASSERT_TRUE(memoryFs.rename("/old-19700101.idx", "/log-20200101.idx"));
+    TEST_ASSERT_TRUE(memoryFs.remove("/old.seg"));
+    // the list already names the segment of the last day
+    uint32_t segment = START / DAY;
+    File list = memoryFs.open("/log.seg", FILE_WRITE);
+    list.write((const uint8_t *)&segment, sizeof(segment));
+    list.close();
+
+    DataLog log(memoryFs, "/log.bin", "/log.idx");
+    TEST_ASSERT_TRUE(log.begin());
+    TEST_ASSERT_FALSE(memoryFs.exists("/log.bin"));
+    assertMinutes(log, 0, DAY_RECORDS);
+}
+
+void test_an_interrupted_list_replacement_is_completed(void)
+{
+    {
+        DataLog log(memoryFs, "/log.bin", "/log.idx");
+        TEST_ASSERT_TRUE(log.begin());
+        appendMinutes(log, 0, 3 * DAY_RECORDS);
+    }
+    std::string list = contents("/log.seg");
+
+    // the first segment removed and the rest written, but the old list still there
+    TEST_ASSERT_TRUE(memoryFs.remove("/log-20200101.bin"));
+    TEST_ASSERT_TRUE(memoryFs.remove("/log-20200101.idx"));
+    File rest = memoryFs.open("/log.seg.new", FILE_WRITE);
+    rest.write((const uint8_t *)list.data() + sizeof(uint32_t), list.size() - sizeof(uint32_t));
+    rest.close();
+    {
+        DataLog log(memoryFs, "/log.bin", "/log.idx");
+        TEST_ASSERT_TRUE(log.begin());
+        TEST_ASSERT_FALSE(memoryFs.exists("/log.seg.new"));
+        TEST_ASSERT_TRUE(list == contents("/log.seg"));
+        // the segment whose files are gone is skipped and dropped again
+        assertMinutes(log, DAY_RECORDS, 3 * DAY_RECORDS);
+        TEST_ASSERT_TRUE(log.dropBefore(START + DAY));
+        TEST_ASSERT_EQUAL_UINT32(2 * sizeof(uint32_t), contents("/log.seg").size());
+    }
+
+    // the old list removed, the new one not renamed yet
+    list = contents("/log.seg");
+    TEST_ASSERT_TRUE(memoryFs.rename("/log.seg", "/log.seg.new"));
+    DataLog log(memoryFs, "/log.bin", "/log.idx");
+    TEST_ASSERT_TRUE(log.begin());
+    TEST_ASSERT_FALSE(memoryFs.exists("/log.seg.new"));
+    TEST_ASSERT_TRUE(list == contents("/log.seg"));
+    assertMinutes(log, DAY_RECORDS, 3 * DAY_RECORDS);
+}
+
+void test_compaction_removes_the_rolled_up_segments(void)
+{
+    DataLog raw(memoryFs, "/log.bin", "/log.idx");
+    DataLog minutes(memoryFs, "/log-min.bin", "/log-min.idx", DATA_LOG_INDEX_PERIOD, DATA_RETENTION_MINUTE_SEGMENT);
+    DataLog hours(memoryFs, "/log-hour.bin", "/log-hour.idx", DATA_RETENTION_HOUR_BLOCK, DATA_RETENTION_HOUR_SEGMENT);
+    DataRetention retention(raw, minutes, hours);
+    struct dataRecord record;
+
+    TEST_ASSERT_TRUE(raw.begin());
+    TEST_ASSERT_TRUE(retention.begin());
+    TEST_ASSERT_TRUE(retention.configure(1, 365, 3650));
+    appendMinutes(raw, 0, 3 * DAY_RECORDS);
+    std::string today = contents("/log-20200103.bin");
+
+    // a day after the middle of the second day, only the first day ended before it
+    TEST_ASSERT_TRUE(retention.compact(START + 2 * DAY + DAY / 2));
+    TEST_ASSERT_FALSE(memoryFs.exists("/log-20200101.bin"));
+    TEST_ASSERT_TRUE(memoryFs.exists("/log-20200102.bin"));
+    TEST_ASSERT_TRUE(today == contents("/log-20200103.bin"));
+    assertMinutes(raw, DAY_RECORDS, 3 * DAY_RECORDS);
+    // the minute log starts with the first day, in its own segment
+    TEST_ASSERT_TRUE(memoryFs.exists("/log-min-20191210.bin"));
+    assertMinutes(minutes, 0, DAY_RECORDS);
+
+    // another hour later there is nothing to roll up or remove
+    std::string minuteData = contents("/log-min-20191210.bin");
+    TEST_ASSERT_TRUE(retention.compact(START + 2 * DAY + DAY / 2 + 3600));
+    TEST_ASSERT_TRUE(minuteData == contents("/log-min-20191210.bin"));
+    assertMinutes(raw, DAY_RECORDS, 3 * DAY_RECORDS);
+
+    // all three logs read one after the other
+    DataLogQuery query(retention.logs(), DATA_RETENTION_LOGS, 0, 0xffffffff);
+    uint32_t minute = 0;
+    while (query.next(&record))
+    {
+        TEST_ASSERT_EQUAL_UINT32(makeRecord(minute++).time, record.time);
+    }
+    TEST_ASSERT_EQUAL_UINT32(3 * DAY_RECORDS, minute);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_each_day_has_a_segment);
+    RUN_TEST(test_a_restart_continues_the_last_segment);
+    RUN_TEST(test_a_partly_listed_segment_is_left_out);
+    RUN_TEST(test_a_drop_removes_whole_segments);
+    RUN_TEST(test_dropping_everything_starts_over);
+    RUN_TEST(test_a_drop_waits_for_queries);
+    RUN_TEST(test_a_log_of_older_firmware_becomes_the_last_segment);
+    RUN_TEST(test_a_move_interrupted_after_the_index_is_finished);
+    RUN_TEST(test_an_interrupted_list_replacement_is_completed);
+    RUN_TEST(test_compaction_removes_the_rolled_up_segments);
+    return UNITY_END();
+}
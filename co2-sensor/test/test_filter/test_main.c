@@ -0,0 +1,258 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <unity.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "filter.h"
+#include "sensorhub-mib.h"
+#include "traces.h"
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+#define TRACE_LEN ARRAY_SIZE(trace_meeting_room)
+/* the empty room before the meeting */
+#define TRACE_FLAT_LEN 120
+/* single sample spikes as a loose connector produces them */
+#define SPIKE_PPM 400
+#define SPIKE_EVERY 37
+#define STEP_FROM 500
+#define STEP_TO 1000
+#define STEP_LEN 40
+
+struct replay {
+    const char *name;
+    struct filter_config config;
+    /* RMS of the sample to sample change in the empty room, ppm */
+    float noise;
+    /* largest change of the output caused by the spikes, ppm */
+    int32_t spike;
+    /* until 90 % of a step are reached, ms */
+    uint32_t latency_ms;
+};
+
+static struct replay replays[] = {
+    { "raw", { 1, FILTER_SMOOTHING_NONE, 0.5f, 1.0f, 1.0f, 0 }, 0, 0, 0 },
+    { "median 3", { 3, FILTER_SMOOTHING_NONE, 0.5f, 1.0f, 1.0f, 0 }, 0, 0, 0 },
+    { "median 5", { 5, FILTER_SMOOTHING_NONE, 0.5f, 1.0f, 1.0f, 0 }, 0, 0, 0 },
+    { "ema 0.3", { 1, FILTER_SMOOTHING_EMA, 0.3f, 1.0f, 1.0f, 0 }, 0, 0, 0 },
+    { "kalman", { 1, FILTER_SMOOTHING_KALMAN, 0.5f, 16.0f, 144.0f, 0 }, 0, 0, 0 },
+    { "median 3 + kalman", { 3, FILTER_SMOOTHING_KALMAN, 0.5f, 16.0f, 144.0f, 0 }, 0, 0, 0 },
+};
+
+static int32_t clean[TRACE_LEN];
+static int32_t spiked[TRACE_LEN];
+static bool measured;
+
+/* replays the samples with the sensor period, the filter state starts empty */
+static void replay(const struct filter_config *config, const int32_t *samples, uint16_t len, int32_t *out)
+{
+    TEST_ASSERT_TRUE(filter_configure(CO2_PPM_MEASUREMENT, config));
+    for (uint16_t i = 0; i < len; i++) {
+        out[i] = filter_process(CO2_PPM_MEASUREMENT, samples[i], i * TRACE_CO2_PERIOD_MS);
+    }
+}
+
+static void measure(struct replay *r)
+{
+    static int32_t out[TRACE_LEN];
+    static int32_t out_spiked[TRACE_LEN];
+    int32_t step[STEP_LEN];
+    int32_t step_out[STEP_LEN];
+    double sum = 0;
+    uint16_t i;
+
+    replay(&r->config, clean, TRACE_LEN, out);
+    for (i = 1; i < TRACE_FLAT_LEN; i++) {
+        sum += (double)(out[i] - out[i - 1]) * (out[i] - out[i - 1]);
+    }
+    r->noise = sqrt(sum / (TRACE_FLAT_LEN - 1));
+
+    replay(&r->config, spiked, TRACE_LEN, out_spiked);
+    r->spike = 0;
+    for (i = 0; i < TRACE_LEN; i++) {
+        int32_t change = abs(out_spiked[i] - out[i]);
+
+        r->spike = change > r->spike ? change : r->spike;
+    }
+
+    for (i = 0; i < STEP_LEN; i++) {
+        step[i] = i < STEP_LEN / 4 ? STEP_FROM : STEP_TO;
+    }
+    replay(&r->config, step, STEP_LEN, step_out);
+    for (i = STEP_LEN / 4; i < STEP_LEN && step_out[i] < STEP_FROM + (STEP_TO - STEP_FROM) * 9 / 10; i++) {
+    }
+    r->latency_ms = (i - STEP_LEN / 4) * TRACE_CO2_PERIOD_MS;
+}
+
+/* replays the trace through every configuration once, the filter is reset afterwards */
+static void measure_all(void)
+{
+    if (measured) {
+        return;
+    }
+
+    for (uint16_t i = 0; i < TRACE_LEN; i++) {
+        clean[i] = trace_meeting_room[i];
+        spiked[i] = clean[i] + (i % SPIKE_EVERY == SPIKE_EVERY - 1 ? SPIKE_PPM : 0);
+    }
+    for (uint8_t i = 0; i < ARRAY_SIZE(replays); i++) {
+        measure(&replays[i]);
+    }
+    filter_reset();
+    measured = true;
+}
+
+static struct replay *find(const char *name)
+{
+    measure_all();
+    for (uint8_t i = 0; i < ARRAY_SIZE(replays); i++) {
+        if (strcmp(replays[i].name, name) == 0) {
+            return &replays[i];
+        }
+    }
+    TEST_FAIL_MESSAGE(name);
+    return NULL;
+}
+
+void setUp(void)
+{
+    filter_reset();
+}
+
+void tearDown(void)
+{
+}
+
+/* prints the comparison of the configurations */
+static void test_replay_the_meeting_room(void)
+{
+    char line[128];
+
+    measure_all();
+    for (uint8_t i = 0; i < ARRAY_SIZE(replays); i++) {
+        snprintf(line, sizeof(line), "%-20s noise %5.1f ppm  spike %4d ppm  latency %5u ms",
+            replays[i].name, replays[i].noise, (int)replays[i].spike, (unsigned)replays[i].latency_ms);
+        TEST_MESSAGE(line);
+    }
+}
+
+static void test_median_removes_single_spikes(void)
+{
+    TEST_ASSERT_EQUAL_INT32(SPIKE_PPM, find("raw")->spike);
+    TEST_ASSERT_LESS_THAN(SPIKE_PPM / 8, find("median 3")->spike);
+    TEST_ASSERT_LESS_THAN(SPIKE_PPM / 8, find("median 5")->spike);
+    TEST_ASSERT_LESS_THAN(SPIKE_PPM / 8, find("median 3 + kalman")->spike);
+
+    /* smoothing alone only spreads a spike */
+    TEST_ASSERT_GREATER_THAN(SPIKE_PPM / 8, find("ema 0.3")->spike);
+    TEST_ASSERT_GREATER_THAN(SPIKE_PPM / 8, find("kalman")->spike);
+}
+
+static void test_smoothing_lowers_the_noise(void)
+{
+    float raw = find("raw")->noise;
+
+    TEST_ASSERT_TRUE(find("median 3")->noise < raw);
+    TEST_ASSERT_TRUE(find("ema 0.3")->noise < raw / 2);
+    TEST_ASSERT_TRUE(find("kalman")->noise < raw / 2);
+    TEST_ASSERT_TRUE(find("median 3 + kalman")->noise < find("kalman")->noise);
+}
+
+static void test_latency_grows_with_the_window(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(0, find("raw")->latency_ms);
+    TEST_ASSERT_EQUAL_UINT32(1 * TRACE_CO2_PERIOD_MS, find("median 3")->latency_ms);
+    TEST_ASSERT_EQUAL_UINT32(2 * TRACE_CO2_PERIOD_MS, find("median 5")->latency_ms);
+    /* 1 - 0.7^7 >= 0.9 with the seventh sample after the step */
+    TEST_ASSERT_EQUAL_UINT32(6 * TRACE_CO2_PERIOD_MS, find("ema 0.3")->latency_ms);
+    TEST_ASSERT_TRUE(find("median 3 + kalman")->latency_ms > find("kalman")->latency_ms);
+}
+
+static void test_rate_limit_bounds_the_change(void)
+{
+    const struct filter_config config = { 1, FILTER_SMOOTHING_NONE, 0.5f, 1.0f, 1.0f, 20 };
+    int32_t step[STEP_LEN];
+    int32_t out[STEP_LEN];
+
+    for (uint16_t i = 0; i < STEP_LEN; i++) {
+        step[i] = i == 0 ? STEP_FROM : STEP_TO;
+    }
+    replay(&config, step, STEP_LEN, out);
+
+    /* 20 ppm/s over 5 s per sample */
+    for (uint16_t i = 1; i < STEP_LEN; i++) {
+        TEST_ASSERT_LESS_OR_EQUAL(100, out[i] - out[i - 1]);
+    }
+    TEST_ASSERT_EQUAL_INT32(STEP_FROM + 100, out[1]);
+    TEST_ASSERT_EQUAL_INT32(STEP_TO, out[5]);
+}
+
+static void test_raw_values_stay_available(void)
+{
+    int32_t raw;
+
+    TEST_ASSERT_FALSE(filter_raw(CO2_PPM_MEASUREMENT, &raw));
+    filter_process(CO2_PPM_MEASUREMENT, 500, 0);
+    filter_process(CO2_PPM_MEASUREMENT, 510, 5000);
+    TEST_ASSERT_EQUAL_INT32(510, filter_process(CO2_PPM_MEASUREMENT, 900, 10000));
+    TEST_ASSERT_TRUE(filter_raw(CO2_PPM_MEASUREMENT, &raw));
+    TEST_ASSERT_EQUAL_INT32(900, raw);
+    TEST_ASSERT_FALSE(filter_raw(TEMPERATURE_MEASUREMENT, &raw));
+}
+
+static void test_configurations_are_validated(void)
+{
+    struct filter_config config = { 3, FILTER_SMOOTHING_EMA, 0.5f, 1.0f, 1.0f, 0 };
+
+    TEST_ASSERT_TRUE(filter_configure(HUMIDITY_MEASUREMENT, &config));
+    TEST_ASSERT_FALSE(filter_configure(0, &config));
+    TEST_ASSERT_FALSE(filter_configure(FILTER_METRICS + 1, &config));
+
+    config.median = FILTER_MEDIAN_MAX + 1;
+    TEST_ASSERT_FALSE(filter_configure(CO2_PPM_MEASUREMENT, &config));
+    config.median = 3;
+    config.alpha = 0;
+    TEST_ASSERT_FALSE(filter_configure(CO2_PPM_MEASUREMENT, &config));
+    config.alpha = NAN;
+    TEST_ASSERT_FALSE(filter_configure(CO2_PPM_MEASUREMENT, &config));
+    config.alpha = 0.5f;
+    config.max_rate = -1;
+    TEST_ASSERT_FALSE(filter_configure(CO2_PPM_MEASUREMENT, &config));
+
+    TEST_ASSERT_EQUAL_UINT8(FILTER_SMOOTHING_EMA, filter_get_config(HUMIDITY_MEASUREMENT)->smoothing);
+    TEST_ASSERT_EQUAL_UINT8(3, filter_get_config(CO2_PPM_MEASUREMENT)->median);
+    TEST_ASSERT_NULL(filter_get_config(0));
+    TEST_ASSERT_EQUAL_INT(FILTER_SMOOTHING_KALMAN, filter_smoothing_from_name(filter_smoothing_name(FILTER_SMOOTHING_KALMAN)));
+    TEST_ASSERT_EQUAL_INT(-1, filter_smoothing_from_name("lowpass"));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_replay_the_meeting_room);
+    RUN_TEST(test_median_removes_single_spikes);
+    RUN_TEST(test_smoothing_lowers_the_noise);
+    RUN_TEST(test_latency_grows_with_the_window);
+    RUN_TEST(test_rate_limit_bounds_the_change);
+    RUN_TEST(test_raw_values_stay_available);
+    RUN_TEST(test_configurations_are_validated);
+    return UNITY_END();
+}
@@ -0,0 +1,345 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <unity.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "glyph-atlas.h"
+#include "traces.h"
+
+/* as in main.h */
+#define CO2_GLYPHS "0123456789pm"
+#define HEADER_GLYPHS " 0123456789:%+-ADFJMNOSTWabcdeghilnoprtuvy"
+
+#define FONT_FIRST 0x20
+#define FONT_LAST 0x7e
+#define FONT_GLYPHS (FONT_LAST - FONT_FIRST + 1)
+#define FONT_GLYPH_BYTES 64
+#define CLOCK_START 1700000000
+#define CLOCK_SECONDS 3600
+/* the SPI clock of the display of the Core2 */
+#define SPI_HZ 40000000.0
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+struct metrics
+{
+    uint8_t width;
+    uint8_t height;
+    uint8_t xAdvance;
+    int8_t xOffset;
+    int8_t yOffset;
+    uint8_t yAdvance;
+    uint8_t stroke;
+};
+
+struct cost
+{
+    uint32_t updates;
+    uint64_t ns;
+    uint32_t windows;
+    uint64_t bytes;
+};
+
+/*
+ * The Adafruit fonts are part of TFT_eSPI and not in this tree. These have the
+ * metrics of FreeMonoBold18pt7b and FreeMono9pt7b, every glyph is an outline
+ * in the stroke of the font with a diagonal that differs per character.
+ */
+static const struct metrics boldMetrics = { 17, 25, 21, 2, -24, 35, 4 };
+static const struct metrics monoMetrics = { 9, 13, 11, 1, -12, 18, 1 };
+
+static GFXglyph boldGlyphs[FONT_GLYPHS];
+static GFXglyph monoGlyphs[FONT_GLYPHS];
+static uint8_t boldBitmap[FONT_GLYPHS * FONT_GLYPH_BYTES];
+static uint8_t monoBitmap[FONT_GLYPHS * FONT_GLYPH_BYTES];
+static GFXfont boldFont = { boldBitmap, boldGlyphs, FONT_FIRST, FONT_LAST, 35 };
+static GFXfont monoFont = { monoBitmap, monoGlyphs, FONT_FIRST, FONT_LAST, 18 };
+
+static const uint16_t co2Colors[] = { CYAN, GREEN, YELLOW, ORANGE, RED };
+static const uint16_t headerColors[] = { WHITE };
+
+static void makeFont(GFXfont *font, const struct metrics *m)
+{
+    for (uint16_t c = FONT_FIRST; c <= FONT_LAST; c++)
+    {
+        GFXglyph *glyph = &font->glyph[c - FONT_FIRST];
+        uint8_t *bitmap = &font->bitmap[(c - FONT_FIRST) * FONT_GLYPH_BYTES];
+
+        glyph->bitmapOffset = (c - FONT_FIRST) * FONT_GLYPH_BYTES;
+        glyph->width = c == ' ' ? 0 : m->width;
+        glyph->height = c == ' ' ? 0 : m->height;
+        glyph->xAdvance = m->xAdvance;
+        glyph->xOffset = m->xOffset;
+        glyph->yOffset = m->yOffset;
+        for (uint16_t bit = 0; bit < glyph->width * glyph->height; bit++)
+        {
+            int16_t x = bit % glyph->width, y = bit / glyph->width;
+            int16_t diagonal = (y * glyph->width / glyph->height + c) % glyph->width;
+            bool edge = x < m->stroke || x >= glyph->width - m->stroke || y < m->stroke || y >= glyph->height - m->stroke;
+
+            if (edge || abs(x - diagonal) < m->stroke)
+            {
+                bitmap[bit / 8] |= 0x80 >> (bit % 8);
+            }
+        }
+    }
+}
+
+static uint16_t co2color(int32_t value)
+{
+    return value < 600 ? CYAN : value < 800 ? GREEN : value < 1000 ? YELLOW : value < 1400 ? ORANGE : RED;
+}
+
+static uint64_t nowNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* the readout before the atlas: the text is rasterized into a sprite which is sent whole */
+static void drawValueSprite(TFT_eSprite &sprite, int32_t ppm)
+{
+    char text[16];
+
+    snprintf(text, sizeof(text), "%dppm", (int)ppm);
+    sprite.fillRect(0, 0, 320, 116, BLACK);
+    sprite.setFreeFont(&boldFont);
+    sprite.setTextColor(co2color(ppm));
+    sprite.setTextSize(2);
+    sprite.drawString(text, 160, 10);
+    sprite.pushSprite(0, 26);
+}
+
+static void drawValueField(GlyphField &field, TFT_eSPI &display, int32_t ppm)
+{
+    char text[16];
+
+    snprintf(text, sizeof(text), "%dppm", (int)ppm);
+    field.draw(display, text, co2color(ppm));
+}
+
+static void clockText(uint32_t second, char *clock, size_t len)
+{
+    time_t now = CLOCK_START + second;
+    struct tm tm;
+
+    gmtime_r(&now, &tm);
+    strftime(clock, len, "%c", &tm);
+}
+
+static void drawHeaderSprite(TFT_eSprite &sprite, uint32_t second, const char *battery)
+{
+    char clock[64];
+
+    clockText(second, clock, sizeof(clock));
+    sprite.fillRect(0, 0, 320, 24, BLACK);
+    sprite.drawString(clock, 0, 1);
+    sprite.setTextDatum(TR_DATUM);
+    sprite.drawString(battery, 320, 1);
+    sprite.setTextDatum(TL_DATUM);
+    sprite.drawLine(0, 25, 320, 25, WHITE);
+    sprite.pushSprite(0, 0);
+}
+
+static void drawHeaderFields(GlyphField &clockField, GlyphField &batteryField, TFT_eSPI &display, uint32_t second,
+                             const char *battery)
+{
+    char clock[64];
+
+    clockText(second, clock, sizeof(clock));
+    clockField.draw(display, clock, WHITE);
+    batteryField.draw(display, battery, WHITE);
+}
+
+static void assertSameRows(const TFT_eSPI &expected, const TFT_eSPI &actual, int16_t top, int16_t bottom)
+{
+    for (int16_t y = top; y < bottom; y++)
+    {
+        for (int16_t x = 0; x < 320; x++)
+        {
+            if (expected.readPixel(x, y) != actual.readPixel(x, y))
+            {
+                char message[64];
+
+                snprintf(message, sizeof(message), "pixel %d,%d differs", x, y);
+                TEST_FAIL_MESSAGE(message);
+            }
+        }
+    }
+}
+
+static void printCost(const char *name, const struct cost *cost)
+{
+    char line[160];
+
+    snprintf(line, sizeof(line), "%-24s %7.1f us/update  %5.1f windows  %7.0f bytes  %5.2f ms SPI at 40 MHz", name,
+             cost->ns / 1e3 / cost->updates, (double)cost->windows / cost->updates, (double)cost->bytes / cost->updates,
+             cost->bytes * 8 / SPI_HZ * 1e3 / cost->updates);
+    TEST_MESSAGE(line);
+}
+
+static GlyphAtlas co2Glyphs(&boldFont, 2, CO2_GLYPHS);
+static GlyphAtlas headerGlyphs(&monoFont, 1, HEADER_GLYPHS);
+
+void setUp(void)
+{
+    if (!co2Glyphs.ready())
+    {
+        makeFont(&boldFont, &boldMetrics);
+        makeFont(&monoFont, &monoMetrics);
+        TEST_ASSERT_TRUE(co2Glyphs.begin(co2Colors, ARRAY_SIZE(co2Colors)));
+        TEST_ASSERT_TRUE(headerGlyphs.begin(headerColors, ARRAY_SIZE(headerColors)));
+    }
+}
+
+void tearDown(void)
+{
+}
+
+static void test_tiles_match_the_rasterized_text(void)
+{
+    static const int32_t values[] = { 412, 419, 1419, 998, 998, 2011, 55 };
+    static const char *batteries[] = { "100%+", "99%-", "9%-", "9%-" };
+    TFT_eSPI spritePanel, tilePanel;
+    TFT_eSprite value(&spritePanel), header(&spritePanel);
+    GlyphField co2Field(co2Glyphs, 160, 36, TC_DATUM);
+    GlyphField clockField(headerGlyphs, 0, 1, TL_DATUM);
+    GlyphField batteryField(headerGlyphs, 320, 1, TR_DATUM);
+
+    value.createSprite(320, 117);
+    value.setTextDatum(TC_DATUM);
+    header.createSprite(320, 26);
+    header.setFreeFont(&monoFont);
+    header.setTextColor(WHITE);
+    tilePanel.fillRect(0, 0, 320, 25, BLACK);
+    tilePanel.drawLine(0, 25, 320, 25, WHITE);
+
+    for (uint8_t i = 0; i < ARRAY_SIZE(values); i++)
+    {
+        drawValueSprite(value, values[i]);
+        drawValueField(co2Field, tilePanel, values[i]);
+        assertSameRows(spritePanel, tilePanel, 26, 26 + 117);
+    }
+
+    for (uint32_t second = 0; second < 130; second += 7)
+    {
+        const char *battery = batteries[second / 40];
+
+        drawHeaderSprite(header, second, battery);
+        drawHeaderFields(clockField, batteryField, tilePanel, second, battery);
+        assertSameRows(spritePanel, tilePanel, 0, 26);
+    }
+}
+
+/* every change of the meeting room trace, as drawValues() sees it */
+static void test_co2_readout_cost(void)
+{
+    TFT_eSPI spritePanel, tilePanel;
+    TFT_eSprite value(&spritePanel);
+    GlyphField co2Field(co2Glyphs, 160, 36, TC_DATUM);
+    struct cost sprite = { 0, 0, 0, 0 }, tiles = { 0, 0, 0, 0 };
+    uint64_t start;
+
+    value.createSprite(320, 117);
+    value.setTextDatum(TC_DATUM);
+    drawValueField(co2Field, tilePanel, trace_meeting_room[0]);
+    tilePanel.resetSent();
+
+    start = nowNs();
+    for (uint16_t i = 1; i < ARRAY_SIZE(trace_meeting_room); i++)
+    {
+        if (trace_meeting_room[i] != trace_meeting_room[i - 1])
+        {
+            drawValueSprite(value, trace_meeting_room[i]);
+            sprite.updates++;
+        }
+    }
+    sprite.ns = nowNs() - start;
+    sprite.windows = spritePanel.windowsSent();
+    sprite.bytes = spritePanel.bytesSent();
+
+    start = nowNs();
+    for (uint16_t i = 1; i < ARRAY_SIZE(trace_meeting_room); i++)
+    {
+        if (trace_meeting_room[i] != trace_meeting_room[i - 1])
+        {
+            drawValueField(co2Field, tilePanel, trace_meeting_room[i]);
+            tiles.updates++;
+        }
+    }
+    tiles.ns = nowNs() - start;
+    tiles.windows = tilePanel.windowsSent();
+    tiles.bytes = tilePanel.bytesSent();
+
+    printCost("co2 readout, sprite", &sprite);
+    printCost("co2 readout, tiles", &tiles);
+    TEST_ASSERT_LESS_THAN(sprite.bytes / 3, tiles.bytes);
+}
+
+/* an hour of the header clock, redrawn every second */
+static void test_header_clock_cost(void)
+{
+    TFT_eSPI spritePanel, tilePanel;
+    TFT_eSprite header(&spritePanel);
+    GlyphField clockField(headerGlyphs, 0, 1, TL_DATUM);
+    GlyphField batteryField(headerGlyphs, 320, 1, TR_DATUM);
+    struct cost sprite = { CLOCK_SECONDS, 0, 0, 0 }, tiles = { CLOCK_SECONDS, 0, 0, 0 };
+    uint64_t start;
+
+    header.createSprite(320, 26);
+    header.setFreeFont(&monoFont);
+    header.setTextColor(WHITE);
+    drawHeaderFields(clockField, batteryField, tilePanel, 0, "87%-");
+    tilePanel.resetSent();
+
+    start = nowNs();
+    for (uint32_t second = 1; second <= CLOCK_SECONDS; second++)
+    {
+        drawHeaderSprite(header, second, "87%-");
+    }
+    sprite.ns = nowNs() - start;
+    sprite.windows = spritePanel.windowsSent();
+    sprite.bytes = spritePanel.bytesSent();
+
+    start = nowNs();
+    for (uint32_t second = 1; second <= CLOCK_SECONDS; second++)
+    {
+        drawHeaderFields(clockField, batteryField, tilePanel, second, "87%-");
+    }
+    tiles.ns = nowNs() - start;
+    tiles.windows = tilePanel.windowsSent();
+    tiles.bytes = tilePanel.bytesSent();
+
+    printCost("header clock, sprite", &sprite);
+    printCost("header clock, tiles", &tiles);
+    TEST_ASSERT_LESS_THAN(sprite.bytes / 3, tiles.bytes);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_tiles_match_the_rasterized_text);
+    RUN_TEST(test_co2_readout_cost);
+    RUN_TEST(test_header_clock_cost);
+    return UNITY_END();
+}
@@ -0,0 +1,271 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <unity.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "gorilla.h"
+#include "history.h"
+#include "sensorhub-mib.h"
+#include "traces.h"
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+/* a year of the minute means the log restores, then a day as the sensors sample it */
+#define HISTORY_START 1700000000
+#define HISTORY_YEAR (366 * 86400)
+#define HISTORY_SAMPLE_S 5
+/* the heap maps 4 MB of the 8 MB PSRAM of the Core2 */
+#define PSRAM_HEAP (4 * 1024 * 1024)
+/* buckets per block of a compressed ring, a block is decoded from its start */
+#define BLOCK_BUCKETS 64
+#define BLOCK_MAX (BLOCK_BUCKETS * GORILLA_RECORD_MAX)
+#define BUCKET_FIELDS 4
+/* the minute rings are the longest */
+#define PACKED_BLOCKS ((HISTORY_MINUTE_BUCKETS + BLOCK_BUCKETS - 1) / BLOCK_BUCKETS)
+#define LOOKUPS 100000
+
+/* a ring as it would be kept compressed: blocks of buckets and the start and offset of every block */
+struct packed_series {
+    uint8_t data[PACKED_BLOCKS * BLOCK_MAX];
+    uint32_t starts[PACKED_BLOCKS];
+    uint32_t offsets[PACKED_BLOCKS + 1];
+    uint16_t blocks;
+    uint16_t len;
+};
+
+static bool filled;
+static struct packed_series packed[HISTORY_MEASUREMENTS][HISTORY_RESOLUTIONS];
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void add_samples(uint32_t time, uint32_t i)
+{
+    uint32_t minute_of_day = time % 86400 / 60;
+
+    history_add_sample(CO2_PPM_MEASUREMENT, time, trace_meeting_room[i % ARRAY_SIZE(trace_meeting_room)]);
+    history_add_sample(TEMPERATURE_MEASUREMENT, time, 200 + (int32_t)(minute_of_day < 720 ? minute_of_day : 1440 - minute_of_day) / 24);
+    history_add_sample(HUMIDITY_MEASUREMENT, time, 450 + (int32_t)(i / 17 % 40));
+    history_add_sample(BATTERY_VOLTAGE_MEASUREMENT, time, 4150 - (int32_t)(minute_of_day / 3));
+    history_add_sample(BATTERY_CURRENT_MEASUREMENT, time, -120 + (int32_t)(i % 7));
+}
+
+static void bucket_values(const struct history_bucket *bucket, int32_t *values)
+{
+    values[0] = bucket->min;
+    values[1] = bucket->max;
+    values[2] = bucket->mean;
+    values[3] = bucket->samples;
+}
+
+static void pack(const struct history_series *series, struct packed_series *out)
+{
+    struct gorilla_state encoder;
+    int32_t values[BUCKET_FIELDS];
+    uint32_t len = 0;
+
+    out->blocks = 0;
+    out->len = series->len;
+    for (uint16_t i = 0; i < series->len; i++) {
+        const struct history_bucket *bucket = history_series_at(series, i);
+
+        if (i % BLOCK_BUCKETS == 0) {
+            gorilla_encoder_init(&encoder, BUCKET_FIELDS);
+            out->starts[out->blocks] = bucket->start;
+            out->offsets[out->blocks++] = len;
+        }
+        bucket_values(bucket, values);
+        len += gorilla_encode(&encoder, bucket->start, values, out->data + len);
+    }
+    out->offsets[out->blocks] = len;
+}
+
+static size_t packed_size(const struct packed_series *series)
+{
+    return series->offsets[series->blocks] + series->blocks * (sizeof(series->starts[0]) + sizeof(series->offsets[0]));
+}
+
+/* the bucket starting at start: the block found by its start, then decoded up to the bucket */
+static bool packed_find(const struct packed_series *series, uint32_t start, struct history_bucket *copy)
+{
+    struct gorilla_decoder decoder;
+    int32_t values[BUCKET_FIELDS];
+    uint32_t time;
+    uint16_t low = 0;
+    uint16_t high = series->blocks;
+
+    while (low < high) {
+        uint16_t mid = low + (high - low) / 2;
+
+        if (series->starts[mid] <= start) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    if (low == 0) {
+        return false;
+    }
+
+    gorilla_decoder_init(&decoder, BUCKET_FIELDS, series->data + series->offsets[low - 1],
+                         series->offsets[low] - series->offsets[low - 1]);
+    while (gorilla_decode(&decoder, &time, values)) {
+        if (time == start) {
+            copy->start = time;
+            copy->min = (int16_t)values[0];
+            copy->max = (int16_t)values[1];
+            copy->mean = (int16_t)values[2];
+            copy->samples = (uint16_t)values[3];
+            return true;
+        }
+    }
+    return false;
+}
+
+void setUp(void)
+{
+    uint32_t i = 0;
+    uint32_t time;
+
+    if (filled) {
+        return;
+    }
+    TEST_ASSERT_TRUE(history_init());
+    for (time = HISTORY_START; time < HISTORY_START + HISTORY_YEAR - 86400; time += 60) {
+        add_samples(time, i++);
+    }
+    for (; time < HISTORY_START + HISTORY_YEAR; time += HISTORY_SAMPLE_S) {
+        add_samples(time, i++);
+    }
+
+    for (uint8_t type = 1; type <= HISTORY_MEASUREMENTS; type++) {
+        for (uint8_t resolution = 1; resolution <= HISTORY_RESOLUTIONS; resolution++) {
+            pack(history_get_series(type, resolution), &packed[type - 1][resolution - 1]);
+        }
+    }
+    filled = true;
+}
+
+void tearDown(void)
+{
+}
+
+/* the compressed rings hold the same buckets */
+static void test_packed_rings_hold_the_buckets(void)
+{
+    struct history_bucket copy;
+
+    for (uint8_t type = 1; type <= HISTORY_MEASUREMENTS; type++) {
+        for (uint8_t resolution = 1; resolution <= HISTORY_RESOLUTIONS; resolution++) {
+            const struct history_series *series = history_get_series(type, resolution);
+
+            TEST_ASSERT_EQUAL_UINT16(series->capacity, series->len);
+            for (uint16_t i = 0; i < series->len; i++) {
+                const struct history_bucket *bucket = history_series_at(series, i);
+
+                TEST_ASSERT_TRUE(packed_find(&packed[type - 1][resolution - 1], bucket->start, &copy));
+                TEST_ASSERT_EQUAL_MEMORY(bucket, &copy, sizeof(copy));
+            }
+        }
+    }
+}
+
+/*
+ * What the rings take and what compressing them would save. They stay plain
+ * as long as the saving is a small part of the PSRAM: the graphs and SNMP
+ * GETNEXT then read any bucket in place.
+ */
+static void test_ring_memory(void)
+{
+    static const char *names[] = { "minute", "hour", "day" };
+    size_t plain_total = 0;
+    size_t packed_total = 0;
+    char line[160];
+
+    for (uint8_t resolution = 1; resolution <= HISTORY_RESOLUTIONS; resolution++) {
+        size_t plain = 0;
+        size_t compressed = 0;
+
+        for (uint8_t type = 1; type <= HISTORY_MEASUREMENTS; type++) {
+            plain += history_get_series(type, resolution)->capacity * sizeof(struct history_bucket);
+            compressed += packed_size(&packed[type - 1][resolution - 1]);
+        }
+        snprintf(line, sizeof(line), "%-6s rings %6.1f kB plain  %6.1f kB compressed  ratio %.1f",
+                 names[resolution - 1], plain / 1024.0, compressed / 1024.0, (double)plain / compressed);
+        TEST_MESSAGE(line);
+        plain_total += plain;
+        packed_total += compressed;
+    }
+
+    snprintf(line, sizeof(line), "all    rings %6.1f kB plain  %6.1f kB compressed, %.1f kB saved, %.2f %% of the PSRAM heap",
+             plain_total / 1024.0, packed_total / 1024.0, ((double)plain_total - packed_total) / 1024.0,
+             100.0 * ((double)plain_total - packed_total) / PSRAM_HEAP);
+    TEST_MESSAGE(line);
+
+    TEST_ASSERT_EQUAL_UINT32(HISTORY_MEASUREMENTS *
+                                 (HISTORY_MINUTE_BUCKETS + HISTORY_HOUR_BUCKETS + HISTORY_DAY_BUCKETS) *
+                                 sizeof(struct history_bucket),
+                             plain_total);
+    /* revisit the plain rings once they grow beyond this */
+    TEST_ASSERT_TRUE(plain_total < packed_total + PSRAM_HEAP / 32);
+}
+
+/* a bucket read in place against one decoded from its block, as shHistoryTable requests them */
+static void test_bucket_lookup_cost(void)
+{
+    const struct history_series *series = history_get_series(CO2_PPM_MEASUREMENT, HISTORY_RESOLUTION_MINUTE);
+    const struct packed_series *compressed = &packed[CO2_PPM_MEASUREMENT - 1][HISTORY_RESOLUTION_MINUTE - 1];
+    struct history_bucket copy;
+    uint32_t found = 0;
+    char line[120];
+
+    uint64_t start = now_ns();
+    for (uint32_t i = 0; i < LOOKUPS; i++) {
+        found += history_find(CO2_PPM_MEASUREMENT, HISTORY_RESOLUTION_MINUTE,
+                              history_series_at(series, i * 7919 % series->len)->start, &copy);
+    }
+    uint64_t plain_ns = now_ns() - start;
+
+    start = now_ns();
+    for (uint32_t i = 0; i < LOOKUPS; i++) {
+        found += packed_find(compressed, history_series_at(series, i * 7919 % series->len)->start, &copy);
+    }
+    uint64_t packed_ns = now_ns() - start;
+
+    snprintf(line, sizeof(line), "bucket lookup %.0f ns in place, %.0f ns from a compressed block",
+             (double)plain_ns / LOOKUPS, (double)packed_ns / LOOKUPS);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL_UINT32(2 * LOOKUPS, found);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_packed_rings_hold_the_buckets);
+    RUN_TEST(test_ring_memory);
+    RUN_TEST(test_bucket_lookup_cost);
+    return UNITY_END();
+}
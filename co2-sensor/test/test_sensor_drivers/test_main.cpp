@@ -0,0 +1,429 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <unity.h>
+
+#include <string.h>
+
+#include "mock-i2c-bus.h"
+#include "sensor-drivers.h"
+#include "sensorhub-mib.h"
+
+#define COMMANDS_MAX 16
+
+#define SCD30_ADDRESS 0x61
+#define SCD4X_ADDRESS 0x62
+
+#define SCD30_READ_MEASUREMENT 0x0300
+#define SCD30_FIRMWARE_VERSION 0xd100
+#define SCD4X_START_PERIODIC_MEASUREMENT 0x21b1
+#define SCD4X_STOP_PERIODIC_MEASUREMENT 0x3f86
+#define SCD4X_READ_MEASUREMENT 0xec05
+#define SCD4X_AUTO_CALIBRATION 0x2416
+#define SCD4X_FORCED_CALIBRATION 0x362f
+#define SCD4X_TEMPERATURE_OFFSET 0x241d
+#define SCD4X_ALTITUDE 0x2427
+#define SCD4X_SERIAL_NUMBER 0x3682
+#define SCD4X_STOP_DELAY_MS 500
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+struct command
+{
+    uint16_t command;
+    uint16_t argument;
+};
+
+/*
+ * A Sensirion sensor on the mock bus: answers the reads with words and their
+ * CRC-8 and records the commands it got. One of the SCD30 or the SCD4x data
+ * ready and read commands applies, the unknown ones are taken as settings.
+ */
+struct sensirion
+{
+    uint16_t dataReady;
+    uint16_t readMeasurement;
+    uint16_t words[6];
+    uint8_t wordsLen;
+    bool ready;
+    // settings are NACKed while measuring, like the SCD4x does
+    bool strict;
+    bool measuring;
+    // flips a bit of the CRC of this word, -1 for none
+    int8_t corrupt;
+    struct command commands[COMMANDS_MAX];
+    uint8_t commandsLen;
+};
+
+static uint8_t crc(const uint8_t *data, uint8_t len)
+{
+    uint8_t crc = 0xff;
+
+    for (uint8_t i = 0; i < len; i++)
+    {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++)
+        {
+            crc = crc & 0x80 ? (crc << 1) ^ 0x31 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static void answer(struct sensirion *sensor, struct i2cTransaction *transaction, const uint16_t *words, uint8_t len)
+{
+    for (uint8_t i = 0; i < len && 3 * i + 2 < transaction->rxLen; i++)
+    {
+        uint8_t *word = &transaction->rx[3 * i];
+
+        word[0] = words[i] >> 8;
+        word[1] = words[i];
+        word[2] = crc(word, 2) ^ (sensor->corrupt == i ? 0x01 : 0);
+    }
+}
+
+static bool sensirion(void *context, struct i2cTransaction *transaction)
+{
+    struct sensirion *sensor = (struct sensirion *)context;
+    struct command *command = &sensor->commands[sensor->commandsLen];
+    uint16_t status;
+
+    TEST_ASSERT_TRUE(transaction->txLen == 2 || transaction->txLen == 5);
+    TEST_ASSERT_LESS_THAN(COMMANDS_MAX, sensor->commandsLen);
+    command->command = transaction->tx[0] << 8 | transaction->tx[1];
+    command->argument = 0;
+    if (transaction->txLen == 5)
+    {
+        TEST_ASSERT_EQUAL_HEX8(crc(&transaction->tx[2], 2), transaction->tx[4]);
+        command->argument = transaction->tx[2] << 8 | transaction->tx[3];
+    }
+    sensor->commandsLen++;
+
+    switch (command->command)
+    {
+    case SCD4X_STOP_PERIODIC_MEASUREMENT:
+        sensor->measuring = false;
+        return true;
+    case SCD4X_START_PERIODIC_MEASUREMENT:
+        sensor->measuring = true;
+        return true;
+    case SCD30_FIRMWARE_VERSION:
+    case SCD4X_SERIAL_NUMBER:
+        answer(sensor, transaction, sensor->words, 3);
+        return true;
+    }
+
+    if (command->command == sensor->dataReady)
+    {
+        status = sensor->ready ? 0x0001 : 0x8000;
+        answer(sensor, transaction, &status, 1);
+        return true;
+    }
+    if (command->command == sensor->readMeasurement)
+    {
+        answer(sensor, transaction, sensor->words, sensor->wordsLen);
+        sensor->ready = false;
+        return true;
+    }
+
+    if (sensor->strict && sensor->measuring)
+    {
+        return false;
+    }
+    // the forced recalibration answers its correction
+    answer(sensor, transaction, &command->argument, 1);
+    return true;
+}
+
+static struct sensirion scd30;
+static struct sensirion scd4x;
+
+static void float_words(float value, uint16_t *words)
+{
+    uint32_t bits;
+
+    memcpy(&bits, &value, sizeof(bits));
+    words[0] = bits >> 16;
+    words[1] = bits;
+}
+
+static int32_t find(const struct sensorReadings *readings, uint8_t type)
+{
+    for (uint8_t i = 0; i < readings->len; i++)
+    {
+        if (readings->reading[i].type == type)
+        {
+            return readings->reading[i].value;
+        }
+    }
+    TEST_FAIL_MESSAGE("missing reading");
+    return 0;
+}
+
+/* steps the driver once and lets the bus complete what it submitted */
+static uint32_t step(MockI2cBus &bus, SensorDriver &driver, struct sensorReadings *readings)
+{
+    uint32_t nextMs;
+
+    memset(readings, 0, sizeof(*readings));
+    nextMs = driver.step(readings);
+    bus.run();
+    return nextMs;
+}
+
+void setUp(void)
+{
+    memset(&scd30, 0, sizeof(scd30));
+    scd30.dataReady = 0x0202;
+    scd30.readMeasurement = SCD30_READ_MEASUREMENT;
+    scd30.corrupt = -1;
+
+    memset(&scd4x, 0, sizeof(scd4x));
+    scd4x.dataReady = 0xe4b8;
+    scd4x.readMeasurement = SCD4X_READ_MEASUREMENT;
+    scd4x.strict = true;
+    scd4x.measuring = true;
+    scd4x.corrupt = -1;
+}
+
+void tearDown(void)
+{
+}
+
+static void test_scd30_polls_data_ready_then_reads(void)
+{
+    MockI2cBus bus;
+    Scd30Driver driver(bus);
+    struct sensorReadings readings;
+    int64_t polledUs;
+
+    TEST_ASSERT_TRUE(bus.attach(SCD30_ADDRESS, sensirion, &scd30));
+    TEST_ASSERT_TRUE(driver.begin());
+    bus.run();
+
+    // nothing ready: poll again a frame later
+    TEST_ASSERT_EQUAL_UINT32(SENSOR_TRANSACTION_TIMEOUT_MS, step(bus, driver, &readings));
+    TEST_ASSERT_TRUE(driver.pending());
+    TEST_ASSERT_EQUAL_UINT32(SENSOR_READY_POLL_MS, step(bus, driver, &readings));
+    TEST_ASSERT_FALSE(driver.pending());
+    TEST_ASSERT_EQUAL_UINT8(0, readings.len);
+
+    float_words(612, &scd30.words[0]);
+    float_words(22.5f, &scd30.words[2]);
+    float_words(43.5f, &scd30.words[4]);
+    scd30.wordsLen = 6;
+    scd30.ready = true;
+    scd30.commandsLen = 0;
+
+    step(bus, driver, &readings);
+    polledUs = bus.now();
+    TEST_ASSERT_EQUAL_UINT32(SENSOR_TRANSACTION_TIMEOUT_MS, step(bus, driver, &readings));
+    TEST_ASSERT_EQUAL_UINT8(0, readings.len);
+    TEST_ASSERT_EQUAL_UINT32(SCD30_INTERVAL_MS - SENSOR_READY_EARLY_MS, step(bus, driver, &readings));
+
+    TEST_ASSERT_EQUAL_UINT8(2, scd30.commandsLen);
+    TEST_ASSERT_EQUAL_HEX16(scd30.dataReady, scd30.commands[0].command);
+    TEST_ASSERT_EQUAL_HEX16(SCD30_READ_MEASUREMENT, scd30.commands[1].command);
+
+    TEST_ASSERT_EQUAL_UINT8(3, readings.len);
+    TEST_ASSERT_EQUAL_INT32(612, find(&readings, CO2_PPM_MEASUREMENT));
+    TEST_ASSERT_EQUAL_INT32(225, find(&readings, TEMPERATURE_MEASUREMENT));
+    TEST_ASSERT_EQUAL_INT32(435, find(&readings, HUMIDITY_MEASUREMENT));
+    TEST_ASSERT_EQUAL_INT64(polledUs, readings.readyUs);
+    TEST_ASSERT_EQUAL_INT64(bus.now(), readings.timestampUs);
+}
+
+static void test_crc_errors_are_rejected(void)
+{
+    MockI2cBus bus;
+    Scd30Driver driver(bus);
+    struct sensorReadings readings;
+
+    TEST_ASSERT_TRUE(bus.attach(SCD30_ADDRESS, sensirion, &scd30));
+    scd30.corrupt = 0;
+    TEST_ASSERT_FALSE(driver.begin());
+
+    scd30.corrupt = -1;
+    TEST_ASSERT_TRUE(driver.begin());
+    bus.run();
+
+    scd30.ready = true;
+    scd30.wordsLen = 6;
+    float_words(612, &scd30.words[0]);
+    scd30.corrupt = 3;
+    step(bus, driver, &readings);
+    step(bus, driver, &readings);
+    TEST_ASSERT_EQUAL_UINT32(SENSOR_RETRY_MS, step(bus, driver, &readings));
+    TEST_ASSERT_EQUAL_UINT8(0, readings.len);
+
+    // a corrupt data ready status is retried as well
+    scd30.corrupt = 0;
+    step(bus, driver, &readings);
+    TEST_ASSERT_EQUAL_UINT32(SENSOR_RETRY_MS, step(bus, driver, &readings));
+    TEST_ASSERT_EQUAL_UINT8(0, readings.len);
+}
+
+static void test_missing_sensors_are_not_probed(void)
+{
+    MockI2cBus bus;
+    Scd30Driver scd30Driver(bus);
+    Scd4xDriver scd4xDriver(bus);
+
+    TEST_ASSERT_FALSE(scd30Driver.begin());
+    TEST_ASSERT_FALSE(scd4xDriver.begin());
+}
+
+static void test_scd4x_reads_the_measurement(void)
+{
+    MockI2cBus bus;
+    Scd4xDriver driver(bus);
+    struct sensorReadings readings;
+
+    TEST_ASSERT_TRUE(bus.attach(SCD4X_ADDRESS, sensirion, &scd4x));
+    TEST_ASSERT_TRUE(driver.begin());
+    TEST_ASSERT_TRUE(scd4x.measuring);
+
+    // T = -45 + 175 * word / 2^16, RH = 100 * word / 2^16
+    scd4x.words[0] = 800;
+    scd4x.words[1] = 0x8000;
+    scd4x.words[2] = 0x8000;
+    scd4x.wordsLen = 3;
+    scd4x.ready = true;
+    step(bus, driver, &readings);
+    step(bus, driver, &readings);
+    TEST_ASSERT_EQUAL_UINT32(SCD4X_INTERVAL_MS - SENSOR_READY_EARLY_MS, step(bus, driver, &readings));
+
+    TEST_ASSERT_EQUAL_UINT8(3, readings.len);
+    TEST_ASSERT_EQUAL_INT32(800, find(&readings, CO2_PPM_MEASUREMENT));
+    TEST_ASSERT_EQUAL_INT32(425, find(&readings, TEMPERATURE_MEASUREMENT));
+    TEST_ASSERT_EQUAL_INT32(500, find(&readings, HUMIDITY_MEASUREMENT));
+}
+
+static void test_scd4x_settings_stop_and_restart(void)
+{
+    const struct command begin[] = {
+        { SCD4X_STOP_PERIODIC_MEASUREMENT, 0 },
+        { SCD4X_SERIAL_NUMBER, 0 },
+        { SCD4X_AUTO_CALIBRATION, 1 },
+        { SCD4X_TEMPERATURE_OFFSET, 1497 },
+        { SCD4X_ALTITUDE, 430 },
+        { SCD4X_START_PERIODIC_MEASUREMENT, 0 },
+    };
+    MockI2cBus bus;
+    Scd4xDriver driver(bus);
+    int64_t startUs;
+
+    TEST_ASSERT_TRUE(bus.attach(SCD4X_ADDRESS, sensirion, &scd4x));
+    driver.configure(true, 4.0f, 430);
+    TEST_ASSERT_TRUE(driver.begin());
+    TEST_ASSERT_EQUAL_UINT8(ARRAY_SIZE(begin), scd4x.commandsLen);
+    for (uint8_t i = 0; i < ARRAY_SIZE(begin); i++)
+    {
+        TEST_ASSERT_EQUAL_HEX16(begin[i].command, scd4x.commands[i].command);
+        TEST_ASSERT_EQUAL_UINT16(begin[i].argument, scd4x.commands[i].argument);
+    }
+
+    // the setting is queued behind a stop and followed by a start
+    scd4x.commandsLen = 0;
+    startUs = bus.now();
+    driver.setTemperatureOffset(2.0f);
+    TEST_ASSERT_EQUAL_UINT8(3, bus.queued());
+    TEST_ASSERT_EQUAL_UINT8(3, bus.run());
+    TEST_ASSERT_EQUAL_UINT8(3, scd4x.commandsLen);
+    TEST_ASSERT_EQUAL_HEX16(SCD4X_STOP_PERIODIC_MEASUREMENT, scd4x.commands[0].command);
+    TEST_ASSERT_EQUAL_HEX16(SCD4X_TEMPERATURE_OFFSET, scd4x.commands[1].command);
+    TEST_ASSERT_EQUAL_UINT16(748, scd4x.commands[1].argument);
+    TEST_ASSERT_EQUAL_HEX16(SCD4X_START_PERIODIC_MEASUREMENT, scd4x.commands[2].command);
+    TEST_ASSERT_TRUE(scd4x.measuring);
+    // the stop delay elapsed on the bus
+    TEST_ASSERT_GREATER_OR_EQUAL_INT64(SCD4X_STOP_DELAY_MS * 1000, bus.now() - startUs);
+
+    // settings while the first is queued are kept, the latest value of each
+    scd4x.commandsLen = 0;
+    driver.forceCalibration(420);
+    driver.setAutoCalibration(false);
+    driver.setTemperatureOffset(1.0f);
+    driver.setAutoCalibration(true);
+    TEST_ASSERT_EQUAL_UINT8(3, bus.queued());
+    TEST_ASSERT_EQUAL_UINT8(3, bus.run());
+    TEST_ASSERT_EQUAL_UINT8(3, scd4x.commandsLen);
+    TEST_ASSERT_EQUAL_HEX16(SCD4X_FORCED_CALIBRATION, scd4x.commands[1].command);
+    TEST_ASSERT_EQUAL_UINT16(420, scd4x.commands[1].argument);
+
+    // submitted one after the other by the steps, each once the one before is done
+    struct sensorReadings readings;
+    const struct command kept[] = {
+        { SCD4X_AUTO_CALIBRATION, 1 },
+        { SCD4X_TEMPERATURE_OFFSET, 374 },
+    };
+    for (uint8_t i = 0; i < ARRAY_SIZE(kept); i++)
+    {
+        scd4x.commandsLen = 0;
+        step(bus, driver, &readings);
+        TEST_ASSERT_GREATER_OR_EQUAL_UINT32(3, scd4x.commandsLen);
+        TEST_ASSERT_EQUAL_HEX16(SCD4X_STOP_PERIODIC_MEASUREMENT, scd4x.commands[0].command);
+        TEST_ASSERT_EQUAL_HEX16(kept[i].command, scd4x.commands[1].command);
+        TEST_ASSERT_EQUAL_UINT16(kept[i].argument, scd4x.commands[1].argument);
+        TEST_ASSERT_EQUAL_HEX16(SCD4X_START_PERIODIC_MEASUREMENT, scd4x.commands[2].command);
+    }
+
+    // nothing is left but the data ready poll
+    scd4x.commandsLen = 0;
+    step(bus, driver, &readings);
+    step(bus, driver, &readings);
+    TEST_ASSERT_EQUAL_UINT8(1, scd4x.commandsLen);
+    TEST_ASSERT_EQUAL_HEX16(scd4x.dataReady, scd4x.commands[0].command);
+}
+
+static void test_scd30_keeps_a_setting_until_the_one_before_is_done(void)
+{
+    const uint16_t version = 0x0342;
+    MockI2cBus bus;
+    Scd30Driver driver(bus);
+    struct sensorReadings readings;
+
+    scd30.words[0] = version;
+    TEST_ASSERT_TRUE(bus.attach(SCD30_ADDRESS, sensirion, &scd30));
+    TEST_ASSERT_TRUE(driver.begin());
+    bus.run();
+
+    scd30.commandsLen = 0;
+    driver.forceCalibration(400);
+    driver.forceCalibration(410);
+    driver.forceCalibration(420);
+    TEST_ASSERT_EQUAL_UINT8(1, bus.queued());
+    bus.run();
+    driver.step(&readings);
+    TEST_ASSERT_EQUAL_UINT8(2, bus.queued());
+    bus.run();
+    TEST_ASSERT_EQUAL_UINT8(3, scd30.commandsLen);
+    TEST_ASSERT_EQUAL_UINT16(400, scd30.commands[0].argument);
+    TEST_ASSERT_EQUAL_UINT16(420, scd30.commands[1].argument);
+    TEST_ASSERT_EQUAL_HEX16(scd30.dataReady, scd30.commands[2].command);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_scd30_polls_data_ready_then_reads);
+    RUN_TEST(test_crc_errors_are_rejected);
+    RUN_TEST(test_missing_sensors_are_not_probed);
+    RUN_TEST(test_scd4x_reads_the_measurement);
+    RUN_TEST(test_scd4x_settings_stop_and_restart);
+    RUN_TEST(test_scd30_keeps_a_setting_until_the_one_before_is_done);
+    return UNITY_END();
+}
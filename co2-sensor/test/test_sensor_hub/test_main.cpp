@@ -0,0 +1,267 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <unity.h>
+
+#include <string.h>
+
+#include "sensor-hub.h"
+#include "sensorhub-mib.h"
+
+#define CALLS_MAX 32
+
+/*
+ * Scripted driver: every step takes intervalMs, every readEvery-th step
+ * reports value and counts it up.
+ */
+class MockDriver : public SensorDriver
+{
+public:
+    MockDriver(const char *driverName, uint8_t type, uint32_t intervalMs, uint8_t readEvery = 1)
+        : driverName(driverName), type(type), intervalMs(intervalMs), readEvery(readEvery),
+          present(true), interrupt(false), steps(0), value(0)
+    {
+    }
+
+    const char *name() const { return driverName; }
+
+    uint8_t measurementTypes(const uint8_t **types) const
+    {
+        *types = &type;
+        return 1;
+    }
+
+    bool begin() { return present; }
+
+    uint32_t step(struct sensorReadings *readings)
+    {
+        steps++;
+        interrupt = false;
+        if (steps % readEvery == 0)
+        {
+            readings->len = 1;
+            readings->reading[0].type = type;
+            readings->reading[0].value = value++;
+        }
+        return intervalMs;
+    }
+
+    bool pending() { return interrupt; }
+
+    const char *driverName;
+    uint8_t type;
+    uint32_t intervalMs;
+    uint8_t readEvery;
+    bool present;
+    bool interrupt;
+    uint32_t steps;
+    int32_t value;
+};
+
+struct call
+{
+    uint8_t sensorId;
+    int32_t value;
+    uint32_t nowMs;
+};
+
+static struct call calls[CALLS_MAX];
+static uint8_t callsLen;
+
+static void record(uint8_t sensorId, const struct sensorReadings *readings, uint32_t nowMs)
+{
+    if (callsLen < CALLS_MAX)
+    {
+        calls[callsLen].sensorId = sensorId;
+        calls[callsLen].value = readings->reading[0].value;
+        calls[callsLen].nowMs = nowMs;
+        callsLen++;
+    }
+}
+
+void setUp(void)
+{
+    callsLen = 0;
+}
+
+void tearDown(void)
+{
+}
+
+static void test_add_probes_and_registers(void)
+{
+    SensorHub hub(record);
+    MockDriver co2("SCD30", CO2_PPM_MEASUREMENT, 100);
+    MockDriver missing("SCD4x", CO2_PPM_MEASUREMENT, 100);
+    MockDriver temperature("BME280", TEMPERATURE_MEASUREMENT, 100);
+    MockDriver more("more", HUMIDITY_MEASUREMENT, 100);
+
+    missing.present = false;
+    TEST_ASSERT_TRUE(hub.add(1, &co2));
+    TEST_ASSERT_FALSE(hub.add(2, &missing));
+    TEST_ASSERT_FALSE(hub.add(1, &temperature));
+    TEST_ASSERT_TRUE(hub.add(3, &temperature));
+    TEST_ASSERT_EQUAL_UINT8(2, hub.count());
+
+    TEST_ASSERT_TRUE(hub.get(1) == &co2);
+    TEST_ASSERT_NULL(hub.get(2));
+    TEST_ASSERT_TRUE(hub.find(TEMPERATURE_MEASUREMENT) == &temperature);
+    TEST_ASSERT_NULL(hub.find(HUMIDITY_MEASUREMENT));
+
+    for (uint8_t id = 4; hub.count() < SENSOR_HUB_SENSORS_MAX; id++)
+    {
+        TEST_ASSERT_TRUE(hub.add(id, &more));
+    }
+    TEST_ASSERT_FALSE(hub.add(100, &more));
+}
+
+static void test_steps_are_limited_per_run(void)
+{
+    SensorHub hub(record);
+    MockDriver drivers[] = {
+        MockDriver("a", CO2_PPM_MEASUREMENT, 1000),
+        MockDriver("b", TEMPERATURE_MEASUREMENT, 1000),
+        MockDriver("c", HUMIDITY_MEASUREMENT, 1000),
+    };
+
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        TEST_ASSERT_TRUE(hub.add(i + 1, &drivers[i]));
+    }
+
+    hub.run(0);
+    TEST_ASSERT_EQUAL_UINT8(SENSOR_HUB_STEPS_PER_RUN, callsLen);
+    hub.run(1);
+    TEST_ASSERT_EQUAL_UINT8(3, callsLen);
+    hub.run(2);
+    TEST_ASSERT_EQUAL_UINT8(3, callsLen);
+
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT32(1, drivers[i].steps);
+    }
+}
+
+static void test_the_longest_waiting_runs_first(void)
+{
+    SensorHub hub(record);
+    MockDriver slow("slow", TEMPERATURE_MEASUREMENT, 50);
+    MockDriver fast("fast", CO2_PPM_MEASUREMENT, 10);
+    MockDriver idle("idle", HUMIDITY_MEASUREMENT, 1000);
+
+    TEST_ASSERT_TRUE(hub.add(1, &slow));
+    TEST_ASSERT_TRUE(hub.add(2, &fast));
+    TEST_ASSERT_TRUE(hub.add(3, &idle));
+    hub.run(0);
+    hub.run(0);
+
+    // due at 50, 10 and 1000: fast has waited longer
+    callsLen = 0;
+    hub.run(60);
+    TEST_ASSERT_EQUAL_UINT8(2, callsLen);
+    TEST_ASSERT_EQUAL_UINT8(2, calls[0].sensorId);
+    TEST_ASSERT_EQUAL_UINT8(1, calls[1].sensorId);
+    TEST_ASSERT_EQUAL_UINT32(60, calls[1].nowMs);
+
+    callsLen = 0;
+    hub.run(69);
+    TEST_ASSERT_EQUAL_UINT8(0, callsLen);
+    TEST_ASSERT_EQUAL_UINT32(1, idle.steps);
+}
+
+static void test_pending_interrupts_run_first(void)
+{
+    SensorHub hub(record);
+    MockDriver overdue("overdue", CO2_PPM_MEASUREMENT, 10);
+    MockDriver ready("ready", TEMPERATURE_MEASUREMENT, 5000);
+
+    TEST_ASSERT_TRUE(hub.add(1, &overdue));
+    TEST_ASSERT_TRUE(hub.add(2, &ready));
+    hub.run(0);
+
+    callsLen = 0;
+    ready.interrupt = true;
+    hub.run(1000);
+    TEST_ASSERT_EQUAL_UINT8(2, callsLen);
+    TEST_ASSERT_EQUAL_UINT8(2, calls[0].sensorId);
+    TEST_ASSERT_EQUAL_UINT8(1, calls[1].sensorId);
+    TEST_ASSERT_EQUAL_UINT32(2, ready.steps);
+}
+
+static void test_scheduling_survives_the_wrap_around(void)
+{
+    SensorHub hub(record);
+    MockDriver co2("SCD30", CO2_PPM_MEASUREMENT, 100);
+    uint32_t nowMs = 0;
+
+    TEST_ASSERT_TRUE(hub.add(1, &co2));
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        hub.run(nowMs);
+        nowMs += 0x40000000;
+    }
+    nowMs -= 50;
+    hub.run(nowMs);
+    TEST_ASSERT_EQUAL_UINT32(5, co2.steps);
+
+    // due at 49 after the wrap
+    hub.run(nowMs + 99);
+    TEST_ASSERT_EQUAL_UINT32(5, co2.steps);
+    hub.run(nowMs + 100);
+    TEST_ASSERT_EQUAL_UINT32(6, co2.steps);
+}
+
+static void test_latest_values_are_kept(void)
+{
+    SensorHub hub(NULL);
+    MockDriver co2("SCD30", CO2_PPM_MEASUREMENT, 10, 2);
+    int32_t value = -1;
+
+    co2.value = 612;
+    TEST_ASSERT_TRUE(hub.add(1, &co2));
+    TEST_ASSERT_FALSE(hub.value(1, CO2_PPM_MEASUREMENT, &value));
+
+    // the first step starts a conversion, the second reads it
+    hub.run(0);
+    TEST_ASSERT_FALSE(hub.value(1, CO2_PPM_MEASUREMENT, &value));
+    hub.run(10);
+    TEST_ASSERT_TRUE(hub.value(1, CO2_PPM_MEASUREMENT, &value));
+    TEST_ASSERT_EQUAL_INT32(612, value);
+
+    // a step without readings keeps the previous ones
+    hub.run(20);
+    TEST_ASSERT_TRUE(hub.value(1, CO2_PPM_MEASUREMENT, &value));
+    TEST_ASSERT_EQUAL_INT32(612, value);
+    hub.run(30);
+    TEST_ASSERT_TRUE(hub.value(1, CO2_PPM_MEASUREMENT, &value));
+    TEST_ASSERT_EQUAL_INT32(613, value);
+
+    TEST_ASSERT_FALSE(hub.value(1, TEMPERATURE_MEASUREMENT, &value));
+    TEST_ASSERT_FALSE(hub.value(2, CO2_PPM_MEASUREMENT, &value));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_add_probes_and_registers);
+    RUN_TEST(test_steps_are_limited_per_run);
+    RUN_TEST(test_the_longest_waiting_runs_first);
+    RUN_TEST(test_pending_interrupts_run_first);
+    RUN_TEST(test_scheduling_survives_the_wrap_around);
+    RUN_TEST(test_latest_values_are_kept);
+    return UNITY_END();
+}
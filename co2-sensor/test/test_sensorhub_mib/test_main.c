@@ -0,0 +1,443 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * Compares the tree the mib:: builders generate for sensorhub_mib with the
+ * objects declared in snmp-mib/sensorhub.mib: every served object has to be
+ * declared with the same OID, type and access, every accessible object of
+ * the MIB file has to be served.
+ */
+
+#include <unity.h>
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sensorhub-mib.h"
+#include "lwip/apps/snmp_core.h"
+#include "lwip/apps/snmp_scalar.h"
+#include "lwip/apps/snmp_table.h"
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+/* relative to the directory of this file */
+#define MIB_FILE "/../../../snmp-mib/sensorhub.mib"
+
+#define MIB_TOKENS 4096
+#define MIB_TOKEN_LEN 48
+#define MIB_OBJECTS 128
+#define MIB_SUB_IDS 4
+#define AGENT_OBJECTS 128
+
+/* declared, but never implemented by the agent */
+static const char *const unserved[] = { "shSetExample" };
+
+struct mib_object {
+    char name[MIB_TOKEN_LEN];
+    char parent[MIB_TOKEN_LEN];
+    u32_t sub_ids[MIB_SUB_IDS];
+    u8_t sub_ids_len;
+    /* first word of the SYNTAX, SEQUENCE for tables, empty for OBJECT IDENTIFIER */
+    char syntax[MIB_TOKEN_LEN];
+    char access[MIB_TOKEN_LEN];
+    struct snmp_obj_id oid;
+    u8_t resolved;
+};
+
+struct agent_object {
+    struct snmp_obj_id oid;
+    u8_t asn1_type;
+    snmp_access_t access;
+};
+
+static char tokens[MIB_TOKENS][MIB_TOKEN_LEN];
+static size_t tokens_len;
+static struct mib_object objects[MIB_OBJECTS];
+static size_t objects_len;
+static struct agent_object served[AGENT_OBJECTS];
+static size_t served_len;
+
+/* identifiers, numbers, ::= and single punctuation; strings and comments are skipped */
+static void tokenize(FILE *file)
+{
+    int c = fgetc(file);
+
+    tokens_len = 0;
+    while (c != EOF) {
+        char *token = tokens[tokens_len];
+        size_t len = 0;
+
+        if (isspace(c)) {
+            c = fgetc(file);
+            continue;
+        }
+        if (c == '"') {
+            while ((c = fgetc(file)) != EOF && c != '"') {
+            }
+            c = fgetc(file);
+            continue;
+        }
+        if (c == '-') {
+            c = fgetc(file);
+            if (c == '-') {
+                while ((c = fgetc(file)) != EOF && c != '\n') {
+                }
+                continue;
+            }
+            token[len++] = '-';
+        }
+
+        TEST_ASSERT_LESS_THAN(MIB_TOKENS, tokens_len + 1);
+        if (isalnum(c)) {
+            while (c != EOF && (isalnum(c) || c == '-' || c == '_')) {
+                TEST_ASSERT_LESS_THAN(MIB_TOKEN_LEN, len + 1);
+                token[len++] = (char)c;
+                c = fgetc(file);
+            }
+        } else if (c == ':') {
+            while (c != EOF && (c == ':' || c == '=')) {
+                TEST_ASSERT_LESS_THAN(MIB_TOKEN_LEN, len + 1);
+                token[len++] = (char)c;
+                c = fgetc(file);
+            }
+        } else {
+            token[len++] = (char)c;
+            c = fgetc(file);
+        }
+        token[len] = '\0';
+        tokens_len++;
+    }
+}
+
+static int token_is(size_t i, const char *text)
+{
+    return i < tokens_len && strcmp(tokens[i], text) == 0;
+}
+
+/* parses "::= { parent n ... }" at i, returns the index behind it */
+static size_t parse_assignment(size_t i, struct mib_object *object)
+{
+    TEST_ASSERT_TRUE_MESSAGE(token_is(i, "::=") && token_is(i + 1, "{"), object->name);
+    i += 2;
+    strcpy(object->parent, tokens[i++]);
+    while (i < tokens_len && !token_is(i, "}")) {
+        TEST_ASSERT_LESS_THAN(MIB_SUB_IDS, object->sub_ids_len);
+        TEST_ASSERT_TRUE_MESSAGE(isdigit((unsigned char)tokens[i][0]), object->name);
+        object->sub_ids[object->sub_ids_len++] = (u32_t)strtoul(tokens[i++], NULL, 10);
+    }
+    TEST_ASSERT_NOT_EQUAL_MESSAGE(0, object->sub_ids_len, object->name);
+    return i + 1;
+}
+
+static struct mib_object *new_object(const char *name)
+{
+    struct mib_object *object = &objects[objects_len++];
+
+    TEST_ASSERT_LESS_OR_EQUAL(MIB_OBJECTS, objects_len);
+    memset(object, 0, sizeof(*object));
+    strcpy(object->name, name);
+    return object;
+}
+
+/* MODULE-IDENTITY, OBJECT IDENTIFIER and OBJECT-TYPE, notifications are not part of the agent tree */
+static void parse_objects(void)
+{
+    size_t i = 0;
+
+    /* the IMPORTS end with the first ; */
+    while (i < tokens_len && !token_is(i, ";")) {
+        i++;
+    }
+
+    objects_len = 0;
+    while (i + 1 < tokens_len) {
+        if (token_is(i + 1, "MODULE-IDENTITY") || token_is(i + 1, "OBJECT-TYPE")) {
+            struct mib_object *object = new_object(tokens[i]);
+
+            for (i += 2; i < tokens_len && !token_is(i, "::="); i++) {
+                if (token_is(i, "SYNTAX")) {
+                    strcpy(object->syntax, tokens[i + 1]);
+                } else if (token_is(i, "MAX-ACCESS") || token_is(i, "ACCESS")) {
+                    strcpy(object->access, tokens[i + 1]);
+                }
+            }
+            i = parse_assignment(i, object);
+        } else if (token_is(i + 1, "OBJECT") && token_is(i + 2, "IDENTIFIER")) {
+            i = parse_assignment(i + 3, new_object(tokens[i]));
+        } else {
+            i++;
+        }
+    }
+}
+
+static struct mib_object *find_object(const char *name)
+{
+    for (size_t i = 0; i < objects_len; i++) {
+        if (strcmp(objects[i].name, name) == 0) {
+            return &objects[i];
+        }
+    }
+    return NULL;
+}
+
+static void resolve(struct mib_object *object, u8_t depth)
+{
+    static const u32_t enterprises[] = { 1, 3, 6, 1, 4, 1 };
+    struct mib_object *parent;
+
+    if (object->resolved) {
+        return;
+    }
+    TEST_ASSERT_LESS_THAN_MESSAGE(MIB_OBJECTS, depth, object->name);
+
+    if (strcmp(object->parent, "enterprises") == 0) {
+        snmp_oid_assign(&object->oid, enterprises, ARRAY_SIZE(enterprises));
+    } else {
+        parent = find_object(object->parent);
+        TEST_ASSERT_NOT_NULL_MESSAGE(parent, object->parent);
+        resolve(parent, depth + 1);
+        object->oid = parent->oid;
+    }
+    for (u8_t i = 0; i < object->sub_ids_len; i++) {
+        object->oid.id[object->oid.len++] = object->sub_ids[i];
+    }
+    object->resolved = 1;
+}
+
+static void load_mib(void)
+{
+    char path[512];
+    const char *slash = strrchr(__FILE__, '/');
+    FILE *file;
+
+    snprintf(path, sizeof(path), "%.*s" MIB_FILE, slash != NULL ? (int)(slash - __FILE__) : 1,
+             slash != NULL ? __FILE__ : ".");
+    file = fopen(path, "r");
+    TEST_ASSERT_NOT_NULL_MESSAGE(file, path);
+    tokenize(file);
+    fclose(file);
+
+    parse_objects();
+    for (size_t i = 0; i < objects_len; i++) {
+        resolve(&objects[i], 0);
+    }
+}
+
+static void add_served(const struct snmp_obj_id *prefix, const u32_t *sub_ids, u8_t sub_ids_len, u8_t asn1_type, snmp_access_t access)
+{
+    struct agent_object *object = &served[served_len++];
+
+    TEST_ASSERT_LESS_OR_EQUAL(AGENT_OBJECTS, served_len);
+    object->oid = *prefix;
+    snmp_oid_append(&object->oid, sub_ids, sub_ids_len);
+    object->asn1_type = asn1_type;
+    object->access = access;
+}
+
+/* the objects below node, prefix is the OID of node */
+static void collect(const struct snmp_node *node, const struct snmp_obj_id *prefix)
+{
+    if (node->node_type == SNMP_NODE_TREE) {
+        const struct snmp_tree_node *tree = (const struct snmp_tree_node *)node;
+
+        for (u16_t i = 0; i < tree->subnode_count; i++) {
+            struct snmp_obj_id oid = *prefix;
+
+            snmp_oid_append(&oid, &tree->subnodes[i]->oid, 1);
+            collect(tree->subnodes[i], &oid);
+        }
+    } else if (node->node_type == SNMP_NODE_SCALAR_ARRAY) {
+        const struct snmp_scalar_array_node *array = (const struct snmp_scalar_array_node *)node;
+
+        for (u16_t i = 0; i < array->array_node_count; i++) {
+            add_served(prefix, &array->array_nodes[i].oid, 1, array->array_nodes[i].asn1_type, array->array_nodes[i].access);
+        }
+    } else if (node->node_type == SNMP_NODE_TABLE) {
+        const struct snmp_table_node *table = (const struct snmp_table_node *)node;
+
+        for (u16_t i = 0; i < table->column_count; i++) {
+            /* the entry is always 1 */
+            const u32_t column[] = { 1, table->columns[i].index };
+
+            add_served(prefix, column, ARRAY_SIZE(column), table->columns[i].asn1_type, table->columns[i].access);
+        }
+    } else if (node->node_type == SNMP_NODE_SCALAR) {
+        const struct snmp_scalar_node *scalar = (const struct snmp_scalar_node *)node;
+
+        add_served(prefix, NULL, 0, scalar->asn1_type, scalar->access);
+    } else {
+        TEST_FAIL_MESSAGE("unexpected node type");
+    }
+}
+
+static const char *oid_text(const struct snmp_obj_id *oid)
+{
+    static char text[SNMP_MAX_OBJ_ID_LEN * 11];
+    size_t len = 0;
+
+    text[0] = '\0';
+    for (u8_t i = 0; i < oid->len; i++) {
+        len += (size_t)snprintf(text + len, sizeof(text) - len, i > 0 ? ".%u" : "%u", (unsigned)oid->id[i]);
+    }
+    return text;
+}
+
+static int accessible(const struct mib_object *object)
+{
+    return strcmp(object->access, "read-only") == 0 || strcmp(object->access, "read-write") == 0 ||
+           strcmp(object->access, "read-create") == 0;
+}
+
+static int is_unserved(const struct mib_object *object)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(unserved); i++) {
+        if (strcmp(object->name, unserved[i]) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static u8_t expected_type(const struct mib_object *object)
+{
+    if (strcmp(object->syntax, "Integer32") == 0 || strcmp(object->syntax, "INTEGER") == 0) {
+        return SNMP_ASN1_TYPE_INTEGER;
+    } else if (strcmp(object->syntax, "Counter32") == 0) {
+        return SNMP_ASN1_TYPE_COUNTER;
+    } else if (strcmp(object->syntax, "Gauge32") == 0 || strcmp(object->syntax, "Unsigned32") == 0) {
+        return SNMP_ASN1_TYPE_GAUGE;
+    } else if (strcmp(object->syntax, "TimeTicks") == 0) {
+        return SNMP_ASN1_TYPE_TIMETICKS;
+    } else if (strcmp(object->syntax, "DisplayString") == 0 || strcmp(object->syntax, "OCTET") == 0) {
+        return SNMP_ASN1_TYPE_OCTET_STRING;
+    }
+    TEST_FAIL_MESSAGE(object->syntax);
+    return 0;
+}
+
+static const struct mib_object *find_by_oid(const struct snmp_obj_id *oid)
+{
+    for (size_t i = 0; i < objects_len; i++) {
+        if (snmp_oid_equal(objects[i].oid.id, objects[i].oid.len, oid->id, oid->len)) {
+            return &objects[i];
+        }
+    }
+    return NULL;
+}
+
+void setUp(void)
+{
+    struct snmp_obj_id base;
+
+    load_mib();
+
+    served_len = 0;
+    snmp_oid_assign(&base, sensorhub_mib.base_oid, sensorhub_mib.base_oid_len);
+    collect(sensorhub_mib.root_node, &base);
+}
+
+void tearDown(void)
+{
+}
+
+static void test_the_base_oid_is_the_module_identity(void)
+{
+    const struct mib_object *module = find_object("sensorHubMIB");
+    const struct snmp_node *root = sensorhub_mib.root_node;
+
+    TEST_ASSERT_NOT_NULL(module);
+    /* the root node is the last sub-id of the base OID */
+    TEST_ASSERT_EQUAL_UINT8(module->oid.len, sensorhub_mib.base_oid_len);
+    TEST_ASSERT_EQUAL_UINT32_ARRAY(module->oid.id, sensorhub_mib.base_oid, module->oid.len);
+    TEST_ASSERT_EQUAL_UINT32(module->oid.id[module->oid.len - 1], root->oid);
+}
+
+static void test_served_objects_are_declared(void)
+{
+    TEST_ASSERT_GREATER_THAN(0, served_len);
+    for (size_t i = 0; i < served_len; i++) {
+        const struct agent_object *object = &served[i];
+        const struct mib_object *declared = find_by_oid(&object->oid);
+
+        TEST_ASSERT_NOT_NULL_MESSAGE(declared, oid_text(&object->oid));
+        TEST_ASSERT_TRUE_MESSAGE(accessible(declared), declared->name);
+        TEST_ASSERT_EQUAL_HEX8_MESSAGE(expected_type(declared), object->asn1_type, declared->name);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(strcmp(declared->access, "read-only") == 0 ? SNMP_NODE_INSTANCE_READ_ONLY
+                                                                                  : SNMP_NODE_INSTANCE_READ_WRITE,
+                                      object->access, declared->name);
+    }
+}
+
+static void test_declared_objects_are_served(void)
+{
+    size_t checked = 0;
+
+    for (size_t i = 0; i < objects_len; i++) {
+        const struct mib_object *declared = &objects[i];
+        int found = 0;
+
+        if (!accessible(declared) || is_unserved(declared)) {
+            continue;
+        }
+        for (size_t j = 0; j < served_len && !found; j++) {
+            found = snmp_oid_equal(served[j].oid.id, served[j].oid.len, declared->oid.id, declared->oid.len);
+        }
+        TEST_ASSERT_TRUE_MESSAGE(found, declared->name);
+        checked++;
+    }
+    TEST_ASSERT_EQUAL_size_t(served_len, checked);
+}
+
+/* a table node of the agent is a SEQUENCE OF in the MIB, with its entry at .1 */
+static void test_tables_are_declared_as_tables(void)
+{
+    const struct snmp_tree_node *root = (const struct snmp_tree_node *)sensorhub_mib.root_node;
+
+    for (u16_t i = 0; i < root->subnode_count; i++) {
+        struct snmp_obj_id oid;
+        const struct mib_object *declared;
+
+        snmp_oid_assign(&oid, sensorhub_mib.base_oid, sensorhub_mib.base_oid_len);
+        snmp_oid_append(&oid, &root->subnodes[i]->oid, 1);
+        declared = find_by_oid(&oid);
+        TEST_ASSERT_NOT_NULL_MESSAGE(declared, oid_text(&oid));
+
+        if (root->subnodes[i]->node_type == SNMP_NODE_TABLE) {
+            const u32_t entry = 1;
+
+            TEST_ASSERT_EQUAL_STRING_MESSAGE("SEQUENCE", declared->syntax, declared->name);
+            snmp_oid_append(&oid, &entry, 1);
+            declared = find_by_oid(&oid);
+            TEST_ASSERT_NOT_NULL_MESSAGE(declared, oid_text(&oid));
+            TEST_ASSERT_EQUAL_STRING_MESSAGE("not-accessible", declared->access, declared->name);
+        } else {
+            TEST_ASSERT_EQUAL_STRING_MESSAGE("", declared->syntax, declared->name);
+        }
+    }
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_the_base_oid_is_the_module_identity);
+    RUN_TEST(test_served_objects_are_declared);
+    RUN_TEST(test_declared_objects_are_served);
+    RUN_TEST(test_tables_are_declared_as_tables);
+    return UNITY_END();
+}
@@ -0,0 +1,600 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <unity.h>
+
+#include <string.h>
+
+#include "host-agent.h"
+#include "host-sensors.h"
+#include "snmp-client.h"
+#include "sensorhub-mib.h"
+#include "snmpv3-users.h"
+#include "lwip/apps/snmp_core.h"
+#include "lwip/apps/snmpv3.h"
+#include "lwip/sys.h"
+#include "esp_timer.h"
+#include "snmp/snmp_cache.h"
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+#define SENSOR_NAME_1 "1.3.6.1.4.1.58049.1.1.1.2.1"
+#define MEASUREMENT_TABLE "1.3.6.1.4.1.58049.1.2"
+#define CO2_VALUE "1.3.6.1.4.1.58049.1.2.1.2.1.1"
+#define CO2_RAW_VALUE "1.3.6.1.4.1.58049.1.2.1.3.1.1"
+#define USM_STATS "1.3.6.1.6.3.15.1.1"
+
+/* RFC 3414 usmStats counters */
+#define UNSUPPORTED_SEC_LEVELS 1
+#define NOT_IN_TIME_WINDOWS 2
+#define UNKNOWN_USER_NAMES 3
+#define UNKNOWN_ENGINE_IDS 4
+
+/* rows of the two host sensors */
+#define MEASUREMENT_ROWS 5
+#define MEASUREMENT_COLUMNS 3
+
+static struct snmp_client client;
+static struct snmp_client_response response;
+static uint8_t frame[SNMP_CLIENT_FRAME_MAX];
+static uint8_t answer[SNMP_CLIENT_FRAME_MAX];
+
+static struct snmp_client_oid oid(const char *text)
+{
+    struct snmp_client_oid result;
+
+    TEST_ASSERT_TRUE_MESSAGE(snmp_client_parse_oid(text, &result), text);
+    return result;
+}
+
+/* sends one request, returns 0 if the agent did not answer */
+static int request(uint8_t pdu_type, const struct snmp_client_oid *oids, uint8_t oids_len, int32_t max_repetitions)
+{
+    size_t len = snmp_client_encode(&client, pdu_type, oids, oids_len, 0, max_repetitions, frame, sizeof(frame));
+    size_t answer_len;
+
+    TEST_ASSERT_NOT_EQUAL(0, len);
+    answer_len = host_agent_request(frame, len, answer, sizeof(answer));
+    if (answer_len == 0) {
+        return 0;
+    }
+    TEST_ASSERT_TRUE(snmp_client_decode(&client, answer, answer_len, &response));
+    TEST_ASSERT_EQUAL_INT32(client.request_id, response.request_id);
+    return 1;
+}
+
+static int get(const char *text)
+{
+    struct snmp_client_oid oids[] = { oid(text) };
+
+    return request(SNMP_CLIENT_GET, oids, 1, 0);
+}
+
+static void discover(void)
+{
+    size_t len = snmp_client_encode_discovery(&client, frame, sizeof(frame));
+
+    len = host_agent_request(frame, len, answer, sizeof(answer));
+    TEST_ASSERT_NOT_EQUAL(0, len);
+    TEST_ASSERT_TRUE(snmp_client_decode(&client, answer, len, &response));
+}
+
+static void assert_report(uint32_t counter)
+{
+    TEST_ASSERT_EQUAL_HEX8(SNMP_CLIENT_REPORT, response.pdu_type);
+    /* only notInTimeWindows is authenticated, so the manager can trust the time */
+    TEST_ASSERT_EQUAL_HEX8(counter == NOT_IN_TIME_WINDOWS ? 0x01 : 0, response.msg_flags & 0x03);
+    TEST_ASSERT_EQUAL_UINT8(1, response.varbinds_len);
+    TEST_ASSERT_EQUAL_UINT8(SNMP_CLIENT_COUNTER, response.varbinds[0].type);
+    TEST_ASSERT_TRUE(response.varbinds[0].integer > 0);
+
+    struct snmp_client_oid expected = oid(USM_STATS);
+    expected.id[expected.len++] = counter;
+    expected.id[expected.len++] = 0;
+    TEST_ASSERT_EQUAL_UINT8(expected.len, response.varbinds[0].oid.len);
+    TEST_ASSERT_EQUAL_UINT32_ARRAY(expected.id, response.varbinds[0].oid.id, expected.len);
+}
+
+/* the PDU of an unknown user can't be decrypted, so the report has no request ID */
+static void assert_get_reported(uint32_t counter)
+{
+    struct snmp_client_oid oids[] = { oid(CO2_VALUE) };
+    size_t len = snmp_client_encode(&client, SNMP_CLIENT_GET, oids, 1, 0, 0, frame, sizeof(frame));
+
+    len = host_agent_request(frame, len, answer, sizeof(answer));
+    TEST_ASSERT_NOT_EQUAL(0, len);
+    TEST_ASSERT_TRUE(snmp_client_decode(&client, answer, len, &response));
+    assert_report(counter);
+}
+
+static void assert_co2(int64_t expected)
+{
+    TEST_ASSERT_EQUAL_INT32(SNMP_ERR_NOERROR, response.error_status);
+    TEST_ASSERT_EQUAL_UINT8(1, response.varbinds_len);
+    TEST_ASSERT_EQUAL_UINT8(SNMP_CLIENT_INTEGER, response.varbinds[0].type);
+    TEST_ASSERT_EQUAL_INT64(expected, response.varbinds[0].integer);
+}
+
+void setUp(void)
+{
+    host_agent_init();
+    snmp_client_init(&client, SNMP_CLIENT_VERSION_2C, "public");
+}
+
+void tearDown(void)
+{
+    sys_now_set(0);
+}
+
+/* stops the clock far enough ahead that earlier tests left no source without tokens */
+static void limit_rate(u16_t per_sec, u16_t burst)
+{
+    static u32_t now;
+
+    now += 1000000;
+    sys_now_set(now);
+    snmp_rate_limit_set(per_sec, burst);
+}
+
+static void test_password_to_key_matches_rfc3414(void)
+{
+    /* RFC 3414 A.3.1 and A.3.2 */
+    static const uint8_t engine_id[] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2 };
+    static const uint8_t md5[] = { 0x52, 0x6f, 0x5e, 0xed, 0x9f, 0xcc, 0xe2, 0x6f, 0x89, 0x64, 0xc2, 0x93, 0x07, 0x87, 0xd8, 0x2b };
+    static const uint8_t sha[] = { 0x66, 0x95, 0xfe, 0xbc, 0x92, 0x88, 0xe3, 0x62, 0x82, 0x23, 0x5f, 0xc7, 0x15, 0x1f, 0x12, 0x84, 0x97, 0xb3, 0x8f, 0x3f };
+    uint8_t key[20];
+
+    snmp_client_password_to_key(SNMP_CLIENT_AUTH_MD5, "maplesyrup", engine_id, sizeof(engine_id), key);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(md5, key, sizeof(md5));
+    snmpv3_password_to_key_md5((const u8_t *)"maplesyrup", 10, engine_id, sizeof(engine_id), key);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(md5, key, sizeof(md5));
+
+    snmp_client_password_to_key(SNMP_CLIENT_AUTH_SHA, "maplesyrup", engine_id, sizeof(engine_id), key);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(sha, key, sizeof(sha));
+    snmpv3_password_to_key_sha((const u8_t *)"maplesyrup", 10, engine_id, sizeof(engine_id), key);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(sha, key, sizeof(sha));
+}
+
+static void test_get(void)
+{
+    struct snmp_client_oid oids[] = { oid(SENSOR_NAME_1), oid(CO2_VALUE), oid(CO2_RAW_VALUE) };
+
+    host_sensors_set_raw(1, CO2_PPM_MEASUREMENT, 655);
+    TEST_ASSERT_TRUE(request(SNMP_CLIENT_GET, oids, ARRAY_SIZE(oids), 0));
+
+    TEST_ASSERT_EQUAL_UINT8(SNMP_CLIENT_RESPONSE, response.pdu_type);
+    TEST_ASSERT_EQUAL_INT32(SNMP_ERR_NOERROR, response.error_status);
+    TEST_ASSERT_EQUAL_UINT8(3, response.varbinds_len);
+    TEST_ASSERT_EQUAL_UINT8(SNMP_CLIENT_OCTET_STRING, response.varbinds[0].type);
+    TEST_ASSERT_EQUAL_UINT16(5, response.varbinds[0].octets_len);
+    TEST_ASSERT_EQUAL_MEMORY("SCD30", response.varbinds[0].octets, 5);
+    TEST_ASSERT_EQUAL_INT64(612, response.varbinds[1].integer);
+    TEST_ASSERT_EQUAL_INT64(655, response.varbinds[2].integer);
+}
+
+static void test_long_names_are_cut(void)
+{
+    static const u8_t types[] = { CO2_PPM_MEASUREMENT };
+    static char name[SNMP_MAX_VALUE_SIZE + 16];
+
+    memset(name, 'n', sizeof(name) - 1);
+    host_sensors_add(3, name, types, sizeof(types));
+    TEST_ASSERT_TRUE(get("1.3.6.1.4.1.58049.1.1.1.2.3"));
+    TEST_ASSERT_EQUAL_UINT8(SNMP_CLIENT_OCTET_STRING, response.varbinds[0].type);
+    TEST_ASSERT_EQUAL_UINT16(SNMP_MAX_VALUE_SIZE, response.varbinds[0].octets_len);
+}
+
+static void test_get_missing_instance(void)
+{
+    TEST_ASSERT_TRUE(get("1.3.6.1.4.1.58049.1.2.1.2.3.1"));
+    TEST_ASSERT_EQUAL_UINT8(SNMP_CLIENT_NO_SUCH_INSTANCE, response.varbinds[0].type);
+
+    TEST_ASSERT_TRUE(get("1.3.6.1.4.1.58049.1.99.0"));
+    TEST_ASSERT_EQUAL_UINT8(SNMP_CLIENT_NO_SUCH_OBJECT, response.varbinds[0].type);
+}
+
+static void test_wrong_community_is_dropped(void)
+{
+    snmp_client_init(&client, SNMP_CLIENT_VERSION_2C, "private");
+    TEST_ASSERT_FALSE(get(CO2_VALUE));
+}
+
+static void test_cache_follows_the_epoch(void)
+{
+    TEST_ASSERT_TRUE(get(CO2_VALUE));
+    assert_co2(612);
+
+    /* cached until the next sample */
+    host_sensors_set(1, CO2_PPM_MEASUREMENT, 1400);
+    TEST_ASSERT_TRUE(get(CO2_VALUE));
+    assert_co2(612);
+
+    snmp_cache_advance_epoch();
+    TEST_ASSERT_TRUE(get(CO2_VALUE));
+    assert_co2(1400);
+}
+
+static void test_getnext_walks_the_measurement_table(void)
+{
+    static const uint32_t rows[MEASUREMENT_ROWS][2] = { { 1, 1 }, { 1, 2 }, { 1, 3 }, { 2, 4 }, { 2, 5 } };
+    struct snmp_client_oid next = oid(MEASUREMENT_TABLE);
+    struct snmp_client_oid table = next;
+
+    for (uint8_t column = 1; column <= MEASUREMENT_COLUMNS; column++) {
+        for (uint8_t row = 0; row < MEASUREMENT_ROWS; row++) {
+            struct snmp_client_oid *found;
+
+            TEST_ASSERT_TRUE(request(SNMP_CLIENT_GETNEXT, &next, 1, 0));
+            found = &response.varbinds[0].oid;
+            TEST_ASSERT_EQUAL_UINT8(table.len + 4, found->len);
+            TEST_ASSERT_EQUAL_UINT32_ARRAY(table.id, found->id, table.len);
+            TEST_ASSERT_EQUAL_UINT32(column, found->id[table.len + 1]);
+            TEST_ASSERT_EQUAL_UINT32(rows[row][0], found->id[table.len + 2]);
+            TEST_ASSERT_EQUAL_UINT32(rows[row][1], found->id[table.len + 3]);
+            next = *found;
+        }
+    }
+
+    /* next is outside of the table */
+    TEST_ASSERT_TRUE(request(SNMP_CLIENT_GETNEXT, &next, 1, 0));
+    TEST_ASSERT_TRUE(response.varbinds[0].oid.id[table.len - 1] > table.id[table.len - 1]);
+}
+
+static void test_getbulk_matches_the_walk(void)
+{
+    struct snmp_client_oid start = oid(MEASUREMENT_TABLE);
+    struct snmp_client_oid walk[MEASUREMENT_ROWS * MEASUREMENT_COLUMNS];
+    struct snmp_client_oid next = start;
+
+    for (uint8_t i = 0; i < ARRAY_SIZE(walk); i++) {
+        TEST_ASSERT_TRUE(request(SNMP_CLIENT_GETNEXT, &next, 1, 0));
+        walk[i] = next = response.varbinds[0].oid;
+    }
+
+    TEST_ASSERT_TRUE(request(SNMP_CLIENT_GETBULK, &start, 1, ARRAY_SIZE(walk)));
+    TEST_ASSERT_EQUAL_INT32(SNMP_ERR_NOERROR, response.error_status);
+    TEST_ASSERT_EQUAL_UINT8(ARRAY_SIZE(walk), response.varbinds_len);
+    for (uint8_t i = 0; i < ARRAY_SIZE(walk); i++) {
+        TEST_ASSERT_EQUAL_UINT8(walk[i].len, response.varbinds[i].oid.len);
+        TEST_ASSERT_EQUAL_UINT32_ARRAY(walk[i].id, response.varbinds[i].oid.id, walk[i].len);
+    }
+}
+
+static void test_getbulk_is_dropped_for_v1(void)
+{
+    struct snmp_client_oid start = oid(MEASUREMENT_TABLE);
+
+    snmp_client_init(&client, SNMP_CLIENT_VERSION_1, "public");
+    TEST_ASSERT_FALSE(request(SNMP_CLIENT_GETBULK, &start, 1, 10));
+    TEST_ASSERT_TRUE(get(CO2_VALUE));
+    assert_co2(612);
+}
+
+static void test_rate_limit_drops_and_counts(void)
+{
+    uint32_t limited = snmp_cache_get_stats()->rate_limited;
+
+    /* off by default */
+    for (uint8_t i = 0; i < 50; i++) {
+        TEST_ASSERT_TRUE(get(CO2_VALUE));
+    }
+    TEST_ASSERT_EQUAL_UINT32(limited, snmp_cache_get_stats()->rate_limited);
+
+    limit_rate(1, 2);
+    TEST_ASSERT_TRUE(get(CO2_VALUE));
+    TEST_ASSERT_TRUE(get(CO2_VALUE));
+    TEST_ASSERT_FALSE(get(CO2_VALUE));
+    TEST_ASSERT_EQUAL_UINT32(limited + 1, snmp_cache_get_stats()->rate_limited);
+
+    /* a token per second */
+    sys_now_set(sys_now() + 1000);
+    TEST_ASSERT_TRUE(get(CO2_VALUE));
+    TEST_ASSERT_FALSE(get(CO2_VALUE));
+    TEST_ASSERT_EQUAL_UINT32(limited + 2, snmp_cache_get_stats()->rate_limited);
+}
+
+static void test_rate_limit_lets_getbulk_walks_continue(void)
+{
+    struct snmp_client_oid start = oid(MEASUREMENT_TABLE);
+    struct snmp_client_oid next;
+    uint32_t limited = snmp_cache_get_stats()->rate_limited;
+    uint16_t requests = 1;
+
+    limit_rate(1, 1);
+    TEST_ASSERT_TRUE(request(SNMP_CLIENT_GETBULK, &start, 1, 4));
+    next = response.varbinds[response.varbinds_len - 1].oid;
+
+    /* out of tokens, other requests and GETBULKs that do not continue the walk are dropped */
+    TEST_ASSERT_FALSE(get(CO2_VALUE));
+    TEST_ASSERT_FALSE(request(SNMP_CLIENT_GETBULK, &start, 1, 4));
+    TEST_ASSERT_EQUAL_UINT32(limited + 2, snmp_cache_get_stats()->rate_limited);
+
+    /* the walk itself goes on to the end of the MIB */
+    while (response.varbinds[response.varbinds_len - 1].type != SNMP_CLIENT_END_OF_MIB_VIEW) {
+        TEST_ASSERT_TRUE_MESSAGE(request(SNMP_CLIENT_GETBULK, &next, 1, 4), "walk dropped");
+        next = response.varbinds[response.varbinds_len - 1].oid;
+        TEST_ASSERT_LESS_THAN(1000, ++requests);
+    }
+    TEST_ASSERT_EQUAL_UINT32(limited + 2, snmp_cache_get_stats()->rate_limited);
+
+    /* and ends there */
+    TEST_ASSERT_FALSE(request(SNMP_CLIENT_GETBULK, &next, 1, 4));
+    TEST_ASSERT_EQUAL_UINT32(limited + 3, snmp_cache_get_stats()->rate_limited);
+}
+
+/* the varbinds of an error response are copied from the request, which spans several pool pbufs */
+static void test_v1_error_returns_the_request_varbinds(void)
+{
+    struct snmp_client_oid oids[12];
+
+    for (uint8_t i = 0; i < ARRAY_SIZE(oids); i++) {
+        oids[i] = oid(CO2_VALUE);
+    }
+    oids[ARRAY_SIZE(oids) - 1] = oid("1.3.6.1.4.1.58049.1.2.1.2.3.1");
+
+    snmp_client_init(&client, SNMP_CLIENT_VERSION_1, "public");
+    TEST_ASSERT_TRUE(request(SNMP_CLIENT_GET, oids, ARRAY_SIZE(oids), 0));
+    TEST_ASSERT_EQUAL_INT32(SNMP_ERR_NOSUCHNAME, response.error_status);
+    TEST_ASSERT_EQUAL_INT32(ARRAY_SIZE(oids), response.error_index);
+    TEST_ASSERT_EQUAL_UINT8(ARRAY_SIZE(oids), response.varbinds_len);
+    for (uint8_t i = 0; i < ARRAY_SIZE(oids); i++) {
+        TEST_ASSERT_EQUAL_UINT8(oids[i].len, response.varbinds[i].oid.len);
+        TEST_ASSERT_EQUAL_UINT32_ARRAY(oids[i].id, response.varbinds[i].oid.id, oids[i].len);
+        TEST_ASSERT_EQUAL_UINT8(SNMP_CLIENT_NULL, response.varbinds[i].type);
+    }
+}
+
+static void test_set_needs_the_write_community(void)
+{
+    struct snmp_client_oid oids[] = { oid(CO2_VALUE) };
+
+    /* the read community may not write */
+    TEST_ASSERT_FALSE(request(SNMP_CLIENT_SET, oids, 1, 0));
+
+    snmp_client_init(&client, SNMP_CLIENT_VERSION_2C, "private");
+    TEST_ASSERT_TRUE(request(SNMP_CLIENT_SET, oids, 1, 0));
+    TEST_ASSERT_NOT_EQUAL(SNMP_ERR_NOERROR, response.error_status);
+    TEST_ASSERT_EQUAL_INT32(1, response.error_index);
+}
+
+static void test_v3_discovery_reports_the_engine(void)
+{
+    static const uint8_t mac[] = HOST_AGENT_MAC;
+    static const uint8_t enterprise[] = { 0x80, 0x00, 0xe2, 0xc1, 0x03 };
+
+    snmp_client_init_v3(&client, "monitor", SNMP_CLIENT_AUTH_SHA, "auth-password", SNMP_CLIENT_PRIV_AES, "priv-password");
+    discover();
+
+    assert_report(UNKNOWN_ENGINE_IDS);
+    TEST_ASSERT_EQUAL_UINT8(sizeof(enterprise) + sizeof(mac), client.engine_id_len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(enterprise, client.engine_id, sizeof(enterprise));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(mac, &client.engine_id[sizeof(enterprise)], sizeof(mac));
+    TEST_ASSERT_EQUAL_INT32(1, client.engine_boots);
+}
+
+static void check_v3(uint8_t auth, uint8_t lwip_auth, uint8_t priv, uint8_t lwip_priv)
+{
+    TEST_ASSERT_EQUAL(ERR_OK, snmpv3_users_add_password("monitor", lwip_auth, "auth-password", lwip_priv, "priv-password"));
+    snmp_client_init_v3(&client, "monitor", auth, "auth-password", priv, "priv-password");
+    discover();
+
+    TEST_ASSERT_TRUE(get(CO2_VALUE));
+    assert_co2(612);
+    TEST_ASSERT_EQUAL_HEX8(0x01 | (priv != SNMP_CLIENT_PRIV_NONE ? 0x02 : 0), response.msg_flags & 0x03);
+}
+
+static void test_v3_md5_des(void)
+{
+    check_v3(SNMP_CLIENT_AUTH_MD5, SNMP_V3_AUTH_ALGO_MD5, SNMP_CLIENT_PRIV_DES, SNMP_V3_PRIV_ALGO_DES);
+}
+
+static void test_v3_sha_aes(void)
+{
+    check_v3(SNMP_CLIENT_AUTH_SHA, SNMP_V3_AUTH_ALGO_SHA, SNMP_CLIENT_PRIV_AES, SNMP_V3_PRIV_ALGO_AES);
+}
+
+static void test_v3_sha_without_privacy(void)
+{
+    check_v3(SNMP_CLIENT_AUTH_SHA, SNMP_V3_AUTH_ALGO_SHA, SNMP_CLIENT_PRIV_NONE, SNMP_V3_PRIV_ALGO_INVAL);
+}
+
+static void test_v3_wrong_password_is_dropped(void)
+{
+    TEST_ASSERT_EQUAL(ERR_OK, snmpv3_users_add_password("monitor", SNMP_V3_AUTH_ALGO_SHA, "auth-password", SNMP_V3_PRIV_ALGO_AES, "priv-password"));
+    snmp_client_init_v3(&client, "monitor", SNMP_CLIENT_AUTH_SHA, "other-password", SNMP_CLIENT_PRIV_AES, "priv-password");
+    discover();
+
+    TEST_ASSERT_FALSE(get(CO2_VALUE));
+}
+
+static void test_v3_unknown_user_is_reported(void)
+{
+    TEST_ASSERT_EQUAL(ERR_OK, snmpv3_users_add_password("monitor", SNMP_V3_AUTH_ALGO_SHA, "auth-password", SNMP_V3_PRIV_ALGO_AES, "priv-password"));
+    snmp_client_init_v3(&client, "nobody", SNMP_CLIENT_AUTH_SHA, "auth-password", SNMP_CLIENT_PRIV_AES, "priv-password");
+    discover();
+
+    assert_get_reported(UNKNOWN_USER_NAMES);
+}
+
+static void test_v3_empty_user_is_reported(void)
+{
+    TEST_ASSERT_EQUAL(ERR_OK, snmpv3_users_add_password("monitor", SNMP_V3_AUTH_ALGO_SHA, "auth-password", SNMP_V3_PRIV_ALGO_AES, "priv-password"));
+    snmp_client_init_v3(&client, "", SNMP_CLIENT_AUTH_NONE, "", SNMP_CLIENT_PRIV_NONE, "");
+    discover();
+
+    TEST_ASSERT_TRUE(get(CO2_VALUE));
+    assert_report(UNKNOWN_USER_NAMES);
+}
+
+static void test_v3_other_security_levels_are_reported(void)
+{
+    TEST_ASSERT_EQUAL(ERR_OK, snmpv3_users_add_password("monitor", SNMP_V3_AUTH_ALGO_SHA, "auth-password", SNMP_V3_PRIV_ALGO_AES, "priv-password"));
+    snmp_client_init_v3(&client, "monitor", SNMP_CLIENT_AUTH_SHA, "auth-password", SNMP_CLIENT_PRIV_AES, "priv-password");
+    discover();
+
+    /* noAuthNoPriv */
+    client.msg_flags_mask = 0;
+    TEST_ASSERT_TRUE(get(CO2_VALUE));
+    assert_report(UNSUPPORTED_SEC_LEVELS);
+
+    /* authNoPriv */
+    client.msg_flags_mask = 0x01;
+    TEST_ASSERT_TRUE(get(CO2_VALUE));
+    assert_report(UNSUPPORTED_SEC_LEVELS);
+
+    client.msg_flags_mask = 0xff;
+    TEST_ASSERT_TRUE(get(CO2_VALUE));
+    assert_co2(612);
+
+    /* authPriv for a user without privacy key */
+    TEST_ASSERT_EQUAL(ERR_OK, snmpv3_users_add_password("monitor", SNMP_V3_AUTH_ALGO_SHA, "auth-password", SNMP_V3_PRIV_ALGO_INVAL, ""));
+    assert_get_reported(UNSUPPORTED_SEC_LEVELS);
+}
+
+static void test_v3_requests_out_of_the_time_window_are_reported(void)
+{
+    TEST_ASSERT_EQUAL(ERR_OK, snmpv3_users_add_password("monitor", SNMP_V3_AUTH_ALGO_SHA, "auth-password", SNMP_V3_PRIV_ALGO_AES, "priv-password"));
+    snmp_client_init_v3(&client, "monitor", SNMP_CLIENT_AUTH_SHA, "auth-password", SNMP_CLIENT_PRIV_AES, "priv-password");
+    discover();
+    int32_t time = client.engine_time;
+
+    /* the window is 150 s to either side */
+    client.engine_time = time + 150;
+    TEST_ASSERT_TRUE(get(CO2_VALUE));
+    assert_co2(612);
+    client.engine_time = time - 151;
+    assert_get_reported(NOT_IN_TIME_WINDOWS);
+    TEST_ASSERT_EQUAL_INT32(time, client.engine_time);
+    client.engine_time = time + 151;
+    assert_get_reported(NOT_IN_TIME_WINDOWS);
+
+    /* a request of an earlier boot is always stale */
+    client.engine_boots--;
+    assert_get_reported(NOT_IN_TIME_WINDOWS);
+
+    /* the report brought the client back in time */
+    TEST_ASSERT_TRUE(get(CO2_VALUE));
+    assert_co2(612);
+}
+
+static void test_v3_engine_time_starts_over_with_the_next_boot(void)
+{
+    TEST_ASSERT_EQUAL(ERR_OK, snmpv3_users_add_password("monitor", SNMP_V3_AUTH_ALGO_SHA, "auth-password", SNMP_V3_PRIV_ALGO_AES, "priv-password"));
+    snmp_client_init_v3(&client, "monitor", SNMP_CLIENT_AUTH_SHA, "auth-password", SNMP_CLIENT_PRIV_AES, "priv-password");
+    discover();
+
+    /* 68 years of uptime, well past what sys_now() in ms can count */
+    esp_timer_advance((int64_t)(SNMPV3_ENGINE_MAX - 10) * 1000000);
+    assert_get_reported(NOT_IN_TIME_WINDOWS);
+    TEST_ASSERT_EQUAL_INT32(1, client.engine_boots);
+    TEST_ASSERT_TRUE(client.engine_time > SNMPV3_ENGINE_MAX - 20);
+
+    esp_timer_advance(20 * 1000000);
+    assert_get_reported(NOT_IN_TIME_WINDOWS);
+    TEST_ASSERT_EQUAL_INT32(2, client.engine_boots);
+    TEST_ASSERT_TRUE(client.engine_time < 20);
+    TEST_ASSERT_EQUAL_UINT32(2, snmpv3_get_engine_boots());
+
+    TEST_ASSERT_TRUE(get(CO2_VALUE));
+    assert_co2(612);
+}
+
+static void test_communities_are_refused_with_v3_users(void)
+{
+    TEST_ASSERT_TRUE(get(CO2_VALUE));
+
+    TEST_ASSERT_EQUAL(ERR_OK, snmpv3_users_add_password("monitor", SNMP_V3_AUTH_ALGO_SHA, "auth-password", SNMP_V3_PRIV_ALGO_AES, "priv-password"));
+    TEST_ASSERT_FALSE(get(CO2_VALUE));
+
+    snmpv3_users_set_v3_only(0);
+    TEST_ASSERT_TRUE(get(CO2_VALUE));
+    assert_co2(612);
+}
+
+/* every prefix of a valid request is malformed, none may be answered or crash the agent */
+static void check_truncations(void)
+{
+    struct snmp_client_oid oids[] = { oid(SENSOR_NAME_1), oid(CO2_VALUE) };
+    size_t len = snmp_client_encode(&client, SNMP_CLIENT_GET, oids, ARRAY_SIZE(oids), 0, 0, frame, sizeof(frame));
+    u32_t inpkts = snmp_stats.inpkts;
+
+    for (size_t i = 0; i < len; i++) {
+        TEST_ASSERT_EQUAL_size_t(0, host_agent_request(frame, i, answer, sizeof(answer)));
+    }
+    TEST_ASSERT_EQUAL_UINT32(inpkts + len, snmp_stats.inpkts);
+
+    TEST_ASSERT_NOT_EQUAL(0, host_agent_request(frame, len, answer, sizeof(answer)));
+}
+
+static void test_truncated_frames_are_dropped(void)
+{
+    check_truncations();
+
+    TEST_ASSERT_EQUAL(ERR_OK, snmpv3_users_add_password("monitor", SNMP_V3_AUTH_ALGO_SHA, "auth-password", SNMP_V3_PRIV_ALGO_AES, "priv-password"));
+    snmp_client_init_v3(&client, "monitor", SNMP_CLIENT_AUTH_SHA, "auth-password", SNMP_CLIENT_PRIV_AES, "priv-password");
+    discover();
+    check_truncations();
+}
+
+/* a flipped bit may still be a valid request, the agent only has to survive it */
+static void test_flipped_bits_do_not_crash(void)
+{
+    struct snmp_client_oid start = oid(MEASUREMENT_TABLE);
+    size_t len = snmp_client_encode(&client, SNMP_CLIENT_GETBULK, &start, 1, 0, 10, frame, sizeof(frame));
+    uint8_t flipped[SNMP_CLIENT_FRAME_MAX];
+
+    for (size_t bit = 0; bit < len * 8; bit++) {
+        memcpy(flipped, frame, len);
+        flipped[bit / 8] ^= (uint8_t)(1 << (bit % 8));
+        host_agent_request(flipped, len, answer, sizeof(answer));
+    }
+
+    TEST_ASSERT_NOT_EQUAL(0, host_agent_request(frame, len, answer, sizeof(answer)));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_password_to_key_matches_rfc3414);
+    RUN_TEST(test_get);
+    RUN_TEST(test_long_names_are_cut);
+    RUN_TEST(test_get_missing_instance);
+    RUN_TEST(test_wrong_community_is_dropped);
+    RUN_TEST(test_cache_follows_the_epoch);
+    RUN_TEST(test_getnext_walks_the_measurement_table);
+    RUN_TEST(test_getbulk_matches_the_walk);
+    RUN_TEST(test_getbulk_is_dropped_for_v1);
+    RUN_TEST(test_rate_limit_drops_and_counts);
+    RUN_TEST(test_rate_limit_lets_getbulk_walks_continue);
+    RUN_TEST(test_v1_error_returns_the_request_varbinds);
+    RUN_TEST(test_set_needs_the_write_community);
+    RUN_TEST(test_v3_discovery_reports_the_engine);
+    RUN_TEST(test_v3_md5_des);
+    RUN_TEST(test_v3_sha_aes);
+    RUN_TEST(test_v3_sha_without_privacy);
+    RUN_TEST(test_v3_wrong_password_is_dropped);
+    RUN_TEST(test_v3_unknown_user_is_reported);
+    RUN_TEST(test_v3_empty_user_is_reported);
+    RUN_TEST(test_v3_other_security_levels_are_reported);
+    RUN_TEST(test_v3_requests_out_of_the_time_window_are_reported);
+    RUN_TEST(test_v3_engine_time_starts_over_with_the_next_boot);
+    RUN_TEST(test_communities_are_refused_with_v3_users);
+    RUN_TEST(test_truncated_frames_are_dropped);
+    RUN_TEST(test_flipped_bits_do_not_crash);
+    return UNITY_END();
+}
@@ -0,0 +1,468 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * Throughput and latency of the agent in process, without the network and
+ * without the rate limit. The numbers are printed, the tests only fail if
+ * the agent stops answering.
+ */
+
+#include <unity.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host-agent.h"
+#include "snmp-client.h"
+#include "snmpv3-users.h"
+#include "esp_timer.h"
+#include "lwip/apps/snmpv3.h"
+#include "snmp/snmp_cache.h"
+#include "snmp/snmp_msg.h"
+#include "snmp/snmp_core_priv.h"
+#include "sensorhub-mib.h"
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+#define REQUESTS 5000
+#define SENSOR_TABLE "1.3.6.1.4.1.58049.1.1"
+#define MEASUREMENT_TABLE "1.3.6.1.4.1.58049.1.2"
+#define CO2_VALUE "1.3.6.1.4.1.58049.1.2.1.2.1.1"
+#define HEALTH "1.3.6.1.4.1.58049.1.7"
+
+/* varbinds encoded per trial, the best of the interleaved trials counts */
+#define ENCODED_VARBINDS 200000
+#define ENCODE_TRIALS 15
+#define ENCODE_BUFFER 8192
+
+/* random OIDs per MIB, resolved RESOLVE_ROUNDS times per trial */
+#define RESOLVE_OIDS 65536
+#define RESOLVE_ROUNDS 16
+#define RESOLVE_TRIALS 5
+#define SYNTHETIC_BASE 1, 3, 6, 1, 4, 1, 99999
+
+static struct snmp_client client;
+static struct snmp_client_response response;
+static uint8_t frame[SNMP_CLIENT_FRAME_MAX];
+static uint8_t answer[SNMP_CLIENT_FRAME_MAX];
+static uint32_t latencies_us[REQUESTS];
+
+static struct snmp_client_oid oid(const char *text)
+{
+    struct snmp_client_oid result;
+
+    TEST_ASSERT_TRUE(snmp_client_parse_oid(text, &result));
+    return result;
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static uint32_t percentile(uint8_t p)
+{
+    return latencies_us[(REQUESTS - 1) * p / 100];
+}
+
+/* every request is encoded before the clock starts, the epoch advances before each if uncached */
+static void bench(const char *name, uint8_t pdu_type, const struct snmp_client_oid *oids, uint8_t oids_len,
+                  int32_t max_repetitions, bool uncached)
+{
+    uint64_t total_us = 0;
+    char line[160];
+
+    for (uint32_t i = 0; i < REQUESTS; i++) {
+        size_t len = snmp_client_encode(&client, pdu_type, oids, oids_len, 0, max_repetitions, frame, sizeof(frame));
+        int64_t start;
+        size_t answer_len;
+
+        if (uncached) {
+            snmp_cache_advance_epoch();
+        }
+        start = esp_timer_get_time();
+        answer_len = host_agent_request(frame, len, answer, sizeof(answer));
+        latencies_us[i] = (uint32_t)(esp_timer_get_time() - start);
+        total_us += latencies_us[i];
+
+        TEST_ASSERT_NOT_EQUAL(0, answer_len);
+        if (i == 0) {
+            TEST_ASSERT_TRUE(snmp_client_decode(&client, answer, answer_len, &response));
+            TEST_ASSERT_EQUAL_INT32(0, response.error_status);
+        }
+    }
+
+    qsort(latencies_us, REQUESTS, sizeof(latencies_us[0]), compare_u32);
+    snprintf(line, sizeof(line), "%-28s %8.0f req/s  p50 %4u us  p90 %4u us  p99 %4u us  max %5u us  %u varbinds",
+             name, REQUESTS * 1e6 / (double)(total_us > 0 ? total_us : 1),
+             (unsigned)percentile(50), (unsigned)percentile(90), (unsigned)percentile(99),
+             (unsigned)latencies_us[REQUESTS - 1], (unsigned)response.varbinds_len);
+    TEST_MESSAGE(line);
+}
+
+void setUp(void)
+{
+    host_agent_init();
+    snmp_client_init(&client, SNMP_CLIENT_VERSION_2C, "public");
+}
+
+void tearDown(void)
+{
+}
+
+static void test_get(void)
+{
+    struct snmp_client_oid co2 = oid(CO2_VALUE);
+    struct snmp_client_oid many[10];
+
+    for (uint8_t i = 0; i < ARRAY_SIZE(many); i++) {
+        many[i] = co2;
+    }
+
+    bench("v2c GET", SNMP_CLIENT_GET, &co2, 1, 0, false);
+    bench("v2c GET uncached", SNMP_CLIENT_GET, &co2, 1, 0, true);
+    bench("v2c GET x10", SNMP_CLIENT_GET, many, ARRAY_SIZE(many), 0, false);
+}
+
+static void test_getnext(void)
+{
+    struct snmp_client_oid table = oid(MEASUREMENT_TABLE);
+    struct snmp_client_oid health = oid(HEALTH);
+
+    bench("v2c GETNEXT table", SNMP_CLIENT_GETNEXT, &table, 1, 0, false);
+    bench("v2c GETNEXT table uncached", SNMP_CLIENT_GETNEXT, &table, 1, 0, true);
+    bench("v2c GETNEXT scalar", SNMP_CLIENT_GETNEXT, &health, 1, 0, false);
+}
+
+static void test_getbulk(void)
+{
+    struct snmp_client_oid table = oid(MEASUREMENT_TABLE);
+    struct snmp_client_oid sensors = oid(SENSOR_TABLE);
+    struct snmp_client_oid health = oid(HEALTH);
+
+    bench("v2c GETBULK table x15", SNMP_CLIENT_GETBULK, &table, 1, 15, false);
+    bench("v2c GETBULK table uncached", SNMP_CLIENT_GETBULK, &table, 1, 15, true);
+    bench("v2c GETBULK sensors x2", SNMP_CLIENT_GETBULK, &sensors, 1, 2, false);
+    bench("v2c GETBULK health x30", SNMP_CLIENT_GETBULK, &health, 1, 30, false);
+}
+
+/* a response of up to 200 measurement cells does not fit a frame, the agent packs what fits */
+static void test_getbulk_repetitions(void)
+{
+    static const int32_t repetitions[] = { 10, 50, 200 };
+    struct snmp_client_oid table = oid(MEASUREMENT_TABLE);
+    char name[32];
+
+    for (uint8_t i = 0; i < ARRAY_SIZE(repetitions); i++) {
+        snprintf(name, sizeof(name), "v2c GETBULK x%d", (int)repetitions[i]);
+        bench(name, SNMP_CLIENT_GETBULK, &table, 1, repetitions[i], true);
+    }
+}
+
+typedef err_t (*varbind_encoder)(struct snmp_pbuf_stream *pbuf_stream, struct snmp_varbind *varbind);
+
+/* returns the encoded length of one list */
+static u16_t encode_varbinds(varbind_encoder encode, struct pbuf *p, struct snmp_varbind *varbinds, u16_t n,
+                             uint32_t rounds, uint64_t *total_us)
+{
+    struct snmp_pbuf_stream stream;
+    int64_t start = esp_timer_get_time();
+    err_t err = ERR_OK;
+
+    for (uint32_t round = 0; round < rounds; round++) {
+        snmp_pbuf_stream_init(&stream, p, 0, p->tot_len);
+        for (u16_t i = 0; i < n; i++) {
+            err |= encode(&stream, &varbinds[i]);
+        }
+    }
+    *total_us = (uint64_t)(esp_timer_get_time() - start);
+
+    TEST_ASSERT_EQUAL(ERR_OK, err);
+    return stream.offset;
+}
+
+/*
+ * Before and after the single pass encoder: snmp_append_outbound_varbind()
+ * counts each varbind with snmp_varbind_length() before writing it, which is
+ * how all responses were encoded before; traps still do.
+ * The varbinds are cells of the measurement table as GETBULK returns them.
+ */
+static void test_encode_varbinds(void)
+{
+    static const u16_t lengths[] = { 10, 50, 200 };
+    static struct snmp_varbind varbinds[200];
+    static s32_t values[200];
+    struct pbuf *before = pbuf_alloc(PBUF_TRANSPORT, ENCODE_BUFFER, PBUF_RAM);
+    struct pbuf *after = pbuf_alloc(PBUF_TRANSPORT, ENCODE_BUFFER, PBUF_RAM);
+    char line[160];
+
+    TEST_ASSERT_NOT_NULL(before);
+    TEST_ASSERT_NOT_NULL(after);
+
+    for (u16_t i = 0; i < ARRAY_SIZE(varbinds); i++) {
+        /* shMeasurementTable.1.column.sensor.type */
+        const u32_t id[] = { 1, 3, 6, 1, 4, 1, 58049, 1, 2, 1, 2 + i % 3, 1 + i / 15, 1 + (i / 3) % 5 };
+
+        memset(&varbinds[i], 0, sizeof(varbinds[i]));
+        snmp_oid_assign(&varbinds[i].oid, id, ARRAY_SIZE(id));
+        values[i] = (i % 3 == 0) ? 400 + i * 7 : i * 1000;
+        varbinds[i].type = SNMP_ASN1_TYPE_INTEGER;
+        varbinds[i].value = &values[i];
+        varbinds[i].value_len = sizeof(values[i]);
+    }
+
+    for (uint8_t i = 0; i < ARRAY_SIZE(lengths); i++) {
+        u16_t n = lengths[i];
+        uint32_t rounds = ENCODED_VARBINDS / n;
+        uint64_t before_us = UINT64_MAX;
+        uint64_t after_us = UINT64_MAX;
+        u16_t before_len = 0;
+        u16_t after_len = 0;
+
+        for (uint8_t trial = 0; trial < ENCODE_TRIALS; trial++) {
+            uint64_t us;
+
+            before_len = encode_varbinds(snmp_append_outbound_varbind, before, varbinds, n, rounds, &us);
+            before_us = us < before_us ? us : before_us;
+            after_len = encode_varbinds(snmp_append_response_varbind, after, varbinds, n, rounds, &us);
+            after_us = us < after_us ? us : after_us;
+        }
+
+        /* the upper bounds are exact for these OIDs, so the output is the same */
+        TEST_ASSERT_EQUAL_UINT16(before_len, after_len);
+        TEST_ASSERT_EQUAL_MEMORY(before->payload, after->payload, before_len);
+
+        before_us = before_us > 0 ? before_us : 1;
+        after_us = after_us > 0 ? after_us : 1;
+        snprintf(line, sizeof(line), "encode %3u varbinds (%4u bytes)  two-pass %8.0f lists/s  single-pass %8.0f lists/s  %+.1f%%",
+                 (unsigned)n, (unsigned)after_len, rounds * 1e6 / (double)before_us, rounds * 1e6 / (double)after_us,
+                 100.0 * ((double)before_us / (double)after_us - 1.0));
+        TEST_MESSAGE(line);
+    }
+
+    pbuf_free(before);
+    pbuf_free(after);
+}
+
+struct resolve_oid {
+    u32_t id[SNMP_MAX_OBJ_ID_LEN];
+    u8_t len;
+};
+
+static struct resolve_oid resolve_oids[RESOLVE_OIDS];
+
+/* a tree of the given fan-out and depth with gaps between the sub-ids, the leaves are scalars */
+static const struct snmp_node *synthetic_tree(u32_t oid, u8_t fan_out, u8_t depth)
+{
+    if (depth == 0) {
+        struct snmp_leaf_node *leaf = calloc(1, sizeof(*leaf));
+
+        TEST_ASSERT_NOT_NULL(leaf);
+        leaf->node.node_type = SNMP_NODE_SCALAR;
+        leaf->node.oid = oid;
+        return &leaf->node;
+    }
+
+    struct snmp_tree_node *tree = calloc(1, sizeof(*tree));
+    const struct snmp_node **subnodes = calloc(fan_out, sizeof(*subnodes));
+
+    TEST_ASSERT_NOT_NULL(tree);
+    TEST_ASSERT_NOT_NULL(subnodes);
+    for (u8_t i = 0; i < fan_out; i++) {
+        subnodes[i] = synthetic_tree(1 + 3 * i, fan_out, depth - 1);
+    }
+    tree->node.node_type = SNMP_NODE_TREE;
+    tree->node.oid = oid;
+    tree->subnode_count = fan_out;
+    tree->subnodes = subnodes;
+    return &tree->node;
+}
+
+static void free_tree(const struct snmp_node *node)
+{
+    if (node->node_type == SNMP_NODE_TREE) {
+        const struct snmp_tree_node *tree = (const struct snmp_tree_node *)node;
+
+        for (u16_t i = 0; i < tree->subnode_count; i++) {
+            free_tree(tree->subnodes[i]);
+        }
+        free((void *)tree->subnodes);
+    }
+    free((void *)node);
+}
+
+/* mostly existing paths with some misses and short or long OIDs, as managers send them */
+static void make_resolve_oids(const struct snmp_mib *mib, u8_t fan_out, u8_t depth)
+{
+    srand(1);
+    for (u32_t i = 0; i < RESOLVE_OIDS; i++) {
+        struct resolve_oid *oid = &resolve_oids[i];
+        u8_t len = (u8_t)(depth - 1 + rand() % 3);
+
+        memcpy(oid->id, mib->base_oid, mib->base_oid_len * sizeof(u32_t));
+        oid->len = mib->base_oid_len;
+        for (u8_t level = 0; level < len; level++) {
+            oid->id[oid->len++] = (level >= depth || rand() % 8 == 0) ? (u32_t)(rand() % (3 * fan_out + 2))
+                                                                    : (u32_t)(1 + 3 * (rand() % fan_out));
+        }
+    }
+}
+
+/* the sensorhub tree, walked with GETNEXT from every prefix of its OIDs */
+static void make_sensorhub_oids(void)
+{
+    struct snmp_obj_id next;
+    u32_t count = 0;
+
+    snmp_oid_assign(&next, sensorhub_mib.base_oid, sensorhub_mib.base_oid_len);
+    while (count < RESOLVE_OIDS && snmp_mib_tree_resolve_next(&sensorhub_mib, next.id, next.len, &next) != NULL) {
+        for (u8_t len = sensorhub_mib.base_oid_len; len <= next.len && count < RESOLVE_OIDS; len++) {
+            memcpy(resolve_oids[count].id, next.id, len * sizeof(u32_t));
+            resolve_oids[count].len = len;
+            count++;
+        }
+    }
+    TEST_ASSERT_GREATER_THAN(0, count);
+    for (u32_t i = count; i < RESOLVE_OIDS; i++) {
+        resolve_oids[i] = resolve_oids[i % count];
+    }
+}
+
+static uint64_t resolve_all(const struct snmp_mib *mib, bool next, uintptr_t *checksum)
+{
+    int64_t start = esp_timer_get_time();
+    struct snmp_obj_id result;
+    u8_t instance_len;
+
+    for (u32_t round = 0; round < RESOLVE_ROUNDS; round++) {
+        for (u32_t i = 0; i < RESOLVE_OIDS; i++) {
+            const struct snmp_node *node = next
+                ? snmp_mib_tree_resolve_next(mib, resolve_oids[i].id, resolve_oids[i].len, &result)
+                : snmp_mib_tree_resolve_exact(mib, resolve_oids[i].id, resolve_oids[i].len, &instance_len);
+
+            *checksum += (uintptr_t)node + (node != NULL ? (next ? result.len : instance_len) : 0);
+        }
+    }
+    return (uint64_t)(esp_timer_get_time() - start);
+}
+
+/*
+ * The mib copy is not registered, so snmp_mib_tree_resolve_*() find no index
+ * for it and walk the tree as before snmp_set_mibs() built the index.
+ */
+static void bench_resolve(const char *name, const struct snmp_mib *mib)
+{
+    struct snmp_mib linear = *mib;
+    char line[160];
+
+    for (uint8_t next = 0; next <= 1; next++) {
+        uint64_t indexed_us = UINT64_MAX;
+        uint64_t linear_us = UINT64_MAX;
+        uintptr_t indexed_sum = 0;
+        uintptr_t linear_sum = 0;
+
+        for (uint8_t trial = 0; trial < RESOLVE_TRIALS; trial++) {
+            uint64_t us = resolve_all(&linear, next, &linear_sum);
+
+            linear_us = us < linear_us ? us : linear_us;
+            us = resolve_all(mib, next, &indexed_sum);
+            indexed_us = us < indexed_us ? us : indexed_us;
+        }
+        /* same node and instance / next OID length for every lookup */
+        TEST_ASSERT_TRUE(indexed_sum == linear_sum);
+
+        linear_us = linear_us > 0 ? linear_us : 1;
+        indexed_us = indexed_us > 0 ? indexed_us : 1;
+        snprintf(line, sizeof(line), "resolve %-5s %-22s linear %6.1f M/s  index %6.1f M/s  %+.1f%%",
+                 next ? "next" : "exact", name,
+                 RESOLVE_ROUNDS * (double)RESOLVE_OIDS / (double)linear_us,
+                 RESOLVE_ROUNDS * (double)RESOLVE_OIDS / (double)indexed_us,
+                 100.0 * ((double)linear_us / (double)indexed_us - 1.0));
+        TEST_MESSAGE(line);
+    }
+}
+
+/* 1M lookups per trial and direction, on the sensorhub MIB and on wider synthetic trees */
+static void test_resolve_oids(void)
+{
+    static const u32_t narrow_base[] = { SYNTHETIC_BASE, 1 };
+    static const u32_t medium_base[] = { SYNTHETIC_BASE, 2 };
+    static const u32_t wide_base[] = { SYNTHETIC_BASE, 3 };
+    static const struct snmp_mib *registered[] = { &sensorhub_mib };
+    const struct snmp_mib narrow = { narrow_base, ARRAY_SIZE(narrow_base), synthetic_tree(1, 4, 4) };
+    const struct snmp_mib medium = { medium_base, ARRAY_SIZE(medium_base), synthetic_tree(2, 20, 3) };
+    const struct snmp_mib wide = { wide_base, ARRAY_SIZE(wide_base), synthetic_tree(3, 64, 2) };
+    const struct snmp_mib *mibs[] = { &sensorhub_mib, &narrow, &medium, &wide };
+
+    snmp_set_mibs(mibs, ARRAY_SIZE(mibs));
+
+    make_sensorhub_oids();
+    bench_resolve("sensorhub", &sensorhub_mib);
+    make_resolve_oids(&narrow, 4, 4);
+    bench_resolve("fan-out 4, depth 4", &narrow);
+    make_resolve_oids(&medium, 20, 3);
+    bench_resolve("fan-out 20, depth 3", &medium);
+    make_resolve_oids(&wide, 64, 2);
+    bench_resolve("fan-out 64, depth 2", &wide);
+
+    snmp_set_mibs(registered, ARRAY_SIZE(registered));
+    free_tree(narrow.root_node);
+    free_tree(medium.root_node);
+    free_tree(wide.root_node);
+}
+
+static void check_v3(const char *name, uint8_t auth, uint8_t lwip_auth, uint8_t priv, uint8_t lwip_priv)
+{
+    struct snmp_client_oid co2 = oid(CO2_VALUE);
+    size_t len;
+
+    TEST_ASSERT_EQUAL(ERR_OK, snmpv3_users_add_password("monitor", lwip_auth, "auth-password", lwip_priv, "priv-password"));
+    snmp_client_init_v3(&client, "monitor", auth, "auth-password", priv, "priv-password");
+    len = snmp_client_encode_discovery(&client, frame, sizeof(frame));
+    len = host_agent_request(frame, len, answer, sizeof(answer));
+    TEST_ASSERT_TRUE(snmp_client_decode(&client, answer, len, &response));
+
+    bench(name, SNMP_CLIENT_GET, &co2, 1, 0, false);
+}
+
+static void test_v3(void)
+{
+    check_v3("v3 GET MD5", SNMP_CLIENT_AUTH_MD5, SNMP_V3_AUTH_ALGO_MD5, SNMP_CLIENT_PRIV_NONE, SNMP_V3_PRIV_ALGO_INVAL);
+    check_v3("v3 GET SHA", SNMP_CLIENT_AUTH_SHA, SNMP_V3_AUTH_ALGO_SHA, SNMP_CLIENT_PRIV_NONE, SNMP_V3_PRIV_ALGO_INVAL);
+    check_v3("v3 GET MD5 DES", SNMP_CLIENT_AUTH_MD5, SNMP_V3_AUTH_ALGO_MD5, SNMP_CLIENT_PRIV_DES, SNMP_V3_PRIV_ALGO_DES);
+    check_v3("v3 GET SHA AES", SNMP_CLIENT_AUTH_SHA, SNMP_V3_AUTH_ALGO_SHA, SNMP_CLIENT_PRIV_AES, SNMP_V3_PRIV_ALGO_AES);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_get);
+    RUN_TEST(test_getnext);
+    RUN_TEST(test_getbulk);
+    RUN_TEST(test_getbulk_repetitions);
+    RUN_TEST(test_encode_varbinds);
+    RUN_TEST(test_resolve_oids);
+    RUN_TEST(test_v3);
+    return UNITY_END();
+}
@@ -0,0 +1,401 @@
+/*
+ * This file is part of the co2sensor distribution (https://github.com/xxxx or http://xxx.github.io).
+ * Copyright (c) 2020 David Gunzinger / smoca AG.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <unity.h>
+
+#include <FSImpl.h>
+#include <string.h>
+
+#include <memory>
+#include <string>
+
+#include "storage.h"
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+enum partitionFormat
+{
+    FORMAT_NONE,
+    FORMAT_SPIFFS,
+    FORMAT_LITTLEFS
+};
+
+struct settingsFile
+{
+    const char *path;
+    size_t size;
+};
+
+// as main.h names them, with sizes around STORAGE_COPY_BUFFER
+static const struct settingsFile settings[] = {
+    {"/state.json", 300}, {"/mqtt.json", 700}, {"/snmpv3.json", STORAGE_COPY_BUFFER}, {"/alerts.json", 0},
+};
+
+// what the flash and the card still change before the power is lost, -1 without a limit
+static int32_t budget = -1;
+// reads stop half way through a file, as on a damaged sector
+static bool failReads;
+
+static bool spend()
+{
+    if (budget == 0)
+    {
+        return false;
+    }
+    if (budget > 0)
+    {
+        budget--;
+    }
+    return true;
+}
+
+// a file whose writes are lost once the power is
+class PowerFileImpl : public fs::FileImpl
+{
+public:
+    explicit PowerFileImpl(File file) : file(file) {}
+
+    size_t write(const uint8_t *buf, size_t size) { return spend() ? file.write(buf, size) : 0; }
+    size_t read(uint8_t *buf, size_t size)
+    {
+        return failReads && file.position() >= file.size() / 2 ? 0 : file.read(buf, size);
+    }
+    void flush() { file.flush(); }
+    bool seek(uint32_t pos, fs::SeekMode mode) { return file.seek(pos, mode); }
+    size_t position() const { return file.position(); }
+    size_t size() const { return file.size(); }
+    bool setBufferSize(size_t size) { return file.setBufferSize(size); }
+    void close() { file.close(); }
+    time_t getLastWrite() { return file.getLastWrite(); }
+    const char *path() const { return file.path(); }
+    const char *name() const { return file.name(); }
+    boolean isDirectory(void) { return file.isDirectory(); }
+    fs::FileImplPtr openNextFile(const char *mode)
+    {
+        File next = file.openNextFile(mode);
+        return next ? std::make_shared<PowerFileImpl>(next) : nullptr;
+    }
+    boolean seekDir(long position) { return file.seekDir(position); }
+    String getNextFileName(void) { return file.getNextFileName(); }
+    void rewindDirectory(void) { file.rewindDirectory(); }
+    operator bool() { return file; }
+
+private:
+    File file;
+};
+
+class PowerFSImpl : public fs::FSImpl
+{
+public:
+    explicit PowerFSImpl(fs::FS &files) : files(files) {}
+
+    fs::FileImplPtr open(const char *path, const char *mode, const bool create)
+    {
+        if (mode[0] != 'r' && !spend())
+        {
+            return nullptr;
+        }
+        File file = files.open(path, mode, create);
+        return file ? std::make_shared<PowerFileImpl>(file) : nullptr;
+    }
+    bool exists(const char *path) { return files.exists(path); }
+    bool rename(const char *pathFrom, const char *pathTo) { return spend() && files.rename(pathFrom, pathTo); }
+    bool remove(const char *path) { return spend() && files.remove(path); }
+    bool mkdir(const char * /* path */) { return false; }
+    bool rmdir(const char * /* path */) { return false; }
+
+private:
+    fs::FS &files;
+};
+
+class PowerFS : public fs::FS
+{
+public:
+    explicit PowerFS(fs::FS &files) : fs::FS(std::make_shared<PowerFSImpl>(files)) {}
+};
+
+// the settings partition, SPIFFS and LittleFS take turns on it
+class Partition
+{
+public:
+    Partition() : power(files), format(FORMAT_NONE) {}
+
+    MemoryFS files;
+    PowerFS power;
+    enum partitionFormat format;
+};
+
+class FlashStorage : public StorageBackend
+{
+public:
+    FlashStorage(const char *label, Partition &partition, enum partitionFormat format)
+        : label(label), partition(partition), format(format)
+    {
+    }
+
+    const char *name() const { return label; }
+
+    // the old file system is erased first, a reset in between leaves neither
+    bool mount(bool format)
+    {
+        if (partition.format == this->format)
+        {
+            return true;
+        }
+        if (!format || !spend())
+        {
+            return false;
+        }
+        partition.files.clear();
+        partition.format = FORMAT_NONE;
+        if (!spend())
+        {
+            return false;
+        }
+        partition.format = this->format;
+        return true;
+    }
+
+    void unmount() {}
+    fs::FS &fs() { return partition.power; }
+
+private:
+    const char *label;
+    Partition &partition;
+    enum partitionFormat format;
+};
+
+class CardStorage : public StorageBackend
+{
+public:
+    CardStorage() : present(true), power(files) {}
+
+    const char *name() const { return "card"; }
+    bool mount(bool /* format */) { return present; }
+    void unmount() {}
+    fs::FS &fs() { return power; }
+
+    bool present;
+    MemoryFS files;
+
+private:
+    PowerFS power;
+};
+
+class StringPrint : public Print
+{
+public:
+    size_t write(const uint8_t *buffer, size_t size)
+    {
+        text.append((const char *)buffer, size);
+        return size;
+    }
+
+    std::string text;
+};
+
+static uint8_t settingsByte(const struct settingsFile *file, size_t i)
+{
+    return (uint8_t)(i * 7 + strlen(file->path));
+}
+
+static void writeSettings(fs::FS &fs)
+{
+    for (const struct settingsFile &setting : settings)
+    {
+        File file = fs.open(setting.path, FILE_WRITE);
+        for (size_t i = 0; i < setting.size; i++)
+        {
+            uint8_t byte = settingsByte(&setting, i);
+            TEST_ASSERT_EQUAL(1, file.write(&byte, 1));
+        }
+        file.close();
+    }
+}
+
+static void assertSettings(fs::FS &fs)
+{
+    uint8_t data[1024];
+
+    for (const struct settingsFile &setting : settings)
+    {
+        File file = fs.open(setting.path, FILE_READ);
+        TEST_ASSERT_TRUE_MESSAGE(file, setting.path);
+        TEST_ASSERT_EQUAL_MESSAGE(setting.size, file.size(), setting.path);
+        TEST_ASSERT_EQUAL(setting.size, file.read(data, sizeof(data)));
+        for (size_t i = 0; i < setting.size; i++)
+        {
+            TEST_ASSERT_EQUAL_UINT8_MESSAGE(settingsByte(&setting, i), data[i], setting.path);
+        }
+        file.close();
+    }
+}
+
+// nothing of the move is left on the card, the data log is untouched
+static void assertCardClean(CardStorage &card)
+{
+    File root = card.files.open("/");
+    uint8_t files = 0;
+
+    for (File file = root.openNextFile(); file; file = root.openNextFile())
+    {
+        TEST_ASSERT_EQUAL_STRING("/log.bin", file.path());
+        files++;
+    }
+    TEST_ASSERT_EQUAL(1, files);
+}
+
+static void prepare(Partition &partition, CardStorage &card)
+{
+    partition.format = FORMAT_SPIFFS;
+    writeSettings(partition.files);
+    File log = card.files.open("/log.bin", FILE_WRITE);
+    log.write((const uint8_t *)"CO2L", 4);
+    log.close();
+}
+
+void setUp(void)
+{
+    budget = -1;
+    failReads = false;
+    Serial.muted = true;
+}
+
+void tearDown(void)
+{
+    Serial.muted = false;
+}
+
+static void test_settings_move_to_the_new_file_system(void)
+{
+    Partition partition;
+    CardStorage card;
+    FlashStorage littleFs("LittleFS", partition, FORMAT_LITTLEFS);
+    FlashStorage spiffs("SPIFFS", partition, FORMAT_SPIFFS);
+    MemoryStorage scratch;
+
+    prepare(partition, card);
+    TEST_ASSERT_EQUAL_PTR(&littleFs, &mountStorage(littleFs, spiffs, scratch, &card));
+    TEST_ASSERT_EQUAL(FORMAT_LITTLEFS, partition.format);
+    assertSettings(littleFs.fs());
+    assertCardClean(card);
+
+    // the next start mounts it as it is
+    TEST_ASSERT_EQUAL_PTR(&littleFs, &mountStorage(littleFs, spiffs, scratch, &card));
+    assertSettings(littleFs.fs());
+}
+
+/* the power is lost after every change to the flash or the card in turn, then the device starts again */
+static void test_a_reset_anywhere_keeps_the_settings(void)
+{
+    int32_t resets;
+    char line[80];
+
+    for (resets = 0;; resets++)
+    {
+        Partition partition;
+        CardStorage card;
+        FlashStorage littleFs("LittleFS", partition, FORMAT_LITTLEFS);
+        FlashStorage spiffs("SPIFFS", partition, FORMAT_SPIFFS);
+        MemoryStorage scratch;
+
+        prepare(partition, card);
+        budget = resets;
+        StorageBackend &interrupted = mountStorage(littleFs, spiffs, scratch, &card);
+        bool completed = budget > 0;
+        budget = -1;
+        // until the reset, the settings are used from wherever they are
+        assertSettings(interrupted.fs());
+
+        TEST_ASSERT_EQUAL_PTR(&littleFs, &mountStorage(littleFs, spiffs, scratch, &card));
+        TEST_ASSERT_EQUAL(FORMAT_LITTLEFS, partition.format);
+        assertSettings(littleFs.fs());
+        assertCardClean(card);
+        if (completed)
+        {
+            break;
+        }
+    }
+
+    snprintf(line, sizeof(line), "a reset after each of %d changes of the move", (int)resets);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_GREATER_THAN(10, resets);
+}
+
+static void test_without_a_card_the_partition_stays(void)
+{
+    Partition partition;
+    CardStorage card;
+    FlashStorage littleFs("LittleFS", partition, FORMAT_LITTLEFS);
+    FlashStorage spiffs("SPIFFS", partition, FORMAT_SPIFFS);
+    MemoryStorage scratch;
+
+    prepare(partition, card);
+    card.present = false;
+    TEST_ASSERT_EQUAL_PTR(&spiffs, &mountStorage(littleFs, spiffs, scratch, &card));
+    TEST_ASSERT_EQUAL_PTR(&spiffs, &mountStorage(littleFs, spiffs, scratch, NULL));
+    TEST_ASSERT_EQUAL(FORMAT_SPIFFS, partition.format);
+    assertSettings(spiffs.fs());
+
+    card.present = true;
+    TEST_ASSERT_EQUAL_PTR(&littleFs, &mountStorage(littleFs, spiffs, scratch, &card));
+    assertSettings(littleFs.fs());
+}
+
+/* a file which cannot be read to its end keeps the partition from being formatted */
+static void test_read_errors_fail_the_copy(void)
+{
+    Partition partition;
+    CardStorage card;
+    FlashStorage littleFs("LittleFS", partition, FORMAT_LITTLEFS);
+    FlashStorage spiffs("SPIFFS", partition, FORMAT_SPIFFS);
+    MemoryStorage scratch;
+
+    prepare(partition, card);
+    failReads = true;
+    TEST_ASSERT_FALSE(copyStorage(spiffs.fs(), "/", scratch.fs(), "/"));
+    TEST_ASSERT_EQUAL_PTR(&spiffs, &mountStorage(littleFs, spiffs, scratch, &card));
+    TEST_ASSERT_EQUAL(FORMAT_SPIFFS, partition.format);
+
+    failReads = false;
+    TEST_ASSERT_TRUE(copyStorage(spiffs.fs(), "/", scratch.fs(), "/"));
+    assertSettings(scratch.fs());
+}
+
+static void test_benchmark_reports_latency_and_wear(void)
+{
+    MemoryStorage memory;
+    StringPrint out;
+
+    memory.mount(true);
+    benchmarkStorage(out, memory);
+    TEST_MESSAGE(out.text.c_str());
+    TEST_ASSERT_NOT_NULL(strstr(out.text.c_str(), "memory open "));
+    TEST_ASSERT_NOT_NULL(strstr(out.text.c_str(), "memory erased/written per append 0/0 rewrite 0/0"));
+    TEST_ASSERT_FALSE(memory.fs().exists(STORAGE_BENCH_FILENAME));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_settings_move_to_the_new_file_system);
+    RUN_TEST(test_a_reset_anywhere_keeps_the_settings);
+    RUN_TEST(test_without_a_card_the_partition_stays);
+    RUN_TEST(test_read_errors_fail_the_copy);
+    RUN_TEST(test_benchmark_reports_latency_and_wear);
+    return UNITY_END();
+}
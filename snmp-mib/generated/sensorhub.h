@@ -1,24 +0,0 @@
-/*
-Generated by LwipMibCompiler
-*/
-
-#ifndef SENSORHUB_H
-#define SENSORHUB_H SENSORHUB_H
-
-#include "lwip/apps/snmp_opts.h"
-#if LWIP_SNMP
-
-#ifdef __cplusplus
-extern "C" {
-#endif /* __cplusplus */
-
-#include "lwip/apps/snmp_core.h"
-
-extern const struct snmp_mib sensorhubmib;
-
-#ifdef __cplusplus
-}
-#endif /* __cplusplus */
-
-#endif /* LWIP_SNMP */
-#endif /* SENSORHUB_H */